@@ -241,7 +241,6 @@ static int
 create_context(struct netbe_lcore *lc, const struct tle_ctx_param *ctx_prm)
 {
 	uint32_t rc = 0, sid;
-	uint64_t frag_cycles;
 	struct tle_ctx_param cprm;
 
 	if (lc->ctx == NULL) {
@@ -264,22 +263,18 @@ create_context(struct netbe_lcore *lc, const struct tle_ctx_param *ctx_prm)
 			cprm.secret_key.u64[1] = rte_rand();
 		}
 
-		frag_cycles = (rte_get_tsc_hz() + MS_PER_S - 1) /
-						MS_PER_S * FRAG_TTL;
-
-		lc->ftbl = rte_ip_frag_table_create(cprm.max_streams,
-			FRAG_TBL_BUCKET_ENTRIES, cprm.max_streams,
-			frag_cycles, sid);
-
-		RTE_LOG(NOTICE, USER1, "%s(lcore=%u): frag_tbl=%p;\n",
-			__func__, lc->id, lc->ftbl);
+		/* IP fragments are reassembled by the UDP context itself. */
+		if (lc->proto == TLE_PROTO_UDP) {
+			cprm.frag_tbl_size = cprm.max_streams;
+			cprm.frag_tmo = FRAG_TTL;
+		}
 
 		lc->ctx = tle_ctx_create(&cprm);
 
 		RTE_LOG(NOTICE, USER1, "%s(lcore=%u): proto=%s, ctx=%p;\n",
 			__func__, lc->id, proto_name[lc->proto], lc->ctx);
 
-		if (lc->ctx == NULL || lc->ftbl == NULL)
+		if (lc->ctx == NULL)
 			rc = ENOMEM;
 	}
 
@@ -325,7 +320,6 @@ lcore_init(struct netbe_lcore *lc, const struct tle_ctx_param *ctx_prm,
 				"%s(lcore=%u) failed with error code: %d\n",
 				__func__, lc->id, rc);
 			tle_ctx_destroy(lc->ctx);
-			rte_ip_frag_table_destroy(lc->ftbl);
 			rte_lpm_free(lc->lpm4);
 			rte_lpm6_free(lc->lpm6);
 			rte_free(lc->prtq[prtqid].port.lcore_id);
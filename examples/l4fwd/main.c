@@ -29,7 +29,6 @@
 
 #define FRAG_MBUF_BUF_SIZE	(RTE_PKTMBUF_HEADROOM + TLE_DST_MAX_HDR)
 #define FRAG_TTL		MS_PER_S
-#define	FRAG_TBL_BUCKET_ENTRIES	16
 
 #define	FIRST_PORT	0x8000
 
@@ -97,7 +96,6 @@ netbe_lcore_fini(struct netbe_cfg *cfg)
 
 	for (i = 0; i != cfg->cpu_num; i++) {
 		tle_ctx_destroy(cfg->cpu[i].ctx);
-		rte_ip_frag_table_destroy(cfg->cpu[i].ftbl);
 		rte_lpm_free(cfg->cpu[i].lpm4);
 		rte_lpm6_free(cfg->cpu[i].lpm6);
 
@@ -130,7 +130,6 @@ struct netbe_lcore {
 	uint32_t proto; /**< L4 proto to handle. */
 	struct rte_lpm *lpm4;
 	struct rte_lpm6 *lpm6;
-	struct rte_ip_frag_tbl *ftbl;
 	struct tle_ctx *ctx;
 	uint32_t prtq_num;
 	uint32_t dst4_num;
@@ -138,7 +137,6 @@ struct netbe_lcore {
 	struct netbe_dev *prtq;
 	struct tle_dest dst4[LCORE_MAX_DST];
 	struct tle_dest dst6[LCORE_MAX_DST];
-	struct rte_ip_frag_death_row death_row;
 	struct {
 		uint64_t flags[UINT8_MAX + 1];
 	} tcp_stat;
@@ -176,11 +176,6 @@ get_ipv6x_hdr_len(struct rte_mbuf *m, uint32_t l2, uint32_t nproto,
 			ofs = (ipx->ip6e_len + 2) << 2;
 			break;
 		case IPPROTO_FRAGMENT:
-			/*
-			 * tso_segsz is not used by RX, so use it as temporary
-			 * buffer to store the fragment offset.
-			 */
-			m->tso_segsz = ofs;
 			ofs = sizeof(struct ip6_frag);
 			m->packet_type &= ~RTE_PTYPE_L4_MASK;
 			m->packet_type |= RTE_PTYPE_L4_FRAG;
@@ -395,96 +390,6 @@ fill_eth_udp_hdr_len(struct rte_mbuf *m)
 		m->packet_type = RTE_PTYPE_UNKNOWN;
 }
 
-static inline uint16_t
-ipv4x_cksum(const void *iph, size_t len)
-{
-	uint16_t cksum;
-
-	cksum = rte_raw_cksum(iph, len);
-	return (cksum == 0xffff) ? cksum : ~cksum;
-}
-
-static inline void
-fix_reassembled(struct rte_mbuf *m, int32_t hwcsum, uint32_t proto)
-{
-	struct rte_ipv4_hdr *iph;
-
-	/* update packet type. */
-	m->packet_type &= ~RTE_PTYPE_L4_MASK;
-
-	if (proto == IPPROTO_TCP)
-		m->packet_type |= RTE_PTYPE_L4_TCP;
-	else
-		m->packet_type |= RTE_PTYPE_L4_UDP;
-
-	/* fix reassemble setting TX flags. */
-	m->ol_flags &= ~RTE_MBUF_F_TX_IP_CKSUM;
-
-	/* fix l3_len after reassemble. */
-	if (RTE_ETH_IS_IPV6_HDR(m->packet_type))
-		m->l3_len = m->l3_len - sizeof(struct ipv6_extension_fragment);
-
-	/* recalculate ipv4 cksum after reassemble. */
-	else if (hwcsum == 0 && RTE_ETH_IS_IPV4_HDR(m->packet_type)) {
-		iph = rte_pktmbuf_mtod_offset(m, struct rte_ipv4_hdr *,
-			m->l2_len);
-		iph->hdr_checksum = ipv4x_cksum(iph, m->l3_len);
-	}
-}
-
-static struct rte_mbuf *
-reassemble(struct rte_mbuf *m, struct netbe_lcore *lc, uint64_t tms,
-	dpdk_port_t port, uint32_t proto)
-{
-	uint32_t l3cs;
-	struct rte_ip_frag_tbl *tbl;
-	struct rte_ip_frag_death_row *dr;
-
-	tbl = lc->ftbl;
-	dr = &lc->death_row;
-	l3cs = lc->prtq[port].port.rx_offload & DEV_RX_OFFLOAD_IPV4_CKSUM;
-
-	if (RTE_ETH_IS_IPV4_HDR(m->packet_type)) {
-
-		struct rte_ipv4_hdr *iph;
-
-		iph = rte_pktmbuf_mtod_offset(m, struct rte_ipv4_hdr *,
-			m->l2_len);
-
-		/* process this fragment. */
-		m = rte_ipv4_frag_reassemble_packet(tbl, dr, m, tms, iph);
-
-	} else if (RTE_ETH_IS_IPV6_HDR(m->packet_type)) {
-
-		struct rte_ipv6_hdr *iph;
-		struct ipv6_extension_fragment *fhdr;
-
-		iph = rte_pktmbuf_mtod_offset(m, struct rte_ipv6_hdr *,
-			m->l2_len);
-
-		/*
-		 * we store fragment header offset in tso_segsz before
-		 * temporary, just to avoid another scan of ipv6 header.
-		 */
-		fhdr = rte_pktmbuf_mtod_offset(m,
-			struct ipv6_extension_fragment *, m->tso_segsz);
-		m->tso_segsz = 0;
-
-		/* process this fragment. */
-		m = rte_ipv6_frag_reassemble_packet(tbl, dr, m, tms, iph, fhdr);
-
-	} else {
-		rte_pktmbuf_free(m);
-		m = NULL;
-	}
-
-	/* got reassembled packet. */
-	if (m != NULL)
-		fix_reassembled(m, l3cs, proto);
-
-	return m;
-}
-
 /* exclude NULLs from the final list of packets. */
 static inline uint32_t
 compress_pkt_list(struct rte_mbuf *pkt[], uint32_t nb_pkt, uint32_t nb_zero)
@@ -512,21 +417,6 @@ compress_pkt_list(struct rte_mbuf *pkt[], uint32_t nb_pkt, uint32_t nb_zero)
 	return nb_pkt;
 }
 
-/*
- * if it is a fragment, try to reassemble it,
- * if by some reason it can't be done, then
- * set pkt[] entry to NULL.
- */
-#define DO_REASSEMBLE(proto) \
-do { \
-	if ((pkt[j]->packet_type & RTE_PTYPE_L4_MASK) == \
-			RTE_PTYPE_L4_FRAG) { \
-		cts = (cts == 0) ? rte_rdtsc() : cts; \
-		pkt[j] = reassemble(pkt[j], lc, cts, port, (proto)); \
-		x += (pkt[j] == NULL); \
-	} \
-} while (0)
-
 /*
  * HW can recognize L2/L3 with/without extensions/L4 (ixgbe/igb/fm10k)
  */
@@ -600,21 +490,16 @@ type0_tcp_rx_callback(__rte_unused dpdk_port_t port,
  * HW can recognize L2/L3 with/without extensions/L4 (ixgbe/igb/fm10k)
  */
 static uint16_t
-type0_udp_rx_callback(dpdk_port_t port, __rte_unused uint16_t queue,
-	struct rte_mbuf *pkt[], uint16_t nb_pkts,
-	__rte_unused uint16_t max_pkts, void *user_param)
+type0_udp_rx_callback(__rte_unused dpdk_port_t port,
+	__rte_unused uint16_t queue, struct rte_mbuf *pkt[], uint16_t nb_pkts,
+	__rte_unused uint16_t max_pkts, __rte_unused void *user_param)
 {
-	uint32_t j, tp, x;
-	uint64_t cts;
-	struct netbe_lcore *lc;
+	uint32_t j, tp;
 	uint32_t l2_len;
 	const struct rte_ether_hdr *eth;
 
-	lc = user_param;
-	cts = 0;
 	l2_len = sizeof(*eth);
 
-	x = 0;
 	for (j = 0; j != nb_pkts; j++) {
 
 		NETBE_PKT_DUMP(pkt[j]);
@@ -664,22 +549,9 @@ type0_udp_rx_callback(dpdk_port_t port, __rte_unused uint16_t queue,
 			pkt[j]->packet_type = RTE_PTYPE_UNKNOWN;
 			break;
 		}
-
-		DO_REASSEMBLE(IPPROTO_UDP);
 	}
 
-	/* reassemble was invoked, cleanup its death-row. */
-	if (cts != 0)
-		rte_ip_frag_free_death_row(&lc->death_row, 0);
-
-	if (x == 0)
-		return nb_pkts;
-
-	NETBE_TRACE("%s(port=%u, queue=%u, nb_pkts=%u): "
-		"%u non-reassembled fragments;\n",
-		__func__, port, queue, nb_pkts, x);
-
-	return compress_pkt_list(pkt, nb_pkts, x);
+	return nb_pkts;
 }
 
 /*
@@ -741,21 +613,16 @@ type1_tcp_rx_callback(__rte_unused dpdk_port_t port,
  * HW can recognize L2/L3/L4 and fragments (i40e).
  */
 static uint16_t
-type1_udp_rx_callback(dpdk_port_t port, __rte_unused uint16_t queue,
-	struct rte_mbuf *pkt[], uint16_t nb_pkts,
-	__rte_unused uint16_t max_pkts, void *user_param)
+type1_udp_rx_callback(__rte_unused dpdk_port_t port,
+	__rte_unused uint16_t queue, struct rte_mbuf *pkt[], uint16_t nb_pkts,
+	__rte_unused uint16_t max_pkts, __rte_unused void *user_param)
 {
-	uint32_t j, tp, x;
-	uint64_t cts;
-	struct netbe_lcore *lc;
+	uint32_t j, tp;
 	uint32_t l2_len;
 	const struct rte_ether_hdr *eth;
 
-	lc = user_param;
-	cts = 0;
 	l2_len = sizeof(*eth);
 
-	x = 0;
 	for (j = 0; j != nb_pkts; j++) {
 
 		NETBE_PKT_DUMP(pkt[j]);
@@ -789,22 +656,9 @@ type1_udp_rx_callback(dpdk_port_t port, __rte_unused uint16_t queue,
 			pkt[j]->packet_type = RTE_PTYPE_UNKNOWN;
 			break;
 		}
-
-		DO_REASSEMBLE(IPPROTO_UDP);
 	}
 
-	/* reassemble was invoked, cleanup its death-row. */
-	if (cts != 0)
-		rte_ip_frag_free_death_row(&lc->death_row, 0);
-
-	if (x == 0)
-		return nb_pkts;
-
-	NETBE_TRACE("%s(port=%u, queue=%u, nb_pkts=%u): "
-		"%u non-reassembled fragments;\n",
-		__func__, port, queue, nb_pkts, x);
-
-	return compress_pkt_list(pkt, nb_pkts, x);
+	return nb_pkts;
 }
 
 /*
@@ -859,38 +713,19 @@ typen_tcp_rx_callback(__rte_unused dpdk_port_t port,
 }
 
 static uint16_t
-typen_udp_rx_callback(dpdk_port_t port, __rte_unused uint16_t queue,
-	struct rte_mbuf *pkt[], uint16_t nb_pkts,
-	__rte_unused uint16_t max_pkts, void *user_param)
+typen_udp_rx_callback(__rte_unused dpdk_port_t port,
+	__rte_unused uint16_t queue, struct rte_mbuf *pkt[], uint16_t nb_pkts,
+	__rte_unused uint16_t max_pkts, __rte_unused void *user_param)
 {
-	uint32_t j, x;
-	uint64_t cts;
-	struct netbe_lcore *lc;
-
-	lc = user_param;
-	cts = 0;
+	uint32_t j;
 
-	x = 0;
 	for (j = 0; j != nb_pkts; j++) {
 
 		NETBE_PKT_DUMP(pkt[j]);
 		fill_eth_udp_hdr_len(pkt[j]);
-
-		DO_REASSEMBLE(IPPROTO_UDP);
 	}
 
-	/* reassemble was invoked, cleanup its death-row. */
-	if (cts != 0)
-		rte_ip_frag_free_death_row(&lc->death_row, 0);
-
-	if (x == 0)
-		return nb_pkts;
-
-	NETBE_TRACE("%s(port=%u, queue=%u, nb_pkts=%u): "
-		"%u non-reassembled fragments;\n",
-		__func__, port, queue, nb_pkts, x);
-
-	return compress_pkt_list(pkt, nb_pkts, x);
+	return nb_pkts;
 }
 
 static uint32_t
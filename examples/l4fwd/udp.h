@@ -381,11 +381,11 @@ netfe_fwd_udp(uint32_t lcore, struct netfe_stream *fes)
 static inline void
 netfe_rxtx_process_udp(__rte_unused uint32_t lcore, struct netfe_stream *fes)
 {
-	uint32_t i, j, k, n;
+	uint32_t i, j, n;
 	uint16_t family;
-	void *pi0, *pi1, *pt;
 	struct rte_mbuf **pkt;
-	struct sockaddr_storage in[2];
+	struct sockaddr_storage in[RTE_DIM(fes->pbuf.pkt)];
+	const struct sockaddr *pi[RTE_DIM(fes->pbuf.pkt)];
 
 	family = fes->family;
 	n = fes->pbuf.num;
@@ -398,41 +398,19 @@ netfe_rxtx_process_udp(__rte_unused uint32_t lcore, struct netfe_stream *fes)
 		return;
 	}
 
-	in[0].ss_family = family;
-	in[1].ss_family = family;
-	pi0 = &in[0];
-	pi1 = &in[1];
-
-	netfe_pkt_addr(pkt[0], pi0, family);
-
-	for (i = 0; i != n; i = j) {
-
-		j = i + pkt_eq_addr(&pkt[i + 1],
-			n - i - 1, family, pi0, pi1) + 1;
-
-		/**
-		 * TODO: cannot use function pointers for unequal param num.
-		 */
-		k = tle_udp_stream_send(fes->s, pkt + i, j - i,
-			(const struct sockaddr *)pi0);
-
-		NETFE_TRACE("%s(%u): tle_%s_stream_send(%p, %u) returns %u\n",
-			__func__, lcore, proto_name[fes->proto],
-			fes->s, j - i, k);
-		fes->stat.txp += k;
-		fes->stat.drops += j - i - k;
-
-		i += k;
+	/* reply to each packet's source. */
+	for (i = 0; i != n; i++) {
+		in[i].ss_family = family;
+		netfe_pkt_addr(pkt[i], in + i, family);
+		pi[i] = (const struct sockaddr *)(in + i);
+	}
 
-		/* stream send buffer is full */
-		if (i != j)
-			break;
+	i = tle_udp_stream_send_multi(fes->s, pkt, n, pi);
 
-		/* swap the pointers */
-		pt = pi0;
-		pi0 = pi1;
-		pi1 = pt;
-	}
+	NETFE_TRACE("%s(%u): tle_%s_stream_send_multi(%p, %u) returns %u\n",
+		__func__, lcore, proto_name[fes->proto], fes->s, n, i);
+	fes->stat.txp += i;
+	fes->stat.drops += n - i;
 
 	/* not able to send anything. */
 	if (i == 0)
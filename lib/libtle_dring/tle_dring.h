@@ -23,6 +23,8 @@
 #include <rte_memory.h>
 #include <rte_ring.h>
 #include <rte_debug.h>
+#include <rte_prefetch.h>
+#include <rte_vect.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -93,6 +95,56 @@ tle_dring_count(const struct tle_dring *dr)
 /*
  * helper routine, to copy objects to/from the ring.
  */
+#if defined(RTE_ARCH_X86_64) && defined(__AVX512F__)
+
+/* 8 pointers per 512-bit register, tail is copied with masked ops. */
+static inline void __attribute__((always_inline))
+__tle_dring_copy_objs(const void *dst[], const void * const src[], uint32_t num)
+{
+	uint32_t i;
+	__m512i v;
+	__mmask8 m;
+
+	for (i = 0; i != RTE_ALIGN_FLOOR(num, 8); i += 8) {
+		v = _mm512_loadu_si512((const void *)(src + i));
+		_mm512_storeu_si512((void *)(dst + i), v);
+	}
+
+	if (i != num) {
+		m = (1 << (num - i)) - 1;
+		v = _mm512_maskz_loadu_epi64(m, src + i);
+		_mm512_mask_storeu_epi64(dst + i, m, v);
+	}
+}
+
+#elif defined(RTE_ARCH_X86_64) && defined(__AVX2__)
+
+/* 4 pointers per 256-bit register. */
+static inline void __attribute__((always_inline))
+__tle_dring_copy_objs(const void *dst[], const void * const src[], uint32_t num)
+{
+	uint32_t i;
+	__m256i v;
+
+	for (i = 0; i != RTE_ALIGN_FLOOR(num, 4); i += 4) {
+		v = _mm256_loadu_si256((const __m256i *)(src + i));
+		_mm256_storeu_si256((__m256i *)(dst + i), v);
+	}
+
+	switch (num % 4) {
+	case 3:
+		dst[i + 2] = src[i + 2];
+		/* fallthrough */
+	case 2:
+		dst[i + 1] = src[i + 1];
+		/* fallthrough */
+	case 1:
+		dst[i] = src[i];
+	}
+}
+
+#else
+
 static inline void __attribute__((always_inline))
 __tle_dring_copy_objs(const void *dst[], const void * const src[], uint32_t num)
 {
@@ -116,6 +168,25 @@ __tle_dring_copy_objs(const void *dst[], const void * const src[], uint32_t num)
 	}
 }
 
+#endif
+
+/*
+ * helper routine, to prefetch header and first objects of the drb
+ * that follows the given one. Pointer to the next drb might be not
+ * set yet (or stale), that is harmless for prefetch.
+ */
+static inline void __attribute__((always_inline))
+__tle_dring_prefetch_next(const struct tle_drb *pb)
+{
+	const struct tle_drb *nb;
+
+	nb = pb->next;
+	if (nb != NULL) {
+		rte_prefetch0(nb);
+		rte_prefetch0((const uint8_t *)nb + RTE_CACHE_LINE_SIZE);
+	}
+}
+
 /*
  * helper routine, to enqueue objects into the ring.
  */
@@ -311,6 +382,8 @@ __tle_dring_dequeue(struct tle_dring *dr, uint32_t head,
 	/* copy from the current consumer block */
 	if (pb->size != 0) {
 		n = head - pb->start;
+		if (pb->size - n < nb_obj)
+			__tle_dring_prefetch_next(pb);
 		k = RTE_MIN(pb->size - n, nb_obj);
 		__tle_dring_copy_objs(objs, pb->objs + n, k);
 		i += k;
@@ -325,9 +398,11 @@ __tle_dring_dequeue(struct tle_dring *dr, uint32_t head,
 			if (pb != &dr->dummy)
 				drbs[j++] = pb;
 
-			/* proceed to the next block. */
+			/* proceed to the next block, prefetch the one after. */
 			pb = pb->next;
 			k = RTE_MIN(pb->size, nb_obj - i);
+			if (k != nb_obj - i)
+				__tle_dring_prefetch_next(pb);
 			__tle_dring_copy_objs(objs + i, pb->objs, k);
 			i += k;
 		} while (j != nb_drb && i != nb_obj);
@@ -0,0 +1,207 @@
+/*
+ * Copyright (c) 2016  Intel Corporation.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <rte_common.h>
+#include <rte_cpuflags.h>
+#include <rte_vect.h>
+
+#include "cksum.h"
+
+/*
+ * SIMD versions of __raw_cksum().
+ * All of them use the same approach: 16-bit words of the input are
+ * accumulated into 32-bit lanes, and these lanes are periodically
+ * (every CKSUM_SIMD_FLUSH iterations) flushed into 64-bit scalar sum,
+ * so carries never get lost.
+ * The remainder (less then one vector) is handled by the scalar code.
+ * As all vector loads are unaligned, any buffer alignment is supported.
+ */
+
+static uint16_t raw_cksum_select(const uint8_t *buf, uint32_t size);
+
+tle_raw_cksum_t tle_raw_cksum_fn = raw_cksum_select;
+
+uint16_t
+tle_raw_cksum_scalar(const uint8_t *buf, uint32_t size)
+{
+	return __raw_cksum_scalar(buf, size);
+}
+
+#ifdef RTE_ARCH_X86
+
+__attribute__((target("avx2"))) uint16_t
+tle_raw_cksum_avx2(const uint8_t *buf, uint32_t size)
+{
+	uint32_t i, j, k, n;
+	uint64_t s, sum;
+	__m256i acc, msk, v;
+	uint32_t x[sizeof(acc) / sizeof(uint32_t)];
+
+	n = size / sizeof(v);
+	msk = _mm256_set1_epi32(UINT16_MAX);
+	sum = 0;
+
+	for (i = 0; i != n; i += k) {
+
+		k = RTE_MIN(n - i, (uint32_t)CKSUM_SIMD_FLUSH);
+		acc = _mm256_setzero_si256();
+
+		for (j = 0; j != k; j++, buf += sizeof(v)) {
+			v = _mm256_loadu_si256((const __m256i *)buf);
+			acc = _mm256_add_epi32(acc, _mm256_and_si256(v, msk));
+			acc = _mm256_add_epi32(acc, _mm256_srli_epi32(v, 16));
+		}
+
+		/* flush lane accumulators into the 64-bit sum. */
+		_mm256_storeu_si256((__m256i *)x, acc);
+		for (j = 0, s = 0; j != RTE_DIM(x); j++)
+			s += x[j];
+		CKSUM_ADD_CARRY(sum, s);
+	}
+
+	s = __raw_cksum_scalar(buf, size % sizeof(v));
+	CKSUM_ADD_CARRY(sum, s);
+	return __cksum_reduce64(sum);
+}
+
+__attribute__((target("avx512f"))) uint16_t
+tle_raw_cksum_avx512(const uint8_t *buf, uint32_t size)
+{
+	uint32_t i, j, k, n;
+	uint64_t s, sum;
+	__m512i acc, msk, v;
+	uint32_t x[sizeof(acc) / sizeof(uint32_t)];
+
+	n = size / sizeof(v);
+	msk = _mm512_set1_epi32(UINT16_MAX);
+	sum = 0;
+
+	for (i = 0; i != n; i += k) {
+
+		k = RTE_MIN(n - i, (uint32_t)CKSUM_SIMD_FLUSH);
+		acc = _mm512_setzero_si512();
+
+		for (j = 0; j != k; j++, buf += sizeof(v)) {
+			v = _mm512_loadu_si512((const void *)buf);
+			acc = _mm512_add_epi32(acc, _mm512_and_si512(v, msk));
+			acc = _mm512_add_epi32(acc, _mm512_srli_epi32(v, 16));
+		}
+
+		/* flush lane accumulators into the 64-bit sum. */
+		_mm512_storeu_si512((void *)x, acc);
+		for (j = 0, s = 0; j != RTE_DIM(x); j++)
+			s += x[j];
+		CKSUM_ADD_CARRY(sum, s);
+	}
+
+	s = __raw_cksum_scalar(buf, size % sizeof(v));
+	CKSUM_ADD_CARRY(sum, s);
+	return __cksum_reduce64(sum);
+}
+
+#endif /* RTE_ARCH_X86 */
+
+#ifdef RTE_ARCH_ARM64
+
+uint16_t
+tle_raw_cksum_neon(const uint8_t *buf, uint32_t size)
+{
+	uint32_t i, j, k, n;
+	uint64_t s, sum;
+	uint32x4_t acc;
+	uint64x2_t acc64;
+	uint16x8_t v;
+
+	n = size / sizeof(v);
+	sum = 0;
+
+	for (i = 0; i != n; i += k) {
+
+		k = RTE_MIN(n - i, (uint32_t)CKSUM_SIMD_FLUSH);
+		acc = vdupq_n_u32(0);
+
+		/* pairwise add 16-bit words into 32-bit lanes. */
+		for (j = 0; j != k; j++, buf += sizeof(v)) {
+			v = vreinterpretq_u16_u8(vld1q_u8(buf));
+			acc = vpadalq_u16(acc, v);
+		}
+
+		/* flush lane accumulators into the 64-bit sum. */
+		acc64 = vpadalq_u32(vdupq_n_u64(0), acc);
+		s = vgetq_lane_u64(acc64, 0) + vgetq_lane_u64(acc64, 1);
+		CKSUM_ADD_CARRY(sum, s);
+	}
+
+	s = __raw_cksum_scalar(buf, size % sizeof(v));
+	CKSUM_ADD_CARRY(sum, s);
+	return __cksum_reduce64(sum);
+}
+
+#endif /* RTE_ARCH_ARM64 */
+
+int
+tle_raw_cksum_supported(tle_raw_cksum_t fn)
+{
+	if (fn == tle_raw_cksum_scalar)
+		return 1;
+#ifdef RTE_ARCH_X86
+	if (fn == tle_raw_cksum_avx512)
+		return rte_cpu_get_flag_enabled(RTE_CPUFLAG_AVX512F) > 0 &&
+			rte_vect_get_max_simd_bitwidth() >= RTE_VECT_SIMD_512;
+	if (fn == tle_raw_cksum_avx2)
+		return rte_cpu_get_flag_enabled(RTE_CPUFLAG_AVX2) > 0 &&
+			rte_vect_get_max_simd_bitwidth() >= RTE_VECT_SIMD_256;
+#endif
+#ifdef RTE_ARCH_ARM64
+	if (fn == tle_raw_cksum_neon)
+		return rte_vect_get_max_simd_bitwidth() >= RTE_VECT_SIMD_128;
+#endif
+	return 0;
+}
+
+/*
+ * Selected lazily on first use, as max SIMD bitwidth
+ * is not known until EAL is initialised.
+ * Concurrent callers might race here, but all of them would store
+ * the same value, so it is harmless.
+ */
+static uint16_t
+raw_cksum_select(const uint8_t *buf, uint32_t size)
+{
+	uint32_t i;
+	tle_raw_cksum_t fn;
+
+	static const tle_raw_cksum_t impl[] = {
+#ifdef RTE_ARCH_X86
+		tle_raw_cksum_avx512,
+		tle_raw_cksum_avx2,
+#endif
+#ifdef RTE_ARCH_ARM64
+		tle_raw_cksum_neon,
+#endif
+		tle_raw_cksum_scalar,
+	};
+
+	fn = tle_raw_cksum_scalar;
+	for (i = 0; i != RTE_DIM(impl); i++) {
+		if (tle_raw_cksum_supported(impl[i]) != 0) {
+			fn = impl[i];
+			break;
+		}
+	}
+
+	tle_raw_cksum_fn = fn;
+	return fn(buf, size);
+}
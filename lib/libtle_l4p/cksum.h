@@ -0,0 +1,213 @@
+/*
+ * Copyright (c) 2016  Intel Corporation.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _CKSUM_H_
+#define _CKSUM_H_
+
+#include <limits.h>
+#include <stdint.h>
+#include <rte_common.h>
+#include <rte_byteorder.h>
+#include <rte_mbuf.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* make compiler to generate: add %r1, %r2; adc $0, %r1. */
+#define CKSUM_ADD_CARRY(s, v)	do {       \
+	(s) += (v);                        \
+	(s) = ((s) < (v)) ? (s) + 1 : (s); \
+} while (0)
+
+/*
+ * buffers shorter than that are always processed by the scalar code,
+ * as for them indirect call and SIMD setup cost is not worth it.
+ */
+#define CKSUM_SIMD_MIN_LEN	0x100
+
+/*
+ * max number of SIMD iterations before 32-bit lane accumulators
+ * have to be flushed into the 64-bit sum.
+ */
+#define CKSUM_SIMD_FLUSH	0x4000
+
+typedef uint16_t (*tle_raw_cksum_t)(const uint8_t *buf, uint32_t size);
+
+/* currently selected (best available) implementation. */
+extern tle_raw_cksum_t tle_raw_cksum_fn;
+
+/* all available implementations, mainly for testing purposes. */
+uint16_t tle_raw_cksum_scalar(const uint8_t *buf, uint32_t size);
+
+#ifdef RTE_ARCH_X86
+uint16_t tle_raw_cksum_avx2(const uint8_t *buf, uint32_t size);
+uint16_t tle_raw_cksum_avx512(const uint8_t *buf, uint32_t size);
+#endif
+
+#ifdef RTE_ARCH_ARM64
+uint16_t tle_raw_cksum_neon(const uint8_t *buf, uint32_t size);
+#endif
+
+/*
+ * returns zero if given implementation can't be used on that machine.
+ */
+int tle_raw_cksum_supported(tle_raw_cksum_t fn);
+
+/* fold 64-bit sum into 16-bit one's complement sum. */
+static inline uint16_t
+__cksum_reduce64(uint64_t sum)
+{
+	uint32_t dw1, dw2;
+	uint16_t w1, w2;
+
+	dw1 = sum;
+	dw2 = sum >> 32;
+	CKSUM_ADD_CARRY(dw1, dw2);
+	w1 = dw1;
+	w2 = dw1 >> 16;
+	CKSUM_ADD_CARRY(w1, w2);
+	return w1;
+}
+
+/*
+ * RFC 1624 incremental checksum update: HC' = ~(~HC + ~m + m'),
+ * where m and m' are the (non-complemented) sums over old and new
+ * values of the modified fields.
+ */
+static inline uint16_t
+__cksum_adjust(uint16_t hc, uint16_t om, uint16_t nm)
+{
+	uint32_t s;
+
+	s = (uint16_t)~hc;
+	s += (uint16_t)~om;
+	s += nm;
+	s = (s & UINT16_MAX) + (s >> 16);
+	s = (s & UINT16_MAX) + (s >> 16);
+	s = (~s) & UINT16_MAX;
+	return (s == 0) ? UINT16_MAX : s;
+}
+
+/**
+ * Process the non-complemented checksum of a buffer.
+ * Scalar version, consumes 8 bytes per iteration.
+ * @param buf
+ *   Pointer to the buffer.
+ * @param size
+ *   Length of the buffer.
+ * @return
+ *   The non-complemented checksum.
+ */
+static inline uint16_t
+__raw_cksum_scalar(const uint8_t *buf, uint32_t size)
+{
+	uint64_t s, sum;
+	uint32_t i, n;
+	const uint64_t *b;
+
+	b = (const uint64_t *)buf;
+	n = size / sizeof(*b);
+	sum = 0;
+
+	/* main loop, consume 8 bytes per iteration. */
+	for (i = 0; i != n; i++) {
+		s = b[i];
+		CKSUM_ADD_CARRY(sum, s);
+	}
+
+	/* consume the remainder. */
+	n = size % sizeof(*b);
+	if (n != 0) {
+		/* position of the of last 8 bytes of data. */
+		b = (const uint64_t *)((uintptr_t)(b + i) + n - sizeof(*b));
+		/* calculate shift amount. */
+		n = (sizeof(*b) - n) * CHAR_BIT;
+		s = b[0] >> n;
+		CKSUM_ADD_CARRY(sum, s);
+	}
+
+	return __cksum_reduce64(sum);
+}
+
+/**
+ * Process the non-complemented checksum of a buffer.
+ * Similar  to rte_raw_cksum(), but provide better performance
+ * (at least on IA platforms).
+ * For big enough buffers, SIMD implementation selected at runtime is used.
+ * @param buf
+ *   Pointer to the buffer.
+ * @param size
+ *   Length of the buffer.
+ * @return
+ *   The non-complemented checksum.
+ */
+static inline uint16_t
+__raw_cksum(const uint8_t *buf, uint32_t size)
+{
+	if (size < CKSUM_SIMD_MIN_LEN)
+		return __raw_cksum_scalar(buf, size);
+	return tle_raw_cksum_fn(buf, size);
+}
+
+/**
+ * Process UDP or TCP checksum over possibly multi-segmented packet.
+ * @param mb
+ *   The pointer to the mbuf with the packet.
+ * @param l4_ofs
+ *   Offset to the beginning of the L4 header (should be in first segment).
+ * @param cksum
+ *   Already pre-calculated pseudo-header checksum value.
+ * @return
+ *   The complemented checksum.
+ */
+static inline uint32_t
+__udptcp_mbuf_cksum(const struct rte_mbuf *mb, uint16_t l4_ofs,
+	uint32_t cksum)
+{
+	uint32_t dlen, i, plen, odd;
+	uint16_t s;
+	const struct rte_mbuf *ms;
+	const void *data;
+
+	plen = rte_pktmbuf_pkt_len(mb);
+	ms = mb;
+	odd = 0;
+
+	for (i = l4_ofs; i < plen && ms != NULL; i += dlen) {
+		data = rte_pktmbuf_mtod_offset(ms, const void *, l4_ofs);
+		dlen = rte_pktmbuf_data_len(ms) - l4_ofs;
+		s = __raw_cksum(data, dlen);
+		/* segment starts at odd offset, its bytes are swapped. */
+		cksum += (odd != 0) ? rte_bswap16(s) : s;
+		odd ^= dlen & 1;
+		ms = ms->next;
+		l4_ofs = 0;
+	}
+
+	cksum = ((cksum & 0xffff0000) >> 16) + (cksum & 0xffff);
+	cksum = ((cksum & 0xffff0000) >> 16) + (cksum & 0xffff);
+	cksum = (~cksum) & 0xffff;
+	if (cksum == 0)
+		cksum = 0xffff;
+
+	return cksum;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _CKSUM_H_ */
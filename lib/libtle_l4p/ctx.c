@@ -13,6 +13,7 @@
  * limitations under the License.
  */
 
+#include <stdio.h>
 #include <string.h>
 #include <rte_malloc.h>
 #include <rte_errno.h>
@@ -22,6 +23,7 @@
 
 #include "stream.h"
 #include "misc.h"
+#include "rlim.h"
 #include "halfsiphash.h"
 
 #define	LPORT_START	0x8000
@@ -73,12 +75,136 @@ check_ctx_prm(const struct tle_ctx_param *prm)
 	return 0;
 }
 
+/* caclulate closest shift to convert from cycles to ms (approximate) */
+static uint32_t
+calc_cycles_ms_shift(void)
+{
+	uint64_t ms;
+
+	ms = (rte_get_tsc_hz() + MS_PER_S - 1) / MS_PER_S;
+	return sizeof(ms) * CHAR_BIT - __builtin_clzll(ms) - 1;
+}
+
+/* deferred callback queue: up to STREAM_CB_NUM entries per stream. */
+static struct rte_ring *
+cbq_create(const struct tle_ctx *ctx)
+{
+	uint32_t n, flags;
+	struct rte_ring *r;
+	const struct tle_ctx_param *prm;
+	char name[RTE_RING_NAMESIZE];
+
+	prm = &ctx->prm;
+	n = rte_align32pow2(prm->max_streams * STREAM_CB_NUM + 1);
+	flags = ((prm->flags & TLE_CTX_FLAG_ST) == 0) ? 0 : RING_F_SP_ENQ;
+
+	snprintf(name, sizeof(name), "cbq@%p", ctx);
+	r = rte_ring_create_elem(name, sizeof(struct stream_cbe), n,
+		prm->socket_id, flags);
+	if (r == NULL)
+		UDP_LOG(ERR, "%s(%s, size=%u, socket=%d) failed "
+			"with error code: %d\n",
+			__func__, name, n, prm->socket_id, rte_errno);
+	return r;
+}
+
+/* number of drbs in per lcore cache of the drb pool. */
+#define	DRB_CACHE_SIZE	0x40
+
+/* at most that part of the user sized drb pool is kept for TCP control. */
+#define	DRB_CTL_RESV_DIV	4
+
+static void
+drb_init(struct rte_mempool *mp, void *arg, void *obj, unsigned int idx)
+{
+	struct tle_drb *drb;
+
+	RTE_SET_USED(idx);
+
+	drb = obj;
+	memset(drb, 0, mp->elt_size);
+	drb->size = (uintptr_t)arg;
+}
+
+static struct rte_mempool *
+drb_pool_create(struct tle_ctx *ctx)
+{
+	uint32_t cs, flags, n, nb, r;
+	struct rte_mempool *mp;
+	const struct tle_ctx_param *prm;
+	char name[RTE_MEMPOOL_NAMESIZE];
+
+	prm = &ctx->prm;
+	nb = drb_nb_elem(ctx);
+
+	/* by default: enough to fill send buffers of all streams. */
+	n = prm->max_drbs;
+	if (n == 0)
+		n = prm->max_streams *
+			((prm->max_stream_sbufs + nb - 1) / nb + 1) +
+			DRB_CACHE_SIZE * rte_lcore_count();
+
+	/*
+	 * TCP control packets (ACK, FIN, RST) have to get through
+	 * when data exhausts the pool: keep one drb per stream for them,
+	 * on top of the default size, or out of the user provided one.
+	 */
+	r = 0;
+	if (prm->proto == TLE_PROTO_TCP) {
+		r = prm->max_streams;
+		if (prm->max_drbs == 0)
+			n += r;
+		else
+			r = RTE_MIN(r, n / DRB_CTL_RESV_DIV);
+	}
+	ctx->drb.nb_resv = r;
+	ctx->drb.nb_max = n - r;
+	ctx->drb.nb_out = 0;
+
+	/* mempool requires cache to be not bigger than n / 1.5 */
+	cs = RTE_MIN((uint32_t)DRB_CACHE_SIZE, n * 2 / 3);
+	cs = RTE_MIN(cs, (uint32_t)RTE_MEMPOOL_CACHE_MAX_SIZE);
+
+	flags = ((prm->flags & TLE_CTX_FLAG_ST) == 0) ? 0 :
+		(RTE_MEMPOOL_F_SP_PUT | RTE_MEMPOOL_F_SC_GET);
+
+	snprintf(name, sizeof(name), "drb@%p", ctx);
+	mp = rte_mempool_create(name, n, tle_drb_calc_size(nb), cs, 0,
+		NULL, NULL, drb_init, (void *)(uintptr_t)nb, prm->socket_id,
+		flags);
+	if (mp == NULL)
+		UDP_LOG(ERR, "%s(%s, n=%u, cache=%u, socket=%d) failed "
+			"with error code: %d\n",
+			__func__, name, n, cs, prm->socket_id, rte_errno);
+	return mp;
+}
+
+static struct dcache *
+dcache_create(struct tle_ctx *ctx, uint32_t lcore)
+{
+	size_t sz;
+	struct dcache *dc;
+
+	sz = sizeof(*dc) + sizeof(dc->ent[0]) * ctx->dcache.nb_set *
+		DCACHE_WAYS;
+	dc = rte_zmalloc_socket(NULL, sz, RTE_CACHE_LINE_SIZE,
+		rte_lcore_to_socket_id(lcore));
+	if (dc == NULL) {
+		TLE_LOG(ERR, "allocation of %zu bytes for destination cache "
+			"for lcore %u failed\n", sz, lcore);
+		return NULL;
+	}
+
+	dcache_init(dc, ctx->dcache.nb_set);
+	ctx->dcache.lc[lcore] = dc;
+	return dc;
+}
+
 struct tle_ctx *
 tle_ctx_create(const struct tle_ctx_param *ctx_prm)
 {
 	struct tle_ctx *ctx;
 	size_t sz;
-	uint64_t ms;
 	uint32_t i;
 	int32_t rc;
 
@@ -97,9 +223,8 @@ tle_ctx_create(const struct tle_ctx_param *ctx_prm)
 		return NULL;
 	}
 
-	/* caclulate closest shift to convert from cycles to ms (approximate) */
-	ms = (rte_get_tsc_hz() + MS_PER_S - 1) / MS_PER_S;
-	ctx->cycles_ms_shift = sizeof(ms) * CHAR_BIT - __builtin_clzll(ms) - 1;
+	ctx->cycles_ms_shift = calc_cycles_ms_shift();
+	ctx_update_tms(ctx);
 
 	ctx->prm = *ctx_prm;
 
@@ -113,6 +238,59 @@ tle_ctx_create(const struct tle_ctx_param *ctx_prm)
 		return NULL;
 	}
 
+	if (ctx_prm->pmtu_max != 0) {
+		sz = sizeof(*ctx->pmtu);
+		ctx->pmtu = rte_zmalloc_socket(NULL, sz, RTE_CACHE_LINE_SIZE,
+			ctx_prm->socket_id);
+		if (ctx->pmtu == NULL) {
+			TLE_LOG(ERR, "allocation of %zu bytes for PMTU cache "
+				"on socket %d failed\n",
+				sz, ctx_prm->socket_id);
+			tle_ctx_destroy(ctx);
+			rte_errno = ENOMEM;
+			return NULL;
+		}
+		pmtu_cache_init(ctx->pmtu);
+	}
+
+	ctx->drbs = drb_pool_create(ctx);
+	if (ctx->drbs == NULL) {
+		tle_ctx_destroy(ctx);
+		rte_errno = ENOMEM;
+		return NULL;
+	}
+
+	if ((ctx_prm->flags & TLE_CTX_FLAG_CB_DEFER) != 0) {
+		ctx->cbq = cbq_create(ctx);
+		if (ctx->cbq == NULL) {
+			tle_ctx_destroy(ctx);
+			rte_errno = ENOMEM;
+			return NULL;
+		}
+	}
+
+	if (ctx_prm->frag_tbl_size != 0) {
+		ctx->frag = frag_tbl_create(ctx_prm, ctx->cycles_ms_shift);
+		if (ctx->frag == NULL) {
+			tle_ctx_destroy(ctx);
+			rte_errno = ENOMEM;
+			return NULL;
+		}
+	}
+
+	/* allocate cache for each EAL lcore, so FE never has to do it. */
+	if (ctx_prm->dst_cache_size != 0) {
+		ctx->dcache.nb_set = rte_align32pow2(RTE_MAX(
+			ctx_prm->dst_cache_size / DCACHE_WAYS, 1U));
+		RTE_LCORE_FOREACH(i) {
+			if (dcache_create(ctx, i) == NULL) {
+				tle_ctx_destroy(ctx);
+				rte_errno = ENOMEM;
+				return NULL;
+			}
+		}
+	}
+
 	for (i = 0; i != RTE_DIM(ctx->use); i++)
 		tle_pbm_init(ctx->use + i, LPORT_START_BLK);
 
@@ -139,13 +317,140 @@ tle_ctx_destroy(struct tle_ctx *ctx)
 		tle_del_dev(ctx->dev + i);
 
 	tle_stream_ops[ctx->prm.proto].fini_streams(ctx);
+
+	for (i = 0; i != RTE_DIM(ctx->dcache.lc); i++)
+		rte_free(ctx->dcache.lc[i]);
+
+	frag_tbl_destroy(ctx->frag);
+	rte_mempool_free(ctx->drbs);
+	rte_ring_free(ctx->cbq);
+	rte_free(ctx->pmtu);
 	rte_free(ctx);
 }
 
+uint32_t
+tle_ctx_cb_dispatch(struct tle_ctx *ctx, uint32_t num)
+{
+	uint32_t i, k, n;
+	struct tle_stream *s;
+	struct stream_cbe ce[MAX_PKT_BURST];
+
+	if (ctx == NULL || ctx->cbq == NULL)
+		return 0;
+
+	k = 0;
+	do {
+		n = rte_ring_dequeue_burst_elem(ctx->cbq, ce, sizeof(ce[0]),
+			RTE_MIN(num - k, (uint32_t)RTE_DIM(ce)), NULL);
+
+		for (i = 0; i != n; i++) {
+			s = ce[i].s;
+
+			/*
+			 * allow the same op to be recorded again,
+			 * callback fires only if still requested.
+			 */
+			__atomic_fetch_and(&s->cbpend, ~(1 << ce[i].op),
+				__ATOMIC_ACQ_REL);
+			tle_stream_ops[ctx->prm.proto].invoke_cb(s, ce[i].op);
+		}
+		k += n;
+	} while (n != 0 && k != num);
+
+	return k;
+}
+
 void
 tle_ctx_invalidate(struct tle_ctx *ctx)
 {
-	RTE_SET_USED(ctx);
+	if (ctx == NULL)
+		return;
+
+	/* makes all cached destinations stale. */
+	rte_atomic32_inc(&ctx->dcache.gen);
+}
+
+static int
+rlim_fill(struct tle_rlim *rl, const struct tle_rlim_param *prm)
+{
+	uint64_t rate;
+	uint32_t shift;
+
+	if (prm->rate == 0 || prm->burst == 0 ||
+			prm->burst > INT64_MAX / RLIM_SCALE)
+		return -EINVAL;
+
+	/*
+	 * convert rate from bytes per second into tokens per
+	 * time unit used (approximately 1ms, see calc_cycles_ms_shift()).
+	 */
+	shift = calc_cycles_ms_shift();
+	rate = (uint64_t)((long double)prm->rate * RLIM_SCALE *
+		(UINT64_C(1) << shift) / rte_get_tsc_hz());
+
+	rl->rate = RTE_MAX(rate, UINT64_C(1));
+	rl->burst = prm->burst * RLIM_SCALE;
+	rl->tokens = RTE_MIN(rl->tokens, rl->burst);
+	rl->prm = *prm;
+	return 0;
+}
+
+struct tle_rlim *
+tle_rlim_create(const struct tle_rlim_param *prm)
+{
+	struct tle_rlim *rl;
+	int32_t rc;
+
+	if (prm == NULL) {
+		rte_errno = EINVAL;
+		return NULL;
+	}
+
+	rl = rte_zmalloc_socket(NULL, sizeof(*rl), RTE_CACHE_LINE_SIZE,
+		prm->socket_id);
+	if (rl == NULL) {
+		TLE_LOG(ERR, "allocation of %zu bytes for new rlim "
+			"on socket %d failed\n",
+			sizeof(*rl), prm->socket_id);
+		rte_errno = ENOMEM;
+		return NULL;
+	}
+
+	rl->tokens = INT64_MAX;
+	rc = rlim_fill(rl, prm);
+	if (rc != 0) {
+		rte_free(rl);
+		rte_errno = -rc;
+		return NULL;
+	}
+
+	rte_spinlock_init(&rl->lock);
+	rl->tms = rte_get_tsc_cycles() >> calc_cycles_ms_shift();
+	return rl;
+}
+
+int
+tle_rlim_update(struct tle_rlim *rl, const struct tle_rlim_param *prm)
+{
+	int32_t rc;
+	struct tle_rlim_param p;
+
+	if (rl == NULL || prm == NULL)
+		return -EINVAL;
+
+	p = *prm;
+	p.socket_id = rl->prm.socket_id;
+
+	rte_spinlock_lock(&rl->lock);
+	rc = rlim_fill(rl, &p);
+	rte_spinlock_unlock(&rl->lock);
+	return rc;
+}
+
+void
+tle_rlim_destroy(struct tle_rlim *rl)
+{
+	rte_free(rl);
 }
 
 static void
@@ -310,6 +615,9 @@ tle_del_dev(struct tle_dev *dev)
 	rte_free(dev->dp[TLE_V6]);
 	memset(dev, 0, sizeof(*dev));
 	ctx->nb_dev--;
+
+	/* cached destinations might refer to that device. */
+	tle_ctx_invalidate(ctx);
 	return 0;
 }
 
@@ -483,12 +791,11 @@ fill_ipv6_am(const struct sockaddr_in6 *in, rte_xmm_t *addr, rte_xmm_t *mask)
 	memcpy(mask, pm, sizeof(*mask));
 }
 
-int
-stream_fill_ctx(struct tle_ctx *ctx, struct tle_stream *s,
-	const struct sockaddr *laddr, const struct sockaddr *raddr)
+static void
+stream_fill_am(struct tle_stream *s, const struct sockaddr *laddr,
+	const struct sockaddr *raddr)
 {
 	const struct sockaddr_in *rin;
-	int32_t rc;
 
 	/* setup ports and port mask fields (except dst port). */
 	rin = (const struct sockaddr_in *)raddr;
@@ -508,6 +815,15 @@ stream_fill_ctx(struct tle_ctx *ctx, struct tle_stream *s,
 		fill_ipv6_am((const struct sockaddr_in6 *)raddr,
 			&s->ipv6.addr.src, &s->ipv6.mask.src);
 	}
+}
+
+int
+stream_fill_ctx(struct tle_ctx *ctx, struct tle_stream *s,
+	const struct sockaddr *laddr, const struct sockaddr *raddr)
+{
+	int32_t rc;
+
+	stream_fill_am(s, laddr, raddr);
 
 	rte_spinlock_lock(&ctx->dev_lock);
 	rc = stream_fill_dev(ctx, s, laddr);
@@ -516,6 +832,105 @@ stream_fill_ctx(struct tle_ctx *ctx, struct tle_stream *s,
 	return rc;
 }
 
+/*
+ * setup ports and addresses for fully specified stream,
+ * local port is not reserved, local address has to belong
+ * to one of the ctx devices.
+ */
+int
+stream_fill_addr(struct tle_ctx *ctx, struct tle_stream *s,
+	const struct sockaddr *laddr, const struct sockaddr *raddr)
+{
+	struct tle_dev *dev;
+	const struct sockaddr_in *lin4;
+	const struct sockaddr_in6 *lin6;
+
+	rte_spinlock_lock(&ctx->dev_lock);
+	if (laddr->sa_family == AF_INET) {
+		lin4 = (const struct sockaddr_in *)laddr;
+		dev = find_ipv4_dev(ctx, &lin4->sin_addr);
+		s->type = TLE_V4;
+		s->port.dst = lin4->sin_port;
+	} else if (laddr->sa_family == AF_INET6) {
+		lin6 = (const struct sockaddr_in6 *)laddr;
+		dev = find_ipv6_dev(ctx, &lin6->sin6_addr);
+		s->type = TLE_V6;
+		s->port.dst = lin6->sin6_port;
+	} else {
+		rte_spinlock_unlock(&ctx->dev_lock);
+		return EINVAL;
+	}
+	rte_spinlock_unlock(&ctx->dev_lock);
+
+	if (dev == NULL) {
+		s->type = TLE_VNUM;
+		return ENODEV;
+	}
+
+	stream_fill_am(s, laddr, raddr);
+	return 0;
+}
+
+/* returns stream that owns given local address and port, or NULL. */
+struct tle_stream *
+stream_find_ctx(struct tle_ctx *ctx, const struct sockaddr *laddr)
+{
+	uint32_t i, sp, t;
+	struct tle_dev *dev;
+	struct tle_stream *s;
+	const struct sockaddr_in *lin4;
+	const struct sockaddr_in6 *lin6;
+
+	s = NULL;
+	rte_spinlock_lock(&ctx->dev_lock);
+
+	if (laddr->sa_family == AF_INET) {
+		lin4 = (const struct sockaddr_in *)laddr;
+		t = TLE_V4;
+		sp = lin4->sin_port;
+		dev = (lin4->sin_addr.s_addr != INADDR_ANY) ?
+			find_ipv4_dev(ctx, &lin4->sin_addr) : NULL;
+	} else {
+		lin6 = (const struct sockaddr_in6 *)laddr;
+		t = TLE_V6;
+		sp = lin6->sin6_port;
+		dev = (memcmp(&tle_ipv6_any, &lin6->sin6_addr,
+			sizeof(tle_ipv6_any)) != 0) ?
+			find_ipv6_dev(ctx, &lin6->sin6_addr) : NULL;
+	}
+
+	/* wildcard address, stream is registered within all devices. */
+	for (i = 0; dev == NULL && i != RTE_DIM(ctx->dev); i++) {
+		if (ctx->dev[i].dp[t] != NULL)
+			dev = ctx->dev + i;
+	}
+
+	if (dev != NULL && dev->dp[t] != NULL)
+		s = dev->dp[t]->streams[sp];
+
+	rte_spinlock_unlock(&ctx->dev_lock);
+	return s;
+}
+
+/* pass ownership of the local port from one stream to another. */
+void
+stream_move_ctx(struct tle_ctx *ctx, const struct tle_stream *os,
+	struct tle_stream *ns)
+{
+	uint32_t i, sp, t;
+
+	t = os->type;
+	sp = os->port.dst;
+
+	rte_spinlock_lock(&ctx->dev_lock);
+	for (i = 0; i != RTE_DIM(ctx->dev); i++) {
+		if (ctx->dev[i].dp[t] != NULL &&
+				ctx->dev[i].dp[t]->streams[sp] == os)
+			ctx->dev[i].dp[t]->streams[sp] = ns;
+	}
+	rte_spinlock_unlock(&ctx->dev_lock);
+}
+
 /* free stream's destination port */
 int
 stream_clear_ctx(struct tle_ctx *ctx, struct tle_stream *s)
@@ -16,6 +16,11 @@
 #ifndef _CTX_H_
 #define _CTX_H_
 
+#include <rte_atomic.h>
+#include <rte_cycles.h>
+#include <rte_lcore.h>
+#include <rte_mempool.h>
+#include <rte_ring.h>
 #include <rte_spinlock.h>
 #include <rte_vect.h>
 #include <tle_dring.h>
@@ -24,6 +29,9 @@
 #include "port_bitmap.h"
 #include "osdep.h"
 #include "net_misc.h"
+#include "pmtu.h"
+#include "dcache.h"
+#include "frag.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -51,6 +59,21 @@ struct tle_dev {
 struct tle_ctx {
 	struct tle_ctx_param prm;
 	uint32_t cycles_ms_shift;  /* to convert from cycles to ms */
+	uint32_t tms;              /* time in ms units, cached by BE */
+	struct pmtu_cache *pmtu;   /* discovered path MTUs, might be NULL */
+	struct frag_tbl *frag;     /* IP reassembly state, might be NULL */
+	struct rte_ring *cbq;      /* deferred callbacks, might be NULL */
+	struct rte_mempool *drbs;  /* TX drbs shared by all streams */
+	struct {
+		uint32_t nb_resv; /* kept for control packets, might be 0 */
+		uint32_t nb_max;  /* drbs other packets can have in flight */
+		uint32_t nb_out;  /* drbs in flight, if nb_resv != 0 */
+	} drb;
+	struct {
+		rte_atomic32_t gen; /* bumped by tle_ctx_invalidate() */
+		uint32_t nb_set;    /* zero means disabled */
+		struct dcache *lc[RTE_MAX_LCORE]; /* NULL for unused lcores */
+	} dcache;
 	struct {
 		rte_spinlock_t lock;
 		uint32_t nb_free; /* number of free streams. */
@@ -68,6 +91,7 @@ struct stream_ops {
 	int (*init_streams)(struct tle_ctx *);
 	void (*fini_streams)(struct tle_ctx *);
 	void (*free_drbs)(struct tle_stream *, struct tle_drb *[], uint32_t);
+	void (*invoke_cb)(struct tle_stream *, uint32_t);
 };
 
 extern struct stream_ops tle_stream_ops[TLE_PROTO_NUM];
@@ -77,6 +101,43 @@ int stream_fill_ctx(struct tle_ctx *ctx, struct tle_stream *s,
 
 int stream_clear_ctx(struct tle_ctx *ctx, struct tle_stream *s);
 
+int stream_fill_addr(struct tle_ctx *ctx, struct tle_stream *s,
+	const struct sockaddr *laddr, const struct sockaddr *raddr);
+
+struct tle_stream *stream_find_ctx(struct tle_ctx *ctx,
+	const struct sockaddr *laddr);
+
+void stream_move_ctx(struct tle_ctx *ctx, const struct tle_stream *os,
+	struct tle_stream *ns);
+
+/*
+ * refresh cached context time, BE functions do it once per call,
+ * so FE functions can use ctx->tms instead of reading TSC themselves.
+ */
+static inline uint32_t
+ctx_update_tms(struct tle_ctx *ctx)
+{
+	uint32_t tms;
+
+	tms = rte_get_tsc_cycles() >> ctx->cycles_ms_shift;
+	ctx->tms = tms;
+	return tms;
+}
+
+/* returns destination cache for the calling lcore, or NULL. */
+static inline struct dcache *
+ctx_dcache(struct tle_ctx *ctx)
+{
+	uint32_t lc;
+
+	/* non-EAL threads are not allowed to use the cache. */
+	lc = rte_lcore_id();
+	if (lc >= RTE_DIM(ctx->dcache.lc))
+		return NULL;
+
+	return ctx->dcache.lc[lc];
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,179 @@
+/*
+ * Copyright (c) 2016  Intel Corporation.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _DCACHE_H_
+#define _DCACHE_H_
+
+#include <stddef.h>
+#include <string.h>
+#include <rte_common.h>
+#include <rte_memcpy.h>
+#include <tle_ctx.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Per lcore cache of destinations returned by lookup4/lookup6 callbacks,
+ * keyed by (stream udata, remote address).
+ * Set associative, DCACHE_WAYS entries per set, LRU replacement
+ * within the set.
+ * Each entry is tagged with the ctx generation it was filled at,
+ * tle_ctx_invalidate() just bumps the generation, so all existing
+ * entries become stale at once.
+ * Accessed only by the owning lcore, so no locking is required.
+ */
+
+#define	DCACHE_WAYS	4
+
+struct dcache_ent {
+	uint64_t udata;
+	uint32_t gen;   /* ctx generation entry was filled at */
+	uint32_t tick;  /* time of the last access, for LRU */
+	uint16_t type;  /* TLE_V4/TLE_V6, TLE_VNUM for empty entry */
+	uint16_t idx;   /* device index returned by stream_get_dest() */
+	union {
+		uint32_t a4;
+		rte_xmm_t a6;
+	} addr;
+	struct tle_dest dst;
+} __rte_cache_aligned;
+
+struct dcache {
+	uint32_t tick;
+	uint32_t nb_set;  /* power of two */
+	struct dcache_ent ent[];
+};
+
+static inline void
+dcache_init(struct dcache *dc, uint32_t nb_set)
+{
+	uint32_t i;
+
+	dc->tick = 0;
+	dc->nb_set = nb_set;
+	for (i = 0; i != nb_set * DCACHE_WAYS; i++)
+		dc->ent[i].type = TLE_VNUM;
+}
+
+static inline uint32_t
+dcache_hash(const struct dcache *dc, uint32_t type, uint64_t udata,
+	const void *addr)
+{
+	uint32_t h;
+	const rte_xmm_t *a6;
+
+	if (type == TLE_V4)
+		h = *(const uint32_t *)addr;
+	else {
+		a6 = addr;
+		h = a6->u32[0] ^ a6->u32[1] ^ a6->u32[2] ^ a6->u32[3];
+	}
+
+	h ^= udata ^ (udata >> 32);
+	h ^= h >> 16;
+	h *= 0x9e3779b1;
+	h ^= h >> 16;
+	return h & (dc->nb_set - 1);
+}
+
+static inline int
+dcache_ent_match(const struct dcache_ent *de, uint32_t gen, uint32_t type,
+	uint64_t udata, const void *addr)
+{
+	if (de->type != type || de->gen != gen || de->udata != udata)
+		return 0;
+	if (type == TLE_V4)
+		return de->addr.a4 == *(const uint32_t *)addr;
+	return memcmp(&de->addr.a6, addr, sizeof(de->addr.a6)) == 0;
+}
+
+/*
+ * on success copies cached destination into *dst* and
+ * returns its device index, otherwise returns -ENOENT.
+ * *set* is filled with the set index for the following dcache_update().
+ */
+static inline int32_t
+dcache_lookup(struct dcache *dc, uint32_t gen, uint32_t type, uint64_t udata,
+	const void *addr, struct tle_dest *dst, uint32_t *set)
+{
+	uint32_t i, n;
+	struct dcache_ent *de;
+
+	*set = dcache_hash(dc, type, udata, addr);
+	de = dc->ent + *set * DCACHE_WAYS;
+
+	for (i = 0; i != DCACHE_WAYS; i++) {
+		if (dcache_ent_match(de + i, gen, type, udata, addr) != 0) {
+			de += i;
+			de->tick = ++dc->tick;
+			/* copy only the part of the header that is in use. */
+			n = offsetof(struct tle_dest, hdr) +
+				de->dst.l2_len + de->dst.l3_len;
+			rte_memcpy(dst, &de->dst, n);
+			return de->idx;
+		}
+	}
+
+	return -ENOENT;
+}
+
+/*
+ * store new destination in the given set, replacing either
+ * a stale or the least recently used entry.
+ */
+static inline void
+dcache_update(struct dcache *dc, uint32_t set, uint32_t gen, uint32_t type,
+	uint64_t udata, const void *addr, const struct tle_dest *dst,
+	uint32_t idx)
+{
+	uint32_t i, k, age, max;
+	struct dcache_ent *de;
+
+	de = dc->ent + set * DCACHE_WAYS;
+
+	k = 0;
+	max = 0;
+	for (i = 0; i != DCACHE_WAYS; i++) {
+		if (de[i].type == TLE_VNUM || de[i].gen != gen) {
+			k = i;
+			break;
+		}
+		age = dc->tick - de[i].tick;
+		if (age >= max) {
+			max = age;
+			k = i;
+		}
+	}
+
+	de += k;
+	de->udata = udata;
+	de->gen = gen;
+	de->tick = ++dc->tick;
+	de->type = type;
+	de->idx = idx;
+	if (type == TLE_V4)
+		de->addr.a4 = *(const uint32_t *)addr;
+	else
+		rte_memcpy(&de->addr.a6, addr, sizeof(de->addr.a6));
+	de->dst = *dst;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _DCACHE_H_ */
@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2016  Intel Corporation.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _EVBULK_H_
+#define _EVBULK_H_
+
+#include <rte_per_lcore.h>
+#include <tle_event.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Events raised by the BE within one rx_bulk/tx_bulk call are not
+ * passed to their queues straight away, but collected and raised
+ * with tle_event_raise_bulk() at the end of the call.
+ * That way each event queue is locked (or its ring is updated)
+ * once per burst, instead of once per stream.
+ * Collector is active only within such calls, all other event
+ * sources (user API, timers) raise events immediately.
+ * Note that postponed event can be raised after the stream was
+ * released. Events are never returned to the system, so memory-wise
+ * that is safe, and raise of the event still free (IDLE) is ignored.
+ * But if the event was allocated again and armed meanwhile, its new
+ * owner gets a spurious wakeup. Collector is per BE lcore, so it can't
+ * be flushed by tle_event_free() called from the FE.
+ */
+
+#define	EVBULK_NUM	0x40
+
+struct evbulk {
+	uint32_t num;
+	struct evbulk *prev;
+	struct tle_event *ev[EVBULK_NUM];
+};
+
+RTE_DECLARE_PER_LCORE(struct evbulk *, _evbulk);
+
+static inline void
+evbulk_start(struct evbulk *eb)
+{
+	eb->num = 0;
+	eb->prev = RTE_PER_LCORE(_evbulk);
+	RTE_PER_LCORE(_evbulk) = eb;
+}
+
+static inline void
+evbulk_finish(struct evbulk *eb)
+{
+	if (eb->num != 0)
+		tle_event_raise_bulk(eb->ev, eb->num);
+	RTE_PER_LCORE(_evbulk) = eb->prev;
+}
+
+/*
+ * raise the event, or postpone it till the end of current burst.
+ * Readiness bits are set straight away.
+ */
+static inline void
+evbulk_raise(struct tle_event *ev, uint32_t msk)
+{
+	struct evbulk *eb;
+
+	eb = RTE_PER_LCORE(_evbulk);
+	if (eb == NULL) {
+		tle_event_raise_mask(ev, msk);
+		return;
+	}
+
+	__tle_event_set_mask(ev, msk);
+
+	/* only events in DOWN state can be raised. */
+	if (tle_event_state(ev) != TLE_SEV_DOWN ||
+			(eb->num != 0 && eb->ev[eb->num - 1] == ev))
+		return;
+
+	if (eb->num == RTE_DIM(eb->ev)) {
+		tle_event_raise_bulk(eb->ev, eb->num);
+		eb->num = 0;
+	}
+	eb->ev[eb->num++] = ev;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _EVBULK_H_ */
@@ -13,35 +13,81 @@
  * limitations under the License.
  */
 
+#include <stdio.h>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
 #include <rte_errno.h>
 #include <rte_malloc.h>
 #include <rte_log.h>
+#include <rte_pause.h>
 #include <tle_event.h>
 
 #include "osdep.h"
+#include "evbulk.h"
+
+RTE_DEFINE_PER_LCORE(struct evbulk *, _evbulk);
+
+/* limits for the number of tle_evq_wait() spins before going to sleep. */
+#define	EVQ_SPIN_MIN	0x40
+#define	EVQ_SPIN_MAX	0x10000
 
 struct tle_evq *
 tle_evq_create(const struct tle_evq_param *prm)
 {
+	int32_t rc;
 	struct tle_evq *evq;
-	size_t sz;
-	uint32_t i;
+	size_t sz, rsz;
+	uint32_t i, n;
+	char name[RTE_RING_NAMESIZE];
 
-	if (prm == NULL) {
+	if (prm == NULL || (prm->flags &
+			~(TLE_EVQ_F_LOCKFREE | TLE_EVQ_F_WAIT)) != 0) {
 		rte_errno = EINVAL;
 		return NULL;
 	}
 
+	/* ring for lock-free queue has to be able to hold all events. */
+	rsz = 0;
+	n = 0;
+	if (prm->flags & TLE_EVQ_F_LOCKFREE) {
+		n = rte_align32pow2(prm->max_events + 1);
+		rsz = rte_ring_get_memsize(n);
+	}
+
 	sz = sizeof(*evq) + sizeof(evq->events[0]) * prm->max_events;
-	evq =  rte_zmalloc_socket(NULL, sz, RTE_CACHE_LINE_SIZE,
+	sz = RTE_ALIGN_CEIL(sz, RTE_CACHE_LINE_SIZE);
+	evq =  rte_zmalloc_socket(NULL, sz + rsz, RTE_CACHE_LINE_SIZE,
 		prm->socket_id);
 	if (evq == NULL) {
 		UDP_LOG(ERR, "allocation of %zu bytes for "
 			"new tle_evq(%u) on socket %d failed\n",
-			sz, prm->max_events, prm->socket_id);
+			sz + rsz, prm->max_events, prm->socket_id);
 		return NULL;
 	}
 
+	if (rsz != 0) {
+		evq->r = (struct rte_ring *)((uintptr_t)evq + sz);
+		snprintf(name, sizeof(name), "evq@%p", evq);
+		rte_ring_init(evq->r, name, n, RING_F_SC_DEQ);
+	}
+
+	evq->efd = -1;
+	if (prm->flags & TLE_EVQ_F_WAIT) {
+		evq->efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+		if (evq->efd < 0) {
+			rc = errno;
+			UDP_LOG(ERR, "%s: eventfd() failed "
+				"with error code: %d\n", __func__, rc);
+			rte_free(evq);
+			rte_errno = rc;
+			return NULL;
+		}
+	}
+
+	evq->flags = prm->flags;
+	evq->spin = EVQ_SPIN_MIN;
 	TAILQ_INIT(&evq->armed);
 	TAILQ_INIT(&evq->free);
 
@@ -59,9 +105,82 @@ tle_evq_create(const struct tle_evq_param *prm)
 void
 tle_evq_destroy(struct tle_evq *evq)
 {
+	if (evq != NULL && evq->efd >= 0)
+		close(evq->efd);
 	rte_free(evq);
 }
 
+void
+__tle_evq_signal(struct tle_evq *evq)
+{
+	uint64_t v;
+
+	/* only first producer after the waiter rearmed the queue. */
+	if (__atomic_exchange_n(&evq->wake, 1, __ATOMIC_ACQ_REL) != 0)
+		return;
+
+	v = 1;
+	if (write(evq->efd, &v, sizeof(v)) != sizeof(v))
+		UDP_LOG(DEBUG, "%s(evq=%p): write() failed with error "
+			"code: %d\n", __func__, evq, errno);
+}
+
+int32_t
+tle_evq_wait(struct tle_evq *evq, const void *evd[], uint32_t num,
+	int32_t timeout)
+{
+	int32_t n, rc;
+	uint32_t i, spin;
+	uint64_t v;
+	struct pollfd pfd;
+
+	if (evq == NULL || evd == NULL || num == 0 ||
+			(evq->flags & TLE_EVQ_F_WAIT) == 0)
+		return -EINVAL;
+
+	n = tle_evq_get(evq, evd, num);
+	if (n != 0)
+		return n;
+
+	/* spin for a while, longer if events arrived while spinning. */
+	spin = (timeout != 0) ? evq->spin : 0;
+	for (i = 0; i != spin; i++) {
+		rte_pause();
+		rte_compiler_barrier();
+		n = tle_evq_get(evq, evd, num);
+		if (n != 0) {
+			evq->spin = RTE_MIN(spin * 2, (uint32_t)EVQ_SPIN_MAX);
+			return n;
+		}
+	}
+
+	/*
+	 * rearm the queue and drain its eventfd, then check for
+	 * the events again: pairs with the barrier the producer issues
+	 * before calling __tle_evq_signal().
+	 */
+	__atomic_store_n(&evq->wake, 0, __ATOMIC_RELAXED);
+	rte_smp_mb();
+	if (read(evq->efd, &v, sizeof(v)) < 0 && errno != EAGAIN)
+		return -errno;
+
+	n = tle_evq_get(evq, evd, num);
+	if (n != 0 || timeout == 0)
+		return n;
+
+	/* nothing arrived while spinning, spin less next time. */
+	evq->spin = RTE_MAX(spin / 2, (uint32_t)EVQ_SPIN_MIN);
+
+	pfd.fd = evq->efd;
+	pfd.events = POLLIN;
+	pfd.revents = 0;
+	rc = poll(&pfd, 1, timeout);
+	if (rc < 0 && errno != EINTR)
+		return -errno;
+
+	return tle_evq_get(evq, evd, num);
+}
+
 struct tle_event *
 tle_event_alloc(struct tle_evq *evq, const void *data)
 {
@@ -78,6 +197,7 @@ tle_event_alloc(struct tle_evq *evq, const void *data)
 		TAILQ_REMOVE(&evq->free, h, ql);
 		evq->nb_free--;
 		h->data = data;
+		h->mask = 0;
 	} else
 		rte_errno = ENOMEM;
 	rte_spinlock_unlock(&evq->lock);
@@ -94,10 +214,12 @@ tle_event_free(struct tle_event *ev)
 		return;
 	}
 
+	/* removes event from the armed list, if necessary. */
+	tle_event_idle(ev);
+
 	q = ev->head;
 	rte_spinlock_lock(&q->lock);
 	ev->data = NULL;
-	ev->state = TLE_SEV_IDLE;
 	TAILQ_INSERT_HEAD(&q->free, ev, ql);
 	q->nb_free++;
 	rte_spinlock_unlock(&q->lock);
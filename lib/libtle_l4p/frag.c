@@ -0,0 +1,242 @@
+/*
+ * Copyright (c) 2016  Intel Corporation.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <rte_malloc.h>
+#include <rte_errno.h>
+#include <rte_cycles.h>
+#include <rte_ip.h>
+#include <rte_tcp.h>
+#include <rte_udp.h>
+
+#include "ctx.h"
+#include "misc.h"
+
+struct frag_tbl *
+frag_tbl_create(const struct tle_ctx_param *prm, uint32_t mshift)
+{
+	size_t sz;
+	uint32_t nb_bkt, tmo;
+	uint64_t cyc;
+	struct frag_tbl *ft;
+
+	sz = sizeof(*ft);
+	ft = rte_zmalloc_socket(NULL, sz, RTE_CACHE_LINE_SIZE,
+		prm->socket_id);
+	if (ft == NULL) {
+		TLE_LOG(ERR, "allocation of %zu bytes for fragment table "
+			"on socket %d failed\n",
+			sz, prm->socket_id);
+		return NULL;
+	}
+
+	/* table timestamps are in ctx time units, convert from ms. */
+	tmo = (prm->frag_tmo == 0) ? FRAG_TMO_DEFAULT : prm->frag_tmo;
+	cyc = (rte_get_tsc_hz() + MS_PER_S - 1) / MS_PER_S * tmo;
+	cyc = RTE_MAX(cyc >> mshift, UINT64_C(1));
+
+	nb_bkt = (prm->frag_tbl_size + FRAG_BUCKET_ENTRIES - 1) /
+		FRAG_BUCKET_ENTRIES;
+	nb_bkt = rte_align32pow2(nb_bkt);
+
+	ft->tbl = rte_ip_frag_table_create(nb_bkt, FRAG_BUCKET_ENTRIES,
+		prm->frag_tbl_size, cyc, prm->socket_id);
+	if (ft->tbl == NULL) {
+		TLE_LOG(ERR, "%s(nb_bkt=%u, max_entries=%u, socket=%d) "
+			"failed with error code: %d\n",
+			__func__, nb_bkt, prm->frag_tbl_size, prm->socket_id,
+			rte_errno);
+		rte_free(ft);
+		return NULL;
+	}
+
+	rte_spinlock_init(&ft->lock);
+	ft->mt = ((prm->flags & TLE_CTX_FLAG_ST) == 0);
+	return ft;
+}
+
+void
+frag_tbl_destroy(struct frag_tbl *ft)
+{
+	if (ft == NULL)
+		return;
+
+	rte_ip_frag_free_death_row(&ft->dr, 0);
+	rte_ip_frag_table_destroy(ft->tbl);
+	rte_free(ft);
+}
+
+static inline int
+frag_ipv4_csum(const struct rte_mbuf *m, const struct rte_ipv4_hdr *iph)
+{
+	uint64_t fl;
+
+	fl = m->ol_flags & RTE_MBUF_F_RX_IP_CKSUM_MASK;
+	if (fl == RTE_MBUF_F_RX_IP_CKSUM_GOOD)
+		return 0;
+	else if (fl == RTE_MBUF_F_RX_IP_CKSUM_BAD)
+		return 1;
+	return _ipv4x_cksum(iph, m->l3_len) != UINT16_MAX;
+}
+
+/*
+ * make reassembled datagram look like a normal RX packet.
+ * returns non-zero if L4 header is not in the first segment.
+ */
+static inline int
+frag_fix_reassembled(struct rte_mbuf *m, uint32_t proto)
+{
+	uint32_t len;
+	const struct rte_tcp_hdr *th;
+
+	/* IPv6 reassembly removes fragment header. */
+	if (RTE_ETH_IS_IPV6_HDR(m->packet_type))
+		m->l3_len -= sizeof(struct rte_ipv6_fragment_ext);
+
+	/*
+	 * IP headers of all fragments were already verified,
+	 * L4 cksum has to be checked over the whole datagram.
+	 */
+	m->ol_flags &= ~(RTE_MBUF_F_TX_IP_CKSUM |
+		RTE_MBUF_F_RX_IP_CKSUM_MASK | RTE_MBUF_F_RX_L4_CKSUM_MASK);
+	m->ol_flags |= RTE_MBUF_F_RX_IP_CKSUM_GOOD |
+		RTE_MBUF_F_RX_L4_CKSUM_UNKNOWN;
+	m->tso_segsz = 0;
+
+	m->packet_type &= ~RTE_PTYPE_L4_MASK;
+	if (proto == IPPROTO_UDP) {
+		m->packet_type |= RTE_PTYPE_L4_UDP;
+		m->l4_len = sizeof(struct rte_udp_hdr);
+		return rte_pktmbuf_data_len(m) <
+			m->l2_len + m->l3_len + m->l4_len;
+	}
+
+	/* TCP header length (with options) is taken from the header. */
+	m->packet_type |= RTE_PTYPE_L4_TCP;
+	len = m->l2_len + m->l3_len;
+	if (rte_pktmbuf_data_len(m) < len + sizeof(*th))
+		return 1;
+
+	th = rte_pktmbuf_mtod_offset(m, const struct rte_tcp_hdr *, len);
+	m->l4_len = (th->data_off >> 4) * 4;
+	return m->l4_len < sizeof(*th) ||
+		rte_pktmbuf_data_len(m) < len + m->l4_len;
+}
+
+/*
+ * feed one fragment into the table.
+ * On success *rm* is set to reassembled datagram, or to NULL if
+ * the fragment was consumed by the table.
+ * Otherwise returns positive error code, *rm* points to the packet
+ * to reject.
+ */
+static inline int
+frag_process(struct frag_tbl *ft, struct rte_mbuf *m, uint64_t tms,
+	uint32_t proto, struct rte_mbuf **rm)
+{
+	struct rte_ipv4_hdr *ip4h;
+	struct rte_ipv6_hdr *ip6h;
+	struct rte_ipv6_fragment_ext *fh;
+
+	*rm = m;
+
+	if (RTE_ETH_IS_IPV4_HDR(m->packet_type)) {
+
+		ip4h = rte_pktmbuf_mtod_offset(m, struct rte_ipv4_hdr *,
+			m->l2_len);
+		if (ip4h->next_proto_id != proto ||
+				frag_ipv4_csum(m, ip4h) != 0)
+			return EINVAL;
+
+		m = rte_ipv4_frag_reassemble_packet(ft->tbl, &ft->dr, m, tms,
+			ip4h);
+
+	} else if (RTE_ETH_IS_IPV6_HDR(m->packet_type)) {
+
+		/* DPDK expects fragment header right after the IPv6 one. */
+		ip6h = rte_pktmbuf_mtod_offset(m, struct rte_ipv6_hdr *,
+			m->l2_len);
+		fh = rte_ipv6_frag_get_ipv6_fragment_header(ip6h);
+		if (fh == NULL || fh->next_header != proto)
+			return EINVAL;
+
+		m = rte_ipv6_frag_reassemble_packet(ft->tbl, &ft->dr, m, tms,
+			ip6h, fh);
+
+	} else
+		return EINVAL;
+
+	*rm = m;
+	if (m != NULL && frag_fix_reassembled(m, proto) != 0)
+		return EINVAL;
+	return 0;
+}
+
+uint32_t
+frag_rx_bulk(struct tle_ctx *ctx, uint32_t proto, struct rte_mbuf *pkt[],
+	uint32_t num, struct rte_mbuf *rp[], int32_t rc[], uint32_t *nb_rej)
+{
+	int32_t err;
+	uint32_t i, k, n;
+	uint64_t tms;
+	struct frag_tbl *ft;
+	struct rte_mbuf *m;
+
+	ft = ctx->frag;
+	tms = rte_get_tsc_cycles() >> ctx->cycles_ms_shift;
+
+	if (ft->mt != 0)
+		rte_spinlock_lock(&ft->lock);
+
+	/* drop incomplete datagrams, at most once per time unit. */
+	if (tms != ft->tms) {
+		rte_frag_table_del_expired_entries(ft->tbl, &ft->dr, tms);
+		ft->tms = tms;
+	}
+
+	k = 0;
+	n = 0;
+	for (i = 0; i != num; i++) {
+
+		m = pkt[i];
+		if (frag_pkt(m) != 0) {
+
+			/* one fragment can release up to MAX_FRAG mbufs. */
+			if (ft->dr.cnt + RTE_LIBRTE_IP_FRAG_MAX_FRAG >
+					RTE_DIM(ft->dr.row))
+				rte_ip_frag_free_death_row(&ft->dr,
+					FRAG_PREFETCH);
+
+			err = frag_process(ft, m, tms, proto, &m);
+			if (err != 0) {
+				rc[k] = err;
+				rp[k] = m;
+				k++;
+				continue;
+			} else if (m == NULL)
+				continue;
+		}
+
+		pkt[n++] = m;
+	}
+
+	/* free mbufs of all failed reassemblies in one go. */
+	rte_ip_frag_free_death_row(&ft->dr, FRAG_PREFETCH);
+
+	if (ft->mt != 0)
+		rte_spinlock_unlock(&ft->lock);
+
+	*nb_rej = k;
+	return n;
+}
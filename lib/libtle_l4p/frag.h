@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2016  Intel Corporation.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _FRAG_H_
+#define _FRAG_H_
+
+#include <rte_cycles.h>
+#include <rte_ip_frag.h>
+#include <rte_mbuf.h>
+#include <rte_spinlock.h>
+#include <tle_ctx.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Per context IP reassembly state.
+ * Incoming fragments are collected in the DPDK fragment table,
+ * timestamps are in ctx time units (see tle_ctx.cycles_ms_shift).
+ * Mbufs of failed/expired reassemblies are put into the death row
+ * and freed in one go at the end of each RX burst.
+ */
+
+/* default reassembly timeout (ms). */
+#define	FRAG_TMO_DEFAULT	MS_PER_S
+
+/* number of entries per fragment table bucket. */
+#define	FRAG_BUCKET_ENTRIES	4
+
+/* prefetch distance for death row freeing. */
+#define	FRAG_PREFETCH	3
+
+struct frag_tbl {
+	rte_spinlock_t lock;
+	uint32_t mt;    /* lock has to be taken */
+	uint64_t tms;   /* time of the last expired entries cleanup */
+	struct rte_ip_frag_tbl *tbl;
+	struct rte_ip_frag_death_row dr;
+};
+
+struct frag_tbl *frag_tbl_create(const struct tle_ctx_param *prm,
+	uint32_t mshift);
+
+void frag_tbl_destroy(struct frag_tbl *ft);
+
+uint32_t frag_rx_bulk(struct tle_ctx *ctx, uint32_t proto,
+	struct rte_mbuf *pkt[], uint32_t num, struct rte_mbuf *rp[],
+	int32_t rc[], uint32_t *nb_rej);
+
+static inline int
+frag_pkt(const struct rte_mbuf *m)
+{
+	return (m->packet_type & RTE_PTYPE_L4_MASK) == RTE_PTYPE_L4_FRAG;
+}
+
+/*
+ * pass IP fragments from *pkt[]* through the reassembly table.
+ * Fragments are removed from *pkt[]*, reassembled datagrams take
+ * position of the fragment that completed them.
+ * Invalid fragments are moved into *rp[]*, with error code in *rc[]*,
+ * their number is returned in *nb_rej*.
+ * returns number of packets left in *pkt[]*.
+ */
+static inline uint32_t
+frag_reassemble(struct tle_ctx *ctx, struct frag_tbl *ft, uint32_t proto,
+	struct rte_mbuf *pkt[], uint32_t num, struct rte_mbuf *rp[],
+	int32_t rc[], uint32_t *nb_rej)
+{
+	uint32_t i;
+
+	*nb_rej = 0;
+	if (ft == NULL)
+		return num;
+
+	/* skip non-fragmented packets. */
+	for (i = 0; i != num && frag_pkt(pkt[i]) == 0; i++)
+		;
+	if (i == num)
+		return num;
+
+	return i + frag_rx_bulk(ctx, proto, pkt + i, num - i, rp, rc, nb_rej);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _FRAG_H_ */
@@ -18,6 +18,8 @@
 
 #include <tle_dpdk_wrapper.h>
 
+#include "cksum.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -93,101 +95,6 @@ _tx_offload_l4_offset(uint64_t ofl)
  * Consider to move them into DPDK librte_net/rte_ip.h.
  */
 
-/* make compiler to generate: add %r1, %r2; adc $0, %r1. */
-#define CKSUM_ADD_CARRY(s, v)	do {       \
-	(s) += (v);                        \
-	(s) = ((s) < (v)) ? (s) + 1 : (s); \
-} while (0)
-
-/**
- * Process the non-complemented checksum of a buffer.
- * Similar  to rte_raw_cksum(), but provide better performance
- * (at least on IA platforms).
- * @param buf
- *   Pointer to the buffer.
- * @param size
- *   Length of the buffer.
- * @return
- *   The non-complemented checksum.
- */
-static inline uint16_t
-__raw_cksum(const uint8_t *buf, uint32_t size)
-{
-	uint64_t s, sum;
-	uint32_t i, n;
-	uint32_t dw1, dw2;
-	uint16_t w1, w2;
-	const uint64_t *b;
-
-	b = (const uint64_t *)buf;
-	n = size / sizeof(*b);
-	sum = 0;
-
-	/* main loop, consume 8 bytes per iteration. */
-	for (i = 0; i != n; i++) {
-		s = b[i];
-		CKSUM_ADD_CARRY(sum, s);
-	}
-
-	/* consume the remainder. */
-	n = size % sizeof(*b);
-	if (n != 0) {
-		/* position of the of last 8 bytes of data. */
-		b = (const uint64_t *)((uintptr_t)(b + i) + n - sizeof(*b));
-		/* calculate shift amount. */
-		n = (sizeof(*b) - n) * CHAR_BIT;
-		s = b[0] >> n;
-		CKSUM_ADD_CARRY(sum, s);
-	}
-
-	/* reduce to 16 bits */
-	dw1 = sum;
-	dw2 = sum >> 32;
-	CKSUM_ADD_CARRY(dw1, dw2);
-	w1 = dw1;
-	w2 = dw1 >> 16;
-	CKSUM_ADD_CARRY(w1, w2);
-	return w1;
-}
-
-/**
- * Process UDP or TCP checksum over possibly multi-segmented packet.
- * @param mb
- *   The pointer to the mbuf with the packet.
- * @param l4_ofs
- *   Offset to the beginning of the L4 header (should be in first segment).
- * @param cksum
- *   Already pre-calculated pseudo-header checksum value.
- * @return
- *   The complemented checksum.
- */
-static inline uint32_t
-__udptcp_mbuf_cksum(const struct rte_mbuf *mb, uint16_t l4_ofs,
-	uint32_t cksum)
-{
-	uint32_t dlen, i, plen;
-	const struct rte_mbuf *ms;
-	const void *data;
-
-	plen = rte_pktmbuf_pkt_len(mb);
-	ms = mb;
-
-	for (i = l4_ofs; i < plen && ms != NULL; i += dlen) {
-		data = rte_pktmbuf_mtod_offset(ms, const void *, l4_ofs);
-		dlen = rte_pktmbuf_data_len(ms) - l4_ofs;
-		cksum += __raw_cksum(data, dlen);
-		ms = ms->next;
-		l4_ofs = 0;
-	}
-
-	cksum = ((cksum & 0xffff0000) >> 16) + (cksum & 0xffff);
-	cksum = (~cksum) & 0xffff;
-	if (cksum == 0)
-		cksum = 0xffff;
-
-	return cksum;
-}
-
 /**
  * Process the pseudo-header checksum of an IPv4 header.
  *
@@ -216,7 +123,7 @@ _ipv4x_phdr_cksum(const struct rte_ipv4_hdr *ipv4_hdr, size_t ipv4h_len,
 	s1 = ipv4_hdr->dst_addr;
 	CKSUM_ADD_CARRY(s0, s1);
 
-	if (ol_flags & RTE_MBUF_F_TX_TCP_SEG)
+	if (ol_flags & (RTE_MBUF_F_TX_TCP_SEG | RTE_MBUF_F_TX_UDP_SEG))
 		s1 = 0;
 	else
 		s1 = rte_cpu_to_be_16(
@@ -424,6 +331,16 @@ free_mbufs(struct rte_mbuf *mb[], uint32_t num)
 		rte_pktmbuf_free(mb[i]);
 }
 
+/* update reference counter for all segments of the packet */
+static inline void
+_rte_pktmbuf_refcnt_update(struct rte_mbuf *m, int16_t v)
+{
+	do {
+		rte_mbuf_refcnt_update(m, v);
+		m = m->next;
+	} while (m != NULL);
+}
+
 /* empty ring and free queued mbufs */
 static inline void
 empty_mbuf_ring(struct rte_ring *r)
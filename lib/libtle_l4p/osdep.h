@@ -36,6 +36,8 @@ extern "C" {
  * logging related macros.
  */
 
+#define TLE_LOG(lvl, fmt, args...)      RTE_LOG(lvl, USER1, fmt, ##args)
+
 #define UDP_LOG(lvl, fmt, args...)      RTE_LOG(lvl, USER1, fmt, ##args)
 
 #define TCP_LOG(lvl, fmt, args...)      RTE_LOG(lvl, USER1, fmt, ##args)
@@ -0,0 +1,152 @@
+/*
+ * Copyright (c) 2016  Intel Corporation.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _PMTU_H_
+#define _PMTU_H_
+
+#include <string.h>
+#include <rte_common.h>
+#include <rte_cycles.h>
+#include <rte_memcpy.h>
+#include <rte_spinlock.h>
+#include <tle_ctx.h>
+
+#include "net_misc.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Per context cache of path MTU values discovered by PLPMTUD
+ * (RFC 8899), keyed by remote address.
+ * Direct mapped: on collision the older entry is simply overwritten.
+ * MTU values are stored in the same units as tle_dest.mtu.
+ */
+
+#define	PMTU_CACHE_NUM	0x400
+
+/* entry lifetime (ms), RFC 8899 5.1.1 PMTU_RAISE_TIMER. */
+#define	PMTU_CACHE_TMO	(600 * MS_PER_S)
+
+struct pmtu_ent {
+	uint32_t tms;   /* time of the last update */
+	uint16_t type;  /* TLE_V4/TLE_V6, TLE_VNUM for empty entry */
+	uint16_t mtu;
+	union {
+		uint32_t a4;
+		rte_xmm_t a6;
+	} addr;
+};
+
+struct pmtu_cache {
+	rte_spinlock_t lock;
+	struct pmtu_ent ent[PMTU_CACHE_NUM];
+};
+
+static inline uint32_t
+pmtu_hash(uint32_t type, const void *addr)
+{
+	uint32_t h;
+	const rte_xmm_t *a6;
+
+	if (type == TLE_V4)
+		h = *(const uint32_t *)addr;
+	else {
+		a6 = addr;
+		h = a6->u32[0] ^ a6->u32[1] ^ a6->u32[2] ^ a6->u32[3];
+	}
+
+	/* multiplicative hashing, PMTU_CACHE_NUM has to be power of two. */
+	h *= 0x9e3779b1;
+	return h >> (sizeof(h) * CHAR_BIT - rte_bsf32(PMTU_CACHE_NUM));
+}
+
+static inline int
+pmtu_ent_match(const struct pmtu_ent *pe, uint32_t type, const void *addr)
+{
+	if (pe->type != type)
+		return 0;
+	if (type == TLE_V4)
+		return pe->addr.a4 == *(const uint32_t *)addr;
+	return memcmp(&pe->addr.a6, addr, sizeof(pe->addr.a6)) == 0;
+}
+
+static inline void
+pmtu_cache_init(struct pmtu_cache *pc)
+{
+	uint32_t i;
+
+	rte_spinlock_init(&pc->lock);
+	for (i = 0; i != RTE_DIM(pc->ent); i++)
+		pc->ent[i].type = TLE_VNUM;
+}
+
+/*
+ * returns cached MTU for given remote address,
+ * or zero if there is no valid entry.
+ */
+static inline uint16_t
+pmtu_cache_lookup(struct pmtu_cache *pc, uint32_t type, const void *addr,
+	uint32_t tms)
+{
+	uint16_t mtu;
+	struct pmtu_ent *pe;
+
+	mtu = 0;
+	pe = pc->ent + pmtu_hash(type, addr);
+
+	rte_spinlock_lock(&pc->lock);
+	if (pmtu_ent_match(pe, type, addr) != 0 &&
+			tms - pe->tms < PMTU_CACHE_TMO)
+		mtu = pe->mtu;
+	rte_spinlock_unlock(&pc->lock);
+
+	return mtu;
+}
+
+/*
+ * store discovered MTU for given remote address,
+ * zero *mtu* value invalidates the entry.
+ */
+static inline void
+pmtu_cache_update(struct pmtu_cache *pc, uint32_t type, const void *addr,
+	uint16_t mtu, uint32_t tms)
+{
+	struct pmtu_ent *pe;
+
+	pe = pc->ent + pmtu_hash(type, addr);
+
+	rte_spinlock_lock(&pc->lock);
+	if (mtu == 0) {
+		if (pmtu_ent_match(pe, type, addr) != 0)
+			pe->type = TLE_VNUM;
+	} else {
+		pe->type = type;
+		if (type == TLE_V4)
+			pe->addr.a4 = *(const uint32_t *)addr;
+		else
+			rte_memcpy(&pe->addr.a6, addr, sizeof(pe->addr.a6));
+		pe->mtu = mtu;
+		pe->tms = tms;
+	}
+	rte_spinlock_unlock(&pc->lock);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _PMTU_H_ */
@@ -0,0 +1,134 @@
+/*
+ * Copyright (c) 2016  Intel Corporation.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _RLIM_H_
+#define _RLIM_H_
+
+#include <rte_common.h>
+#include <rte_mbuf.h>
+#include <rte_spinlock.h>
+#include <tle_ctx.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Token bucket rate limiter.
+ * Tokens are kept in 1/RLIM_SCALE byte units, to avoid loss of precision
+ * for low rates, and refilled lazily from the caller provided time:
+ * cached context time (tle_ctx.tms, see ctx_update_tms()), so all
+ * users see the same TSC based clock in the same units.
+ * Limiter can be shared by streams of different contexts, so caller's
+ * time might be a bit behind the time of the last refill.
+ * Token counter might go negative: packet is allowed to go if there
+ * is at least one token available, the whole packet length is charged.
+ * The debt is paid by subsequent refills.
+ */
+
+#define	RLIM_SCALE	1000
+
+struct tle_rlim {
+	rte_spinlock_t lock;
+	uint32_t tms;      /* time of the last refill */
+	int64_t tokens;    /* available tokens */
+	int64_t burst;     /* bucket depth */
+	uint64_t rate;     /* tokens per time unit */
+	struct tle_rlim_param prm;
+} __rte_cache_aligned;
+
+static inline void
+rlim_refill(struct tle_rlim *rl, uint32_t tms)
+{
+	int32_t dt;
+	uint64_t d, n;
+
+	/* caller's time is not ahead of the last refill, nothing to add. */
+	dt = tms - rl->tms;
+	if (dt <= 0)
+		return;
+
+	d = dt;
+	n = rl->burst - rl->tokens;
+	if (d < n / rl->rate)
+		n = d * rl->rate;
+
+	rl->tokens += n;
+	rl->tms = tms;
+}
+
+/*
+ * refill the bucket, returns number of bytes allowed to send
+ * (zero when bucket is empty).
+ */
+static inline uint32_t
+rlim_avail(struct tle_rlim *rl, uint32_t tms)
+{
+	int64_t n;
+
+	rte_spinlock_lock(&rl->lock);
+	rlim_refill(rl, tms);
+	n = rl->tokens;
+	rte_spinlock_unlock(&rl->lock);
+
+	if (n <= 0)
+		return 0;
+	return RTE_MAX(RTE_MIN(n / RLIM_SCALE, (int64_t)UINT32_MAX), 1);
+}
+
+/* consume tokens for *len* bytes that were actually sent. */
+static inline void
+rlim_charge(struct tle_rlim *rl, uint32_t len)
+{
+	if (len == 0)
+		return;
+
+	rte_spinlock_lock(&rl->lock);
+	rl->tokens -= (int64_t)len * RLIM_SCALE;
+	rte_spinlock_unlock(&rl->lock);
+}
+
+/*
+ * number of bytes output packet is charged for: L2/L3/L4 headers
+ * are excluded, so UDP is accounted the same way as TCP (payload only).
+ */
+static inline uint32_t
+rlim_pkt_len(const struct rte_mbuf *m)
+{
+	return m->pkt_len - (m->l2_len + m->l3_len + m->l4_len);
+}
+
+/*
+ * returns number of packets from *pkt[]* that are allowed to go,
+ * tokens are not consumed.
+ */
+static inline uint32_t
+rlim_admit_pkts(struct tle_rlim *rl, uint32_t tms,
+	struct rte_mbuf * const pkt[], uint32_t num)
+{
+	int64_t n;
+	uint32_t i;
+
+	n = rlim_avail(rl, tms);
+	for (i = 0; i != num && n > 0; i++)
+		n -= rlim_pkt_len(pkt[i]);
+	return i;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _RLIM_H_ */
@@ -35,6 +35,9 @@ struct tle_stream {
 
 	uint64_t udata; /* user data associated wih the stream */
 
+	uint32_t cbpend; /* (1 << STREAM_CB_*) deferred callbacks queued */
+	uint32_t cbreq;  /* (1 << STREAM_CB_*) deferred callbacks requested */
+
 	/* Stream address information. */
 	union l4_ports port;
 	union l4_ports pmsk;
@@ -51,6 +54,67 @@ struct tle_stream {
 	};
 };
 
+/* stream callbacks that can be deferred (TLE_CTX_FLAG_CB_DEFER). */
+enum {
+	STREAM_CB_RX,
+	STREAM_CB_TX,
+	STREAM_CB_ERR,
+	STREAM_CB_NUM
+};
+
+/* deferred callback queue entry. */
+struct stream_cbe {
+	struct tle_stream *s;
+	uint32_t op;
+	uint32_t pad;
+};
+
+/*
+ * invoke stream callback for *op*, or record it in the ctx deferred
+ * queue, unless it is already there.
+ * cbpend bit stays set till dispatch drains the entry, even across
+ * stream close, so queue holds at most STREAM_CB_NUM entries per
+ * stream and enqueue shouldn't fail.
+ * cbreq bit is what actually triggers the callback, it is cleared
+ * when the stream is closed, so stale entry never fires for the
+ * stream that was reopened in the same slot.
+ */
+static inline void
+stream_invoke_cb(struct tle_stream *s, const struct tle_stream_cb *cb,
+	uint32_t op)
+{
+	struct stream_cbe ce;
+
+	if (s->ctx->cbq == NULL) {
+		cb->func(cb->data, s);
+		return;
+	}
+
+	__atomic_fetch_or(&s->cbreq, 1 << op, __ATOMIC_ACQ_REL);
+	if ((__atomic_fetch_or(&s->cbpend, 1 << op, __ATOMIC_ACQ_REL) &
+			(1 << op)) != 0)
+		return;
+
+	ce.s = s;
+	ce.op = op;
+	ce.pad = 0;
+
+	/* don't leave *op* blocked forever, let next invoke retry. */
+	if (rte_ring_enqueue_elem(s->ctx->cbq, &ce, sizeof(ce)) != 0)
+		__atomic_fetch_and(&s->cbpend, ~(1 << op), __ATOMIC_ACQ_REL);
+}
+
+/*
+ * consume request for deferred callback *op*,
+ * caller has to hold the stream, so it can't be closed meanwhile.
+ */
+static inline int
+stream_take_cb(struct tle_stream *s, uint32_t op)
+{
+	return (__atomic_fetch_and(&s->cbreq, ~(1 << op), __ATOMIC_ACQ_REL) &
+		(1 << op)) != 0;
+}
+
 static inline uint32_t
 get_streams(struct tle_ctx *ctx, struct tle_stream *s[], uint32_t num)
 {
@@ -92,6 +156,12 @@ get_stream(struct tle_ctx *ctx)
 static inline void
 put_stream(struct tle_ctx *ctx, struct tle_stream *s, int32_t head)
 {
+	/*
+	 * deferred callbacks queued so far become stale,
+	 * cbpend is left to dispatch, as the entries are still in the queue.
+	 */
+	__atomic_store_n(&s->cbreq, 0, __ATOMIC_RELEASE);
+
 	s->type = TLE_VNUM;
 	rte_spinlock_lock(&ctx->streams.lock);
 	if (head != 0)
@@ -121,21 +191,107 @@ drb_nb_elem(const struct tle_ctx *ctx)
 		ctx->prm.send_bulk_size : MAX_PKT_BURST;
 }
 
+/* account up to *num* drbs within *lim*, returns number accounted. */
+static inline uint32_t
+drb_cnt_add(uint32_t *cnt, uint32_t lim, uint32_t num)
+{
+	uint32_t k, n;
+
+	n = __atomic_add_fetch(cnt, num, __ATOMIC_RELAXED);
+	k = (n > lim) ? RTE_MIN(n - lim, num) : 0;
+	if (k != 0)
+		__atomic_sub_fetch(cnt, k, __ATOMIC_RELAXED);
+	return num - k;
+}
+
+/*
+ * Drbs are allocated from the ctx pool, *nb_out* counts drbs
+ * the stream has in flight, that count can't exceed *nb_max*.
+ * If ctx keeps a reserve for control packets, only *ctl* requests
+ * can dig into it.
+ * Each drb carries pointer to its stream in udata,
+ * so BE can return it to the right stream.
+ */
+static inline uint32_t
+stream_drb_get(struct tle_ctx *ctx, void *s, uint32_t *nb_out,
+	uint32_t nb_max, uint32_t ctl, struct tle_drb *drbs[], uint32_t num)
+{
+	uint32_t i, k, lim, m, n;
+
+	if (num == 0)
+		return 0;
+
+	/* reserve drbs within the stream limit. */
+	n = drb_cnt_add(nb_out, nb_max, num);
+
+	/* and within the ctx limit. */
+	m = n;
+	if (ctx->drb.nb_resv != 0 && n != 0) {
+		lim = ctx->drb.nb_max + ((ctl != 0) ? ctx->drb.nb_resv : 0);
+		m = drb_cnt_add(&ctx->drb.nb_out, lim, n);
+	}
+
+	/* pool get is all or nothing, retry with smaller bulks. */
+	for (i = m; i != 0 &&
+			rte_mempool_get_bulk(ctx->drbs, (void **)drbs, i) != 0;
+			i /= 2)
+		;
+
+	if (i != n)
+		__atomic_sub_fetch(nb_out, n - i, __ATOMIC_RELAXED);
+	if (i != m && ctx->drb.nb_resv != 0)
+		__atomic_sub_fetch(&ctx->drb.nb_out, m - i, __ATOMIC_RELAXED);
+
+	for (k = 0; k != i; k++)
+		drbs[k]->udata = s;
+	return i;
+}
+
+/* returns number of drbs the stream had in flight before that call. */
+static inline uint32_t
+stream_drb_put(struct tle_ctx *ctx, uint32_t *nb_out,
+	struct tle_drb *drbs[], uint32_t num)
+{
+	rte_mempool_put_bulk(ctx->drbs, (void **)drbs, num);
+	if (ctx->drb.nb_resv != 0)
+		__atomic_sub_fetch(&ctx->drb.nb_out, num, __ATOMIC_RELEASE);
+	return __atomic_fetch_sub(nb_out, num, __ATOMIC_RELEASE);
+}
+
+static inline uint32_t
+stream_drb_out(const uint32_t *nb_out)
+{
+	return __atomic_load_n(nb_out, __ATOMIC_ACQUIRE);
+}
+
 static inline int32_t
 stream_get_dest(struct tle_stream *s, const void *dst_addr,
 	struct tle_dest *dst)
 {
 	int32_t rc;
+	uint32_t gen, set;
 	const struct in_addr *d4;
 	const struct in6_addr *d6;
 	struct tle_ctx *ctx;
 	struct tle_dev *dev;
+	struct dcache *dc;
 
 	ctx = s->ctx;
 
 	/* it is here just to keep gcc happy. */
 	d4 = NULL;
 	d6 = NULL;
+	gen = 0;
+	set = 0;
+
+	dc = ctx_dcache(ctx);
+	if (dc != NULL && s->type < TLE_VNUM) {
+		gen = rte_atomic32_read(&ctx->dcache.gen);
+		rc = dcache_lookup(dc, gen, s->type, s->udata, dst_addr, dst,
+			&set);
+		if (rc >= 0)
+			return rc;
+	}
 
 	if (s->type == TLE_V4) {
 		d4 = dst_addr;
@@ -167,7 +323,11 @@ stream_get_dest(struct tle_stream *s, const void *dst_addr,
 		}
 	}
 
-	return dev - ctx->dev;
+	rc = dev - ctx->dev;
+	if (dc != NULL)
+		dcache_update(dc, set, gen, s->type, s->udata, dst_addr, dst,
+			rc);
+	return rc;
 }
 
 #ifdef __cplusplus
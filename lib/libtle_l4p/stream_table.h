@@ -144,6 +144,30 @@ stbl_find_data(struct stbl *st, const union pkt_info *pi)
 	return (ent == NULL) ? NULL : ent->data;
 }
 
+/*
+ * bulk version of stbl_find_data() for keys of the same address family,
+ * *data[i]* is set to NULL when there is no entry for *key[i]*.
+ */
+static inline void
+stbl_find_data_bulk(struct stbl *st, uint32_t type,
+	const struct stbl_key *key[], void *data[], uint32_t num)
+{
+	uint32_t i, k, n;
+	struct shtbl *ht;
+	int32_t pos[RTE_HASH_LOOKUP_BULK_MAX];
+
+	ht = st->ht + type;
+
+	for (i = 0; i != num; i += n) {
+		n = RTE_MIN(num - i, (uint32_t)RTE_HASH_LOOKUP_BULK_MAX);
+		rte_hash_lookup_bulk(ht->t, (const void **)(uintptr_t)(key + i),
+			n, pos);
+		for (k = 0; k != n; k++)
+			data[i + k] = ((uint32_t)pos[k] >= ht->nb_ent) ?
+				NULL : ht->ent[pos[k]].data;
+	}
+}
+
 #include "tcp_stream.h"
 
 static inline void
@@ -190,6 +214,57 @@ stbl_add_stream_lock(struct stbl *st, const struct tle_tcp_stream *s)
 	return se;
 }
 
+/*
+ * add a batch of streams into the stream table, acquiring the lock
+ * only once per address family.
+ * entries with non-zero rc[] are skipped, for failed insertions
+ * rc[] is set to -ENOBUFS.
+ * returns number of successfully added streams.
+ */
+static inline uint32_t
+stbl_add_stream_bulk_lock(struct stbl *st, struct tle_tcp_stream *s[],
+	int32_t rc[], uint32_t num)
+{
+	uint32_t i, k, n, type;
+	int32_t ret;
+	struct stbl_key key;
+	struct shtbl *ht;
+
+	n = 0;
+	for (type = TLE_V4; type != TLE_VNUM; type++) {
+
+		ht = st->ht + type;
+
+		/* nothing to insert for that address family */
+		for (i = 0; i != num && (rc[i] != 0 || s[i]->s.type != type);
+				i++)
+			;
+		if (i == num)
+			continue;
+
+		stbl_lock(st, type);
+		for (k = i; k != num; k++) {
+
+			if (rc[k] != 0 || s[k]->s.type != type)
+				continue;
+
+			stbl_stream_fill_key(&key, &s[k]->s, type);
+			ret = rte_hash_add_key(ht->t, &key);
+			if ((uint32_t)ret >= ht->nb_ent) {
+				s[k]->ste = NULL;
+				rc[k] = -ENOBUFS;
+			} else {
+				s[k]->ste = ht->ent + ret;
+				s[k]->ste->data = (void *)(uintptr_t)s[k];
+				n++;
+			}
+		}
+		stbl_unlock(st, type);
+	}
+
+	return n;
+}
+
 static inline void
 stbl_del_stream(struct stbl *st, struct stbl_entry *se,
 	const struct tle_tcp_stream *s, uint32_t lock)
@@ -154,6 +154,7 @@ tcp_stream_reset(struct tle_ctx *ctx, struct tle_tcp_stream *s)
 
 	/* reset TX armed */
 	rte_atomic32_set(&s->tx.arm, 0);
+	s->tx.deficit = 0;
 
 	/* reset TCB */
 	uop = s->tcb.uop & ~TLE_TCP_OP_CLOSE_ABORT;
@@ -162,8 +163,13 @@ tcp_stream_reset(struct tle_ctx *ctx, struct tle_tcp_stream *s)
 	/* reset remote events */
 	s->err.rev = 0;
 
+	/* reset pending window update */
+	s->rx.wu = 0;
+
 	/* reset cached destination */
 	memset(&s->tx.dst, 0, sizeof(s->tx.dst));
+	s->tx.tmpl.len = 0;
+	memset(&s->tx.pmtu, 0, sizeof(s->tx.pmtu));
 
 	if (uop != TLE_TCP_OP_ACCEPT) {
 		/* free stream's destination port */
@@ -271,6 +277,42 @@ tcp_stream_get(struct tle_ctx *ctx, uint32_t flag)
 	return cs;
 }
 
+/*
+ * bulk version of tcp_stream_get():
+ * grab as many streams as possible from the free list in one go,
+ * the ones that still have packets pending for TX are returned back
+ * to the tail of the free list, the rest is allocated from the memtank.
+ * returns number of allocated streams.
+ */
+static inline uint32_t
+tcp_stream_get_bulk(struct tle_ctx *ctx, struct tle_tcp_stream *cs[],
+	uint32_t num, uint32_t flag)
+{
+	uint32_t i, k, n;
+	struct tle_tcp_stream *s;
+	struct tle_stream *fs[num];
+	struct tcp_streams *ts;
+
+	ts = CTX_TCP_STREAMS(ctx);
+
+	/* check TX pending list */
+	n = (ctx->streams.nb_free == 0) ? 0 : get_streams(ctx, fs, num);
+
+	for (i = 0, k = 0; i != n; i++) {
+		s = TCP_STREAM(fs[i]);
+		if (TCP_STREAM_TX_FINISHED(s))
+			cs[k++] = s;
+		else
+			put_stream(ctx, &s->s, 0);
+	}
+
+	if (k != num)
+		k += tle_memtank_alloc(ts->mts, (void **)(cs + k), num - k,
+			flag);
+
+	return k;
+}
+
 #ifdef __cplusplus
 }
 #endif
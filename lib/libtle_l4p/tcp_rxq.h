@@ -17,6 +17,7 @@
 #define _TCP_RXQ_H_
 
 #include "tcp_ofo.h"
+#include "evbulk.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -136,10 +137,10 @@ rx_data_enqueue(struct tle_tcp_stream *s, uint32_t seq, uint32_t len,
 	if (r != n) {
 		/* raise RX event */
 		if (s->rx.ev != NULL)
-			tle_event_raise(s->rx.ev);
+			evbulk_raise(s->rx.ev, TLE_EV_IN);
 		/* if RX queue was empty invoke RX notification callback. */
 		else if (s->rx.cb.func != NULL && r == 0)
-			s->rx.cb.func(s->rx.cb.data, &s->s);
+			stream_invoke_cb(&s->s, &s->rx.cb, STREAM_CB_RX);
 	}
 
 	return t;
@@ -20,6 +20,7 @@
 #include <rte_tcp.h>
 
 #include "tcp_stream.h"
+#include "evbulk.h"
 #include "tcp_timer.h"
 #include "stream_table.h"
 #include "syncookie.h"
@@ -28,8 +29,11 @@
 #include "tcp_rxq.h"
 #include "tcp_txq.h"
 #include "tcp_tx_seg.h"
+#include "rlim.h"
+#include "pmtu.h"
 
 #define	TCP_MAX_PKT_SEG	0x20
+#define	TCP_MAX_EST_BURST	0x40
 
 /*
  * checks if input TCP ports and IP addresses match given stream.
@@ -171,14 +175,17 @@ static inline void
 stream_drb_free(struct tle_tcp_stream *s, struct tle_drb *drbs[],
 	uint32_t nb_drb)
 {
-	_rte_ring_enqueue_burst(s->tx.drb.r, (void **)drbs, nb_drb);
+	stream_drb_put(s->s.ctx, &s->tx.drb.nb_out, drbs, nb_drb);
 }
 
+/* control packets can use ctx reserve and are not limited per stream. */
 static inline uint32_t
 stream_drb_alloc(struct tle_tcp_stream *s, struct tle_drb *drbs[],
-	uint32_t nb_drb)
+	uint32_t nb_drb, uint32_t ctl)
 {
-	return _rte_ring_dequeue_burst(s->tx.drb.r, (void **)drbs, nb_drb);
+	return stream_drb_get(s->s.ctx, s, &s->tx.drb.nb_out,
+		(ctl != 0) ? UINT32_MAX : s->tx.drb.nb_max, ctl,
+		drbs, nb_drb);
 }
 
 static inline uint32_t
@@ -205,6 +212,15 @@ tcp_stream_adjust_tms(const struct tle_tcp_stream *s, uint32_t tms)
 	return tms - s->ts_offset;
 }
 
+/* receive window to advertise in non-SYN segments. */
+static inline uint16_t
+calc_adv_wnd(const struct tcb *tcb)
+{
+	if (tcb->rcv.lwnd == 0)
+		return tcb->rcv.wnd >> tcb->rcv.wscale;
+	return RTE_MIN(tcb->rcv.wnd, tcb->rcv.lwnd) >> tcb->rcv.wscale;
+}
+
 static inline void
 fill_tcph(struct rte_tcp_hdr *l4h, const struct tcb *tcb, union l4_ports port,
 	uint32_t seq, uint8_t hlen, uint8_t flags)
@@ -214,9 +230,10 @@ fill_tcph(struct rte_tcp_hdr *l4h, const struct tcb *tcb, union l4_ports port,
 	l4h->src_port = port.dst;
 	l4h->dst_port = port.src;
 
-	wnd = (flags & TCP_FLAG_SYN) ?
-		RTE_MIN(tcb->rcv.wnd, (uint32_t)UINT16_MAX) :
-		tcb->rcv.wnd >> tcb->rcv.wscale;
+	if (flags & TCP_FLAG_SYN)
+		wnd = RTE_MIN(tcb->rcv.wnd, (uint32_t)UINT16_MAX);
+	else
+		wnd = calc_adv_wnd(tcb);
 
 	/* ??? use sse shuffle to hton all remaining 16 bytes at once. ??? */
 	l4h->sent_seq = rte_cpu_to_be_32(seq);
@@ -233,6 +250,169 @@ fill_tcph(struct rte_tcp_hdr *l4h, const struct tcb *tcb, union l4_ports port,
 		fill_tms_opts(l4h + 1, tcb->snd.ts, tcb->rcv.ts);
 }
 
+/*
+ * Build stream header template.
+ * Should be invoked when stream enters ESTABLISHED state,
+ * i.e. when destination, ports and TS option usage are already known.
+ */
+static inline void
+tcp_tmpl_init(struct tle_tcp_stream *s)
+{
+	uint32_t len, l4;
+	uint64_t cs;
+	struct tcp_tmpl *tm;
+	struct rte_tcp_hdr *l4h;
+	const struct tle_dest *dst;
+
+	tm = &s->tx.tmpl;
+	dst = &s->tx.dst;
+
+	len = dst->l2_len + dst->l3_len;
+	l4 = (s->tcb.rcv.ts != 0) ?
+		sizeof(*l4h) + TCP_TX_OPT_LEN_TMS : sizeof(*l4h);
+
+	rte_memcpy(tm->hdr, dst->hdr, len);
+
+	l4h = (struct rte_tcp_hdr *)(tm->hdr + len);
+	memset(l4h, 0, l4);
+	l4h->src_port = s->s.port.dst;
+	l4h->dst_port = s->s.port.src;
+	l4h->data_off = l4 / TCP_DATA_ALIGN << TCP_DATA_OFFSET;
+
+	cs = (uint32_t)l4h->src_port + l4h->dst_port;
+	if (l4 != sizeof(*l4h)) {
+		fill_tms_opts(l4h + 1, 0, 0);
+		cs += TCP_OPT_TMS_HDR;
+	}
+	tm->th_cksum = __cksum_reduce64(cs);
+
+	if (s->s.type == TLE_V4) {
+		struct rte_ipv4_hdr *l3h;
+		l3h = (struct rte_ipv4_hdr *)(tm->hdr + dst->l2_len);
+		l3h->total_length = 0;
+		l3h->packet_id = 0;
+		l3h->hdr_checksum = 0;
+		tm->ip_cksum = __raw_cksum((const uint8_t *)l3h, dst->l3_len);
+		cs = (uint64_t)l3h->src_addr + l3h->dst_addr +
+			rte_cpu_to_be_16(l3h->next_proto_id);
+	} else {
+		struct rte_ipv6_hdr *l3h;
+		l3h = (struct rte_ipv6_hdr *)(tm->hdr + dst->l2_len);
+		l3h->payload_len = 0;
+		tm->ip_cksum = 0;
+		cs = __raw_cksum((const uint8_t *)&l3h->src_addr,
+			sizeof(l3h->src_addr) + sizeof(l3h->dst_addr));
+		cs += rte_cpu_to_be_16(l3h->proto);
+	}
+	tm->ph_cksum = __cksum_reduce64(cs);
+
+	tm->l4_len = l4;
+	tm->len = len;
+}
+
+/* sum over TCP header fields, that are updated for each segment. */
+static inline uint16_t
+tcp_tmpl_dyn_cksum(const struct rte_tcp_hdr *l4h, uint32_t l4_len)
+{
+	uint64_t cs;
+	const uint32_t *opt;
+
+	cs = (uint64_t)l4h->sent_seq + l4h->recv_ack + l4h->rx_win +
+		*(const uint16_t *)&l4h->data_off;
+	if (l4_len != sizeof(*l4h)) {
+		opt = (const uint32_t *)(l4h + 1);
+		cs += (uint64_t)opt[1] + opt[2];
+	}
+	return __cksum_reduce64(cs);
+}
+
+static inline uint16_t
+tcp_tmpl_ip_cksum(const struct tcp_tmpl *tm, const struct rte_ipv4_hdr *l3h)
+{
+	uint16_t cs;
+
+	cs = __cksum_reduce64((uint64_t)tm->ip_cksum + l3h->total_length +
+		l3h->packet_id);
+	return (cs == UINT16_MAX) ? cs : ~cs;
+}
+
+/*
+ * full TCP checksum: precomputed pseudo-header (cs) and static header
+ * sums plus dynamic header fields, only payload has to be processed.
+ */
+static inline uint16_t
+tcp_tmpl_l4_cksum(const struct tcp_tmpl *tm, const struct rte_mbuf *m,
+	const struct rte_tcp_hdr *l4h, uint64_t cs)
+{
+	cs += tm->th_cksum;
+	cs += tcp_tmpl_dyn_cksum(l4h, tm->l4_len);
+	return __udptcp_mbuf_cksum(m, tm->len + tm->l4_len,
+		__cksum_reduce64(cs));
+}
+
+/* fill L2/L3/L4 headers of the data or ACK segment from the template. */
+static inline int
+tcp_fill_mbuf_tmpl(struct rte_mbuf *m, const struct tle_tcp_stream *s,
+	uint64_t ol_flags, uint32_t seq, uint32_t flags, uint32_t pid,
+	uint32_t swcsm)
+{
+	uint32_t l2, l3, l4, len, plen;
+	uint64_t cs;
+	struct rte_tcp_hdr *l4h;
+	const struct tcp_tmpl *tm;
+	char *l2h;
+
+	tm = &s->tx.tmpl;
+	l2 = s->tx.dst.l2_len;
+	l3 = s->tx.dst.l3_len;
+	l4 = tm->l4_len;
+	len = tm->len;
+	plen = m->pkt_len;
+
+	l2h = rte_pktmbuf_prepend(m, len + l4);
+	if (l2h == NULL)
+		return -EINVAL;
+
+	rte_memcpy(l2h, tm->hdr, len + l4);
+
+	/* patch per segment TCP fields */
+	l4h = (struct rte_tcp_hdr *)(l2h + len);
+	l4h->sent_seq = rte_cpu_to_be_32(seq);
+	l4h->recv_ack = rte_cpu_to_be_32(s->tcb.rcv.nxt);
+	l4h->tcp_flags = flags;
+	l4h->rx_win = rte_cpu_to_be_16(calc_adv_wnd(&s->tcb));
+	if (l4 != sizeof(*l4h))
+		fill_tms_opts(l4h + 1, s->tcb.snd.ts, s->tcb.rcv.ts);
+
+	m->tx_offload = _mbuf_tx_offload(l2, l3, l4, 0, 0, 0);
+	m->ol_flags |= ol_flags;
+
+	/* pseudo-header checksum, L4 length is excluded for TSO */
+	cs = tm->ph_cksum;
+	if ((ol_flags & RTE_MBUF_F_TX_TCP_SEG) == 0)
+		cs += rte_cpu_to_be_16(plen + l4);
+
+	if (s->s.type == TLE_V4) {
+		struct rte_ipv4_hdr *l3h;
+		l3h = (struct rte_ipv4_hdr *)(l2h + l2);
+		l3h->packet_id = rte_cpu_to_be_16(pid);
+		l3h->total_length = rte_cpu_to_be_16(plen + l3 + l4);
+		if ((ol_flags & RTE_MBUF_F_TX_IP_CKSUM) == 0 && swcsm != 0)
+			l3h->hdr_checksum = tcp_tmpl_ip_cksum(tm, l3h);
+	} else {
+		struct rte_ipv6_hdr *l3h;
+		l3h = (struct rte_ipv6_hdr *)(l2h + l2);
+		l3h->payload_len = rte_cpu_to_be_16(plen + l4);
+	}
+
+	if ((ol_flags & RTE_MBUF_F_TX_TCP_CKSUM) != 0)
+		l4h->cksum = __cksum_reduce64(cs);
+	else if (swcsm != 0)
+		l4h->cksum = tcp_tmpl_l4_cksum(tm, m, l4h, cs);
+
+	return 0;
+}
+
 static inline int
 tcp_fill_mbuf(struct rte_mbuf *m, const struct tle_tcp_stream *s,
 	const struct tle_dest *dst, uint64_t ol_flags,
@@ -243,6 +423,12 @@ tcp_fill_mbuf(struct rte_mbuf *m, const struct tle_tcp_stream *s,
 	struct rte_tcp_hdr *l4h;
 	char *l2h;
 
+	/* established stream, use pre-built headers */
+	if (dst == &s->tx.dst && s->tx.tmpl.len != 0 &&
+			(flags & (TCP_FLAG_SYN | TCP_FLAG_RST)) == 0)
+		return tcp_fill_mbuf_tmpl(m, s, ol_flags, seq, flags, pid,
+			swcsm);
+
 	len = dst->l2_len + dst->l3_len;
 	plen = m->pkt_len;
 
@@ -305,7 +491,7 @@ tcp_fill_mbuf(struct rte_mbuf *m, const struct tle_tcp_stream *s,
  *  - if no HW cksum offloads are enabled, calculates TCP checksum.
  */
 static inline void
-tcp_update_mbuf(struct rte_mbuf *m, uint32_t type, const struct tcb *tcb,
+tcp_update_mbuf_full(struct rte_mbuf *m, uint32_t type, const struct tcb *tcb,
 	uint32_t seq, uint32_t pid, uint8_t tcp_flags)
 {
 	struct rte_tcp_hdr *l4h;
@@ -352,6 +538,107 @@ tcp_update_mbuf(struct rte_mbuf *m, uint32_t type, const struct tcb *tcb,
 	}
 }
 
+/*
+ * Same as above, but uses stream header template:
+ * IPv4 header checksum is derived from the template partial sum,
+ * TCP checksum is calculated over payload only for the first
+ * transmission, and adjusted incrementally (RFC 1624) for retransmits.
+ */
+static inline void
+tcp_update_mbuf(struct rte_mbuf *m, const struct tle_tcp_stream *s,
+	uint32_t seq, uint32_t pid, uint8_t tcp_flags)
+{
+	struct rte_tcp_hdr *l4h;
+	const struct tcb *tcb;
+	const struct tcp_tmpl *tm;
+	uint32_t len;
+	uint16_t om;
+	uint64_t cs;
+
+	tcb = &s->tcb;
+	tm = &s->tx.tmpl;
+	len = m->l2_len + m->l3_len;
+
+	/* packet was built without template */
+	if (tm->len != len || tm->l4_len != m->l4_len) {
+		tcp_update_mbuf_full(m, s->s.type, tcb, seq, pid, tcp_flags);
+		return;
+	}
+
+	l4h = rte_pktmbuf_mtod_offset(m, struct rte_tcp_hdr *, len);
+	om = tcp_tmpl_dyn_cksum(l4h, tm->l4_len);
+
+	l4h->sent_seq = rte_cpu_to_be_32(seq);
+	l4h->recv_ack = rte_cpu_to_be_32(tcb->rcv.nxt);
+
+	l4h->tcp_flags |= tcp_flags;
+
+	if (tm->l4_len != sizeof(*l4h))
+		fill_tms_opts(l4h + 1, tcb->snd.ts, tcb->rcv.ts);
+
+	if (s->s.type == TLE_V4) {
+		struct rte_ipv4_hdr *l3h;
+		l3h = rte_pktmbuf_mtod_offset(m, struct rte_ipv4_hdr *,
+			m->l2_len);
+		l3h->hdr_checksum = 0;
+		l3h->packet_id = rte_cpu_to_be_16(pid);
+		if ((m->ol_flags & RTE_MBUF_F_TX_IP_CKSUM) == 0)
+			l3h->hdr_checksum = tcp_tmpl_ip_cksum(tm, l3h);
+	}
+
+	if ((m->ol_flags & RTE_MBUF_F_TX_TCP_CKSUM) != 0)
+		return;
+
+	/*
+	 * segments are queued with zero checksum (and it is reset to zero
+	 * each time segment payload changes),
+	 * while calculated checksum is never zero.
+	 */
+	if (l4h->cksum == 0) {
+		cs = tm->ph_cksum;
+		cs += rte_cpu_to_be_16(m->pkt_len - len);
+		l4h->cksum = tcp_tmpl_l4_cksum(tm, m, l4h, cs);
+	} else
+		l4h->cksum = __cksum_adjust(l4h->cksum, om,
+			tcp_tmpl_dyn_cksum(l4h, tm->l4_len));
+}
+
+/*
+ * update L3 length and L4 checksum,
+ * after some payload was appended to the already prepared packet:
+ * pseudo-header checksum for HW offload, or zero for SW checksum,
+ * so tcp_update_mbuf() recalculates it over the whole payload.
+ */
+static inline void
+tcp_update_mbuf_len(struct rte_mbuf *m, uint32_t type)
+{
+	uint32_t len;
+	struct rte_tcp_hdr *l4h;
+
+	len = m->l2_len + m->l3_len;
+	l4h = rte_pktmbuf_mtod_offset(m, struct rte_tcp_hdr *, len);
+
+	if (type == TLE_V4) {
+		struct rte_ipv4_hdr *l3h;
+		l3h = rte_pktmbuf_mtod_offset(m, struct rte_ipv4_hdr *,
+			m->l2_len);
+		l3h->total_length = rte_cpu_to_be_16(m->pkt_len - m->l2_len);
+		if ((m->ol_flags & RTE_MBUF_F_TX_TCP_CKSUM) != 0)
+			l4h->cksum = _ipv4x_phdr_cksum(l3h, m->l3_len,
+				m->ol_flags);
+	} else {
+		struct rte_ipv6_hdr *l3h;
+		l3h = rte_pktmbuf_mtod_offset(m, struct rte_ipv6_hdr *,
+			m->l2_len);
+		l3h->payload_len = rte_cpu_to_be_16(m->pkt_len - len);
+		if ((m->ol_flags & RTE_MBUF_F_TX_TCP_CKSUM) != 0)
+			l4h->cksum = rte_ipv6_phdr_cksum(l3h, m->ol_flags);
+	}
+
+	if ((m->ol_flags & RTE_MBUF_F_TX_TCP_CKSUM) == 0)
+		l4h->cksum = 0;
+}
+
 /* Send data packets that need to be ACK-ed by peer */
 static inline uint32_t
 tx_data_pkts(struct tle_tcp_stream *s, struct rte_mbuf *const m[], uint32_t num)
@@ -365,9 +652,12 @@ tx_data_pkts(struct tle_tcp_stream *s, struct rte_mbuf *const m[], uint32_t num)
 	nbm = (num + bsz - 1) / bsz;
 
 	/* allocate drbs, adjust number of packets. */
-	nb = stream_drb_alloc(s, drb, nbm);
+	nb = stream_drb_alloc(s, drb, nbm, 0);
+
+	/* ran out of drbs, BE has to retry later. */
+	if (nb != nbm)
+		s->tx.drb.wait = 1;
 
-	/* drb ring is empty. */
 	if (nb == 0)
 		return 0;
 
@@ -388,117 +678,456 @@ tx_data_pkts(struct tle_tcp_stream *s, struct rte_mbuf *const m[], uint32_t num)
 	return i;
 }
 
+/*
+ * PLPMTUD (RFC 8899) helpers.
+ * Probes are regular data segments, bigger than validated MSS.
+ * Probe is considered successful when it is fully acknowledged,
+ * and lost when BE is about to retransmit it.
+ */
+
+/* min difference between probe sizes to continue the search. */
+#define	TCP_PMTU_SEARCH_STEP	0x40
+
+/* RFC 8899 5.1.2 MAX_PROBES */
+#define	TCP_PMTU_MAX_PROBES	3
+
+/*
+ * number of consecutive retransmission timeouts
+ * to consider path as a black hole for the current MSS.
+ */
+#define	TCP_PMTU_BH_RETX	2
+
 static inline uint32_t
-tx_data_bulk(struct tle_tcp_stream *s, union seqlen *sl, struct rte_mbuf *mi[],
-	uint32_t num)
+pmtu_to_mss(uint32_t mtu, const struct tle_dest *dst)
 {
-	uint32_t fail, i, k, n, mss, pid, plen, sz, tn, type;
-	struct tle_dev *dev;
-	struct rte_mbuf *mb;
-	struct rte_mbuf *mo[MAX_PKT_BURST + TCP_MAX_PKT_SEG];
-	uint8_t tcp_flags;
+	return mtu - dst->l2_len - dst->l3_len - TCP_TX_HDR_DACK;
+}
 
-	mss = s->tcb.snd.mss;
-	type = s->s.type;
+static inline uint32_t
+mss_to_pmtu(uint32_t mss, const struct tle_dest *dst)
+{
+	return mss + dst->l2_len + dst->l3_len + TCP_TX_HDR_DACK;
+}
 
-	dev = s->tx.dst.dev;
-	pid = get_ip_pid(dev, num, type, (s->flags & TLE_CTX_FLAG_ST) != 0);
+static inline const void *
+tcp_stream_raddr(const struct tle_tcp_stream *s)
+{
+	if (s->s.type == TLE_V4)
+		return &s->s.ipv4.addr.src;
+	return &s->s.ipv6.addr.src;
+}
 
-	k = 0;
-	tn = 0;
-	fail = 0;
-	tcp_flags = 0x0;
+/*
+ * select next probe size or complete the search.
+ * First probe is always for the max possible size,
+ * after first failure binary search is used.
+ */
+static inline void
+tcp_pmtu_next(struct tle_tcp_stream *s, uint32_t tms)
+{
+	struct tcp_pmtu *pm;
+	const struct tle_dest *dst;
 
-	for (i = 0; i != num && sl->len != 0 && fail == 0; i++) {
+	pm = &s->tx.pmtu;
+	dst = &s->tx.dst;
 
-		mb = mi[i];
-		sz = RTE_MIN(sl->len, mss);
-		plen = PKT_L4_PLEN(mb);
+	pm->len = 0;
+	pm->fail = 0;
 
-		/*fast path, no need to use indirect mbufs. */
-		if (plen <= sz) {
+	if (pm->hi < pm->lo + TCP_PMTU_SEARCH_STEP) {
+		pm->st = TCP_PMTU_ST_DONE;
+		pm->tms = tms;
+		s->tcb.snd.mss = pm->lo;
+		pmtu_cache_update(s->s.ctx->pmtu, s->s.type,
+			tcp_stream_raddr(s), mss_to_pmtu(pm->lo, dst), tms);
+	} else {
+		pm->st = TCP_PMTU_ST_SEARCH;
+		s->tcb.snd.mss = (pm->hi == pm->max) ? pm->hi :
+			pm->lo + (pm->hi - pm->lo + 1) / 2;
+	}
+}
 
-			if (i == (num - 1)) {
-				tcp_flags |= TCP_FLAG_PSH;
-			}
+/*
+ * Should be invoked when stream enters ESTABLISHED state,
+ * right after snd.mss is set from tle_dest.mtu and peer MSS (*rmss*).
+ * Uses cached PMTU value (if any), otherwise starts the search.
+ */
+static inline void
+tcp_pmtu_init(struct tle_tcp_stream *s, uint32_t rmss)
+{
+	uint32_t max, mss, mtu, tms;
+	struct tcp_pmtu *pm;
+	const struct tle_ctx *ctx;
+	const struct tle_dest *dst;
 
-			/* update pkt TCP header */
-			tcp_update_mbuf(mb, type, &s->tcb, sl->seq, pid + i, tcp_flags);
+	pm = &s->tx.pmtu;
+	ctx = s->s.ctx;
+	dst = &s->tx.dst;
 
-			/* keep mbuf till ACK is received. */
-			rte_pktmbuf_refcnt_update(mb, 1);
-			sl->len -= plen;
-			sl->seq += plen;
-			mo[k++] = mb;
-		/* remaining snd.wnd is less them MSS, send nothing */
-		} else if (sz < mss)
-			break;
-		/* packet indirection needed */
-		else
-			RTE_VERIFY(0);
+	memset(pm, 0, sizeof(*pm));
+	pm->min = s->tcb.snd.mss;
+	pm->lo = pm->min;
 
-		if (k >= MAX_PKT_BURST) {
-			n = tx_data_pkts(s, mo, k);
-			fail = k - n;
-			tn += n;
-			k = 0;
-		}
-	}
+	if (ctx->pmtu == NULL || ctx->prm.pmtu_max <= dst->mtu)
+		return;
 
-	if (k != 0) {
-		n = tx_data_pkts(s, mo, k);
-		fail = k - n;
-		tn += n;
-	}
+	/* BE has to be able to split the biggest segment into *min* ones */
+	max = pmtu_to_mss(RTE_MIN(ctx->prm.pmtu_max, UINT16_MAX), dst);
+	max = RTE_MIN(max, rmss);
+	max = RTE_MIN(max, (uint32_t)pm->min * TCP_MAX_PKT_SEG);
+	if (max <= pm->min)
+		return;
 
-	if (fail != 0) {
-		sz = tcp_mbuf_seq_free(mo + n, fail);
-		sl->seq -= sz;
-		sl->len += sz;
-	}
+	pm->max = max;
+	pm->hi = max;
 
-	return tn;
+	tms = tcp_get_tms(ctx->cycles_ms_shift);
+	mtu = pmtu_cache_lookup(ctx->pmtu, s->s.type, tcp_stream_raddr(s),
+		tms);
+
+	/* path MTU is already known, use it */
+	if (mtu > dst->mtu) {
+		mss = RTE_MIN(pmtu_to_mss(mtu, dst), max);
+		pm->st = TCP_PMTU_ST_DONE;
+		pm->lo = mss;
+		pm->tms = tms;
+		s->tcb.snd.mss = mss;
+	} else
+		tcp_pmtu_next(s, tms);
 }
 
 /*
- * gets data from stream send buffer, updates it and
- * queues it into TX device queue.
- * Note that this function and is not MT safe.
+ * Check can segment bigger than validated MSS be sent as it is
+ * (i.e. as a probe). If that segment is a retransmission of the
+ * probe in flight, then consider the probe as lost.
  */
-static inline uint32_t
-tx_nxt_data(struct tle_tcp_stream *s, uint32_t tms)
+static inline int
+tcp_pmtu_probe(struct tle_tcp_stream *s, uint32_t seq, uint32_t plen)
 {
-	uint32_t n, num, tn, wnd;
-	struct rte_mbuf **mi;
-	union seqlen sl;
+	uint32_t tms;
+	struct tcp_pmtu *pm;
 
-	tn = 0;
-	wnd = s->tcb.snd.wnd - (uint32_t)(s->tcb.snd.nxt - s->tcb.snd.una);
-	sl.seq = s->tcb.snd.nxt;
-	sl.len = RTE_MIN(wnd, s->tcb.snd.cwnd);
+	pm = &s->tx.pmtu;
+	if (pm->st != TCP_PMTU_ST_SEARCH || plen > s->tcb.snd.mss)
+		return 0;
 
-	if (sl.len == 0)
-		return tn;
+	/* new probe */
+	if (pm->len == 0) {
+		pm->seq = seq;
+		pm->len = plen;
+		return 1;
+	}
 
-	/* update send timestamp */
-	s->tcb.snd.ts = tms;
+	/* probe retransmission */
+	if (pm->seq == seq) {
+		pm->len = 0;
+		if (++pm->fail >= TCP_PMTU_MAX_PROBES) {
+			pm->hi = plen - 1;
+			tms = tcp_get_tms(s->s.ctx->cycles_ms_shift);
+			tcp_pmtu_next(s, tms);
+		}
+	}
 
-	do {
-		/* get group of packets */
-		mi = tcp_txq_get_nxt_objs(s, &num);
+	return 0;
+}
 
-		/* stream send buffer is empty */
-		if (num == 0)
-			break;
+/* probe in flight was acknowledged, raise MSS */
+static inline void
+tcp_pmtu_ack(struct tle_tcp_stream *s)
+{
+	struct tcp_pmtu *pm;
 
-		/* queue data packets for TX */
-		n = tx_data_bulk(s, &sl, mi, num);
+	pm = &s->tx.pmtu;
+	if (pm->len == 0 ||
+			tcp_seq_lt((uint32_t)s->tcb.snd.una, pm->seq + pm->len))
+		return;
+
+	pm->lo = pm->len;
+	tcp_pmtu_next(s, tcp_get_tms(s->s.ctx->cycles_ms_shift));
+}
+
+/*
+ * RFC 8899 4.3 black hole detection:
+ * consecutive RTOs while segments bigger then base MSS are in use,
+ * fall back to the base MSS, invalidate cached value.
+ */
+static inline void
+tcp_pmtu_rto(struct tle_tcp_stream *s)
+{
+	uint32_t tms;
+	struct tcp_pmtu *pm;
+
+	pm = &s->tx.pmtu;
+	if (pm->st == TCP_PMTU_ST_DISABLED || pm->lo == pm->min ||
+			s->tcb.snd.nb_retx + 1 < TCP_PMTU_BH_RETX)
+		return;
+
+	tms = tcp_get_tms(s->s.ctx->cycles_ms_shift);
+	pmtu_cache_update(s->s.ctx->pmtu, s->s.type, tcp_stream_raddr(s),
+		0, tms);
+
+	pm->st = TCP_PMTU_ST_DONE;
+	pm->len = 0;
+	pm->lo = pm->min;
+	pm->hi = pm->min;
+	pm->tms = tms;
+	s->tcb.snd.mss = pm->min;
+}
+
+/* RFC 8899 5.1.1 PMTU_RAISE_TIMER: periodically restart the search. */
+static inline void
+tcp_pmtu_raise(struct tle_tcp_stream *s)
+{
+	uint32_t tms;
+	struct tcp_pmtu *pm;
+
+	pm = &s->tx.pmtu;
+	if (pm->st != TCP_PMTU_ST_DONE || pm->lo == pm->max)
+		return;
+
+	tms = tcp_get_tms(s->s.ctx->cycles_ms_shift);
+	if (tms - pm->tms >= PMTU_CACHE_TMO) {
+		pm->hi = pm->max;
+		tcp_pmtu_next(s, tms);
+	}
+}
+
+/*
+ * split segment bigger than *mss* into the smaller ones,
+ * original segment is kept intact in the TX queue for possible
+ * retransmission. Returns zero on success.
+ * If only some of the new segments were queued for TX, the whole
+ * original one will be transmitted again next time.
+ */
+static inline int
+tx_data_split(struct tle_tcp_stream *s, union seqlen *sl, struct rte_mbuf *mb,
+	uint32_t mss, uint8_t tcp_flags)
+{
+	int32_t rc;
+	uint32_t i, k, n, pid, plen, seq;
+	uint64_t ol_flags;
+	struct rte_mbuf *ms[TCP_MAX_PKT_SEG];
+
+	rc = tcp_segmentation_ofs(mb, mb->l2_len + mb->l3_len + mb->l4_len,
+		ms, RTE_DIM(ms), &s->tx.dst, mss);
+	if (rc <= 0)
+		return -ENOBUFS;
+
+	n = rc;
+	pid = get_ip_pid(s->tx.dst.dev, n, s->s.type,
+		(s->flags & TLE_CTX_FLAG_ST) != 0);
+	ol_flags = s->tx.dst.ol_flags;
+	seq = sl->seq;
+
+	for (i = 0; i != n; i++) {
+		plen = ms[i]->pkt_len;
+		rc = tcp_fill_mbuf(ms[i], s, &s->tx.dst, ol_flags, s->s.port,
+			seq, TCP_FLAG_ACK | ((i == n - 1) ? tcp_flags : 0),
+			pid + i, 1);
+		if (rc != 0)
+			break;
+		seq += plen;
+	}
+
+	k = (i == n) ? tx_data_pkts(s, ms, n) : 0;
+	if (k != n) {
+		free_mbufs(ms + k, n - k);
+		return -ENOBUFS;
+	}
+
+	sl->len -= seq - sl->seq;
+	sl->seq = seq;
+	return 0;
+}
+
+static inline uint32_t
+tx_data_bulk(struct tle_tcp_stream *s, union seqlen *sl, struct rte_mbuf *mi[],
+	uint32_t num)
+{
+	uint32_t fail, i, k, n, mss, pid, plen, sz, tn, type;
+	struct tle_dev *dev;
+	struct rte_mbuf *mb;
+	struct rte_mbuf *mo[MAX_PKT_BURST + TCP_MAX_PKT_SEG];
+	uint8_t tcp_flags;
+
+	/* while PMTU search is in progress, snd.mss is the probe size */
+	mss = (s->tx.pmtu.st == TCP_PMTU_ST_SEARCH) ?
+		s->tx.pmtu.lo : s->tcb.snd.mss;
+	type = s->s.type;
+
+	dev = s->tx.dst.dev;
+	pid = get_ip_pid(dev, num, type, (s->flags & TLE_CTX_FLAG_ST) != 0);
+
+	k = 0;
+	tn = 0;
+	fail = 0;
+	tcp_flags = 0x0;
+
+	for (i = 0; i != num && sl->len != 0 && fail == 0; i++) {
+
+		mb = mi[i];
+		plen = PKT_L4_PLEN(mb);
+
+		/* remaining snd.wnd is less them segment size, send nothing */
+		if (plen > sl->len)
+			break;
+
+		/*fast path, no need to use indirect mbufs. */
+		if (plen <= mss || tcp_pmtu_probe(s, sl->seq, plen) != 0) {
+
+			if (i == (num - 1)) {
+				tcp_flags |= TCP_FLAG_PSH;
+			}
+
+			/* update pkt TCP header */
+			tcp_update_mbuf(mb, s, sl->seq, pid + i, tcp_flags);
+
+			/* keep mbuf till ACK is received. */
+			_rte_pktmbuf_refcnt_update(mb, 1);
+			sl->len -= plen;
+			sl->seq += plen;
+			mo[k++] = mb;
+
+		/* segment is bigger than current MSS, indirection needed */
+		} else {
+
+			/* send already collected segments first */
+			if (k != 0) {
+				n = tx_data_pkts(s, mo, k);
+				fail = k - n;
+				tn += n;
+				k = 0;
+				if (fail != 0)
+					break;
+			}
+
+			if (i == (num - 1))
+				tcp_flags |= TCP_FLAG_PSH;
+
+			if (tx_data_split(s, sl, mb, mss, tcp_flags) != 0)
+				break;
+			tn++;
+		}
+
+		if (k >= MAX_PKT_BURST) {
+			n = tx_data_pkts(s, mo, k);
+			fail = k - n;
+			tn += n;
+			k = 0;
+		}
+	}
+
+	if (k != 0) {
+		n = tx_data_pkts(s, mo, k);
+		fail = k - n;
+		tn += n;
+	}
+
+	if (fail != 0) {
+		sz = tcp_mbuf_seq_free(mo + n, fail);
+		sl->seq -= sz;
+		sl->len += sz;
+	}
+
+	return tn;
+}
+
+/*
+ * check should the last not yet sent segment be held back
+ * (NAGLE/CORK semantics).
+ */
+static inline int
+tx_hold_partial(const struct tle_tcp_stream *s, uint32_t opts,
+	const struct rte_mbuf *m, uint32_t seq)
+{
+	uint32_t state;
+	struct rte_ring *r;
+
+	if (opts == 0 || PKT_L4_PLEN(m) >= s->tcb.snd.mss)
+		return 0;
+
+	/* stream is closing, FIN has to follow */
+	state = s->tcb.state;
+	if (state != TLE_TCP_ST_ESTABLISHED && state != TLE_TCP_ST_CLOSE_WAIT)
+		return 0;
+
+	/* segment was queued before last flush or is a retransmission */
+	r = s->tx.q;
+	if ((int32_t)(r->prod.tail - 1 - s->tx.push) < 0 ||
+			(int32_t)(r->prod.tail - 1 - s->tx.sent) < 0)
+		return 0;
+
+	if ((opts & TLE_TCP_TX_OPT_CORK) != 0)
+		return 1;
+
+	/* NAGLE: hold while there is unacknowledged data */
+	return seq != s->tcb.snd.una;
+}
+
+/* amount of new data peer and congestion windows allow to send. */
+static inline uint32_t
+tx_wnd_avail(const struct tle_tcp_stream *s)
+{
+	uint32_t wnd;
+
+	wnd = s->tcb.snd.wnd - (uint32_t)(s->tcb.snd.nxt - s->tcb.snd.una);
+	return RTE_MIN(wnd, s->tcb.snd.cwnd);
+}
+
+/*
+ * gets data from stream send buffer, updates it and
+ * queues it into TX device queue.
+ * No more then *lim* bytes of payload will be sent.
+ * Note that this function and is not MT safe.
+ */
+static inline uint32_t
+tx_nxt_data(struct tle_tcp_stream *s, uint32_t tms, uint32_t lim)
+{
+	uint32_t n, num, opts, tn;
+	struct rte_mbuf **mi;
+	union seqlen sl;
+
+	tn = 0;
+	sl.seq = s->tcb.snd.nxt;
+	sl.len = RTE_MIN(tx_wnd_avail(s), lim);
+
+	if (sl.len == 0)
+		return tn;
+
+	/* update send timestamp */
+	s->tcb.snd.ts = tms;
+
+	/*
+	 * FE might append data to the not yet sent segments.
+	 * Lock is taken regardless of the options in use,
+	 * as they can be changed by tle_tcp_stream_update_cfg() any time.
+	 */
+	rte_spinlock_lock(&s->tx.lock);
+	opts = s->tx.opts;
+
+	do {
+		/* get group of packets */
+		mi = tcp_txq_get_nxt_objs(s, &num);
+
+		/* hold last partially filled segment, if requested */
+		if (num != 0 && num == tcp_txq_nxt_cnt(s) &&
+				tx_hold_partial(s, opts, mi[num - 1], sl.seq))
+			num--;
+
+		/* stream send buffer is empty */
+		if (num == 0)
+			break;
+
+		/* queue data packets for TX */
+		n = tx_data_bulk(s, &sl, mi, num);
 		tn += n;
 
 		/* update consumer head */
 		tcp_txq_set_nxt_head(s, n);
 	} while (n == num);
 
+	rte_spinlock_unlock(&s->tx.lock);
+
 	s->tcb.snd.nxt += sl.seq - (uint32_t)s->tcb.snd.nxt;
 	return tn;
 }
@@ -518,7 +1147,10 @@ free_una_data(struct tle_tcp_stream *s, uint32_t len)
 		if (num == 0)
 			break;
 
-		/* free acked data */
+		/*
+		 * free acked data, for packets with external buffers
+		 * attached that triggers user completion callback.
+		 */
 		for (i = 0; i != num && plen != len; i++) {
 			uint32_t next_pkt_len = PKT_L4_PLEN(mi[i]);
 			if (plen + next_pkt_len > len) {
@@ -552,11 +1184,27 @@ calc_smss(uint16_t mss, const struct tle_dest *dst)
 {
 	uint16_t n;
 
-	n = dst->mtu - dst->l2_len - dst->l3_len - TCP_TX_HDR_DACK;
+	n = pmtu_to_mss(dst->mtu, dst);
 	mss = RTE_MIN(n, mss);
 	return mss;
 }
 
+/*
+ * MSS to announce to the peer.
+ * With PLPMTUD enabled, peer is allowed to send segments up to
+ * pmtu_max, otherwise peer MSS would limit our probes.
+ */
+static inline uint16_t
+calc_rmss(const struct tle_ctx *ctx, const struct tle_dest *dst)
+{
+	uint32_t mtu;
+
+	mtu = dst->mtu;
+	if (ctx->pmtu != NULL)
+		mtu = RTE_MAX(mtu, RTE_MIN(ctx->prm.pmtu_max, UINT16_MAX));
+	return pmtu_to_mss(mtu, dst);
+}
+
 /*
  * RFC 6928 2
  * min (10*MSS, max (2*MSS, 14600))
@@ -582,7 +1230,7 @@ send_pkt(struct tle_tcp_stream *s, struct tle_dev *dev, struct rte_mbuf *m)
 	uint32_t n, nb;
 	struct tle_drb *drb;
 
-	if (stream_drb_alloc(s, &drb, 1) == 0)
+	if (stream_drb_alloc(s, &drb, 1, 1) == 0)
 		return -ENOBUFS;
 
 	/* enqueue pkt for TX. */
@@ -698,7 +1346,7 @@ sync_ack(struct tle_tcp_stream *s, const union pkt_info *pi,
 	s->tcb.so.ts.val = sync_gen_ts(ts, s->tcb.so.wscale);
 	s->tcb.so.wscale = (s->tcb.so.wscale == TCP_WSCALE_NONE) ?
 		TCP_WSCALE_NONE : TCP_WSCALE_DEFAULT;
-	s->tcb.so.mss = calc_smss(dst.mtu, &dst);
+	s->tcb.so.mss = calc_rmss(s->s.ctx, &dst);
 
 	/* reset mbuf's data contents. */
 	len = m->l2_len + m->l3_len + m->l4_len;
@@ -856,9 +1504,9 @@ stream_term(struct tle_tcp_stream *s)
 
 	/* notify user that stream need to be closed */
 	} else if (s->err.ev != NULL)
-		tle_event_raise(s->err.ev);
+		evbulk_raise(s->err.ev, TLE_EV_ERR);
 	else if (s->err.cb.func != NULL)
-		s->err.cb.func(s->err.cb.data, &s->s);
+		stream_invoke_cb(&s->s, &s->err.cb, STREAM_CB_ERR);
 }
 
 static inline int
@@ -904,6 +1552,7 @@ accept_prep_stream(struct tle_tcp_stream *ps, struct stbl *st,
 	uint32_t tms, const union pkt_info *pi, const union seg_info *si)
 {
 	int32_t rc;
+	uint32_t mss;
 
 	/* some TX still pending for that stream. */
 	if (TCP_STREAM_TX_PENDING(cs))
@@ -935,19 +1584,30 @@ accept_prep_stream(struct tle_tcp_stream *ps, struct stbl *st,
 	cs->s.type = ps->s.type;
 	cs->flags = ps->flags;
 
+	/* inherit transmit options from the listen stream */
+	cs->tx.opts = ps->tx.opts;
+	cs->tx.push = cs->tx.q->prod.tail;
+	cs->tx.sent = cs->tx.q->prod.tail;
+	cs->tx.weight = ps->tx.weight;
+	cs->tx.deficit = 0;
+	cs->tx.rlim = ps->tx.rlim;
+
 	/* retrive and cache destination information. */
 	rc = stream_fill_dest(cs);
 	if (rc != 0)
 		return rc;
 
 	/* update snd.mss with SMSS value */
-	cs->tcb.snd.mss = calc_smss(cs->tcb.snd.mss, &cs->tx.dst);
+	mss = cs->tcb.snd.mss;
+	cs->tcb.snd.mss = calc_smss(mss, &cs->tx.dst);
 
 	/* setup congestion variables */
 	cs->tcb.snd.cwnd = initial_cwnd(cs->tcb.snd.mss, ps->tcb.snd.cwnd);
 	cs->tcb.snd.ssthresh = cs->tcb.snd.wnd;
 	cs->tcb.snd.rto_tw = ps->tcb.snd.rto_tw;
 
+	tcp_pmtu_init(cs, mss);
+	tcp_tmpl_init(cs);
 	cs->tcb.state = TLE_TCP_ST_ESTABLISHED;
 
 	/* add stream to the table */
@@ -1056,13 +1716,15 @@ rx_ackdata(struct tle_tcp_stream *s, uint32_t ack)
 		/* advance SND.UNA and free related packets. */
 		k = rte_ring_free_count(s->tx.q);
 		free_una_data(s, n);
+		tcp_pmtu_ack(s);
 
 		/* mark the stream as available for writing */
 		if (rte_ring_free_count(s->tx.q) != 0) {
 			if (s->tx.ev != NULL)
-				tle_event_raise(s->tx.ev);
+				evbulk_raise(s->tx.ev, TLE_EV_OUT);
 			else if (k == 0 && s->tx.cb.func != NULL)
-				s->tx.cb.func(s->tx.cb.data, &s->s);
+				stream_invoke_cb(&s->s, &s->tx.cb,
+					STREAM_CB_TX);
 		}
 	}
 
@@ -1096,9 +1758,9 @@ rx_fin_state(struct tle_tcp_stream *s, struct resp_info *rsp)
 		s->tcb.state = TLE_TCP_ST_CLOSE_WAIT;
 		/* raise err.ev & err.cb */
 		if (s->err.ev != NULL)
-			tle_event_raise(s->err.ev);
+			evbulk_raise(s->err.ev, TLE_EV_HUP);
 		else if (s->err.cb.func != NULL)
-			s->err.cb.func(s->err.cb.data, &s->s);
+			stream_invoke_cb(&s->s, &s->err.cb, STREAM_CB_ERR);
 	} else if (state == TLE_TCP_ST_FIN_WAIT_1 ||
 			state == TLE_TCP_ST_CLOSING) {
 		rsp->flags |= TCP_FLAG_ACK;
@@ -1647,13 +2309,15 @@ rx_synack(struct tle_tcp_stream *s, uint32_t ts, uint32_t state,
 	rsp->flags |= TCP_FLAG_ACK;
 
 	timer_stop(s);
+	tcp_pmtu_init(s, so.mss);
+	tcp_tmpl_init(s);
 	s->tcb.state = TLE_TCP_ST_ESTABLISHED;
 	rte_smp_wmb();
 
 	if (s->tx.ev != NULL)
-		tle_event_raise(s->tx.ev);
+		evbulk_raise(s->tx.ev, TLE_EV_OUT);
 	else if (s->tx.cb.func != NULL)
-		s->tx.cb.func(s->tx.cb.data, &s->s);
+		stream_invoke_cb(&s->s, &s->tx.cb, STREAM_CB_TX);
 
 	return 0;
 }
@@ -1857,10 +2521,11 @@ rx_postsyn(struct tle_dev *dev, struct stbl *st, uint32_t type, uint32_t ts,
 
 			/* inform listen stream about new connections */
 			if (s->rx.ev != NULL)
-				tle_event_raise(s->rx.ev);
+				evbulk_raise(s->rx.ev, TLE_EV_IN);
 			else if (s->rx.cb.func != NULL &&
 					rte_ring_count(s->rx.q) == 1)
-				s->rx.cb.func(s->rx.cb.data, &s->s);
+				stream_invoke_cb(&s->s, &s->rx.cb,
+					STREAM_CB_RX);
 
 			/* if there is no data, drop current packet */
 			if (PKT_L4_PLEN(mb[i]) == 0) {
@@ -1932,13 +2597,14 @@ tle_tcp_rx_bulk(struct tle_dev *dev, struct rte_mbuf *pkt[],
 {
 	struct stbl *st;
 	struct tle_ctx *ctx;
-	uint32_t i, j, k, mt, n, t, ts;
+	uint32_t i, j, k, mt, n, nb, t, ts;
 	union pkt_info pi[num];
 	union seg_info si[num];
 	union {
 		uint8_t t[TLE_VNUM];
 		uint32_t raw;
 	} stu;
+	struct evbulk eb;
 
 	ctx = dev->ctx;
 	ts = tcp_get_tms(ctx->cycles_ms_shift);
@@ -1947,6 +2613,11 @@ tle_tcp_rx_bulk(struct tle_dev *dev, struct rte_mbuf *pkt[],
 
 	stu.raw = 0;
 
+	/* reassemble IP fragments, if enabled. */
+	nb = num;
+	num = frag_reassemble(ctx, ctx->frag, IPPROTO_TCP, pkt, num, rp, rc,
+		&k);
+
 	/* extract packet info and check the L3/L4 csums */
 	for (i = 0; i != num; i++) {
 
@@ -1962,7 +2633,7 @@ tle_tcp_rx_bulk(struct tle_dev *dev, struct rte_mbuf *pkt[],
 	if (stu.t[TLE_V6] != 0)
 		stbl_lock(st, TLE_V6);
 
-	k = 0;
+	evbulk_start(&eb);
 	for (i = 0; i != num; i += j) {
 
 		t = pi[i].tf.type;
@@ -1992,7 +2663,8 @@ tle_tcp_rx_bulk(struct tle_dev *dev, struct rte_mbuf *pkt[],
 	if (stu.t[TLE_V6] != 0)
 		stbl_unlock(st, TLE_V6);
 
-	return num - k;
+	evbulk_finish(&eb);
+	return nb - k;
 }
 
 uint16_t
@@ -2004,6 +2676,7 @@ tle_tcp_stream_rx_bulk(struct tle_stream *ts, struct rte_mbuf *pkt[],
 	uint32_t i, j, k, n, t, tms;
 	union pkt_info pi[num];
 	union seg_info si[num];
+	struct evbulk eb;
 
 	ctx = ts->ctx;
 	tms = tcp_get_tms(ctx->cycles_ms_shift);
@@ -2026,6 +2699,7 @@ tle_tcp_stream_rx_bulk(struct tle_stream *ts, struct rte_mbuf *pkt[],
 			IPPROTO_TCP);
 	}
 
+	evbulk_start(&eb);
 	k = 0;
 	for (i = 0; i != num; i += j) {
 
@@ -2048,6 +2722,7 @@ tle_tcp_stream_rx_bulk(struct tle_stream *ts, struct rte_mbuf *pkt[],
 	}
 
 	tcp_stream_release(s);
+	evbulk_finish(&eb);
 	return num - k;
 }
 
@@ -2072,7 +2747,7 @@ tle_tcp_stream_accept(struct tle_stream *ts, struct tle_stream *rs[],
 	 */
 	if (n == num && rte_ring_count(s->rx.q) != 0) {
 		if (tcp_stream_try_acquire(s) > 0 && s->rx.ev != NULL)
-			tle_event_raise(s->rx.ev);
+			tle_event_raise_mask(s->rx.ev, TLE_EV_IN);
 		tcp_stream_release(s);
 	}
 
@@ -2197,7 +2872,7 @@ tx_syn(struct tle_tcp_stream *s, const struct sockaddr *addr)
 	s->tcb.so.ts.val = tms;
 	s->tcb.so.ts.ecr = 0;
 	s->tcb.so.wscale = TCP_WSCALE_DEFAULT;
-	s->tcb.so.mss = calc_smss(s->tx.dst.mtu, &s->tx.dst);
+	s->tcb.so.mss = calc_rmss(s->s.ctx, &s->tx.dst);
 
 	/* note that rcv.nxt is 0 here for sync_gen_seq.*/
 	seq = sync_gen_seq(&pi, s->tcb.rcv.nxt, tms, s->tcb.so.mss,
@@ -2272,11 +2947,10 @@ tle_tcp_stream_connect(struct tle_stream *ts, const struct sockaddr *addr)
  * updates stream's TCB.
  */
 static inline void
-tcb_establish(struct tle_tcp_stream *s, const struct tle_tcp_conn_info *ci)
+tcb_establish(struct tle_tcp_stream *s, const struct tle_tcp_conn_info *ci,
+	uint32_t tms)
 {
-	uint32_t mss, tms;
-
-	tms = tcp_get_tms(s->s.ctx->cycles_ms_shift);
+	uint32_t mss;
 
 	/* set a default MSS if it is unset (0) */
 	if ((ci->so.mss == 0) && (s->s.type == TLE_V4)) {
@@ -2319,7 +2993,7 @@ tle_tcp_stream_establish(struct tle_ctx *ctx,
 	struct stbl *st;
 
 	if (ctx == NULL || prm == NULL || ci == NULL) {
-		rte_errno = -EINVAL;
+		rte_errno = EINVAL;
 		return NULL;
 	}
 
@@ -2354,7 +3028,9 @@ tle_tcp_stream_establish(struct tle_ctx *ctx,
 		}
 
 		/* fill TCB from user provided data */
-		tcb_establish(s, ci);
+		tcb_establish(s, ci, tcp_get_tms(ctx->cycles_ms_shift));
+		tcp_pmtu_init(s, s->tcb.so.mss);
+		tcp_tmpl_init(s);
 		s->tcb.state = TLE_TCP_ST_ESTABLISHED;
 		tcp_stream_up(s);
 
@@ -2364,12 +3040,88 @@ tle_tcp_stream_establish(struct tle_ctx *ctx,
 	if (rc != 0) {
 		tcp_stream_reset(ctx, s);
 		rte_errno = -rc;
-		s = NULL;
+		return NULL;
 	}
 
 	return &s->s;
 }
 
+static uint32_t
+stream_establish_bulk(struct tle_ctx *ctx,
+	const struct tle_tcp_stream_param prm[],
+	const struct tle_tcp_conn_info ci[], struct tle_stream *ts[],
+	int32_t rc[], uint32_t num, uint32_t flags)
+{
+	uint32_t i, k, n, tms;
+	struct tle_tcp_stream *s[num];
+
+	/* allocate new streams */
+	n = tcp_stream_get_bulk(ctx, s, num,
+		TLE_MTANK_ALLOC_CHUNK | TLE_MTANK_ALLOC_GROW);
+
+	for (i = n; i != num; i++) {
+		ts[i] = NULL;
+		rc[i] = -ENFILE;
+	}
+
+	/* check and use stream addresses and parameters */
+	for (i = 0; i != n; i++) {
+		s[i]->tcb.uop |= TLE_TCP_OP_ESTABLISH;
+		rc[i] = tcp_stream_fill_prm(s[i], prm + i);
+		if (rc[i] == 0)
+			rc[i] = stream_fill_dest(s[i]);
+	}
+
+	/* add streams to the stream table */
+	if ((flags & TLE_TCP_STREAM_F_PRIVATE) == 0)
+		stbl_add_stream_bulk_lock(CTX_TCP_STLB(ctx), s, rc, n);
+
+	/* fill TCBs from user provided data, cleanup on failure */
+	tms = tcp_get_tms(ctx->cycles_ms_shift);
+
+	k = 0;
+	for (i = 0; i != n; i++) {
+		if (rc[i] == 0) {
+			tcb_establish(s[i], ci + i, tms);
+			tcp_pmtu_init(s[i], s[i]->tcb.so.mss);
+			tcp_tmpl_init(s[i]);
+			s[i]->tcb.state = TLE_TCP_ST_ESTABLISHED;
+			tcp_stream_up(s[i]);
+			ts[i] = &s[i]->s;
+			k++;
+		} else {
+			tcp_stream_reset(ctx, s[i]);
+			ts[i] = NULL;
+		}
+	}
+
+	return k;
+}
+
+uint32_t
+tle_tcp_stream_establish_bulk(struct tle_ctx *ctx,
+	const struct tle_tcp_stream_param prm[],
+	const struct tle_tcp_conn_info ci[], struct tle_stream *ts[],
+	int32_t rc[], uint32_t num, uint32_t flags)
+{
+	uint32_t i, k, n;
+
+	if (ctx == NULL || prm == NULL || ci == NULL || ts == NULL ||
+			rc == NULL) {
+		rte_errno = EINVAL;
+		return 0;
+	}
+
+	k = 0;
+	for (i = 0; i != num; i += n) {
+		n = RTE_MIN(num - i, (uint32_t)TCP_MAX_EST_BURST);
+		k += stream_establish_bulk(ctx, prm + i, ci + i, ts + i,
+			rc + i, n, flags);
+	}
+
+	return k;
+}
+
 uint16_t
 tle_tcp_stream_recv(struct tle_stream *ts, struct rte_mbuf *pkt[], uint16_t num)
 {
@@ -2387,7 +3139,7 @@ tle_tcp_stream_recv(struct tle_stream *ts, struct rte_mbuf *pkt[], uint16_t num)
 	 */
 	if (n == num && rte_ring_count(s->rx.q) != 0) {
 		if (tcp_stream_try_acquire(s) > 0 && s->rx.ev != NULL)
-			tle_event_raise(s->rx.ev);
+			tle_event_raise_mask(s->rx.ev, TLE_EV_IN);
 		tcp_stream_release(s);
 	}
 
@@ -2449,7 +3201,92 @@ tle_tcp_stream_readv(struct tle_stream *ts, const struct iovec *iov,
 	 */
 	if (i == iovcnt && rte_ring_count(s->rx.q) != 0) {
 		if (tcp_stream_try_acquire(s) > 0 && s->rx.ev != NULL)
-			tle_event_raise(s->rx.ev);
+			tle_event_raise_mask(s->rx.ev, TLE_EV_IN);
+		tcp_stream_release(s);
+	}
+
+	return sz;
+}
+
+int
+tle_tcp_stream_peekv(struct tle_stream *ts, struct iovec iov[], int iovcnt)
+{
+	uint32_t i, j, k, mn;
+	struct tle_tcp_stream *s;
+	struct rte_mbuf *m;
+	struct rxq_objs mo[2];
+
+	if (ts == NULL || iov == NULL || iovcnt <= 0)
+		return -EINVAL;
+
+	s = TCP_STREAM(ts);
+
+	/* get group of packets */
+	mn = tcp_rxq_get_objs(s, mo);
+	if (mn == 0)
+		return 0;
+
+	k = 0;
+	for (i = 0; i != mn && k != (uint32_t)iovcnt; i++) {
+		for (j = 0; j != mo[i].num && k != (uint32_t)iovcnt; j++) {
+			for (m = mo[i].mb[j]; m != NULL && k != (uint32_t)iovcnt;
+					m = m->next) {
+				if (m->data_len == 0)
+					continue;
+				iov[k].iov_base = rte_pktmbuf_mtod(m, void *);
+				iov[k].iov_len = m->data_len;
+				k++;
+			}
+		}
+	}
+
+	/* leave all packets inside the RX queue */
+	_rte_ring_mcs_dequeue_abort(s->rx.q);
+	return k;
+}
+
+size_t
+tle_tcp_stream_consume(struct tle_stream *ts, size_t len)
+{
+	uint32_t i, j, mn, n;
+	size_t sz;
+	struct tle_tcp_stream *s;
+	struct rte_mbuf *m;
+	struct rxq_objs mo[2];
+
+	s = TCP_STREAM(ts);
+
+	/* get group of packets */
+	mn = tcp_rxq_get_objs(s, mo);
+	if (mn == 0)
+		return 0;
+
+	sz = 0;
+	n = 0;
+	for (i = 0; i != mn && sz != len; i++) {
+		for (j = 0; j != mo[i].num && sz != len; j++) {
+			m = mo[i].mb[j];
+			if (m->pkt_len <= len - sz) {
+				sz += m->pkt_len;
+				rte_pktmbuf_free(m);
+				n++;
+			/* partly consumed mbuf stays in the queue */
+			} else {
+				mo[i].mb[j] = _rte_pktmbuf_adj(m, len - sz);
+				sz = len;
+			}
+		}
+	}
+
+	tcp_rxq_consume(s, n);
+
+	/*
+	 * if we still have packets to read,
+	 * then rearm stream RX event.
+	 */
+	if (rte_ring_count(s->rx.q) != 0) {
+		if (tcp_stream_try_acquire(s) > 0 && s->rx.ev != NULL)
+			tle_event_raise_mask(s->rx.ev, TLE_EV_IN);
 		tcp_stream_release(s);
 	}
 
@@ -2483,14 +3320,202 @@ tx_segments(struct tle_tcp_stream *s, uint64_t ol_flags,
 	return rc;
 }
 
+/*
+ * find the last not yet sent segment in the stream send queue,
+ * that can be used to append more data to it.
+ * should be called with stream tx lock held.
+ * returns NULL if there is no such segment.
+ */
+static inline struct rte_mbuf *
+tx_coalesce_seg(const struct tle_tcp_stream *s, uint32_t *room)
+{
+	uint32_t len, plen;
+	struct rte_ring *r;
+	struct rte_mbuf *m;
+
+	if (tcp_txq_nxt_cnt(s) == 0)
+		return NULL;
+
+	/* segment was already sent, its checksum can't be patched */
+	r = s->tx.q;
+	if ((int32_t)(r->prod.tail - 1 - s->tx.sent) < 0)
+		return NULL;
+
+	m = ((struct rte_mbuf **)_rte_ring_get_data(r))[(r->prod.tail - 1) &
+		_rte_ring_get_mask(r)];
+
+	/* segment is still referenced by the device or is not a plain one */
+	if (rte_mbuf_refcnt_read(m) != 1 || m->next != NULL ||
+			!RTE_MBUF_DIRECT(m))
+		return NULL;
+
+	plen = PKT_L4_PLEN(m);
+	if (plen >= s->tcb.snd.mss)
+		return NULL;
+
+	len = RTE_MIN(s->tcb.snd.mss - plen,
+		(uint32_t)rte_pktmbuf_tailroom(m));
+	if (len == 0)
+		return NULL;
+
+	*room = len;
+	return m;
+}
+
+/* append data to the not yet sent segment and fix its headers */
+static inline void
+tx_coalesce_append(const struct tle_tcp_stream *s, struct rte_mbuf *m,
+	const void *data, uint32_t len)
+{
+	void *dst;
+
+	dst = rte_pktmbuf_append(m, len);
+	rte_memcpy(dst, data, len);
+	tcp_update_mbuf_len(m, s->s.type);
+}
+
+/*
+ * append small packets to the last not yet sent segment.
+ * returns number of consumed (and freed) packets.
+ */
+static inline uint32_t
+tx_coalesce_pkts(struct tle_tcp_stream *s, struct rte_mbuf *pkt[],
+	uint32_t num)
+{
+	uint32_t i, len, room;
+	struct rte_mbuf *m;
+
+	rte_spinlock_lock(&s->tx.lock);
+
+	for (i = 0; i != num && pkt[i]->nb_segs == 1; i++) {
+		len = pkt[i]->data_len;
+		m = tx_coalesce_seg(s, &room);
+		if (m == NULL || len > room)
+			break;
+		tx_coalesce_append(s, m, rte_pktmbuf_mtod(pkt[i], const void *),
+			len);
+		rte_pktmbuf_free(pkt[i]);
+	}
+
+	rte_spinlock_unlock(&s->tx.lock);
+	return i;
+}
+
+/*
+ * append user data to the last not yet sent segment.
+ * returns number of bytes appended, *iv* is updated accordingly.
+ */
+static inline size_t
+tx_coalesce_iovec(struct tle_tcp_stream *s, struct iovec *iv)
+{
+	uint32_t len, room;
+	struct rte_mbuf *m;
+
+	rte_spinlock_lock(&s->tx.lock);
+
+	len = 0;
+	m = tx_coalesce_seg(s, &room);
+	if (m != NULL) {
+		len = RTE_MIN(room, iv->iov_len);
+		tx_coalesce_append(s, m, iv->iov_base, len);
+		iv->iov_base = (uint8_t *)iv->iov_base + len;
+		iv->iov_len -= len;
+	}
+
+	rte_spinlock_unlock(&s->tx.lock);
+	return len;
+}
+
+/*
+ * queue packets into the stream send buffer,
+ * segment packets that are bigger than MSS.
+ * returns number of consumed packets, error code is stored in *rc*.
+ */
+static inline uint32_t
+tx_pkts(struct tle_tcp_stream *s, struct rte_mbuf *pkt[], uint32_t num,
+	int32_t *rc)
+{
+	uint32_t i, j, k, mss, n;
+	int32_t ret;
+	uint64_t ol_flags;
+	struct rte_mbuf *segs[TCP_MAX_PKT_SEG];
+
+	mss = s->tcb.snd.mss;
+	ol_flags = s->tx.dst.ol_flags;
+
+	/* append small packets to the not yet sent segment */
+	k = (s->tx.opts != 0) ? tx_coalesce_pkts(s, pkt, num) : 0;
+
+	ret = 0;
+	while (k != num) {
+		/* prepare and check for TX */
+		for (i = k; i != num; i++) {
+			if (pkt[i]->pkt_len > mss ||
+					pkt[i]->nb_segs > TCP_MAX_PKT_SEG)
+				break;
+			ret = tcp_fill_mbuf(pkt[i], s, &s->tx.dst, ol_flags,
+				s->s.port, 0, TCP_FLAG_ACK, 0, 0);
+			if (ret != 0)
+				break;
+		}
+
+		if (i != k) {
+			/* queue packets for further transmission. */
+			n = _rte_ring_enqueue_burst(s->tx.q,
+				(void **)pkt + k, (i - k));
+			k += n;
+
+			/*
+			 * for unsent, but already modified packets:
+			 * remove pkt l2/l3 headers, restore ol_flags
+			 */
+			if (i != k) {
+				ol_flags = ~s->tx.dst.ol_flags;
+				for (j = k; j != i; j++) {
+					rte_pktmbuf_adj(pkt[j], pkt[j]->l2_len +
+						pkt[j]->l3_len +
+						pkt[j]->l4_len);
+					pkt[j]->ol_flags &= ol_flags;
+				}
+				break;
+			}
+		}
+
+		if (ret != 0)
+			break;
+
+		/* segment large packet and enqueue for sending */
+		else if (i != num) {
+			/* segment the packet. */
+			ret = tcp_segmentation(pkt[i], segs, RTE_DIM(segs),
+				&s->tx.dst, mss);
+			if (ret < 0)
+				break;
+
+			ret = tx_segments(s, ol_flags, segs, ret);
+			if (ret == 0) {
+				/* free the large mbuf */
+				rte_pktmbuf_free(pkt[i]);
+				/* set the mbuf as consumed */
+				k++;
+			} else {
+				/* no space left in tx queue */
+				ret = 0;
+				break;
+			}
+		}
+	}
+
+	*rc = ret;
+	return k;
+}
+
 uint16_t
 tle_tcp_stream_send(struct tle_stream *ts, struct rte_mbuf *pkt[], uint16_t num)
 {
-	uint32_t i, j, k, mss, n, state;
+	uint32_t k, state;
 	int32_t rc;
-	uint64_t ol_flags;
 	struct tle_tcp_stream *s;
-	struct rte_mbuf *segs[TCP_MAX_PKT_SEG];
 
 	s = TCP_STREAM(ts);
 
@@ -2507,93 +3532,146 @@ tle_tcp_stream_send(struct tle_stream *ts, struct rte_mbuf *pkt[], uint16_t num)
 		return 0;
 	}
 
-	mss = s->tcb.snd.mss;
-	ol_flags = s->tx.dst.ol_flags;
+	k = tx_pkts(s, pkt, num, &rc);
+	if (rc != 0)
+		rte_errno = -rc;
 
-	k = 0;
+	/* notify BE about more data to send */
+	if (k != 0)
+		txs_enqueue(s->s.ctx, s);
+	/* if possible, re-arm stream write event. */
+	if (rte_ring_free_count(s->tx.q) != 0 && s->tx.ev != NULL)
+		tle_event_raise_mask(s->tx.ev, TLE_EV_OUT);
+
+	tcp_stream_release(s);
+
+	return k;
+}
+
+/*
+ * limit receive window of the *si* stream by the space available
+ * in the send buffer of the *so* stream.
+ * Once all spliced data is consumed (input stream receive buffer and
+ * output stream send buffer are both empty), the limit is removed.
+ */
+static inline void
+splice_link_wnd(struct tle_tcp_stream *si, const struct tle_tcp_stream *so)
+{
+	uint32_t n, q, ow, wnd;
+
+	q = rte_ring_count(si->rx.q);
+
+	if (q == 0 && rte_ring_count(so->tx.q) == 0)
+		wnd = 0;
+	else {
+		n = rte_ring_free_count(so->tx.q);
+		wnd = (n > q) ? (n - q) * so->tcb.snd.mss : 0;
+		wnd = RTE_MAX(wnd, 1U);
+	}
+
+	ow = si->tcb.rcv.lwnd;
+	si->tcb.rcv.lwnd = wnd;
+
+	/* window re-opened, notify the peer */
+	if (ow != 0 && ow < si->tcb.rcv.mss &&
+			(wnd == 0 || wnd >= si->tcb.rcv.mss)) {
+		si->rx.wu = 1;
+		txs_enqueue(si->s.ctx, si);
+	}
+}
+
+ssize_t
+tle_tcp_stream_splice(struct tle_stream *ts_in, struct tle_stream *ts_out)
+{
+	int32_t rc;
+	uint32_t i, j, k, l, mn, n, state, tn;
+	size_t sz;
+	struct tle_tcp_stream *si, *so;
+	struct rxq_objs mo[2];
+	uint32_t len[MAX_PKT_BURST];
+
+	si = TCP_STREAM(ts_in);
+	so = TCP_STREAM(ts_out);
+
+	/* mark output stream as not closable. */
+	if (tcp_stream_acquire(so) < 0) {
+		rte_errno = EAGAIN;
+		return -1;
+	}
+
+	state = so->tcb.state;
+	if (state != TLE_TCP_ST_ESTABLISHED && state != TLE_TCP_ST_CLOSE_WAIT) {
+		rte_errno = ENOTCONN;
+		tcp_stream_release(so);
+		return -1;
+	}
+
+	/* get group of packets */
+	mn = tcp_rxq_get_objs(si, mo);
+
+	/* move them into the output stream send buffer */
 	rc = 0;
-	while (k != num) {
-		/* prepare and check for TX */
-		for (i = k; i != num; i++) {
-			if (pkt[i]->pkt_len > mss ||
-					pkt[i]->nb_segs > TCP_MAX_PKT_SEG)
-				break;
-			rc = tcp_fill_mbuf(pkt[i], s, &s->tx.dst, ol_flags,
-				s->s.port, 0, TCP_FLAG_ACK, 0, 0);
-			if (rc != 0)
-				break;
-		}
+	sz = 0;
+	tn = 0;
+	for (i = 0; i != mn; i++) {
 
-		if (i != k) {
-			/* queue packets for further transmission. */
-			n = _rte_ring_enqueue_burst(s->tx.q,
-				(void **)pkt + k, (i - k));
-			k += n;
+		for (j = 0; j != mo[i].num; j += k) {
 
-			/*
-			 * for unsent, but already modified packets:
-			 * remove pkt l2/l3 headers, restore ol_flags
-			 */
-			if (i != k) {
-				ol_flags = ~s->tx.dst.ol_flags;
-				for (j = k; j != i; j++) {
-					rte_pktmbuf_adj(pkt[j], pkt[j]->l2_len +
-						pkt[j]->l3_len +
-						pkt[j]->l4_len);
-					pkt[j]->ol_flags &= ol_flags;
-				}
+			n = RTE_MIN(mo[i].num - j, RTE_DIM(len));
+			for (k = 0; k != n; k++)
+				len[k] = mo[i].mb[j + k]->pkt_len;
+
+			k = tx_pkts(so, mo[i].mb + j, n, &rc);
+			for (l = 0; l != k; l++)
+				sz += len[l];
+			tn += k;
+
+			if (k != n)
 				break;
-			}
 		}
 
-		if (rc != 0) {
-			rte_errno = -rc;
+		/* no more space in the output stream */
+		if (j != mo[i].num)
 			break;
+	}
 
-		/* segment large packet and enqueue for sending */
-		} else if (i != num) {
-			/* segment the packet. */
-			rc = tcp_segmentation(pkt[i], segs, RTE_DIM(segs),
-				&s->tx.dst, mss);
-			if (rc < 0) {
-				rte_errno = -rc;
-				break;
-			}
+	if (mn != 0)
+		tcp_rxq_consume(si, tn);
 
-			rc = tx_segments(s, ol_flags, segs, rc);
-			if (rc == 0) {
-				/* free the large mbuf */
-				rte_pktmbuf_free(pkt[i]);
-				/* set the mbuf as consumed */
-				k++;
-			} else
-				/* no space left in tx queue */
-				break;
-		}
+	if (tn != 0) {
+		/* notify BE about more data to send */
+		txs_enqueue(so->s.ctx, so);
+
+		/* if possible, re-arm stream write event. */
+		if (rte_ring_free_count(so->tx.q) != 0 && so->tx.ev != NULL)
+			tle_event_raise_mask(so->tx.ev, TLE_EV_OUT);
 	}
 
-	/* notify BE about more data to send */
-	if (k != 0)
-		txs_enqueue(s->s.ctx, s);
-	/* if possible, re-arm stream write event. */
-	if (rte_ring_free_count(s->tx.q) != 0 && s->tx.ev != NULL)
-		tle_event_raise(s->tx.ev);
+	/* adjust input stream receive window */
+	if (tcp_stream_try_acquire(si) > 0)
+		splice_link_wnd(si, so);
+	tcp_stream_release(si);
 
-	tcp_stream_release(s);
+	tcp_stream_release(so);
 
-	return k;
+	if (tn == 0 && rc != 0) {
+		rte_errno = -rc;
+		return -1;
+	}
+
+	return sz;
 }
 
 ssize_t
 tle_tcp_stream_writev(struct tle_stream *ts, struct rte_mempool *mp,
 	const struct iovec *iov, int iovcnt)
 {
-	int32_t i, rc;
-	uint32_t j, k, n, num, slen, state;
+	int32_t fi, i, rc;
+	uint32_t j, k, n, num, opts, slen, state;
 	uint64_t ol_flags;
-	size_t sz, tsz;
+	size_t csz, sz, tsz;
 	struct tle_tcp_stream *s;
-	struct iovec iv;
+	struct iovec fiv, iv;
 	struct rte_mbuf *mb[2 * MAX_PKT_BURST];
 
 	s = TCP_STREAM(ts);
@@ -2611,10 +3689,22 @@ tle_tcp_stream_writev(struct tle_stream *ts, struct rte_mempool *mp,
 		return -1;
 	}
 
+	/* append data to the not yet sent segment first */
+	csz = 0;
+	opts = s->tx.opts;
+	for (fi = 0; fi != iovcnt; fi++) {
+		fiv = iov[fi];
+		if (opts == 0)
+			break;
+		csz += tx_coalesce_iovec(s, &fiv);
+		if (fiv.iov_len != 0)
+			break;
+	}
+
 	/* figure out how many mbufs do we need */
 	tsz = 0;
-	for (i = 0; i != iovcnt; i++)
-		tsz += iov[i].iov_len;
+	for (i = fi; i != iovcnt; i++)
+		tsz += (i == fi) ? fiv.iov_len : iov[i].iov_len;
 
 	slen = rte_pktmbuf_data_room_size(mp);
 	slen = RTE_MIN(slen, s->tcb.snd.mss);
@@ -2626,16 +3716,20 @@ tle_tcp_stream_writev(struct tle_stream *ts, struct rte_mempool *mp,
 
 	/* allocate mbufs */
 	if (rte_pktmbuf_alloc_bulk(mp, mb, n) != 0) {
-		rte_errno = ENOMEM;
-		tcp_stream_release(s);
-		return -1;
+		if (csz == 0) {
+			rte_errno = ENOMEM;
+			tcp_stream_release(s);
+			return -1;
+		}
+		/* report only data that was appended */
+		n = 0;
 	}
 
 	/* copy data into the mbufs */
 	k = 0;
 	sz = 0;
-	for (i = 0; i != iovcnt; i++) {
-		iv = iov[i];
+	for (i = fi; i != iovcnt && n != 0; i++) {
+		iv = (i == fi) ? fiv : iov[i];
 		sz += iv.iov_len;
 		k += _iovec_to_mbsegs(&iv, slen, mb + k, n - k);
 		if (iv.iov_len != 0) {
@@ -2679,26 +3773,226 @@ tle_tcp_stream_writev(struct tle_stream *ts, struct rte_mempool *mp,
 		}
 	}
 
-        if (k != 0) {
+	/* add data appended to the not yet sent segment */
+	if (csz != 0)
+		sz = (sz == (size_t)-1) ? csz : sz + csz;
+
+        if (k != 0 || csz != 0) {
+
+		/* notify BE about more data to send */
+		txs_enqueue(s->s.ctx, s);
+
+		/* if possible, re-arm stream write event. */
+		if (rte_ring_free_count(s->tx.q) != 0 && s->tx.ev != NULL)
+			tle_event_raise_mask(s->tx.ev, TLE_EV_OUT);
+	}
+
+	tcp_stream_release(s);
+	return sz;
+}
+
+ssize_t
+tle_tcp_stream_writev_ext(struct tle_stream *ts, struct rte_mempool *mp,
+	const struct iovec *iov, int iovcnt,
+	struct rte_mbuf_ext_shared_info *shinfo)
+{
+	int32_t i, rc;
+	uint32_t j, k, len, n, num, slen, state;
+	uint64_t ol_flags;
+	rte_iova_t iova;
+	size_t sz;
+	struct tle_tcp_stream *s;
+	struct iovec iv;
+	void *addr;
+	struct rte_mbuf *md;
+	struct rte_mbuf *mb[2 * MAX_PKT_BURST];
+	uint32_t plen[MAX_PKT_BURST];
+
+	if (ts == NULL || mp == NULL || iov == NULL || iovcnt <= 0 ||
+			shinfo == NULL || shinfo->free_cb == NULL) {
+		rte_errno = EINVAL;
+		return -1;
+	}
+
+	s = TCP_STREAM(ts);
+
+	/* mark stream as not closable. */
+	if (tcp_stream_acquire(s) < 0) {
+		rte_errno = EAGAIN;
+		return -1;
+	}
+
+	state = s->tcb.state;
+	if (state != TLE_TCP_ST_ESTABLISHED && state != TLE_TCP_ST_CLOSE_WAIT) {
+		rte_errno = ENOTCONN;
+		tcp_stream_release(s);
+		return -1;
+	}
+
+	/* figure out how many packets do we need */
+	slen = s->tcb.snd.mss;
+
+	num = 0;
+	for (i = 0; i != iovcnt; i++)
+		num += (iov[i].iov_len + slen - 1) / slen;
+
+	n = rte_ring_free_count(s->tx.q);
+	num = RTE_MIN(num, n);
+	num = RTE_MIN(num, RTE_DIM(mb) / 2);
+
+	if (num == 0) {
+		tcp_stream_release(s);
+		return 0;
+	}
+
+	/*
+	 * allocate mbufs: first *num* ones are used for headers,
+	 * second *num* ones to attach user provided buffers.
+	 */
+	if (rte_pktmbuf_alloc_bulk(mp, mb, 2 * num) != 0) {
+		rte_errno = ENOMEM;
+		tcp_stream_release(s);
+		return -1;
+	}
+
+	/* hold an extra reference till all packets are enqueued. */
+	rte_mbuf_ext_refcnt_set(shinfo, 1);
+
+	/* attach user data to the mbufs */
+	k = 0;
+	for (i = 0; i != iovcnt && k != num; i++) {
+		iv = iov[i];
+		while (iv.iov_len != 0 && k != num) {
+
+			len = RTE_MIN(iv.iov_len, slen);
+			iova = rte_mem_virt2iova(iv.iov_base);
+			if (iova == RTE_BAD_IOVA)
+				break;
+
+			md = mb[num + k];
+			rte_mbuf_ext_refcnt_update(shinfo, 1);
+			rte_pktmbuf_attach_extbuf(md, iv.iov_base, iova, len,
+				shinfo);
+			md->data_len = len;
+			md->pkt_len = len;
+			rte_pktmbuf_chain(mb[k], md);
+			plen[k] = len;
+
+			iv.iov_base = (uint8_t *)iv.iov_base + len;
+			iv.iov_len -= len;
+			k++;
+		}
+		if (iv.iov_len != 0)
+			break;
+	}
+
+	/* free unused mbufs */
+	free_mbufs(mb + k, num - k);
+	free_mbufs(mb + num + k, num - k);
+
+	/*
+	 * remember the first attached buffer now: once enqueued,
+	 * packets can be sent and released by the BE at any moment.
+	 */
+	addr = (k != 0) ? mb[0]->next->buf_addr : NULL;
+
+	/* fill pkt headers */
+	rc = 0;
+	ol_flags = s->tx.dst.ol_flags;
+
+	for (j = 0; j != k; j++) {
+		rc = tcp_fill_mbuf(mb[j], s, &s->tx.dst, ol_flags,
+			s->s.port, 0, TCP_FLAG_ACK, 0, 0);
+		if (rc != 0)
+			break;
+	}
+
+	/* if no error encountered, then enqueue pkts for transmission */
+	if (k == j)
+		n = _rte_ring_enqueue_burst(s->tx.q, (void **)mb, j);
+	else
+		n = 0;
+
+	/* enqueued mbufs can't be accessed any more, use saved lengths. */
+	sz = 0;
+	for (j = 0; j != n; j++)
+		sz += plen[j];
+
+	if (n != k) {
+
+		/* free pkts that were not enqueued */
+		free_mbufs(mb + n, k - n);
+
+		/* report an error */
+		if (rc != 0) {
+			rte_errno = -rc;
+			sz = -1;
+		}
+	}
+
+	/* first user buffer can't be mapped. */
+	if (k == 0) {
+		rte_errno = EFAULT;
+		sz = -1;
+	}
+
+	/*
+	 * nothing was queued, user buffer is not referenced anymore,
+	 * completion callback shouldn't be invoked.
+	 */
+	if (n == 0)
+		rte_mbuf_ext_refcnt_set(shinfo, 0);
+
+	/* release our own reference. */
+	else if (rte_mbuf_ext_refcnt_update(shinfo, -1) == 0)
+		shinfo->free_cb(addr, shinfo->fcb_opaque);
+
+	if (n != 0) {
 
 		/* notify BE about more data to send */
 		txs_enqueue(s->s.ctx, s);
 
 		/* if possible, re-arm stream write event. */
 		if (rte_ring_free_count(s->tx.q) != 0 && s->tx.ev != NULL)
-			tle_event_raise(s->tx.ev);
+			tle_event_raise_mask(s->tx.ev, TLE_EV_OUT);
 	}
 
 	tcp_stream_release(s);
 	return sz;
 }
 
+int
+tle_tcp_stream_flush(struct tle_stream *ts)
+{
+	struct tle_tcp_stream *s;
+
+	s = TCP_STREAM(ts);
+	if (ts == NULL || s->s.type >= TLE_VNUM)
+		return -EINVAL;
+
+	/* mark stream as not closable. */
+	if (tcp_stream_acquire(s) < 0)
+		return -EAGAIN;
+
+	/* all segments queued so far can't be held anymore */
+	s->tx.push = s->tx.q->prod.tail;
+	rte_smp_wmb();
+
+	/* notify BE about more data to send */
+	if (tcp_txq_nxt_cnt(s) != 0)
+		txs_enqueue(s->s.ctx, s);
+
+	tcp_stream_release(s);
+	return 0;
+}
+
 /* send data and FIN (if needed) */
 static inline void
-tx_data_fin(struct tle_tcp_stream *s, uint32_t tms, uint32_t state)
+tx_data_fin(struct tle_tcp_stream *s, uint32_t tms, uint32_t state,
+	uint32_t lim)
 {
 	/* try to send some data */
-	tx_nxt_data(s, tms);
+	tx_nxt_data(s, tms, lim);
 
 	/* we also have to send a FIN */
 	if (state != TLE_TCP_ST_ESTABLISHED &&
@@ -2710,12 +4004,17 @@ tx_data_fin(struct tle_tcp_stream *s, uint32_t tms, uint32_t state)
 	}
 }
 
-static inline void
-tx_stream(struct tle_tcp_stream *s, uint32_t tms)
+/*
+ * returns number of payload bytes sent.
+ * *lim* limits amount of new data to send.
+ */
+static inline uint32_t
+tx_stream(struct tle_tcp_stream *s, uint32_t tms, uint32_t lim)
 {
-	uint32_t state;
+	uint32_t nxt, state;
 
 	state = s->tcb.state;
+	nxt = s->tcb.snd.nxt;
 
 	if (state == TLE_TCP_ST_SYN_SENT) {
 		/* send the SYN, start the rto timer */
@@ -2725,16 +4024,35 @@ tx_stream(struct tle_tcp_stream *s, uint32_t tms)
 	} else if (state >= TLE_TCP_ST_ESTABLISHED &&
 			state <= TLE_TCP_ST_LAST_ACK) {
 
-		tx_data_fin(s, tms, state);
+		tcp_pmtu_raise(s);
+		tx_data_fin(s, tms, state, lim);
+
+		/* window update was requested by tle_tcp_stream_splice() */
+		if (s->rx.wu != 0 &&
+				rte_atomic32_cmpset(&s->rx.wu, 1, 0) != 0)
+			send_ack(s, tms, TCP_FLAG_ACK);
 
 		/* start RTO timer. */
 		if (s->tcb.snd.nxt != s->tcb.snd.una)
 			timer_start(s);
+
+		/*
+		 * drbs ran out, while with nothing in flight neither ACK
+		 * nor RTO would bring the stream back: retry next time unit.
+		 */
+		if (s->tx.drb.wait != 0) {
+			s->tx.drb.wait = 0;
+			if (tcp_txq_nxt_cnt(s) != 0)
+				txs_park(s->s.ctx, s, s->s.ctx->tms);
+		}
 	} else if (state == TLE_TCP_ST_CLOSED) {
 		if ((s->tcb.snd.close_flags & TCP_FLAG_RST) != 0)
 			send_rst(s, s->tcb.snd.nxt);
 		stream_term(s);
+		return 0;
 	}
+
+	return (uint32_t)s->tcb.snd.nxt - nxt;
 }
 
 static inline void
@@ -2775,7 +4093,10 @@ rto_stream(struct tle_tcp_stream *s, uint32_t tms)
 			tcp_txq_rst_nxt_head(s);
 			s->tcb.snd.nxt = s->tcb.snd.una;
 
-			tx_data_fin(s, tms, state);
+			/* segments might be too big for the path */
+			tcp_pmtu_rto(s);
+
+			tx_data_fin(s, tms, state, UINT32_MAX);
 
 		} else if (state == TLE_TCP_ST_SYN_SENT) {
 			/* resending SYN */
@@ -2811,6 +4132,99 @@ rto_stream(struct tle_tcp_stream *s, uint32_t tms)
 	}
 }
 
+/*
+ * transmit stream data obeying stream rate limiter (if any).
+ * *tms* is the context time (not adjusted by the stream TS offset).
+ * Stream throttled by the rate limiter is parked till the next time unit,
+ * when the bucket gets refilled.
+ */
+static inline uint32_t
+tx_stream_rlim(struct tle_tcp_stream *s, uint32_t tms, uint32_t lim)
+{
+	uint32_t state, sz, tok, wnd;
+	struct tle_rlim *rl;
+
+	rl = s->tx.rlim;
+	if (rl == NULL)
+		return tx_stream(s, tcp_stream_adjust_tms(s, tms), lim);
+
+	/* allow at least one full segment, excess will be paid later */
+	tok = rlim_avail(rl, tms);
+	tok = (tok != 0) ? RTE_MAX(tok, (uint32_t)s->tcb.snd.mss) : 0;
+	wnd = tx_wnd_avail(s);
+
+	sz = tx_stream(s, tcp_stream_adjust_tms(s, tms), RTE_MIN(tok, lim));
+	rlim_charge(rl, sz);
+
+	state = s->tcb.state;
+	if (tok < lim && tok < wnd && tcp_txq_nxt_cnt(s) != 0 &&
+			state >= TLE_TCP_ST_ESTABLISHED &&
+			state <= TLE_TCP_ST_LAST_ACK)
+		txs_park(s->s.ctx, s, tms);
+
+	return sz;
+}
+
+/*
+ * Deficit round robin over the streams from to-send queue.
+ * Each round every stream gets (quantum * weight) bytes of credit.
+ * Stream that still has data to send after its credit is used up,
+ * is put back to the tail of to-send queue, keeping the remaining
+ * deficit for the next round.
+ * Stream limited by peer/congestion window (or with nothing to send)
+ * loses its deficit: it will be re-queued by ACK or by the FE.
+ * Total amount of data sent by one call is limited by the budget,
+ * streams not served within the budget are re-queued untouched.
+ */
+static inline void
+tx_streams_drr(struct tle_ctx *ctx, struct tle_tcp_stream *rs[],
+	uint32_t num, uint32_t tms)
+{
+	uint32_t budget, i, lim, quantum, sz, wnd;
+	uint64_t dfc;
+	struct tle_tcp_stream *s;
+
+	quantum = ctx->prm.tx_quantum;
+	budget = (ctx->prm.tx_budget == 0) ? UINT32_MAX : ctx->prm.tx_budget;
+
+	for (i = 0; i != num; i++) {
+
+		s = rs[i];
+		rte_atomic32_set(&s->tx.arm, 0);
+
+		/* budget is exhausted, leave it for the next call */
+		if (budget == 0) {
+			txs_enqueue(ctx, s);
+			continue;
+		}
+
+		if (tcp_stream_try_acquire(s) <= 0) {
+			txs_enqueue(ctx, s);
+			tcp_stream_release(s);
+			continue;
+		}
+
+		dfc = (uint64_t)quantum * s->tx.weight + s->tx.deficit;
+		dfc = RTE_MIN(dfc, (uint64_t)INT32_MAX);
+
+		lim = RTE_MIN((uint32_t)dfc, budget);
+		wnd = tx_wnd_avail(s);
+
+		sz = tx_stream_rlim(s, tms, lim);
+		budget -= RTE_MIN(sz, budget);
+
+		/* stream was limited by the scheduler, not by the windows */
+		if (lim - RTE_MIN(sz, lim) < s->tcb.snd.mss && lim < wnd &&
+				tcp_txq_nxt_cnt(s) != 0) {
+			s->tx.deficit = dfc - RTE_MIN(sz, (uint32_t)dfc);
+			txs_enqueue(ctx, s);
+		} else
+			s->tx.deficit = 0;
+
+		tcp_stream_release(s);
+	}
+}
+
 int
 tle_tcp_process(struct tle_ctx *ctx, uint32_t num)
 {
@@ -2823,7 +4237,7 @@ tle_tcp_process(struct tle_ctx *ctx, uint32_t num)
 	/* process streams with RTO exipred */
 
 	tw = CTX_TCP_TMWHL(ctx);
-	tms = tcp_get_tms(ctx->cycles_ms_shift);
+	tms = ctx_update_tms(ctx);
 	tle_timer_expire(tw, tms);
 
 	k = tle_timer_get_expired_bulk(tw, (void **)rs, RTE_DIM(rs));
@@ -2839,18 +4253,24 @@ tle_tcp_process(struct tle_ctx *ctx, uint32_t num)
 
 	/* process streams from to-send queue */
 
+	txs_unpark(ctx, tms);
 	k = txs_dequeue_bulk(ctx, rs, RTE_DIM(rs));
 
-	for (i = 0; i != k; i++) {
+	if (ctx->prm.tx_quantum != 0)
+		tx_streams_drr(ctx, rs, k, tms);
 
-		s = rs[i];
-		rte_atomic32_set(&s->tx.arm, 0);
+	else {
+		for (i = 0; i != k; i++) {
 
-		if (tcp_stream_try_acquire(s) > 0)
-			tx_stream(s, tcp_stream_adjust_tms(s, tms));
-		else
-			txs_enqueue(s->s.ctx, s);
-		tcp_stream_release(s);
+			s = rs[i];
+			rte_atomic32_set(&s->tx.arm, 0);
+
+			if (tcp_stream_try_acquire(s) > 0)
+				tx_stream_rlim(s, tms, UINT32_MAX);
+			else
+				txs_enqueue(s->s.ctx, s);
+			tcp_stream_release(s);
+		}
 	}
 
 	/* collect streams to close from the death row */
@@ -48,6 +48,7 @@ tcp_fini_streams(struct tle_ctx *ctx)
 		stbl_fini(&ts->st);
 		tle_timer_free(ts->tmr);
 		rte_free(ts->tsq);
+		rte_free(ts->rlq);
 		tle_memtank_dump(stdout, ts->mts, TLE_MTANK_DUMP_STAT);
 		tle_memtank_sanity_check(ts->mts, 0);
 		tle_memtank_destroy(ts->mts);
@@ -113,15 +114,9 @@ calc_stream_szofs(struct tle_ctx *ctx, struct stream_szofs *szofs)
 	sz += rte_ring_get_memsize(na);
 	sz = RTE_ALIGN_CEIL(sz, RTE_CACHE_LINE_SIZE);
 
+	/* drbs are taken from the ctx pool. */
 	szofs->drb.nb_obj = drb_nb_elem(ctx);
 	szofs->drb.nb_max = calc_stream_drb_num(ctx, szofs->drb.nb_obj);
-	szofs->drb.nb_rng = rte_align32pow2(szofs->drb.nb_max);
-	szofs->drb.rng_sz = rte_ring_get_memsize(szofs->drb.nb_rng);
-	szofs->drb.blk_sz = tle_drb_calc_size(szofs->drb.nb_obj);
-	szofs->drb.ofs = sz;
-
-	sz += szofs->drb.rng_sz + szofs->drb.blk_sz * szofs->drb.nb_max;
-	sz = RTE_ALIGN_CEIL(sz, RTE_CACHE_LINE_SIZE);
 
 	szofs->size = sz;
 }
@@ -130,8 +125,7 @@ static void
 init_stream(struct tle_ctx *ctx, struct tle_tcp_stream *s,
 	const struct stream_szofs *szofs)
 {
-	uint32_t f, i;
-	struct tle_drb *drb;
+	uint32_t f;
 
 	f = ((ctx->prm.flags & TLE_CTX_FLAG_ST) == 0) ? 0 :
 		(RING_F_SP_ENQ |  RING_F_SC_DEQ);
@@ -149,19 +143,12 @@ init_stream(struct tle_ctx *ctx, struct tle_tcp_stream *s,
 	s->tx.q = (void *)((uintptr_t)s + szofs->txq.ofs);
 	rte_ring_init(s->tx.q, __func__, szofs->txq.nb_obj, f | RING_F_SC_DEQ);
 
-	s->tx.drb.r = (void *)((uintptr_t)s + szofs->drb.ofs);
-	rte_ring_init(s->tx.drb.r, __func__, szofs->drb.nb_rng, f);
-
-	for (i = 0; i != szofs->drb.nb_max; i++) {
-		drb = (struct tle_drb *)((uintptr_t)s->tx.drb.r +
-			szofs->drb.rng_sz + szofs->drb.blk_sz * i);
-		drb->udata = s;
-		drb->size = szofs->drb.nb_obj;
-		rte_ring_enqueue(s->tx.drb.r, drb);
-	}
-
 	s->tx.drb.nb_elem = szofs->drb.nb_obj;
 	s->tx.drb.nb_max = szofs->drb.nb_max;
+	s->tx.drb.nb_out = 0;
+	s->tx.drb.wait = 0;
+
+	rte_spinlock_init(&s->tx.lock);
 
 	/* mark stream as avaialble to use. */
 
@@ -175,7 +162,28 @@ tcp_free_drbs(struct tle_stream *s, struct tle_drb *drb[], uint32_t nb_drb)
 	struct tle_tcp_stream *us;
 
 	us = (struct tle_tcp_stream *)s;
-	_rte_ring_enqueue_burst(us->tx.drb.r, (void **)drb, nb_drb);
+	stream_drb_put(s->ctx, &us->tx.drb.nb_out, drb, nb_drb);
+}
+
+/* invoke deferred callback, unless the stream was closed since. */
+static void
+tcp_invoke_cb(struct tle_stream *s, uint32_t op)
+{
+	struct tle_stream_cb *cb;
+	struct tle_tcp_stream *us;
+
+	us = TCP_STREAM(s);
+	if (op == STREAM_CB_RX)
+		cb = &us->rx.cb;
+	else if (op == STREAM_CB_TX)
+		cb = &us->tx.cb;
+	else
+		cb = &us->err.cb;
+
+	if (tcp_stream_try_acquire(us) > 0 && stream_take_cb(s, op) != 0 &&
+			cb->func != NULL)
+		cb->func(cb->data, s);
+	tcp_stream_release(us);
 }
 
 static struct tle_timer_wheel *
@@ -296,10 +304,13 @@ tcp_init_streams(struct tle_ctx *ctx)
 	if (rc == 0) {
 		ts->tsq = alloc_ring(ctx->prm.max_streams, f | RING_F_SC_DEQ,
 			ctx->prm.socket_id);
+		ts->rlq = alloc_ring(ctx->prm.max_streams,
+			RING_F_SP_ENQ | RING_F_SC_DEQ, ctx->prm.socket_id);
 		ts->tmr = alloc_timers(ctx);
 		ts->mts = alloc_mts(ctx, szofs.size);
 	
-		if (ts->tsq == NULL || ts->tmr == NULL || ts->mts == NULL)
+		if (ts->tsq == NULL || ts->rlq == NULL || ts->tmr == NULL ||
+				ts->mts == NULL)
 			rc = -ENOMEM;
 
 		tle_memtank_dump(stdout, ts->mts, TLE_MTANK_DUMP_STAT);
@@ -320,6 +331,7 @@ tcp_stream_setup(void)
 		.init_streams = tcp_init_streams,
 		.fini_streams = tcp_fini_streams,
 		.free_drbs = tcp_free_drbs,
+		.invoke_cb = tcp_invoke_cb,
 	};
 
 	tle_stream_ops[TLE_PROTO_TCP] = tcp_ops;
@@ -373,6 +385,16 @@ tcp_stream_fill_cfg(struct tle_tcp_stream *s, const struct tle_ctx_param *cprm,
 	s->err.ev = scfg->err_ev;
 	s->err.cb = scfg->err_cb;
 
+	/* setup small writes coalescing */
+	s->tx.opts = scfg->tx_opts;
+	s->tx.push = s->tx.q->prod.tail;
+	s->tx.sent = s->tx.q->prod.tail;
+
+	/* setup TX scheduler params */
+	s->tx.weight = (scfg->tx_weight != 0) ? scfg->tx_weight : 1;
+	s->tx.deficit = 0;
+	s->tx.rlim = scfg->tx_rlim;
+
 	/* store other params */
 	s->flags = cprm->flags;
 	s->tcb.snd.nb_retm = (scfg->nb_retries != 0) ? scfg->nb_retries :
@@ -784,25 +806,36 @@ stream_update_cfg(struct tle_stream *ts,struct tle_tcp_stream_cfg *prm)
 	/* store other params */
 	s->tcb.snd.nb_retm = (prm->nb_retries != 0) ? prm->nb_retries :
 		TLE_TCP_DEFAULT_RETRIES;
+	s->tx.weight = (prm->tx_weight != 0) ? prm->tx_weight : 1;
+	s->tx.rlim = prm->tx_rlim;
 	s->s.udata = prm->udata;
 
+	/* held segments (if any) might have to be sent now */
+	rte_spinlock_lock(&s->tx.lock);
+	s->tx.opts = prm->tx_opts;
+	rte_spinlock_unlock(&s->tx.lock);
+	if (tcp_txq_nxt_cnt(s) != 0)
+		txs_enqueue(s->s.ctx, s);
+
 	/* invoke async notifications, if any */
 	if (rte_ring_count(s->rx.q) != 0) {
 		if (s->rx.ev != NULL)
-			tle_event_raise(s->rx.ev);
+			tle_event_raise_mask(s->rx.ev, TLE_EV_IN);
 		else if (s->rx.cb.func != NULL)
 			s->rx.cb.func(s->rx.cb.data, &s->s);
 	}
 	if (rte_ring_free_count(s->tx.q) != 0) {
 		if (s->tx.ev != NULL)
-			tle_event_raise(s->tx.ev);
+			tle_event_raise_mask(s->tx.ev, TLE_EV_OUT);
 		else if (s->tx.cb.func != NULL)
 			s->tx.cb.func(s->tx.cb.data, &s->s);
 	}
 	if (s->tcb.state == TLE_TCP_ST_CLOSE_WAIT ||
 			s->tcb.state ==  TLE_TCP_ST_CLOSED) {
 		if (s->err.ev != NULL)
-			tle_event_raise(s->err.ev);
+			tle_event_raise_mask(s->err.ev,
+				(s->tcb.state == TLE_TCP_ST_CLOSE_WAIT) ?
+				TLE_EV_HUP : TLE_EV_ERR);
 		else if (s->err.cb.func != NULL)
 			s->err.cb.func(s->err.cb.data, &s->s);
 	}
@@ -37,6 +37,7 @@ struct tcb {
 		uint32_t nxt;
 		uint32_t irs; /* initial received sequence */
 		uint32_t wnd;
+		uint32_t lwnd; /* wnd limit imposed by splice, 0 - no limit */
 		uint32_t ts;
 		struct {
 			uint32_t seq;
@@ -72,6 +73,46 @@ struct tcb {
 	struct tle_tcp_syn_opts so; /* initial syn options. */
 };
 
+/*
+ * Pre-built L2/L3/L4 headers for the established stream, plus
+ * partial checksums over the header fields that never change
+ * during stream lifetime. For each segment only SEQ/ACK/WND/flags,
+ * lengths, IP packet id and TS option values have to be patched.
+ */
+struct tcp_tmpl {
+	uint16_t len;      /* L2/L3 headers length, zero if not valid */
+	uint16_t l4_len;   /* TCP header and options length */
+	uint32_t ip_cksum; /* IPv4 header, without total_length/packet_id */
+	uint32_t ph_cksum; /* pseudo-header, without L4 length */
+	uint32_t th_cksum; /* TCP ports and TS option kind/len */
+	uint8_t hdr[TLE_DST_MAX_HDR + TCP_TX_HDR_DACK];
+};
+
+/*
+ * PLPMTUD (RFC 8899) search state.
+ * While searching, snd.mss is set to the probe size, so FE builds
+ * segments of that size. BE sends one of them as it is (the probe),
+ * all others are split into *lo* sized segments till the probe
+ * gets acknowledged or considered lost.
+ */
+enum {
+	TCP_PMTU_ST_DISABLED,
+	TCP_PMTU_ST_SEARCH,
+	TCP_PMTU_ST_DONE,
+};
+
+struct tcp_pmtu {
+	uint16_t st;    /* search state (TCP_PMTU_ST_*) */
+	uint16_t fail;  /* number of lost probes of the current size */
+	uint16_t min;   /* base MSS, derived from tle_dest.mtu */
+	uint16_t max;   /* max MSS to search for */
+	uint16_t lo;    /* validated MSS */
+	uint16_t hi;    /* upper bound of the search */
+	uint32_t seq;   /* start of the probe in flight */
+	uint32_t len;   /* length of the probe in flight, 0 if none */
+	uint32_t tms;   /* time of the search completion */
+};
+
 struct tle_tcp_stream {
 
 	struct tle_stream s;
@@ -100,6 +141,7 @@ struct tle_tcp_stream {
 		struct ofo *ofo;
 		struct tle_event *ev;    /* user provided recv event. */
 		struct tle_stream_cb cb; /* user provided recv callback. */
+		uint32_t wu;             /* window update requested by FE. */
 	} rx __rte_cache_aligned;
 
 	struct {
@@ -107,12 +149,22 @@ struct tle_tcp_stream {
 		struct {
 			uint32_t nb_elem;  /* number of objects per drb. */
 			uint32_t nb_max;   /* number of drbs per stream. */
-			struct rte_ring *r;
+			uint32_t nb_out;   /* drbs in flight. */
+			uint32_t wait;     /* ran out of drbs, used by BE. */
 		} drb;
 		struct rte_ring *q;  /* (re)tx queue */
+		uint32_t opts;       /* TLE_TCP_TX_OPT_* */
+		uint32_t push;       /* tx queue position at last flush */
+		uint32_t sent;       /* tx queue position past last sent seg */
+		uint32_t weight;     /* DRR weight */
+		uint32_t deficit;    /* DRR deficit counter (bytes) */
+		struct tle_rlim *rlim; /* egress rate limiter */
+		rte_spinlock_t lock; /* serialises coalescing and transmit */
 		struct tle_event *ev;
 		struct tle_stream_cb cb;
 		struct tle_dest dst;
+		struct tcp_tmpl tmpl; /* header template */
+		struct tcp_pmtu pmtu; /* path MTU discovery */
 	} tx __rte_cache_aligned;
 
 } __rte_cache_aligned;
@@ -121,10 +173,10 @@ struct tle_tcp_stream {
 ((struct tle_tcp_stream *)((uintptr_t)(p) - offsetof(struct tle_tcp_stream, s)))
 
 #define TCP_STREAM_TX_PENDING(s)	\
-	((s)->tx.drb.nb_max != rte_ring_count((s)->tx.drb.r))
+	(stream_drb_out(&(s)->tx.drb.nb_out) != 0)
 
 #define TCP_STREAM_TX_FINISHED(s)	\
-	((s)->tx.drb.nb_max == rte_ring_count((s)->tx.drb.r))
+	(stream_drb_out(&(s)->tx.drb.nb_out) == 0)
 
 #include "stream_table.h"
 
@@ -147,10 +199,6 @@ struct stream_szofs {
 		uint32_t nb_obj;
 	} rxq, txq;
 	struct {
-		uint32_t ofs;
-		uint32_t blk_sz;
-		uint32_t rng_sz;
-		uint32_t nb_rng;
 		uint32_t nb_obj;
 		uint32_t nb_max;
 	} drb;
@@ -160,6 +208,8 @@ struct tcp_streams {
 	struct stbl st;
 	struct tle_timer_wheel *tmr; /* timer wheel */
 	struct rte_ring *tsq;        /* to-send streams queue */
+	struct rte_ring *rlq;        /* streams throttled by rate limiters */
+	uint32_t rlq_tms;            /* time when rlq was last filled */
 	struct tle_memtank *mts;     /* memtank to allocate streams from */
 	struct sdr dr;               /* death row for zombie streams */
 	struct stream_szofs szofs;   /* size and offsets for stream data */
@@ -169,6 +219,7 @@ struct tcp_streams {
 #define CTX_TCP_STLB(ctx)	(&CTX_TCP_STREAMS(ctx)->st)
 #define CTX_TCP_TMWHL(ctx)	(CTX_TCP_STREAMS(ctx)->tmr)
 #define CTX_TCP_TSQ(ctx)	(CTX_TCP_STREAMS(ctx)->tsq)
+#define CTX_TCP_RLQ(ctx)	(CTX_TCP_STREAMS(ctx)->rlq)
 #define CTX_TCP_SDR(ctx)	(&CTX_TCP_STREAMS(ctx)->dr)
 #define CTX_TCP_MTS(ctx)	(CTX_TCP_STREAMS(ctx)->mts)
 
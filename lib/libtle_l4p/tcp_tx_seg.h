@@ -20,24 +20,35 @@
 extern "C" {
 #endif
 
+/*
+ * split data of the *mbin*, starting from offset *ofs*, into *mss* sized
+ * packets, using indirect mbufs. *mbin* itself is not modified.
+ */
 static inline int32_t
-tcp_segmentation(struct rte_mbuf *mbin, struct rte_mbuf *mbout[], uint16_t num,
-	const struct tle_dest *dst, uint16_t mss)
+tcp_segmentation_ofs(struct rte_mbuf *mbin, uint32_t ofs,
+	struct rte_mbuf *mbout[], uint16_t num, const struct tle_dest *dst,
+	uint16_t mss)
 {
 	struct rte_mbuf *in_seg = NULL;
 	uint32_t nbseg, in_seg_data_pos;
 	uint32_t more_in_segs;
 	uint16_t bytes_left;
 
-	in_seg = mbin;
-	in_seg_data_pos = 0;
-	nbseg = 0;
-
 	/* Check that pkts_out is big enough to hold all fragments */
-	if (mss * num < (uint16_t)mbin->pkt_len)
+	if ((uint32_t)mss * num < mbin->pkt_len - ofs)
 		return -ENOSPC;
 
-	more_in_segs = 1;
+	/* skip first *ofs* bytes */
+	in_seg = mbin;
+	while (in_seg != NULL && ofs >= in_seg->data_len) {
+		ofs -= in_seg->data_len;
+		in_seg = in_seg->next;
+	}
+
+	in_seg_data_pos = ofs;
+	nbseg = 0;
+
+	more_in_segs = (in_seg != NULL);
 	while (more_in_segs) {
 		struct rte_mbuf *out_pkt = NULL, *out_seg_prev = NULL;
 		uint32_t more_out_segs;
@@ -101,6 +112,13 @@ tcp_segmentation(struct rte_mbuf *mbin, struct rte_mbuf *mbout[], uint16_t num,
 	return nbseg;
 }
 
+static inline int32_t
+tcp_segmentation(struct rte_mbuf *mbin, struct rte_mbuf *mbout[], uint16_t num,
+	const struct tle_dest *dst, uint16_t mss)
+{
+	return tcp_segmentation_ofs(mbin, 0, mbout, num, dst, mss);
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -63,6 +63,10 @@ tcp_txq_set_nxt_head(struct tle_tcp_stream *s, uint32_t num)
 
 	r = s->tx.q;
 	r->cons.head += num;
+
+	/* remember how far the stream ever got */
+	if ((int32_t)(r->cons.head - s->tx.sent) > 0)
+		s->tx.sent = r->cons.head;
 }
 
 static inline void
@@ -85,7 +89,7 @@ tcp_txq_set_una_tail(struct tle_tcp_stream *s, uint32_t num)
 }
 
 static inline uint32_t
-tcp_txq_nxt_cnt(struct tle_tcp_stream *s)
+tcp_txq_nxt_cnt(const struct tle_tcp_stream *s)
 {
 	struct rte_ring *r;
 
@@ -106,6 +110,48 @@ txs_enqueue(struct tle_ctx *ctx, struct tle_tcp_stream *s)
 	}
 }
 
+/*
+ * put stream throttled by its rate limiter (or short of drbs) aside,
+ * till the next time unit.
+ * Only BE (tle_tcp_process) parks and unparks streams.
+ */
+static inline void
+txs_park(struct tle_ctx *ctx, struct tle_tcp_stream *s, uint32_t tms)
+{
+	struct rte_ring *r;
+	uint32_t n;
+
+	if (rte_atomic32_add_return(&s->tx.arm, 1) == 1) {
+		r = CTX_TCP_RLQ(ctx);
+		n = _rte_ring_enqueue_burst(r, (void * const *)&s, 1);
+		RTE_VERIFY(n == 1);
+		CTX_TCP_STREAMS(ctx)->rlq_tms = tms;
+	}
+}
+
+/*
+ * move parked streams back into to-send queue,
+ * once the time unit they were parked at is over.
+ */
+static inline void
+txs_unpark(struct tle_ctx *ctx, uint32_t tms)
+{
+	struct rte_ring *r;
+	struct tle_tcp_stream *s[MAX_PKT_BURST];
+	uint32_t k, n;
+
+	if (tms == CTX_TCP_STREAMS(ctx)->rlq_tms)
+		return;
+
+	r = CTX_TCP_RLQ(ctx);
+	do {
+		n = _rte_ring_dequeue_burst(r, (void **)s, RTE_DIM(s));
+		k = _rte_ring_enqueue_burst(CTX_TCP_TSQ(ctx),
+			(void * const *)s, n);
+		RTE_VERIFY(k == n);
+	} while (n == RTE_DIM(s));
+}
+
 static inline uint32_t
 txs_dequeue_bulk(struct tle_ctx *ctx, struct tle_tcp_stream *s[], uint32_t num)
 {
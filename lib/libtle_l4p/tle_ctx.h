@@ -106,6 +106,12 @@ enum {
 
 enum {
 	TLE_CTX_FLAG_ST = 1,  /**< ctx will be used by single thread */
+	TLE_CTX_FLAG_CB_DEFER = 2,
+	/**< stream recv/send/error callbacks are not invoked from
+	 * within tle_*_rx_bulk()/tle_*_tx_bulk()/tle_tcp_process(),
+	 * but recorded in the context deferred queue, at most once per
+	 * <stream, op> till dispatched. User has to dispatch them with
+	 * tle_ctx_cb_dispatch() (see below). */
 };
 
 struct tle_ctx_param {
@@ -144,6 +150,58 @@ struct tle_ctx_param {
 	uint32_t timewait;
 	/**< TCP TIME_WAIT state timeout duration in milliseconds,
 	 * default 2MSL, if UINT32_MAX */
+	uint32_t tx_quantum;
+	/**< TCP TX scheduler: number of bytes per unit of stream weight
+	 * each stream is allowed to send per round (deficit round robin).
+	 * 0 disables the scheduler: each stream sends as much as
+	 * its windows allow. */
+	uint32_t tx_budget;
+	/**< TCP TX scheduler: max number of payload bytes to send
+	 * by one tle_tcp_process() call, 0 means no limit. */
+	uint32_t pmtu_max;
+	/**< TCP packetization layer path MTU discovery (RFC 8899):
+	 * max MTU value (in the same units as tle_dest.mtu) to probe for.
+	 * Discovered values are cached per remote address.
+	 * MSS derived from that value is also announced to the peer,
+	 * so it should not exceed MTU configured for the devices.
+	 * 0 or value not greater than tle_dest.mtu disables probing,
+	 * in that case tle_dest.mtu is always used. */
+	uint32_t dst_cache_size;
+	/**< number of entries in per lcore cache of destinations returned
+	 * by lookup4/lookup6 callbacks, keyed by stream user data and
+	 * remote address. Rounded up to the power of two.
+	 * Caches for all EAL lcores are allocated by tle_ctx_create(),
+	 * non-EAL threads don't use the cache.
+	 * Cached entries stay valid till tle_ctx_invalidate() is called,
+	 * so user has to call it each time routing/neighbour information
+	 * changes. 0 disables the cache. */
+	uint32_t frag_tbl_size;
+	/**< max number of IP datagrams being reassembled at the same time.
+	 * If non-zero, tle_udp_rx_bulk()/tle_tcp_rx_bulk() reassemble
+	 * IPv4/IPv6 fragments themselves. Fragments have to be marked with
+	 * RTE_PTYPE_L4_FRAG, with l2_len/l3_len set (for IPv6 l3_len
+	 * includes fragment header, that has to follow the IPv6 header).
+	 * Fragments are held by the library till the datagram is complete
+	 * or reassembly times out, and are counted as accepted.
+	 * 0 disables reassembly, fragments are rejected. */
+	uint32_t frag_tmo;
+	/**< IP reassembly timeout in milliseconds,
+	 * default (1s) is used if 0. */
+	uint32_t max_drbs;
+	/**< number of TX descriptor blocks (drbs) shared by all streams
+	 * of the context, each holds up to send_bulk_size packets.
+	 * Drbs are allocated through per lcore caches, each stream still
+	 * can't have more than max(1.5 * max_stream_sbufs / send_bulk_size,
+	 * RTE_MAX_ETHPORTS + 1) drbs in flight.
+	 * When the pool is exhausted, UDP send functions accept fewer
+	 * packets, stream is notified (send event/callback) when
+	 * tle_udp_tx_bulk() returns drbs into the pool.
+	 * TCP stream short of drbs is retried by tle_tcp_process()
+	 * in the next millisecond. Up to one drb per stream
+	 * (but no more than quarter of max_drbs) is kept for TCP control
+	 * packets (ACK, FIN, RST).
+	 * If 0, enough drbs for all streams to fill their send buffers
+	 * at the same time (plus TCP control reserve) are allocated. */
 };
 
 /**
@@ -205,10 +263,29 @@ tle_add_dev(struct tle_ctx *ctx, const struct tle_dev_param *dev_prm);
  */
 int tle_del_dev(struct tle_dev *dev);
 
+/**
+ * invoke stream callbacks deferred by the context created with
+ * TLE_CTX_FLAG_CB_DEFER flag. Could be called by the BE thread after
+ * its rx/tx calls, or by a separate (FE) thread.
+ * Callbacks are invoked with the same sort of read lock held
+ * on the stream as without TLE_CTX_FLAG_CB_DEFER, callbacks
+ * for the streams that were closed since (even if the stream
+ * was reopened afterwards) are skipped.
+ * @param ctx
+ *   context to dispatch deferred callbacks for.
+ * @param num
+ *   max number of deferred callbacks to process.
+ * @return
+ *   number of deferred callbacks processed, including skipped ones.
+ */
+uint32_t tle_ctx_cb_dispatch(struct tle_ctx *ctx, uint32_t num);
+
 /**
  * Flags to the context that destinations info might be changed,
  * so if it has any destinations data cached, then
  * it has to be invalidated.
+ * All entries of per lcore destination caches are invalidated at once,
+ * so it is cheap enough to be called from the data-path.
  * @param ctx
  *   context to invalidate.
  */
@@ -223,6 +300,8 @@ void tle_ctx_invalidate(struct tle_ctx *ctx);
  * send callback will be invoked when stream send buffer was full,
  * and some packets belonging to that stream were sent
  * (part of send buffer became free again).
+ * With TLE_CTX_FLAG_CB_DEFER, callbacks are invoked by
+ * tle_ctx_cb_dispatch() instead.
  * Note that both recv and send callbacks are called with sort of read lock
  * held on that stream. So it is not permitted to call stream_close()
  * within the callback function. Doing that would cause a deadlock.
@@ -259,6 +338,57 @@ struct tle_stream_cb {
 	void *data;
 };
 
+/**
+ * Egress rate limiter (token bucket).
+ * Could be attached to an individual TCP/UDP stream (see
+ * tle_tcp_stream_cfg.tx_rlim and tle_udp_stream_param.tx_rlim),
+ * or shared by a class of streams, possibly from different contexts.
+ * Limits amount of payload (TCP) or datagram (UDP) bytes the streams
+ * are allowed to put into the device TX queues.
+ * Packets that exceed the limit are not dropped, but kept in the stream
+ * send buffer (TCP) or returned to the caller (UDP, EAGAIN).
+ */
+struct tle_rlim;
+
+struct tle_rlim_param {
+	int32_t socket_id; /**< socket ID to allocate memory for. */
+	uint64_t rate;     /**< sustained rate, bytes per second. */
+	uint64_t burst;    /**< bucket depth (max burst size), bytes. */
+};
+
+/**
+ * create new rate limiter, the bucket is full initially.
+ * @param prm
+ *   Rate limiter parameters.
+ * @return
+ *   Pointer to the new rate limiter, or NULL on error,
+ *   with error code set in rte_errno.
+ *   Possible rte_errno errors include:
+ *   - EINVAL - invalid parameter passed to function
+ *   - ENOMEM - out of memory
+ */
+struct tle_rlim *tle_rlim_create(const struct tle_rlim_param *prm);
+
+/**
+ * update rate and burst size of the existing rate limiter.
+ * @param rl
+ *   Pointer to the rate limiter.
+ * @param prm
+ *   New rate limiter parameters (socket_id is ignored).
+ * @return
+ *   zero on successful completion.
+ *   - -EINVAL - invalid parameter passed to function
+ */
+int tle_rlim_update(struct tle_rlim *rl, const struct tle_rlim_param *prm);
+
+/**
+ * destroy the rate limiter.
+ * Caller has to make sure that no stream uses it anymore.
+ * @param rl
+ *   Pointer to the rate limiter to destroy.
+ */
+void tle_rlim_destroy(struct tle_rlim *rl);
+
 #ifdef __cplusplus
 }
 #endif
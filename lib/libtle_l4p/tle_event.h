@@ -20,7 +20,9 @@
 #include <rte_memory.h>
 #include <rte_spinlock.h>
 #include <rte_atomic.h>
+#include <rte_ring.h>
 #include <sys/queue.h>
+#include <tle_dpdk_wrapper.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -38,18 +40,70 @@ enum tle_ev_state {
 	TLE_SEV_NUM
 };
 
+/*
+ * for lock-free queues only: set together with the state
+ * while the event is in the queue ring.
+ */
+#define	TLE_SEV_QUEUED	0x4
+#define	TLE_SEV_MASK	(TLE_SEV_QUEUED - 1)
+
+/* max number of events passed to/from lock-free queue ring at once. */
+#define	TLE_EVQ_LF_BURST	0x20
+
+/**
+ * Readiness bits, accumulated by the event since the last time
+ * it was retrieved with tle_evq_get_mask().
+ * Allow to use one event per stream (epoll-like), instead of
+ * separate recv/send/error ones: the same event is passed as all of
+ * recv_ev, send_ev and err_ev, and one tle_evq_get_mask() returns
+ * both the stream and its readiness mask.
+ */
+enum {
+	TLE_EV_IN = 1,   /**< stream has data (or connections) to read */
+	TLE_EV_OUT = 2,  /**< stream has space to write */
+	TLE_EV_ERR = 4,  /**< stream was terminated and has to be closed */
+	TLE_EV_HUP = 8,  /**< peer closed the connection */
+};
+
 struct tle_event {
 	TAILQ_ENTRY(tle_event) ql;
 	struct tle_evq *head;
 	const void *data;
-	enum tle_ev_state state;
+	union {
+		enum tle_ev_state state;
+		uint32_t lfs; /* lock-free queue: state | TLE_SEV_QUEUED */
+	};
+	uint32_t mask; /* TLE_EV_* bits, updated atomically */
 } __rte_cache_aligned;
 
+/**
+ * event queue flags.
+ */
+enum {
+	TLE_EVQ_F_LOCKFREE = 1,
+	/**< state transitions are done with atomic operations,
+	 * without taking the queue lock. Raised events are passed to
+	 * the consumer through the multi-producer/single-consumer ring,
+	 * so tle_evq_get() can't be called for the same queue
+	 * by multiple threads concurrently.
+	 * nb_armed is not maintained for such queues. */
+	TLE_EVQ_F_WAIT = 2,
+	/**< queue has an eventfd associated with it, that becomes
+	 * readable when events are raised for the empty queue.
+	 * Allows to sleep in tle_evq_wait(), or to poll the queue
+	 * from an external epoll loop (see tle_evq_fd()). */
+};
+
 struct tle_evq {
 	rte_spinlock_t lock;
+	uint32_t flags;
 	uint32_t nb_events;
 	uint32_t nb_armed;
 	uint32_t nb_free;
+	struct rte_ring *r; /* armed events for lock-free queue */
+	int32_t efd;        /* eventfd for TLE_EVQ_F_WAIT queues */
+	uint32_t wake;      /* efd was signalled since the last wait */
+	uint32_t spin;      /* current spin limit for tle_evq_wait() */
 	TAILQ_HEAD(, tle_event) armed;
 	TAILQ_HEAD(, tle_event) free;
 	struct tle_event events[0];
@@ -61,6 +115,7 @@ struct tle_evq {
 struct tle_evq_param {
 	int32_t socket_id;    /**< socket ID to allocate memory from. */
 	uint32_t max_events;  /**< max number of events in queue. */
+	uint32_t flags;       /**< TLE_EVQ_F_* flags. */
 };
 
 /**
@@ -101,15 +156,73 @@ struct tle_event *tle_event_alloc(struct tle_evq *evq, const void *data);
 
 /**
  * free an allocated event.
+ * Event raise postponed by the BE till the end of its current burst
+ * can still reach the event after that call. If the event is allocated
+ * again by then, it might be raised spuriously.
  * @param ev
  *   Pointer to the event to free.
  */
 void tle_event_free(struct tle_event *ev);
 
+/* signal the queue eventfd, if not signalled yet. */
+void __tle_evq_signal(struct tle_evq *evq);
+
+/*
+ * called by the producer after events were added into the empty
+ * queue. The barrier pairs with the one in tle_evq_wait(): either
+ * the waiter sees the new events, or the producer sees the waiter.
+ */
+static inline void
+__tle_evq_wakeup(struct tle_evq *evq)
+{
+	if ((evq->flags & TLE_EVQ_F_WAIT) == 0)
+		return;
+
+	rte_smp_mb();
+	if (__atomic_load_n(&evq->wake, __ATOMIC_RELAXED) == 0)
+		__tle_evq_signal(evq);
+}
+
 static inline enum tle_ev_state
 tle_event_state(const struct tle_event *ev)
 {
-	return ev->state;
+	return (enum tle_ev_state)(ev->lfs & TLE_SEV_MASK);
+}
+
+/*
+ * lock-free queue: move event into *st* state, if its current state
+ * is one of the *msk* (bitmask of (1 << state) values).
+ * returns non-zero if event moved to UP state and has to be put
+ * into the queue ring (i.e. it is not there already).
+ */
+static inline int
+__tle_event_set_lf(struct tle_event *ev, uint32_t msk, enum tle_ev_state st)
+{
+	uint32_t nv, ov;
+
+	ov = __atomic_load_n(&ev->lfs, __ATOMIC_RELAXED);
+	do {
+		if (((1 << (ov & TLE_SEV_MASK)) & msk) == 0)
+			return 0;
+		nv = st | (ov & TLE_SEV_QUEUED);
+		if (st == TLE_SEV_UP)
+			nv |= TLE_SEV_QUEUED;
+	} while (__atomic_compare_exchange_n(&ev->lfs, &ov, nv, 0,
+			__ATOMIC_ACQ_REL, __ATOMIC_RELAXED) == 0);
+
+	return (st == TLE_SEV_UP && (ov & TLE_SEV_QUEUED) == 0);
+}
+
+static inline void
+__tle_event_move_lf(struct tle_event *ev, uint32_t msk,
+	enum tle_ev_state st)
+{
+	/* ring can hold all events of the queue, so can't fail. */
+	if (__tle_event_set_lf(ev, msk, st) != 0) {
+		_rte_ring_mp_enqueue_burst(ev->head->r,
+			(void * const *)&ev, 1);
+		__tle_evq_wakeup(ev->head);
+	}
 }
 
 /**
@@ -120,21 +233,148 @@ tle_event_state(const struct tle_event *ev)
 static inline void
 tle_event_raise(struct tle_event *ev)
 {
+	uint32_t n;
 	struct tle_evq *q;
 
-	if (ev->state != TLE_SEV_DOWN)
+	if (tle_event_state(ev) != TLE_SEV_DOWN)
 		return;
 
 	q = ev->head;
+	if (q->flags & TLE_EVQ_F_LOCKFREE) {
+		__tle_event_move_lf(ev, 1 << TLE_SEV_DOWN, TLE_SEV_UP);
+		return;
+	}
+
 	rte_compiler_barrier();
 
 	rte_spinlock_lock(&q->lock);
+	n = q->nb_armed;
 	if (ev->state == TLE_SEV_DOWN) {
 		ev->state = TLE_SEV_UP;
 		TAILQ_INSERT_TAIL(&q->armed, ev, ql);
 		q->nb_armed++;
 	}
+	n = (n == 0 && q->nb_armed != 0);
+	rte_spinlock_unlock(&q->lock);
+
+	if (n != 0)
+		__tle_evq_wakeup(q);
+}
+
+/* add readiness bits to the event, without raising it. */
+static inline void
+__tle_event_set_mask(struct tle_event *ev, uint32_t msk)
+{
+	if ((__atomic_load_n(&ev->mask, __ATOMIC_RELAXED) & msk) != msk)
+		__atomic_fetch_or(&ev->mask, msk, __ATOMIC_RELEASE);
+}
+
+/**
+ * add readiness bits to the event and move it from DOWN to UP state.
+ * Bits are added even if the event is not in DOWN state, so they
+ * are not lost while the event is already UP.
+ * @param ev
+ *   Pointer to the event.
+ * @param msk
+ *   Bitmask of TLE_EV_* values.
+ */
+static inline void
+tle_event_raise_mask(struct tle_event *ev, uint32_t msk)
+{
+	__tle_event_set_mask(ev, msk);
+	tle_event_raise(ev);
+}
+
+static inline void
+__tle_evq_raise(struct tle_evq *q, struct tle_event *ev[], uint32_t num)
+{
+	uint32_t i, k, n;
+
+	rte_spinlock_lock(&q->lock);
+	k = q->nb_armed;
+	n = 0;
+	for (i = 0; i != num; i++) {
+		if (ev[i]->state == TLE_SEV_DOWN) {
+			ev[i]->state = TLE_SEV_UP;
+			TAILQ_INSERT_TAIL(&q->armed, ev[i], ql);
+			n++;
+		}
+	}
+	q->nb_armed += n;
 	rte_spinlock_unlock(&q->lock);
+
+	if (k == 0 && n != 0)
+		__tle_evq_wakeup(q);
+}
+
+static inline void
+__tle_evq_raise_lf(struct tle_evq *q, struct tle_event *ev[], uint32_t num)
+{
+	uint32_t i, k, n;
+	struct tle_event *rev[TLE_EVQ_LF_BURST];
+
+	k = 0;
+	n = 0;
+	for (i = 0; i != num; i++) {
+		if (__tle_event_set_lf(ev[i], 1 << TLE_SEV_DOWN,
+				TLE_SEV_UP) == 0)
+			continue;
+		rev[n++] = ev[i];
+		if (n == RTE_DIM(rev)) {
+			_rte_ring_mp_enqueue_bulk(q->r, (void * const *)rev, n);
+			k += n;
+			n = 0;
+		}
+	}
+
+	if (n != 0)
+		_rte_ring_mp_enqueue_bulk(q->r, (void * const *)rev, n);
+
+	if (k + n != 0)
+		__tle_evq_wakeup(q);
+}
+
+/**
+ * move multiple events from DOWN to UP state.
+ * Events that belong to the same queue are raised together:
+ * with one lock acquisition, or with one ring enqueue per
+ * TLE_EVQ_LF_BURST events for lock-free queues.
+ * Events that are not in DOWN state are ignored.
+ * Note that order of elements in *ev* array might be changed.
+ * @param ev
+ *   An array of pointers to the events.
+ * @param num
+ *   Number of elements in the *ev* array.
+ */
+static inline void
+tle_event_raise_bulk(struct tle_event *ev[], uint32_t num)
+{
+	uint32_t i, j, k, n;
+	struct tle_evq *q;
+	struct tle_event *t;
+
+	for (i = 0; i != num; i = k) {
+
+		/* gather all events of the same queue together. */
+		q = ev[i]->head;
+		n = (tle_event_state(ev[i]) == TLE_SEV_DOWN);
+		for (j = i + 1, k = j; j != num; j++) {
+			if (ev[j]->head == q) {
+				t = ev[k];
+				ev[k] = ev[j];
+				ev[j] = t;
+				n += (tle_event_state(ev[k]) == TLE_SEV_DOWN);
+				k++;
+			}
+		}
+
+		if (n == 0)
+			continue;
+		else if (q->flags & TLE_EVQ_F_LOCKFREE)
+			__tle_evq_raise_lf(q, ev + i, k - i);
+		else
+			__tle_evq_raise(q, ev + i, k - i);
+	}
 }
 
 /**
@@ -147,10 +387,15 @@ tle_event_down(struct tle_event *ev)
 {
 	struct tle_evq *q;
 
-	if (ev->state != TLE_SEV_UP)
+	if (tle_event_state(ev) != TLE_SEV_UP)
 		return;
 
 	q = ev->head;
+	if (q->flags & TLE_EVQ_F_LOCKFREE) {
+		__tle_event_move_lf(ev, 1 << TLE_SEV_UP, TLE_SEV_DOWN);
+		return;
+	}
+
 	rte_compiler_barrier();
 
 	rte_spinlock_lock(&q->lock);
@@ -172,23 +417,34 @@ tle_event_down(struct tle_event *ev)
 static inline void
 tle_event_active(struct tle_event *ev, enum tle_ev_state st)
 {
+	uint32_t n;
 	struct tle_evq *q;
 
-	if (ev->state != TLE_SEV_IDLE)
+	if (tle_event_state(ev) != TLE_SEV_IDLE)
 		return;
 
 	q = ev->head;
+	if (q->flags & TLE_EVQ_F_LOCKFREE) {
+		if (st != TLE_SEV_IDLE)
+			__tle_event_move_lf(ev, 1 << TLE_SEV_IDLE, st);
+		return;
+	}
+
 	rte_compiler_barrier();
 
+	n = 0;
 	rte_spinlock_lock(&q->lock);
 	if (st > ev->state) {
 		if (st == TLE_SEV_UP) {
 			TAILQ_INSERT_TAIL(&q->armed, ev, ql);
-			q->nb_armed++;
+			n = (q->nb_armed++ == 0);
 		}
 		ev->state = st;
 	}
 	rte_spinlock_unlock(&q->lock);
+
+	if (n != 0)
+		__tle_evq_wakeup(q);
 }
 
 /**
@@ -201,10 +457,16 @@ tle_event_idle(struct tle_event *ev)
 {
 	struct tle_evq *q;
 
-	if (ev->state == TLE_SEV_IDLE)
+	if (tle_event_state(ev) == TLE_SEV_IDLE)
 		return;
 
 	q = ev->head;
+	if (q->flags & TLE_EVQ_F_LOCKFREE) {
+		__tle_event_move_lf(ev, (1 << TLE_SEV_DOWN) | (1 << TLE_SEV_UP),
+			TLE_SEV_IDLE);
+		return;
+	}
+
 	rte_compiler_barrier();
 
 	rte_spinlock_lock(&q->lock);
@@ -221,6 +483,12 @@ tle_evq_idle(struct tle_evq *evq, struct tle_event *ev[], uint32_t num)
 {
 	uint32_t i, n;
 
+	if (evq->flags & TLE_EVQ_F_LOCKFREE) {
+		for (i = 0; i != num; i++)
+			tle_event_idle(ev[i]);
+		return;
+	}
+
 	rte_spinlock_lock(&evq->lock);
 
 	n = 0;
@@ -236,6 +504,87 @@ tle_evq_idle(struct tle_evq *evq, struct tle_event *ev[], uint32_t num)
 	rte_spinlock_unlock(&evq->lock);
 }
 
+/*
+ * For events retrieved with their readiness mask: collect the mask,
+ * events without readiness bits (already reported) are skipped.
+ * Mask is collected after the event was moved to DOWN state,
+ * while tle_event_raise_mask() sets it before the raise, so no
+ * bits can be lost.
+ */
+static inline int
+__tle_event_get_mask(struct tle_event *ev, uint32_t msk[], uint32_t k)
+{
+	if (msk == NULL)
+		return 1;
+
+	msk[k] = __atomic_exchange_n(&ev->mask, 0, __ATOMIC_ACQ_REL);
+	return msk[k] != 0;
+}
+
+/*
+ * lock-free queue: dequeue events from the ring, clearing their
+ * QUEUED flag. Events that are still in UP state are moved to DOWN
+ * and reported, all others (moved DOWN/IDLE since) are just skipped.
+ */
+static inline int32_t
+__tle_evq_get_lf(struct tle_evq *evq, const void *evd[], uint32_t msk[],
+	uint32_t num)
+{
+	uint32_t i, k, n, nv, ov;
+	struct tle_event *ev[TLE_EVQ_LF_BURST];
+
+	k = 0;
+	do {
+		n = _rte_ring_dequeue_burst(evq->r, (void **)ev,
+			RTE_MIN(num - k, (uint32_t)RTE_DIM(ev)));
+
+		for (i = 0; i != n; i++) {
+			ov = __atomic_load_n(&ev[i]->lfs, __ATOMIC_RELAXED);
+			do {
+				nv = ov & TLE_SEV_MASK;
+				nv = (nv == TLE_SEV_UP) ? TLE_SEV_DOWN : nv;
+			} while (__atomic_compare_exchange_n(&ev[i]->lfs, &ov,
+					nv, 0, __ATOMIC_ACQ_REL,
+					__ATOMIC_RELAXED) == 0);
+
+			if ((ov & TLE_SEV_MASK) == TLE_SEV_UP &&
+					__tle_event_get_mask(ev[i], msk,
+					k) != 0)
+				evd[k++] = ev[i]->data;
+		}
+	} while (n != 0 && k != num);
+
+	return k;
+}
+
+static inline int32_t
+__tle_evq_get(struct tle_evq *evq, const void *evd[], uint32_t msk[],
+	uint32_t num)
+{
+	uint32_t i, k, n;
+	struct tle_event *ev;
+
+	if (evq->flags & TLE_EVQ_F_LOCKFREE)
+		return __tle_evq_get_lf(evq, evd, msk, num);
+
+	if (evq->nb_armed == 0)
+		return 0;
+
+	rte_compiler_barrier();
+
+	rte_spinlock_lock(&evq->lock);
+	n = RTE_MIN(num, evq->nb_armed);
+	for (i = 0, k = 0; i != n; i++) {
+		ev = TAILQ_FIRST(&evq->armed);
+		ev->state = TLE_SEV_DOWN;
+		TAILQ_REMOVE(&evq->armed, ev, ql);
+		evd[k] = ev->data;
+		k += __tle_event_get_mask(ev, msk, k);
+	}
+	evq->nb_armed -= n;
+	rte_spinlock_unlock(&evq->lock);
+	return k;
+}
 
 /*
  * return up to *num* user data pointers associated with
@@ -254,25 +603,75 @@ tle_evq_idle(struct tle_evq *evq, struct tle_event *ev[], uint32_t num)
 static inline int32_t
 tle_evq_get(struct tle_evq *evq, const void *evd[], uint32_t num)
 {
-	uint32_t i, n;
-	struct tle_event *ev;
+	return __tle_evq_get(evq, evd, NULL, num);
+}
 
-	if (evq->nb_armed == 0)
-		return 0;
+/**
+ * same as tle_evq_get(), but also returns readiness mask
+ * accumulated by each retrieved event (see TLE_EV_*),
+ * mask of the retrieved event is reset.
+ * Events with the empty mask are moved into the DOWN state,
+ * but not reported.
+ * @param evq
+ *   event queue to retrieve events from.
+ * @param evd
+ *   An array of user data pointers associated with the events retrieved.
+ *   It must be large enough to store up to *num* pointers in it.
+ * @param msk
+ *   An array of readiness masks for the events retrieved.
+ *   It must be large enough to store up to *num* values in it.
+ * @param num
+ *   Number of elements in the *evd* and *msk* arrays.
+ * @return
+ *   number of of entries filled inside *evd* and *msk* arrays.
+ */
+static inline int32_t
+tle_evq_get_mask(struct tle_evq *evq, const void *evd[], uint32_t msk[],
+	uint32_t num)
+{
+	return __tle_evq_get(evq, evd, msk, num);
+}
 
-	rte_compiler_barrier();
+/**
+ * same as tle_evq_get(), but if there are no events in UP state,
+ * waits for them to be raised: spins first (with the spin limit
+ * adapted to the recent events arrival), then sleeps on the queue
+ * eventfd.
+ * Queue has to be created with TLE_EVQ_F_WAIT flag.
+ * @param evq
+ *   event queue to retrieve events from.
+ * @param evd
+ *   An array of user data pointers associated with the events retrieved.
+ *   It must be large enough to store up to *num* pointers in it.
+ * @param num
+ *   Number of elements in the *evd* array.
+ * @param timeout
+ *   Max time to sleep (ms), negative value means infinite wait.
+ *   With zero timeout the queue eventfd is just rearmed,
+ *   that allows to use it with the external epoll loop.
+ * @return
+ *   number of of entries filled inside *evd* array (might be zero
+ *   on timeout or signal), or negative error code on failure:
+ *   - -EINVAL - invalid parameter passed to function
+ */
+int32_t tle_evq_wait(struct tle_evq *evq, const void *evd[], uint32_t num,
+	int32_t timeout);
 
-	rte_spinlock_lock(&evq->lock);
-	n = RTE_MIN(num, evq->nb_armed);
-	for (i = 0; i != n; i++) {
-		ev = TAILQ_FIRST(&evq->armed);
-		ev->state = TLE_SEV_DOWN;
-		TAILQ_REMOVE(&evq->armed, ev, ql);
-		evd[i] = ev->data;
-	}
-	evq->nb_armed -= n;
-	rte_spinlock_unlock(&evq->lock);
-	return n;
+/**
+ * get the eventfd of the queue created with TLE_EVQ_F_WAIT flag.
+ * That descriptor becomes readable when events are raised for
+ * the empty queue. It is level triggered: it stays readable till
+ * the user calls tle_evq_wait() that finds the queue empty.
+ * Descriptor is owned by the queue and closed by tle_evq_destroy().
+ * @param evq
+ *   event queue.
+ * @return
+ *   file descriptor, or -1 if the queue has no eventfd.
+ */
+static inline int
+tle_evq_fd(const struct tle_evq *evq)
+{
+	return (evq->flags & TLE_EVQ_F_WAIT) ? evq->efd : -1;
 }
 
 
@@ -86,12 +86,40 @@ struct tle_tcp_stream_addr {
 
 #define	TLE_TCP_DEFAULT_RETRIES	3
 
+/*
+ * stream transmit options
+ */
+enum {
+	/**
+	 * append small writes into the last not yet transmitted segment,
+	 * hold partially filled segment while there is unacknowledged data.
+	 */
+	TLE_TCP_TX_OPT_NAGLE = 0x1,
+	/**
+	 * append small writes into the last not yet transmitted segment,
+	 * hold partially filled segment till tle_tcp_stream_flush().
+	 */
+	TLE_TCP_TX_OPT_CORK = 0x2,
+};
+
 struct tle_tcp_stream_cfg {
 	uint8_t nb_retries;     /**< max number of retransmission attempts. */
+	uint32_t tx_opts;       /**< combination of TLE_TCP_TX_OPT_* values. */
+	uint32_t tx_weight;
+	/**< stream weight for the TX scheduler (see tle_ctx_param.tx_quantum),
+	 * 1 if 0. */
+	struct tle_rlim *tx_rlim;
+	/**< egress rate limiter to use, NULL if none. */
 
 	uint64_t udata; /**< user data to be associated with the stream. */
 
-	/* _cb and _ev are mutually exclusive */
+	/*
+	 * _cb and _ev are mutually exclusive.
+	 * The same event can be used for err, recv and send,
+	 * then tle_evq_get_mask() tells which of them happened:
+	 * TLE_EV_IN, TLE_EV_OUT, TLE_EV_HUP (FIN received) or
+	 * TLE_EV_ERR (stream was terminated).
+	 */
 	struct tle_event *err_ev;      /**< error event to use.  */
 	struct tle_stream_cb err_cb;   /**< error callback to use. */
 
@@ -297,6 +325,44 @@ tle_tcp_stream_establish(struct tle_ctx *ctx,
 	const struct tle_tcp_stream_param *prm,
 	const struct tle_tcp_conn_info *ci, uint32_t flags);
 
+/**
+ * Bulk version of tle_tcp_stream_establish().
+ * Creates up to *num* new streams within given TCP context and puts
+ * them into ESTABLISHED state straightaway.
+ * Stream allocation and stream table insertion are performed
+ * for the whole batch at once, which makes it considerably cheaper
+ * than calling tle_tcp_stream_establish() for each connection.
+ * @param ctx
+ *   TCP context to create new streams within.
+ * @param prm
+ *   An array of parameters used to create and initialise the new streams.
+ * @param ci
+ *   An array of connection state values to recreate.
+ * @param ts
+ *   An array of pointers to be filled with the new streams.
+ *   For each failed entry, NULL is stored.
+ * @param rc
+ *   An array to be filled with the per-entry result:
+ *   zero on success, or negative error code otherwise:
+ *   - -EINVAL - invalid parameter passed to function
+ *   - -ENFILE - max limit of open streams reached for that context
+ *   - -ENOBUFS - no room left in the stream table
+ *   Any error returned by the lookup4/lookup6 callback is reported as is.
+ * @param num
+ *   Number of elements in the *prm*, *ci*, *ts* and *rc* arrays.
+ * @param flags
+ *   Combination of TLE_TCP_STREAM_F_* values, applied to all streams.
+ * @return
+ *   Number of successfully established streams.
+ *   In case of invalid input parameters, zero is returned and
+ *   rte_errno is set to EINVAL.
+ */
+uint32_t
+tle_tcp_stream_establish_bulk(struct tle_ctx *ctx,
+	const struct tle_tcp_stream_param prm[],
+	const struct tle_tcp_conn_info ci[], struct tle_stream *ts[],
+	int32_t rc[], uint32_t num, uint32_t flags);
+
 /**
  * Client mode connect API.
  */
@@ -457,6 +523,44 @@ uint16_t tle_tcp_stream_recv(struct tle_stream *s, struct rte_mbuf *pkt[],
 ssize_t tle_tcp_stream_readv(struct tle_stream *ts, const struct iovec *iov,
 	int iovcnt);
 
+/**
+ * Zero-copy receive: provides read-only access to the in-order data
+ * waiting in the stream receive buffer, without removing it.
+ * Each filled *iov* element points directly to the payload of one
+ * mbuf segment inside the stream receive buffer.
+ * Data ordering is preserved.
+ * Returned buffers remain valid until the data they refer to is removed
+ * by tle_tcp_stream_consume() (or by any other receive call).
+ * Note that user has to guarantee that no other thread reads from
+ * the same stream between tle_tcp_stream_peekv() and
+ * tle_tcp_stream_consume() calls.
+ * @param ts
+ *   TCP stream to peek data from.
+ * @param iov
+ *   Points to an array of iovec structures to be filled.
+ * @param iovcnt
+ *   Number of elements in the *iov* array.
+ * @return
+ *   number of of entries filled inside *iov* array,
+ *   or -EINVAL if *ts* or *iov* is NULL or *iovcnt* is not positive.
+ */
+int tle_tcp_stream_peekv(struct tle_stream *ts, struct iovec iov[],
+	int iovcnt);
+
+/**
+ * Removes up to *len* bytes of in-order data from the stream receive
+ * buffer, usually after it was inspected with tle_tcp_stream_peekv().
+ * If *len* ends in the middle of a packet, the rest of that packet
+ * stays in the stream receive buffer.
+ * @param ts
+ *   TCP stream to remove data from.
+ * @param len
+ *   Number of bytes to remove.
+ * @return
+ *   number of bytes actually removed from the stream receive buffer.
+ */
+size_t tle_tcp_stream_consume(struct tle_stream *ts, size_t len);
+
 /**
  * Consume and queue up to *num* packets, that will be sent eventually
  * by tle_tcp_tx_bulk().
@@ -488,6 +592,35 @@ ssize_t tle_tcp_stream_readv(struct tle_stream *ts, const struct iovec *iov,
 uint16_t tle_tcp_stream_send(struct tle_stream *s, struct rte_mbuf *pkt[],
 	uint16_t num);
 
+/**
+ * Moves in-order data from the receive buffer of one TCP stream
+ * straight into the send buffer of another one, without copying it.
+ * Data is re-segmented according to the MSS of the output stream.
+ * Receive window advertised by the input stream is limited by
+ * the space available in the send buffer of the output stream,
+ * so the input side is opened only as fast as the output side drains.
+ * As the window limit is re-evaluated only by that function,
+ * user is expected to call it on both: recv event (or callback) for the
+ * input stream and send event (or callback) for the output stream.
+ * The limit is removed by the first call that finds all spliced data
+ * consumed: nothing left in the input stream receive buffer and all
+ * data in the output stream send buffer acknowledged by its peer.
+ * Note that the output stream has to be in connected state.
+ * @param ts_in
+ *   TCP stream to receive data from.
+ * @param ts_out
+ *   TCP stream to send data to.
+ * @return
+ *   On success, number of bytes moved into the output stream send buffer.
+ *   In case of error, returns -1 and error code will be set in rte_errno.
+ *   - EAGAIN - operation can't be perfomed right now
+ *              (most likely close() was perfomed on output stream allready).
+ *   - ENOTCONN - the output stream is not connected.
+ *   - ENOMEM - not enough internal buffer (mbuf) to re-segment data.
+ */
+ssize_t tle_tcp_stream_splice(struct tle_stream *ts_in,
+	struct tle_stream *ts_out);
+
 /**
  * Writes iovcnt buffers of data described by iov to the for given TCP stream.
  * Note that the stream has to be in connected state.
@@ -514,6 +647,69 @@ uint16_t tle_tcp_stream_send(struct tle_stream *s, struct rte_mbuf *pkt[],
 ssize_t tle_tcp_stream_writev(struct tle_stream *ts, struct rte_mempool *mp,
 	const struct iovec *iov, int iovcnt);
 
+/**
+ * Zero-copy version of tle_tcp_stream_writev().
+ * Instead of copying user data into the mbufs allocated from *mp*,
+ * user buffers are attached to them as external buffers
+ * (see rte_pktmbuf_attach_extbuf()), while *mp* is used for packet headers
+ * and mbuf metadata only.
+ * Memory pointed to by *iov* has to be DPDK managed (or registered
+ * external) memory, i.e. rte_mem_virt2iova() has to work for it.
+ * As each packet consists of two segments, the underlying device has to
+ * support multi-segment transmission.
+ * The caller has to setup free_cb and fcb_opaque fields of *shinfo*,
+ * while its reference counter is maintained by the stream.
+ * If the function returns a positive value, then *shinfo->free_cb* will be
+ * invoked exactly once, when all of the written data is acknowledged
+ * by the peer and released (or the stream is closed).
+ * Until then, neither user buffers nor *shinfo* can be modified or freed.
+ * Otherwise, user buffers are not referenced by the stream and
+ * the callback is not invoked.
+ * As with any other DPDK external buffer, the first argument of
+ * *shinfo->free_cb* is the start of one of the buffers attached by that
+ * call, which one depends on the packet that drops the last reference.
+ * The second one is *shinfo->fcb_opaque*, that is what the caller
+ * should use to identify the completed write.
+ * @param ts
+ *   TCP stream to send data to.
+ * @param mp
+ *   Mempool to allocate mbufs from.
+ * @param iov
+ *   Points to an array of iovec structures.
+ * @param iovcnt
+ *   Number of elements in the *iov* array.
+ * @param shinfo
+ *   Shared info to use for all buffers attached by that call.
+ * @return
+ *   On success, number of bytes written to the stream send buffer.
+ *   In case of error, returns -1 and error code will be set in rte_errno.
+ *   - EINVAL - invalid parameter passed to function
+ *              (*iovcnt* is not positive or *shinfo->free_cb* is NULL).
+ *   - EAGAIN - operation can't be perfomed right now
+ *              (most likely close() was perfomed on that stream allready).
+ *   - ENOTCONN - the stream is not connected.
+ *   - ENOMEM - not enough internal buffer (mbuf) to store user provided data.
+ *   - EFAULT - IO address for user provided buffer can't be determined.
+ */
+ssize_t tle_tcp_stream_writev_ext(struct tle_stream *ts,
+	struct rte_mempool *mp, const struct iovec *iov, int iovcnt,
+	struct rte_mbuf_ext_shared_info *shinfo);
+
+/**
+ * Push all data queued so far in the stream send buffer towards the peer,
+ * including partially filled segments held because of
+ * TLE_TCP_TX_OPT_NAGLE or TLE_TCP_TX_OPT_CORK options.
+ * Note that actual transmission happens within tle_tcp_process().
+ * @param ts
+ *   TCP stream to flush.
+ * @return
+ *   zero on successful completion.
+ *   - -EINVAL - invalid parameter passed to function
+ *   - -EAGAIN - operation can't be perfomed right now
+ *              (most likely close() was perfomed on that stream allready).
+ */
+int tle_tcp_stream_flush(struct tle_stream *ts);
+
 /**
  * Back End (BE) API.
  * BE API functions are not multi-thread safe.
@@ -528,6 +724,9 @@ ssize_t tle_tcp_stream_writev(struct tle_stream *ts, struct rte_mempool *mp,
  *	- (packet_type & RTE_PTYPE_L4_TCP) != 0,
  * During delivery L3/L4 checksums will be verified
  * (either relies on HW offload or in SW).
+ * If tle_ctx_param.frag_tbl_size is set, IP fragments
+ * (packet_type & RTE_PTYPE_L4_MASK) == RTE_PTYPE_L4_FRAG are reassembled
+ * first; fragments held for reassembly are counted as delivered.
  * May cause some extra packets to be queued for TX.
  * This function is not multi-thread safe.
  * @param dev
@@ -541,6 +740,7 @@ ssize_t tle_tcp_stream_writev(struct tle_stream *ts, struct rte_mempool *mp,
  *   The array that will contain error code for corresponding rp[] entry:
  *   - ENOENT - no open stream matching this packet.
  *   - ENOBUFS - receive buffer of the destination stream is full.
+ *   - EINVAL - invalid IP fragment.
  *   Should contain at least *num* elements.
  * @param num
  *   Number of elements in the *pkt* input array.
@@ -610,6 +810,10 @@ uint16_t tle_tcp_tx_bulk(struct tle_dev *dev, struct rte_mbuf *pkt[],
  * Checks which timers are expired and performs the required actions
  * (retransmission/connection abort, etc.)
  * May cause some extra packets to be queued for TX.
+ * If tle_ctx_param.tx_quantum is set, streams with data to send are
+ * served in deficit round robin order (weighted by
+ * tle_tcp_stream_cfg.tx_weight), with at most tle_ctx_param.tx_budget
+ * payload bytes sent per call.
  * This function is not multi-thread safe.
  * @param ctx
  *   TCP context to process.
@@ -22,6 +22,51 @@
 extern "C" {
 #endif
 
+/*
+ * stream receive options
+ */
+enum {
+	/**
+	 * receive side coalescing (GRO): consecutive datagrams of the
+	 * same flow and of the same size (last one might be smaller),
+	 * received within one tle_udp_rx_bulk() call, are chained into
+	 * one multi-segment packet (at most TLE_UDP_GRO_MAX_SEG datagrams).
+	 * For such packet tle_udp_stream_recv() sets *tso_segsz* to the
+	 * datagram payload size, L2/L3/L4 headers are the ones of
+	 * the first datagram. For other packets received by such stream
+	 * *tso_segsz* is zero.
+	 */
+	TLE_UDP_RX_OPT_GRO = 0x1,
+	/**
+	 * share local port between several streams (SO_REUSEPORT):
+	 * stream opened with the same local and remote addresses as
+	 * already existing stream, when both have that option set,
+	 * joins its port group instead of failing with EEXIST.
+	 * Received datagrams are spread between group members by flow
+	 * hash (remote address and port), so all datagrams of one flow
+	 * go to the same stream. Local port has to be specified explicitly,
+	 * at most TLE_UDP_REUSEPORT_MAX streams per group.
+	 * Doesn't apply to connected streams.
+	 */
+	TLE_UDP_RX_OPT_REUSEPORT = 0x2,
+};
+
+/**
+ * max number of streams that can share one local port.
+ */
+#define	TLE_UDP_REUSEPORT_MAX	32
+
+/**
+ * max number of streams that can join the same multicast group
+ * on the same local port.
+ */
+#define	TLE_UDP_MCAST_MAX_MEMB	32
+
+/**
+ * max number of datagrams GRO can chain into one packet.
+ */
+#define	TLE_UDP_GRO_MAX_SEG	64
+
 /**
  * UDP stream creation parameters.
  */
@@ -29,14 +74,35 @@ struct tle_udp_stream_param {
 	struct sockaddr_storage local_addr;  /**< stream local address. */
 	struct sockaddr_storage remote_addr; /**< stream remote address. */
 
-	/* _cb and _ev are mutually exclusive */
+	/*
+	 * _cb and _ev are mutually exclusive.
+	 * The same event can be used for recv and send, then
+	 * tle_evq_get_mask() reports TLE_EV_IN and/or TLE_EV_OUT.
+	 */
 	struct tle_event *recv_ev;          /**< recv event to use.  */
 	struct tle_stream_cb recv_cb;   /**< recv callback to use. */
 
 	struct tle_event *send_ev;          /**< send event to use. */
 	struct tle_stream_cb send_cb;   /**< send callback to use. */
+
+	struct tle_rlim *tx_rlim; /**< egress rate limiter, NULL if none. */
+
+	uint16_t gso_size;
+	/**< UDP generic segmentation: max payload size of each datagram.
+	 * Packets passed to tle_udp_stream_send() with bigger payload
+	 * will be split into multiple datagrams (at most TLE_UDP_GSO_MAX_SEG)
+	 * of that size (last one might be smaller). Segmentation is done by
+	 * the device (if it supports UDP TSO), otherwise in SW.
+	 * 0 disables segmentation, IP fragmentation is used instead. */
+
+	uint32_t rx_opts; /**< combination of TLE_UDP_RX_OPT_* values. */
 };
 
+/**
+ * max number of datagrams one packet can be split into by UDP GSO.
+ */
+#define	TLE_UDP_GSO_MAX_SEG	64
+
 /**
  * create a new stream within given UDP context.
  * @param ctx
@@ -87,6 +153,9 @@ tle_udp_stream_get_param(const struct tle_stream *s,
  *	- (packet_type & RTE_PTYPE_L4_UDP) != 0,
  * During delivery L3/L4 checksums will be verified
  * (either relies on HW offload or in SW).
+ * If tle_ctx_param.frag_tbl_size is set, IP fragments
+ * (packet_type & RTE_PTYPE_L4_MASK) == RTE_PTYPE_L4_FRAG are reassembled
+ * first; fragments held for reassembly are counted as delivered.
  * This function is not multi-thread safe.
  * @param dev
  *   UDP device the packets were received from.
@@ -99,6 +168,7 @@ tle_udp_stream_get_param(const struct tle_stream *s,
  *   The array that will contain error code for corresponding rp[] entry:
  *   - ENOENT - no open stream matching this packet.
  *   - ENOBUFS - receive buffer of the destination stream is full.
+ *   - EINVAL - invalid IP fragment.
  *   Should contain at least *num* elements.
  * @param num
  *   Number of elements in the *pkt* input array.
@@ -159,7 +229,8 @@ uint16_t tle_udp_stream_recv(struct tle_stream *s, struct rte_mbuf *pkt[],
  * The main purpose of that function is to determine over which UDP dev
  * given packets have to be sent out and do necessary preparations for that.
  * Based on the *dst_addr* it does route lookup, fills L2/L3/L4 headers,
- * and, if necessary, fragments packets.
+ * and, if necessary, segments (see gso_size stream parameter)
+ * or fragments packets.
  * Depending on the underlying device information, it either does
  * IP/UDP checksum calculations in SW or sets mbuf TX checksum
  * offload fields properly.
@@ -180,6 +251,68 @@ uint16_t tle_udp_stream_recv(struct tle_stream *s, struct rte_mbuf *pkt[],
 uint16_t tle_udp_stream_send(struct tle_stream *s, struct rte_mbuf *pkt[],
 	uint16_t num, const struct sockaddr *dst_addr);
 
+/**
+ * Same as tle_udp_stream_send(), but each packet might have its own
+ * destination address (similar to sendmmsg()).
+ * Packets are grouped by destination internally, so route lookup
+ * is done only once per each unique destination, and consecutive packets
+ * going over the same device are enqueued into its TX queue at once.
+ * Packets are queued in the order they are given: sending stops at the
+ * first packet that can't be queued (invalid or unreachable destination,
+ * stream send buffer is full), rte_errno is set in that case.
+ * @param s
+ *   UDP stream to send packets over.
+ * @param pkt
+ *   The burst of output packets that need to be send.
+ * @param num
+ *   Number of elements in the *pkt* and *dst_addr* arrays.
+ * @param dst_addr
+ *   Destination address for each packet, NULL element means
+ *   that default remote address associated with that stream
+ *   will be used for that packet.
+ * @return
+ *   number of packets successfully queued in the stream send buffer,
+ *   i.e. number of packets from the start of *pkt* array that will be sent.
+ */
+uint16_t tle_udp_stream_send_multi(struct tle_stream *s,
+	struct rte_mbuf *pkt[], uint16_t num,
+	const struct sockaddr * const dst_addr[]);
+
+/**
+ * Join multicast group (or IPv4 limited broadcast address).
+ * Datagrams sent to that group address and stream's local port
+ * will be delivered to all streams that joined it.
+ * Each stream gets its own (indirect) mbuf that refers to the same
+ * packet data, i.e. data is not copied.
+ * Only streams bound to wildcard local address
+ * (i.e. not connected ones) can join multicast groups.
+ * @param s
+ *   UDP stream to join the group.
+ * @param grp
+ *   Group address, port value is ignored.
+ *   Address family has to match stream one.
+ * @return
+ *   zero on successful completion.
+ *   - -EINVAL - invalid parameter passed to function
+ *   - -EEXIST - stream already joined that group
+ *   - -ENOSPC - too many groups or group members
+ */
+int tle_udp_stream_join(struct tle_stream *s, const struct sockaddr *grp);
+
+/**
+ * Leave multicast group previously joined by tle_udp_stream_join().
+ * Stream leaves all its groups automatically when closed.
+ * @param s
+ *   UDP stream to leave the group.
+ * @param grp
+ *   Group address, port value is ignored.
+ * @return
+ *   zero on successful completion.
+ *   - -EINVAL - invalid parameter passed to function
+ *   - -ENOENT - stream is not a member of that group
+ */
+int tle_udp_stream_leave(struct tle_stream *s, const struct sockaddr *grp);
+
 #ifdef __cplusplus
 }
 #endif
@@ -15,13 +15,17 @@
 
 #include <rte_malloc.h>
 #include <rte_errno.h>
+#include <rte_cycles.h>
 #include <rte_ethdev.h>
 #include <rte_ip.h>
 #include <rte_ip_frag.h>
 #include <rte_udp.h>
 
 #include "udp_stream.h"
+#include "evbulk.h"
 #include "misc.h"
+#include "rlim.h"
+#include "tcp_tx_seg.h"
 
 static inline struct tle_udp_stream *
 rx_stream_obtain(struct tle_dev *dev, uint32_t type, uint32_t port)
@@ -41,8 +45,47 @@ rx_stream_obtain(struct tle_dev *dev, uint32_t type, uint32_t port)
 	return s;
 }
 
+/*
+ * batched 4-tuple lookup for connected streams,
+ * *cs[i]* is set to NULL when there is no connected stream for i-th packet.
+ */
+static inline void
+rx_conn_lookup(struct tle_ctx *ctx, const union l4_ports tp[],
+	const union l4_ports port[], const union ipv4_addrs a4[],
+	union ipv6_addrs * const pa6[], void *cs[], uint32_t num)
+{
+	uint32_t i, n, t;
+	uint32_t idx[num];
+	struct stbl_key key[num];
+	const struct stbl_key *pk[num];
+	void *data[num];
+
+	for (t = TLE_V4; t != TLE_VNUM; t++) {
+
+		n = 0;
+		for (i = 0; i != num; i++) {
+			if (tp[i].src != t)
+				continue;
+			key[n].port = port[i];
+			if (t == TLE_V4)
+				key[n].addr4 = a4[i];
+			else
+				key[n].addr6 = *pa6[i];
+			pk[n] = key + n;
+			idx[n] = i;
+			n++;
+		}
+
+		if (n != 0) {
+			stbl_find_data_bulk(CTX_UDP_STLB(ctx), t, pk, data, n);
+			for (i = 0; i != n; i++)
+				cs[idx[i]] = data[i];
+		}
+	}
+}
+
 static inline uint16_t
-get_pkt_type(const struct rte_mbuf *m)
+get_udp_pkt_type(const struct rte_mbuf *m)
 {
 	uint32_t v;
 
@@ -64,7 +107,7 @@ pkt_info(struct rte_mbuf *m, union l4_ports *ports, union ipv4_addrs *addr4,
 	union l4_ports ret, *up;
 	union ipv4_addrs *pa4;
 
-	ret.src = get_pkt_type(m);
+	ret.src = get_udp_pkt_type(m);
 
 	len = m->l2_len;
 	if (ret.src == TLE_V4) {
@@ -98,7 +141,7 @@ rx_stream(struct tle_udp_stream *s, void *mb[], struct rte_mbuf *rp[],
 
 	/* if RX queue was empty invoke user RX notification callback. */
 	if (s->rx.cb.func != NULL && r != 0 && rte_ring_count(s->rx.q) == r)
-		s->rx.cb.func(s->rx.cb.data, &s->s);
+		stream_invoke_cb(&s->s, &s->rx.cb, STREAM_CB_RX);
 
 	for (i = r, k = 0; i != num; i++, k++) {
 		rc[k] = ENOBUFS;
@@ -108,14 +151,82 @@ rx_stream(struct tle_udp_stream *s, void *mb[], struct rte_mbuf *rp[],
 	return r;
 }
 
+/*
+ * Receive side coalescing: chain consecutive datagrams of the same flow
+ * and of the same payload size (last one might be smaller) into one
+ * multi-segment packet. *same[i]* is non-zero when i-th packet belongs
+ * to the same flow as previous one.
+ * As after merging checksums can't be verified any more, it is done
+ * here (instead of stream_recv()), packets with invalid cksum are dropped.
+ * Returns number of packets left in *mb*.
+ */
+static inline uint32_t
+rx_gro(void *mb[], const uint8_t same[], uint32_t num, uint32_t type)
+{
+	uint32_t i, k, nd, plen, sz;
+	struct rte_mbuf *h, *m, *t;
+
+	h = NULL;
+	t = NULL;
+	nd = 0;
+	sz = 0;
+
+	k = 0;
+	for (i = 0; i != num; i++) {
+
+		m = mb[i];
+
+		/* drop packets with invalid cksum(s). */
+		if (check_pkt_csum(m, m->ol_flags, type, IPPROTO_UDP) != 0) {
+			rte_pktmbuf_free(m);
+			h = NULL;
+			continue;
+		}
+
+		plen = m->pkt_len - (m->l2_len + m->l3_len + m->l4_len);
+
+		/* append datagram to the current packet */
+		if (h != NULL && same[i] != 0 && plen <= sz &&
+				nd != TLE_UDP_GRO_MAX_SEG &&
+				h->nb_segs + m->nb_segs <=
+				RTE_MBUF_MAX_NB_SEGS) {
+
+			rte_pktmbuf_adj(m, m->l2_len + m->l3_len + m->l4_len);
+			t->next = m;
+			t = rte_pktmbuf_lastseg(m);
+			h->nb_segs += m->nb_segs;
+			h->pkt_len += m->pkt_len;
+			h->tso_segsz = sz;
+			nd++;
+
+			/* smaller datagram terminates the sequence */
+			if (plen != sz)
+				h = NULL;
+
+		/* start new packet */
+		} else {
+			mb[k++] = m;
+			h = m;
+			t = rte_pktmbuf_lastseg(m);
+			h->tso_segsz = 0;
+			sz = plen;
+			nd = 1;
+		}
+	}
+
+	return k;
+}
+
 static inline uint16_t
 rx_stream6(struct tle_udp_stream *s, struct rte_mbuf *pkt[],
 	union ipv6_addrs *addr[], union l4_ports port[],
 	struct rte_mbuf *rp[], int32_t rc[], uint16_t num)
 {
-	uint32_t i, k, n;
+	uint32_t i, j, k, n;
 	void *mb[num];
+	uint8_t same[num];
 
+	j = 0;
 	k = 0;
 	n = 0;
 
@@ -128,11 +239,19 @@ rx_stream6(struct tle_udp_stream *s, struct rte_mbuf *pkt[],
 			rp[k] = pkt[i];
 			k++;
 		} else {
+			same[n] = (n != 0 && port[i].raw == port[j].raw &&
+				ymm_cmp(&addr[i]->raw, &addr[j]->raw) == 0);
 			mb[n] = pkt[i];
 			n++;
+			j = i;
 		}
 	}
 
+	if ((s->prm.rx_opts & TLE_UDP_RX_OPT_GRO) != 0 && n != 0) {
+		i = rx_gro(mb, same, n, TLE_V6);
+		return rx_stream(s, mb, rp + k, rc + k, i) + n - i;
+	}
+
 	return rx_stream(s, mb, rp + k, rc + k, n);
 }
 
@@ -141,9 +260,11 @@ rx_stream4(struct tle_udp_stream *s, struct rte_mbuf *pkt[],
 	union ipv4_addrs addr[], union l4_ports port[],
 	struct rte_mbuf *rp[], int32_t rc[], uint16_t num)
 {
-	uint32_t i, k, n;
+	uint32_t i, j, k, n;
 	void *mb[num];
+	uint8_t same[num];
 
+	j = 0;
 	k = 0;
 	n = 0;
 
@@ -156,49 +277,437 @@ rx_stream4(struct tle_udp_stream *s, struct rte_mbuf *pkt[],
 			rp[k] = pkt[i];
 			k++;
 		} else {
+			same[n] = (n != 0 && port[i].raw == port[j].raw &&
+				addr[i].raw == addr[j].raw);
 			mb[n] = pkt[i];
 			n++;
+			j = i;
 		}
 	}
 
+	if ((s->prm.rx_opts & TLE_UDP_RX_OPT_GRO) != 0 && n != 0) {
+		i = rx_gro(mb, same, n, TLE_V4);
+		return rx_stream(s, mb, rp + k, rc + k, i) + n - i;
+	}
+
 	return rx_stream(s, mb, rp + k, rc + k, n);
 }
 
+/* deliver packets to the stream, returns number of accepted packets. */
+static inline uint32_t
+rx_stream_deliver(struct tle_udp_stream *s, uint32_t type,
+	struct rte_mbuf *pkt[], union ipv4_addrs a4[],
+	union ipv6_addrs *pa6[], union l4_ports port[],
+	struct rte_mbuf *rp[], int32_t rc[], uint32_t num)
+{
+	uint32_t n;
+
+	if (type == TLE_V4)
+		n = rx_stream4(s, pkt, a4, port, rp, rc, num);
+	else
+		n = rx_stream6(s, pkt, pa6, port, rp, rc, num);
+
+	if (s->rx.ev != NULL)
+		evbulk_raise(s->rx.ev, TLE_EV_IN);
+	return n;
+}
+
+static inline uint32_t
+rx_flow_hash(uint32_t type, const union ipv4_addrs *pa4,
+	const union ipv6_addrs *pa6, union l4_ports port)
+{
+	uint32_t h;
+
+	if (type == TLE_V4)
+		h = pa4->src;
+	else
+		h = pa6->src.u32[0] ^ pa6->src.u32[1] ^ pa6->src.u32[2] ^
+			pa6->src.u32[3];
+
+	h ^= port.src;
+	h *= 0x9e3779b1;
+	return h ^ (h >> 16);
+}
+
+/*
+ * spread packets for the port group between its members by flow hash,
+ * packets of the same flow are kept in order.
+ * returns number of accepted packets.
+ */
+static inline uint32_t
+rx_port_grp(const struct udp_port_grp *grp, uint32_t type,
+	struct rte_mbuf *pkt[], union ipv4_addrs a4[],
+	union ipv6_addrs *pa6[], union l4_ports port[],
+	struct rte_mbuf *rp[], int32_t rc[], uint32_t num)
+{
+	uint32_t h, i, k, m, n, x;
+	struct tle_udp_stream *s;
+	uint32_t ofs[TLE_UDP_REUSEPORT_MAX];
+	uint8_t idx[num];
+	struct rte_mbuf *spkt[num];
+	union ipv4_addrs sa4[num];
+	union ipv6_addrs *spa6[num];
+	union l4_ports sport[num];
+
+	n = grp->num;
+	rte_smp_rmb();
+
+	/* select member for each packet. */
+	memset(ofs, 0, n * sizeof(ofs[0]));
+	for (i = 0; i != num; i++) {
+		h = rx_flow_hash(type, a4 + i, pa6[i], port[i]);
+		idx[i] = ((uint64_t)h * n) >> 32;
+		ofs[idx[i]]++;
+	}
+
+	/* group packets by member (stable counting sort). */
+	for (x = 0, k = 0; x != n; x++) {
+		m = ofs[x];
+		ofs[x] = k;
+		k += m;
+	}
+	for (i = 0; i != num; i++) {
+		m = ofs[idx[i]]++;
+		spkt[m] = pkt[i];
+		sport[m] = port[i];
+		if (type == TLE_V4)
+			sa4[m] = a4[i];
+		else
+			spa6[m] = pa6[i];
+	}
+
+	/* now ofs[x] points to the end of x-th member packets. */
+	k = 0;
+	for (x = 0, i = 0; x != n; i = ofs[x], x++) {
+
+		m = ofs[x] - i;
+		if (m == 0)
+			continue;
+
+		s = grp->s[x];
+		if (rwl_acquire(&s->rx.use) < 0) {
+			for (; i != ofs[x]; i++, k++) {
+				rc[k] = ENOENT;
+				rp[k] = spkt[i];
+			}
+			continue;
+		}
+
+		k += m - rx_stream_deliver(s, type, spkt + i, sa4 + i,
+			spa6 + i, sport + i, rp + k, rc + k, m);
+		rwl_release(&s->rx.use);
+	}
+
+	return num - k;
+}
+
+static inline int
+rx_is_mcast(uint32_t type, const union ipv4_addrs *pa4,
+	const union ipv6_addrs *pa6)
+{
+	if (type == TLE_V4)
+		return (pa4->dst & rte_cpu_to_be_32(0xf0000000)) ==
+			rte_cpu_to_be_32(0xe0000000) ||
+			pa4->dst == INADDR_BROADCAST;
+	return pa6->dst.u8[0] == UINT8_MAX;
+}
+
+/*
+ * find multicast group for each multicast/broadcast packet,
+ * *mg[i]* is set to NULL for all other packets.
+ */
+static inline void
+rx_mcast_lookup(const struct udp_streams *us, const union l4_ports tp[],
+	const union ipv4_addrs a4[], union ipv6_addrs * const pa6[],
+	const void *mg[], uint32_t num)
+{
+	uint32_t i, t, x;
+	const void *addr;
+	const struct udp_mcast_grp *pg;
+
+	pg = NULL;
+	for (i = 0; i != num; i++) {
+
+		mg[i] = NULL;
+		t = tp[i].src;
+		if (t >= TLE_VNUM || rx_is_mcast(t, a4 + i, pa6[i]) == 0)
+			continue;
+
+		addr = (t == TLE_V4) ? (const void *)&a4[i].dst :
+			(const void *)&pa6[i]->dst;
+
+		/* usually all packets in the burst are for the same group */
+		if (pg != NULL && udp_mcast_match(pg, t, addr, tp[i].dst)) {
+			mg[i] = pg;
+			continue;
+		}
+
+		for (x = 0; x != RTE_DIM(us->mcast); x++) {
+			if (udp_mcast_match(us->mcast + x, t, addr,
+					tp[i].dst) != 0) {
+				pg = us->mcast + x;
+				mg[i] = pg;
+				break;
+			}
+		}
+	}
+}
+
+/* same address/port filtering as in rx_stream4/rx_stream6. */
+static inline int
+rx_stream_match(const struct tle_udp_stream *s, uint32_t type,
+	const union ipv4_addrs *pa4, const union ipv6_addrs *pa6,
+	union l4_ports port)
+{
+	if ((port.raw & s->s.pmsk.raw) != s->s.port.raw)
+		return 0;
+	if (type == TLE_V4)
+		return (pa4->raw & s->s.ipv4.mask.raw) == s->s.ipv4.addr.raw;
+	return ymm_mask_cmp(&pa6->raw, &s->s.ipv6.addr.raw,
+		&s->s.ipv6.mask.raw) == 0;
+}
+
+/*
+ * enqueue multicast datagrams to the stream,
+ * returns number of enqueued packets, caller is responsible
+ * for the ones that don't fit into the stream RX queue.
+ */
+static inline uint32_t
+rx_stream_mcast(struct tle_udp_stream *s, void *mb[], uint32_t num)
+{
+	uint32_t r;
+
+	r = _rte_ring_enqueue_burst(s->rx.q, mb, num);
+
+	/* if RX queue was empty invoke user RX notification callback. */
+	if (s->rx.cb.func != NULL && r != 0 && rte_ring_count(s->rx.q) == r)
+		stream_invoke_cb(&s->s, &s->rx.cb, STREAM_CB_RX);
+
+	if (r != 0 && s->rx.ev != NULL)
+		evbulk_raise(s->rx.ev, TLE_EV_IN);
+
+	return r;
+}
+
+/*
+ * grab all members of the group that are still open.
+ * Group entry could be updated or even reused for another group
+ * by FE meanwhile, so members are taken from the consistent
+ * snapshot of the entry only.
+ * returns number of members taken.
+ */
+static inline uint32_t
+rx_mcast_acquire(const struct udp_mcast_grp *mg, uint32_t type,
+	const void *addr, uint16_t port, struct tle_udp_stream *ms[])
+{
+	uint32_t i, j, n, seq;
+	struct tle_udp_stream *s;
+
+	for (;;) {
+		seq = mcast_grp_rbegin(mg);
+
+		j = 0;
+		if (udp_mcast_match(mg, type, addr, port) != 0) {
+			n = RTE_MIN(mg->num, RTE_DIM(mg->s));
+			for (i = 0; i != n; i++) {
+				s = mg->s[i];
+				if (rwl_acquire(&s->rx.use) >= 0)
+					ms[j++] = s;
+			}
+		}
+
+		if (mcast_grp_rretry(mg, seq) == 0)
+			return j;
+
+		for (i = 0; i != j; i++)
+			rwl_release(&ms[i]->rx.use);
+	}
+}
+
+/*
+ * deliver multicast datagrams to all member streams of the group.
+ * Packet data is not copied: each member, except the last one,
+ * gets an indirect mbuf attached to the original packet.
+ * Checksums are verified here only once, not by each member.
+ * Packets not accepted by any member are returned via *rp*.
+ * returns number of accepted packets.
+ */
+static inline uint32_t
+rx_mcast(const struct udp_mcast_grp *mg, uint32_t type,
+	struct rte_mbuf *pkt[], union ipv4_addrs a4[],
+	union ipv6_addrs *pa6[], union l4_ports port[],
+	struct rte_mbuf *rp[], int32_t rc[], uint32_t num)
+{
+	uint32_t i, j, k, n, r, x;
+	const void *addr;
+	struct rte_mbuf *m;
+	struct tle_udp_stream *s, *ms[TLE_UDP_MCAST_MAX_MEMB];
+	uint8_t acc[num], left[num];
+	uint32_t idx[num];
+	void *mb[num];
+
+	/* all packets are destined to the same group. */
+	addr = (type == TLE_V4) ? (const void *)&a4[0].dst :
+		(const void *)&pa6[0]->dst;
+	n = rx_mcast_acquire(mg, type, addr, port[0].dst, ms);
+
+	/* count number of consumers for each packet. */
+	k = 0;
+	for (i = 0; i != num; i++) {
+
+		m = pkt[i];
+		acc[i] = 0;
+		left[i] = 0;
+
+		/* drop packets with invalid cksum(s). */
+		if (check_pkt_csum(m, m->ol_flags, type, IPPROTO_UDP) != 0) {
+			rte_pktmbuf_free(m);
+			pkt[i] = NULL;
+			continue;
+		}
+
+		/* avoid cksum verification by each consumer */
+		m->ol_flags &= ~(RTE_MBUF_F_RX_IP_CKSUM_MASK |
+			RTE_MBUF_F_RX_L4_CKSUM_MASK);
+		m->ol_flags |= RTE_MBUF_F_RX_IP_CKSUM_GOOD |
+			RTE_MBUF_F_RX_L4_CKSUM_GOOD;
+		m->tso_segsz = 0;
+
+		for (x = 0; x != n; x++)
+			left[i] += rx_stream_match(ms[x], type, a4 + i, pa6[i],
+				port[i]);
+
+		if (left[i] == 0) {
+			rc[k] = ENOENT;
+			rp[k] = m;
+			k++;
+			pkt[i] = NULL;
+		}
+	}
+
+	for (x = 0; x != n; x++) {
+
+		s = ms[x];
+		for (i = 0, j = 0; i != num; i++) {
+
+			m = pkt[i];
+			if (m == NULL || rx_stream_match(s, type, a4 + i,
+					pa6[i], port[i]) == 0)
+				continue;
+
+			/* last consumer gets the original packet. */
+			if (--left[i] == 0)
+				pkt[i] = NULL;
+			else {
+				m = rte_pktmbuf_clone(m, m->pool);
+				if (m == NULL)
+					continue;
+			}
+			mb[j] = m;
+			idx[j++] = i;
+		}
+
+		r = (j != 0) ? rx_stream_mcast(s, mb, j) : 0;
+		rwl_release(&s->rx.use);
+
+		for (i = 0; i != r; i++)
+			acc[idx[i]]++;
+
+		/*
+		 * stream RX queue is full: drop the copy, but return
+		 * the original packet if no one else accepted it.
+		 */
+		for (i = r; i != j; i++) {
+			m = mb[i];
+			if (left[idx[i]] == 0 && acc[idx[i]] == 0) {
+				rc[k] = ENOBUFS;
+				rp[k] = m;
+				k++;
+			} else
+				rte_pktmbuf_free(m);
+		}
+	}
+
+	return num - k;
+}
+
 uint16_t
 tle_udp_rx_bulk(struct tle_dev *dev, struct rte_mbuf *pkt[],
 	struct rte_mbuf *rp[], int32_t rc[], uint16_t num)
 {
 	struct tle_udp_stream *s;
-	uint32_t i, j, k, n, p, t;
+	struct udp_port_grp *grp;
+	uint32_t i, j, k, n, nb, p, t;
 	union l4_ports tp[num], port[num];
 	union ipv4_addrs a4[num];
 	union ipv6_addrs *pa6[num];
+	void *cs[num];
+	const void *mg[num];
+	struct udp_streams *us;
+	struct evbulk eb;
+
+	us = CTX_UDP_STREAMS(dev->ctx);
+	ctx_update_tms(dev->ctx);
+	evbulk_start(&eb);
+
+	/* reassemble IP fragments, if enabled. */
+	nb = num;
+	num = frag_reassemble(dev->ctx, dev->ctx->frag, IPPROTO_UDP, pkt, num,
+		rp, rc, &k);
 
-	for (i = 0; i != num; i++)
+	for (i = 0; i != num; i++) {
 		tp[i] = pkt_info(pkt[i], &port[i], &a4[i], &pa6[i]);
+		cs[i] = NULL;
+		mg[i] = NULL;
+	}
+
+	/* find connected streams, if any. */
+	if (rte_atomic32_read(&us->nb_conn) != 0)
+		rx_conn_lookup(dev->ctx, tp, port, a4, pa6, cs, num);
+
+	/* find multicast groups, if any. */
+	if (rte_atomic32_read(&us->nb_mcast) != 0)
+		rx_mcast_lookup(us, tp, a4, pa6, mg, num);
 
-	k = 0;
 	for (i = 0; i != num; i = j) {
 
-		for (j = i + 1; j != num && tp[j].raw == tp[i].raw; j++)
+		for (j = i + 1; j != num && tp[j].raw == tp[i].raw &&
+				cs[j] == cs[i] && mg[j] == mg[i]; j++)
 			;
 
 		t = tp[i].src;
 		p = tp[i].dst;
-		s = rx_stream_obtain(dev, t, p);
+
+		/* multicast group members. */
+		if (mg[i] != NULL) {
+			n = rx_mcast(mg[i], t, pkt + i, a4 + i, pa6 + i,
+				port + i, rp + k, rc + k, j - i);
+			k += j - i - n;
+			continue;
+		}
+
+		/* fallback to the stream bound to the local port. */
+		if (cs[i] != NULL) {
+			s = cs[i];
+			if (rwl_acquire(&s->rx.use) < 0)
+				s = NULL;
+		} else
+			s = rx_stream_obtain(dev, t, p);
+
 		if (s != NULL) {
 
-			if (t == TLE_V4)
-				n = rx_stream4(s, pkt + i, a4 + i,
-					port + i, rp + k, rc + k, j - i);
+			/* port is shared by several streams. */
+			grp = s->rx.grp;
+			if (grp != NULL && grp->num > 1)
+				n = rx_port_grp(grp, t, pkt + i, a4 + i,
+					pa6 + i, port + i, rp + k, rc + k,
+					j - i);
 			else
-				n = rx_stream6(s, pkt + i, pa6 + i, port + i,
-					rp + k, rc + k, j - i);
+				n = rx_stream_deliver(s, t, pkt + i, a4 + i,
+					pa6 + i, port + i, rp + k, rc + k,
+					j - i);
 
 			k += j - i - n;
-
-			if (s->rx.ev != NULL)
-				tle_event_raise(s->rx.ev);
 			rwl_release(&s->rx.use);
 
 		} else {
@@ -210,7 +719,8 @@ tle_udp_rx_bulk(struct tle_dev *dev, struct rte_mbuf *pkt[],
 		}
 	}
 
-	return num - k;
+	evbulk_finish(&eb);
+	return nb - k;
 }
 
 static inline void
@@ -219,30 +729,61 @@ stream_drb_release(struct tle_udp_stream *s, struct tle_drb *drb[],
 {
 	uint32_t n;
 
-	n = rte_ring_count(s->tx.drb.r);
-	_rte_ring_enqueue_burst(s->tx.drb.r, (void **)drb, nb_drb);
+	/* number of drbs in flight before they were returned. */
+	n = stream_drb_put(s->s.ctx, &s->tx.drb.nb_out, drb, nb_drb);
 
 	/* If stream is still open, then mark it as avaialble for writing. */
 	if (rwl_try_acquire(&s->tx.use) > 0) {
 
 		if (s->tx.ev != NULL)
-			tle_event_raise(s->tx.ev);
+			evbulk_raise(s->tx.ev, TLE_EV_OUT);
 
 		/* if stream send buffer was full invoke TX callback */
-		else if (s->tx.cb.func != NULL && n == 0)
-			s->tx.cb.func(s->tx.cb.data, &s->s);
+		else if (s->tx.cb.func != NULL && n >= s->tx.drb.nb_max)
+			stream_invoke_cb(&s->s, &s->tx.cb, STREAM_CB_TX);
 
 	}
 
 	rwl_release(&s->tx.use);
 }
 
+/*
+ * drbs were returned into the ctx pool,
+ * notify streams that failed to get them while sending.
+ */
+static inline void
+stream_drb_wakeup(struct udp_streams *us)
+{
+	uint32_t i, n;
+	struct tle_udp_stream *s, *ws[MAX_PKT_BURST];
+
+	n = _rte_ring_mc_dequeue_burst(us->drbq, (void **)ws, RTE_DIM(ws));
+
+	for (i = 0; i != n; i++) {
+		s = ws[i];
+		__atomic_store_n(&s->tx.drb.wait, 0, __ATOMIC_RELEASE);
+
+		if (rwl_try_acquire(&s->tx.use) > 0) {
+			if (s->tx.ev != NULL)
+				evbulk_raise(s->tx.ev, TLE_EV_OUT);
+			else if (s->tx.cb.func != NULL)
+				stream_invoke_cb(&s->s, &s->tx.cb,
+					STREAM_CB_TX);
+		}
+		rwl_release(&s->tx.use);
+	}
+}
+
 uint16_t
 tle_udp_tx_bulk(struct tle_dev *dev, struct rte_mbuf *pkt[], uint16_t num)
 {
 	uint32_t i, j, k, n;
 	struct tle_drb *drb[num];
 	struct tle_udp_stream *s;
+	struct evbulk eb;
+
+	/* refresh time used by the FE (rate limiters). */
+	ctx_update_tms(dev->ctx);
 
 	/* extract packets from device TX queue. */
 
@@ -255,12 +796,16 @@ tle_udp_tx_bulk(struct tle_dev *dev, struct rte_mbuf *pkt[], uint16_t num)
 
 	/* free empty drbs and notify related streams. */
 
+	evbulk_start(&eb);
 	for (i = 0; i != k; i = j) {
 		s = drb[i]->udata;
 		for (j = i + 1; j != k && s == drb[j]->udata; j++)
 			;
 		stream_drb_release(s, drb + i, j - i);
 	}
+	if (k != 0)
+		stream_drb_wakeup(CTX_UDP_STREAMS(dev->ctx));
+	evbulk_finish(&eb);
 
 	return n;
 }
@@ -268,9 +813,11 @@ tle_udp_tx_bulk(struct tle_dev *dev, struct rte_mbuf *pkt[], uint16_t num)
 /*
  * helper function, do the necessary pre-processing for the received packets
  * before handiing them to the strem_recv caller.
+ * *csum* is zero when checksums were already verified by rx_gro().
  */
 static inline uint32_t
-recv_pkt_process(struct rte_mbuf *m[], uint32_t num, uint32_t type)
+recv_pkt_process(struct rte_mbuf *m[], uint32_t num, uint32_t type,
+	uint32_t csum)
 {
 	uint32_t i, k;
 	uint64_t flg[num], ofl[num];
@@ -284,7 +831,8 @@ recv_pkt_process(struct rte_mbuf *m[], uint32_t num, uint32_t type)
 	for (i = 0; i != num; i++) {
 
 		/* drop packets with invalid cksum(s). */
-		if (check_pkt_csum(m[i], flg[i], type, IPPROTO_UDP) != 0) {
+		if (csum != 0 && check_pkt_csum(m[i], flg[i], type,
+				IPPROTO_UDP) != 0) {
 			rte_pktmbuf_free(m[i]);
 			m[i] = NULL;
 			k++;
@@ -312,18 +860,24 @@ tle_udp_stream_recv(struct tle_stream *us, struct rte_mbuf *pkt[], uint16_t num)
 	 */
 	if (n == num && rte_ring_count(s->rx.q) != 0) {
 		if (rwl_try_acquire(&s->rx.use) > 0 && s->rx.ev != NULL)
-			tle_event_raise(s->rx.ev);
+			tle_event_raise_mask(s->rx.ev, TLE_EV_IN);
 		rwl_release(&s->rx.use);
 	}
 
-	k = recv_pkt_process(pkt, n, s->s.type);
+	k = recv_pkt_process(pkt, n, s->s.type,
+		(s->prm.rx_opts & TLE_UDP_RX_OPT_GRO) == 0);
 	return compress_pkt_list(pkt, n, k);
 }
 
+/*
+ * fill L2/L3/L4 headers.
+ * for HW segmentation (RTE_MBUF_F_TX_UDP_SEG) *segsz* is the
+ * payload size of each datagram to produce.
+ */
 static inline int
 udp_fill_mbuf(struct rte_mbuf *m,
 	uint32_t type, uint64_t ol_flags, uint32_t pid,
-	union udph udph, const struct tle_dest *dst)
+	union udph udph, const struct tle_dest *dst, uint32_t segsz)
 {
 	uint32_t len, plen;
 	char *l2h;
@@ -347,7 +901,7 @@ udp_fill_mbuf(struct rte_mbuf *m,
 
 	/* setup mbuf TX offload related fields. */
 	m->tx_offload = _mbuf_tx_offload(dst->l2_len, dst->l3_len,
-		sizeof(*l4h), 0, 0, 0);
+		sizeof(*l4h), segsz, 0, 0);
 	m->ol_flags |= ol_flags;
 
 	l4h->len = rte_cpu_to_be_16(plen + sizeof(*l4h));
@@ -439,27 +993,109 @@ fragment(struct rte_mbuf *pkt, struct rte_mbuf *frag[], uint32_t num,
 	return frag_num;
 }
 
+/*
+ * check can device do UDP segmentation for us:
+ * UDP TSO requires L3/L4 checksum offloads to be enabled too.
+ */
+static inline int
+udp_dev_uso(const struct tle_dev *dev, uint32_t type)
+{
+	uint64_t ol_flags;
+
+	if ((dev->prm.tx_offload & DEV_TX_OFFLOAD_UDP_TSO) == 0)
+		return 0;
+
+	ol_flags = dev->tx.ol_flags[type];
+	return (ol_flags & RTE_MBUF_F_TX_UDP_CKSUM) != 0 &&
+		(type != TLE_V4 || (ol_flags & RTE_MBUF_F_TX_IP_CKSUM) != 0);
+}
+
+/*
+ * SW fallback for UDP GSO: split packet payload into *segsz* sized
+ * datagrams. Payload is not copied, each datagram consists of
+ * the header mbuf (filled from the destination header template)
+ * and indirect mbuf(s) attached to the original packet.
+ * Returns negative for failure or actual number of datagrams.
+ */
+static inline int
+segment(struct rte_mbuf *pkt, struct rte_mbuf *seg[], uint32_t num,
+	uint32_t type, uint64_t ol_flags, union udph udph,
+	const struct tle_dest *dst, uint32_t segsz)
+{
+	int32_t i, n, rc;
+	uint32_t pid;
+
+	n = tcp_segmentation(pkt, seg, num, dst, segsz);
+	if (n <= 0)
+		return (n == 0) ? -EINVAL : n;
+
+	pid = rte_atomic32_add_return(&dst->dev->tx.packet_id[type], n) - n;
+
+	for (i = 0; i != n; i++) {
+		rc = udp_fill_mbuf(seg[i], type, ol_flags, pid + i, udph,
+			dst, 0);
+		if (rc != 0) {
+			free_mbufs(seg, n);
+			return rc;
+		}
+	}
+
+	return n;
+}
+
 static inline void
 stream_drb_free(struct tle_udp_stream *s, struct tle_drb *drbs[],
 	uint32_t nb_drb)
 {
-	_rte_ring_enqueue_burst(s->tx.drb.r, (void **)drbs, nb_drb);
+	stream_drb_put(s->s.ctx, &s->tx.drb.nb_out, drbs, nb_drb);
 }
 
 static inline uint32_t
 stream_drb_alloc(struct tle_udp_stream *s, struct tle_drb *drbs[],
 	uint32_t nb_drb)
 {
-	return _rte_ring_dequeue_burst(s->tx.drb.r, (void **)drbs, nb_drb);
+	uint32_t n;
+	struct udp_streams *us;
+
+	n = stream_drb_get(s->s.ctx, s, &s->tx.drb.nb_out, s->tx.drb.nb_max,
+		0, drbs, nb_drb);
+	if (n == nb_drb)
+		return n;
+
+	/*
+	 * ask BE to notify the stream when drbs are returned,
+	 * then retry: they could have been returned meanwhile.
+	 */
+	us = CTX_UDP_STREAMS(s->s.ctx);
+	if (__atomic_exchange_n(&s->tx.drb.wait, 1, __ATOMIC_ACQ_REL) == 0)
+		_rte_ring_mp_enqueue_burst(us->drbq, (void * const *)&s, 1);
+
+	return n + stream_drb_get(s->s.ctx, s, &s->tx.drb.nb_out,
+		s->tx.drb.nb_max, 0, drbs + n, nb_drb - n);
 }
 
-/* enqueue up to num packets to the destination device queue. */
+/*
+ * enqueue up to num packets to the destination device queue.
+ * obeys stream rate limiter (if any), *tms* is the current time.
+ */
 static inline uint16_t
 queue_pkt_out(struct tle_udp_stream *s, struct tle_dev *dev,
 		const void *pkt[], uint16_t nb_pkt,
-		struct tle_drb *drbs[], uint32_t *nb_drb, uint8_t all_or_nothing)
+		struct tle_drb *drbs[], uint32_t *nb_drb, uint8_t all_or_nothing,
+		uint32_t tms)
 {
-	uint32_t bsz, i, n, nb, nbc, nbm;
+	uint32_t bsz, i, n, nb, nbc, nbm, sz;
+	struct tle_rlim *rl;
+
+	/* reduce number of packets to send, if rate limit is reached */
+	rl = s->prm.tx_rlim;
+	if (rl != NULL) {
+		n = rlim_admit_pkts(rl, tms,
+			(struct rte_mbuf * const *)(uintptr_t)pkt, nb_pkt);
+		if (n == 0 || (n != nb_pkt && all_or_nothing))
+			return 0;
+		nb_pkt = n;
+	}
 
 	bsz = s->tx.drb.nb_elem;
 
@@ -495,96 +1131,184 @@ queue_pkt_out(struct tle_udp_stream *s, struct tle_dev *dev,
 		drbs[i] = drbs[nbc + i];
 
 	*nb_drb = nb;
+
+	if (rl != NULL) {
+		sz = 0;
+		for (i = 0; i != n; i++)
+			sz += rlim_pkt_len((const struct rte_mbuf *)pkt[i]);
+		rlim_charge(rl, sz);
+	}
+
 	return n;
 }
 
-uint16_t
-tle_udp_stream_send(struct tle_stream *us, struct rte_mbuf *pkt[],
-	uint16_t num, const struct sockaddr *dst_addr)
+/* max number of packets processed by one tle_udp_stream_send_multi() pass */
+#define	UDP_SEND_MULTI_BURST	MAX_PKT_BURST
+
+/* destination information shared by group of packets to send. */
+struct send_dst {
+	const void *da;     /* remote IP address */
+	union udph udph;    /* UDP header template */
+	uint32_t num;       /* number of packets to that destination */
+	uint32_t pid;       /* next IP packet id */
+	uint32_t mtu;       /* max L4 packet length */
+	uint32_t gsz;       /* GSO segment size, 0 when disabled */
+	uint32_t uso;       /* HW UDP segmentation is supported */
+	struct tle_dest dst;
+};
+
+/* figure out what destination addr/port to use. */
+static inline int
+send_dst_addr(const struct tle_udp_stream *s, struct send_dst *sd,
+	const struct sockaddr *dst_addr)
 {
-	int32_t di, frg, rc;
-	uint64_t ol_flags;
-	uint32_t i, k, n, nb;
-	uint32_t mtu, pid, type;
 	const struct sockaddr_in *d4;
 	const struct sockaddr_in6 *d6;
-	struct tle_udp_stream *s;
-	const void *da;
-	union udph udph;
-	struct tle_dest dst;
-	struct tle_drb *drb[num];
 
-	s = UDP_STREAM(us);
-	type = s->s.type;
-
-	/* start filling UDP header. */
-	udph.raw = 0;
-	udph.ports.src = s->s.port.dst;
+	sd->udph.raw = 0;
+	sd->udph.ports.src = s->s.port.dst;
 
-	/* figure out what destination addr/port to use. */
 	if (dst_addr != NULL) {
-		if (dst_addr->sa_family != s->prm.remote_addr.ss_family) {
-			rte_errno = EINVAL;
-			return 0;
-		}
-		if (type == TLE_V4) {
+		if (dst_addr->sa_family != s->prm.remote_addr.ss_family)
+			return -EINVAL;
+		if (s->s.type == TLE_V4) {
 			d4 = (const struct sockaddr_in *)dst_addr;
-			da = &d4->sin_addr;
-			udph.ports.dst = d4->sin_port;
+			sd->da = &d4->sin_addr;
+			sd->udph.ports.dst = d4->sin_port;
 		} else {
 			d6 = (const struct sockaddr_in6 *)dst_addr;
-			da = &d6->sin6_addr;
-			udph.ports.dst = d6->sin6_port;
+			sd->da = &d6->sin6_addr;
+			sd->udph.ports.dst = d6->sin6_port;
 		}
 	} else {
-		udph.ports.dst = s->s.port.src;
-		if (type == TLE_V4)
-			da = &s->s.ipv4.addr.src;
+		sd->udph.ports.dst = s->s.port.src;
+		if (s->s.type == TLE_V4)
+			sd->da = &s->s.ipv4.addr.src;
 		else
-			da = &s->s.ipv6.addr.src;
+			sd->da = &s->s.ipv6.addr.src;
 	}
 
-	di = stream_get_dest(&s->s, da, &dst);
-	if (di < 0) {
-		rte_errno = -di;
+	return 0;
+}
+
+static inline int
+send_dst_equal(uint32_t type, const struct send_dst *a,
+	const struct send_dst *b)
+{
+	if (a->udph.raw != b->udph.raw)
 		return 0;
-	}
+	if (type == TLE_V4)
+		return ((const struct in_addr *)a->da)->s_addr ==
+			((const struct in_addr *)b->da)->s_addr;
+	return memcmp(a->da, b->da, sizeof(struct in6_addr)) == 0;
+}
 
-	pid = rte_atomic32_add_return(&dst.dev->tx.packet_id[type], num) - num;
-	mtu = dst.mtu - dst.l2_len - dst.l3_len;
+/* route lookup, reserve IP packet ids for *sd->num* packets. */
+static inline int
+send_dst_init(struct tle_udp_stream *s, struct send_dst *sd)
+{
+	int32_t rc;
+	uint32_t type;
 
-	/* mark stream as not closable. */
-	if (rwl_acquire(&s->tx.use) < 0) {
-		rte_errno = EAGAIN;
-		return 0;
-	}
+	type = s->s.type;
+
+	rc = stream_get_dest(&s->s, sd->da, &sd->dst);
+	if (rc < 0)
+		return rc;
+
+	sd->pid = rte_atomic32_add_return(&sd->dst.dev->tx.packet_id[type],
+		sd->num) - sd->num;
+	sd->mtu = sd->dst.mtu - sd->dst.l2_len - sd->dst.l3_len;
+
+	/* GSO datagrams should not be fragmented */
+	sd->gsz = s->prm.gso_size;
+	if (sd->gsz != 0) {
+		sd->gsz = RTE_MIN(sd->gsz, sd->mtu - sizeof(sd->udph));
+		sd->uso = udp_dev_uso(sd->dst.dev, type);
+	} else
+		sd->uso = 0;
+
+	return 0;
+}
+
+/*
+ * fill headers and enqueue packets to the destination devices.
+ * *idx* maps each packet to its destination within *sd*,
+ * NULL means that all packets go to sd[0].
+ * Consecutive packets for the same device are enqueued at once.
+ * Returns number of packets enqueued, on failure rte_errno is set and
+ * headers of not enqueued packets are removed.
+ */
+static uint32_t
+send_pkts(struct tle_udp_stream *s, struct rte_mbuf *pkt[], uint32_t num,
+	struct send_dst sd[], const uint8_t idx[], struct tle_drb *drb[],
+	uint32_t *nb, uint32_t tms)
+{
+	int32_t frg, gso, rc;
+	uint64_t ol_flags;
+	uint32_t i, k, n, plen, type;
+	struct tle_dev *dev;
+	struct send_dst *d;
+
+	type = s->s.type;
 
-	nb = 0;
 	for (i = 0, k = 0; k != num; k = i) {
 
 		/* copy L2/L3/L4 headers into mbufs, setup mbufs metadata. */
 
 		frg = 0;
-		ol_flags = dst.dev->tx.ol_flags[type];
+		gso = 0;
+		ol_flags = 0;
+		d = sd + ((idx != NULL) ? idx[i] : 0);
+		dev = d->dst.dev;
 
 		while (i != num && frg == 0) {
-			frg = pkt[i]->pkt_len > mtu;
-			if (frg != 0)
-				ol_flags &= ~RTE_MBUF_F_TX_UDP_CKSUM;
-			rc = udp_fill_mbuf(pkt[i], type, ol_flags, pid + i,
-				udph, &dst);
+
+			d = sd + ((idx != NULL) ? idx[i] : 0);
+
+			/* different device, enqueue what we already have. */
+			if (d->dst.dev != dev)
+				break;
+
+			ol_flags = dev->tx.ol_flags[type];
+			plen = pkt[i]->pkt_len;
+			gso = (d->gsz != 0 && plen > d->gsz);
+
+			/* HW segmentation, pass packet as it is */
+			if (gso != 0 && d->uso != 0 &&
+					plen <= d->gsz * TLE_UDP_GSO_MAX_SEG &&
+					plen + d->dst.l3_len +
+					sizeof(d->udph) <= UINT16_MAX) {
+				rc = udp_fill_mbuf(pkt[i], type,
+					ol_flags | RTE_MBUF_F_TX_UDP_SEG,
+					d->pid, d->udph, &d->dst, d->gsz);
+
+			/* SW segmentation, headers are filled per datagram */
+			} else if (gso != 0) {
+				frg = 1;
+				break;
+
+			} else {
+				frg = plen > d->mtu;
+				if (frg != 0)
+					ol_flags &= ~RTE_MBUF_F_TX_UDP_CKSUM;
+				rc = udp_fill_mbuf(pkt[i], type, ol_flags,
+					d->pid, d->udph, &d->dst, 0);
+			}
+
 			if (rc != 0) {
 				rte_errno = -rc;
 				goto out;
 			}
+			d->pid++;
 			i += (frg == 0);
 		}
 
 		/* enqueue non-fragment packets to the destination device. */
 		if (k != i) {
-			k += queue_pkt_out(s, dst.dev,
+			k += queue_pkt_out(s, dev,
 				(const void **)(uintptr_t)&pkt[k], i - k,
-				drb, &nb, 0);
+				drb, nb, 0, tms);
 
 			/* stream TX queue is full. */
 			if (k != i) {
@@ -593,20 +1317,28 @@ tle_udp_stream_send(struct tle_stream *us, struct rte_mbuf *pkt[],
 			}
 		}
 
-		/* enqueue packet that need to be fragmented */
-		if (i != num) {
+		/* enqueue packet that need to be segmented or fragmented */
+		if (frg != 0) {
 
-			struct rte_mbuf *frag[RTE_LIBRTE_IP_FRAG_MAX_FRAG];
+			struct rte_mbuf *frag[RTE_MAX(TLE_UDP_GSO_MAX_SEG,
+				RTE_LIBRTE_IP_FRAG_MAX_FRAG)];
 
-			/* fragment the packet. */
-			rc = fragment(pkt[i], frag, RTE_DIM(frag), type, &dst);
+			if (gso != 0)
+				rc = segment(pkt[i], frag, TLE_UDP_GSO_MAX_SEG,
+					type, ol_flags, d->udph, &d->dst,
+					d->gsz);
+			else
+				rc = fragment(pkt[i], frag,
+					RTE_LIBRTE_IP_FRAG_MAX_FRAG, type,
+					&d->dst);
 			if (rc < 0) {
 				rte_errno = -rc;
 				break;
 			}
 
-			n = queue_pkt_out(s, dst.dev,
-				(const void **)(uintptr_t)frag, rc, drb, &nb, 1);
+			n = queue_pkt_out(s, dev,
+				(const void **)(uintptr_t)frag, rc, drb, nb, 1,
+				tms);
 			if (n == 0) {
 				while (rc-- != 0)
 					rte_pktmbuf_free(frag[rc]);
@@ -614,17 +1346,69 @@ tle_udp_stream_send(struct tle_stream *us, struct rte_mbuf *pkt[],
 				break;
 			}
 
-			/* all fragments enqueued, free the original packet. */
+			/*
+			 * all fragments enqueued, free the original packet
+			 * (GSO datagrams still reference its data).
+			 */
 			rte_pktmbuf_free(pkt[i]);
 			i++;
 		}
 	}
 
+out:
+	/*
+	 * remove pkt l2/l3 headers, restore ol_flags for unsent, but
+	 * already modified packets.
+	 */
+	for (n = k; n != i; n++) {
+		d = sd + ((idx != NULL) ? idx[n] : 0);
+		rte_pktmbuf_adj(pkt[n], d->dst.l2_len + d->dst.l3_len +
+			sizeof(d->udph));
+		pkt[n]->ol_flags &= ~(d->dst.dev->tx.ol_flags[type] |
+			RTE_MBUF_F_TX_UDP_SEG);
+	}
+
+	return k;
+}
+
+uint16_t
+tle_udp_stream_send(struct tle_stream *us, struct rte_mbuf *pkt[],
+	uint16_t num, const struct sockaddr *dst_addr)
+{
+	int32_t rc;
+	uint32_t k, nb, tms;
+	struct tle_udp_stream *s;
+	struct send_dst sd;
+	struct tle_drb *drb[RTE_MAX(num, TLE_UDP_GSO_MAX_SEG)];
+
+	s = UDP_STREAM(us);
+
+	rc = send_dst_addr(s, &sd, dst_addr);
+	if (rc == 0) {
+		sd.num = num;
+		rc = send_dst_init(s, &sd);
+	}
+	if (rc != 0) {
+		rte_errno = -rc;
+		return 0;
+	}
+
+	/* current time for the rate limiter */
+	tms = s->s.ctx->tms;
+
+	/* mark stream as not closable. */
+	if (rwl_acquire(&s->tx.use) < 0) {
+		rte_errno = EAGAIN;
+		return 0;
+	}
+
+	nb = 0;
+	k = send_pkts(s, pkt, num, &sd, NULL, drb, &nb, tms);
+
 	/* if possible, rearm socket write event. */
 	if (k == num && s->tx.ev != NULL)
-		tle_event_raise(s->tx.ev);
+		tle_event_raise_mask(s->tx.ev, TLE_EV_OUT);
 
-out:
 	/* free unused drbs. */
 	if (nb != 0)
 		stream_drb_free(s, drb, nb);
@@ -632,15 +1416,125 @@ out:
 	/* stream can be closed. */
 	rwl_release(&s->tx.use);
 
+	return k;
+}
+
+/*
+ * group packets by destination: fill *sd* with unique destinations,
+ * *idx* with destination index for each packet.
+ * Grouping stops at the first packet with invalid or unreachable
+ * destination: *num* is updated with number of packets before it,
+ * rte_errno is set.
+ * returns number of unique destinations or negative error code,
+ * if the very first packet can't be sent.
+ */
+static int
+send_dst_group(struct tle_udp_stream *s, const struct sockaddr * const da[],
+	uint32_t *num, struct send_dst sd[], uint8_t idx[])
+{
+	int32_t rc, rv;
+	uint32_t i, j, k, n;
+	uint32_t first[*num];
+
+	n = 0;
+	rc = 0;
+	for (i = 0; i != *num; i++) {
+
+		rc = send_dst_addr(s, sd + n, da[i]);
+		if (rc != 0)
+			break;
+
+		/* bursts are usually short, so linear search is good enough */
+		for (j = 0; j != n && send_dst_equal(s->s.type, sd + j,
+				sd + n) == 0; j++)
+			;
+
+		idx[i] = j;
+		if (j == n) {
+			first[n] = i;
+			sd[n++].num = 0;
+		}
+		sd[j].num++;
+	}
+
 	/*
-	 * remove pkt l2/l3 headers, restore ol_flags for unsent, but
-	 * already modified packets.
+	 * resolve each unique destination only once,
+	 * packets starting from the first one to unreachable
+	 * destination are not sent.
 	 */
-	ol_flags = ~dst.dev->tx.ol_flags[type];
-	for (n = k; n != i; n++) {
-		rte_pktmbuf_adj(pkt[n], dst.l2_len + dst.l3_len + sizeof(udph));
-		pkt[n]->ol_flags &= ol_flags;
+	k = i;
+	for (j = 0; j != n; j++) {
+		rv = send_dst_init(s, sd + j);
+		if (rv != 0) {
+			rc = rv;
+			k = first[j];
+			n = j;
+			break;
+		}
+	}
+
+	if (k != *num)
+		rte_errno = -rc;
+	*num = k;
+	return (k == 0) ? rc : (int32_t)n;
+}
+
+uint16_t
+tle_udp_stream_send_multi(struct tle_stream *us, struct rte_mbuf *pkt[],
+	uint16_t num, const struct sockaddr * const dst_addr[])
+{
+	int32_t rc;
+	uint32_t k, m, n, nb, tms;
+	struct tle_udp_stream *s;
+	uint8_t idx[UDP_SEND_MULTI_BURST];
+	struct send_dst sd[UDP_SEND_MULTI_BURST];
+	struct tle_drb *drb[RTE_MAX(UDP_SEND_MULTI_BURST,
+		TLE_UDP_GSO_MAX_SEG)];
+
+	s = UDP_STREAM(us);
+
+	if (dst_addr == NULL) {
+		rte_errno = EINVAL;
+		return 0;
 	}
 
+	/* current time for the rate limiter */
+	tms = s->s.ctx->tms;
+
+	/* mark stream as not closable. */
+	if (rwl_acquire(&s->tx.use) < 0) {
+		rte_errno = EAGAIN;
+		return 0;
+	}
+
+	nb = 0;
+	for (k = 0; k != num; k += n) {
+
+		n = RTE_MIN(num - k, (uint32_t)UDP_SEND_MULTI_BURST);
+		m = n;
+
+		/* rte_errno is set when not all packets can be sent */
+		rc = send_dst_group(s, dst_addr + k, &m, sd, idx);
+		if (rc < 0)
+			break;
+
+		rc = send_pkts(s, pkt + k, m, sd, idx, drb, &nb, tms);
+		if ((uint32_t)rc != n) {
+			k += rc;
+			break;
+		}
+	}
+
+	/* if possible, rearm socket write event. */
+	if (k == num && s->tx.ev != NULL)
+		tle_event_raise_mask(s->tx.ev, TLE_EV_OUT);
+
+	/* free unused drbs. */
+	if (nb != 0)
+		stream_drb_free(s, drb, nb);
+
+	/* stream can be closed. */
+	rwl_release(&s->tx.use);
+
 	return k;
 }
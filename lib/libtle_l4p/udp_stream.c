@@ -34,25 +34,25 @@ unuse_stream(struct tle_udp_stream *s)
 static void
 fini_stream(struct tle_udp_stream *s)
 {
-	if (s != NULL) {
+	if (s != NULL)
 		rte_free(s->rx.q);
-		rte_free(s->tx.drb.r);
-	}
 }
 
 static void
 udp_fini_streams(struct tle_ctx *ctx)
 {
 	uint32_t i;
-	struct tle_udp_stream *s;
+	struct udp_streams *us;
 
-	s = ctx->streams.buf;
-	if (s != NULL) {
+	us = CTX_UDP_STREAMS(ctx);
+	if (us != NULL) {
+		stbl_fini(&us->st);
+		rte_ring_free(us->drbq);
 		for (i = 0; i != ctx->prm.max_streams; i++)
-			fini_stream(s + i);
+			fini_stream(us->s + i);
 	}
 
-	rte_free(s);
+	rte_free(us);
 	ctx->streams.buf = NULL;
 	STAILQ_INIT(&ctx->streams.free);
 }
@@ -60,9 +60,8 @@ udp_fini_streams(struct tle_ctx *ctx)
 static int
 init_stream(struct tle_ctx *ctx, struct tle_udp_stream *s)
 {
-	size_t bsz, rsz, sz;
-	uint32_t i, k, n, nb;
-	struct tle_drb *drb;
+	size_t sz;
+	uint32_t n, nb;
 	char name[RTE_RING_NAMESIZE];
 
 	/* init RX part. */
@@ -83,44 +82,13 @@ init_stream(struct tle_ctx *ctx, struct tle_udp_stream *s)
 	snprintf(name, sizeof(name), "%p@%zu", s, sz);
 	rte_ring_init(s->rx.q, name, n, RING_F_SP_ENQ);
 
-	/* init TX part. */
+	/* init TX part, drbs are taken from the ctx pool. */
 
 	nb = drb_nb_elem(ctx);
-	k = calc_stream_drb_num(ctx, nb);
-	n = rte_align32pow2(k);
-
-	/* size of the drbs ring */
-	rsz = rte_ring_get_memsize(n);
-	rsz = RTE_ALIGN_CEIL(rsz, RTE_CACHE_LINE_SIZE);
-
-	/* size of the drb. */
-	bsz = tle_drb_calc_size(nb);
-
-	/* total stream drbs size. */
-	sz = rsz + bsz * k;
-
-	s->tx.drb.r = rte_zmalloc_socket(NULL, sz, RTE_CACHE_LINE_SIZE,
-		ctx->prm.socket_id);
-	if (s->tx.drb.r == NULL) {
-		UDP_LOG(ERR, "%s(%p): allocation of %zu bytes on socket %d "
-			"failed with error code: %d\n",
-			__func__, s, sz, ctx->prm.socket_id, rte_errno);
-		return -ENOMEM;
-	}
-
-	snprintf(name, sizeof(name), "%p@%zu", s, sz);
-	rte_ring_init(s->tx.drb.r, name, n, 0);
-
-	for (i = 0; i != k; i++) {
-		drb = (struct tle_drb *)((uintptr_t)s->tx.drb.r +
-			rsz + bsz * i);
-		drb->udata = s;
-		drb->size = nb;
-		rte_ring_enqueue(s->tx.drb.r, drb);
-	}
-
 	s->tx.drb.nb_elem = nb;
-	s->tx.drb.nb_max = k;
+	s->tx.drb.nb_max = calc_stream_drb_num(ctx, nb);
+	s->tx.drb.nb_out = 0;
+	s->tx.drb.wait = 0;
 
 	/* mark stream as avaialble to use. */
 
@@ -136,8 +104,32 @@ udp_free_drbs(struct tle_stream *s, struct tle_drb *drb[], uint32_t nb_drb)
 {
 	struct tle_udp_stream *us;
 
-	us = (struct tle_udp_stream *)s;
-	_rte_ring_enqueue_burst(us->tx.drb.r, (void **)drb, nb_drb);
+	us = UDP_STREAM(s);
+	stream_drb_put(s->ctx, &us->tx.drb.nb_out, drb, nb_drb);
+}
+
+/* invoke deferred callback, unless the stream was closed since. */
+static void
+udp_invoke_cb(struct tle_stream *s, uint32_t op)
+{
+	rte_atomic32_t *use;
+	struct tle_stream_cb *cb;
+	struct tle_udp_stream *us;
+
+	us = UDP_STREAM(s);
+	if (op == STREAM_CB_RX) {
+		use = &us->rx.use;
+		cb = &us->rx.cb;
+	} else if (op == STREAM_CB_TX) {
+		use = &us->tx.use;
+		cb = &us->tx.cb;
+	} else
+		return;
+
+	if (rwl_try_acquire(use) > 0 && stream_take_cb(s, op) != 0 &&
+			cb->func != NULL)
+		cb->func(cb->data, s);
+	rwl_release(use);
 }
 
 static int
@@ -146,23 +138,48 @@ udp_init_streams(struct tle_ctx *ctx)
 	size_t sz;
 	uint32_t i;
 	int32_t rc;
-	struct tle_udp_stream *s;
+	struct udp_streams *us;
+	char name[RTE_RING_NAMESIZE];
 
-	sz = sizeof(*s) * ctx->prm.max_streams;
-	s = rte_zmalloc_socket(NULL, sz, RTE_CACHE_LINE_SIZE,
+	sz = sizeof(*us) + sizeof(us->s[0]) * ctx->prm.max_streams;
+	us = rte_zmalloc_socket(NULL, sz, RTE_CACHE_LINE_SIZE,
 		ctx->prm.socket_id);
-	if (s == NULL) {
+	if (us == NULL) {
 		UDP_LOG(ERR, "allocation of %zu bytes on socket %d "
 			"for %u udp_streams failed\n",
 			sz, ctx->prm.socket_id, ctx->prm.max_streams);
 		return -ENOMEM;
 	}
 
-	ctx->streams.buf = s;
+	ctx->streams.buf = us;
 	STAILQ_INIT(&ctx->streams.free);
+	rte_spinlock_init(&us->grp_lock);
+	for (i = 0; i != RTE_DIM(us->mcast); i++)
+		us->mcast[i].type = TLE_VNUM;
+
+	rc = stbl_init(&us->st, ctx->prm.max_streams, ctx->prm.socket_id);
+	if (rc != 0) {
+		UDP_LOG(ERR, "initalisation of connected streams table "
+			"failed with error code: %d\n", rc);
+		udp_fini_streams(ctx);
+		return rc;
+	}
+
+	/* each stream is queued at most once. */
+	snprintf(name, sizeof(name), "udp_drbq@%p", ctx);
+	us->drbq = rte_ring_create(name,
+		rte_align32pow2(ctx->prm.max_streams + 1),
+		ctx->prm.socket_id, 0);
+	if (us->drbq == NULL) {
+		UDP_LOG(ERR, "creation of drb wait queue %s "
+			"failed with error code: %d\n", name, rte_errno);
+		rc = -rte_errno;
+		udp_fini_streams(ctx);
+		return rc;
+	}
 
 	for (i = 0; i != ctx->prm.max_streams; i++) {
-		rc = init_stream(ctx, s + i);
+		rc = init_stream(ctx, us->s + i);
 		if (rc != 0) {
 			UDP_LOG(ERR, "initalisation of %u-th stream failed", i);
 			udp_fini_streams(ctx);
@@ -181,6 +198,7 @@ udp_stream_setup(void)
 		.init_streams = udp_init_streams,
 		.fini_streams = udp_fini_streams,
 		.free_drbs = udp_free_drbs,
+		.invoke_cb = udp_invoke_cb,
 	};
 
 	tle_stream_ops[TLE_PROTO_UDP] = udp_ops;
@@ -200,6 +218,386 @@ stream_up(struct tle_udp_stream *s)
 	rwl_up(&s->tx.use);
 }
 
+/*
+ * stream with both local and remote addresses and ports specified
+ * is demultiplexed by 4-tuple.
+ */
+static int
+stream_is_connected(const struct tle_udp_stream_param *prm)
+{
+	const struct sockaddr_in *lin4, *rin4;
+	const struct sockaddr_in6 *lin6, *rin6;
+
+	if (prm->local_addr.ss_family == AF_INET) {
+		lin4 = (const struct sockaddr_in *)&prm->local_addr;
+		rin4 = (const struct sockaddr_in *)&prm->remote_addr;
+		return lin4->sin_port != 0 && rin4->sin_port != 0 &&
+			lin4->sin_addr.s_addr != INADDR_ANY &&
+			rin4->sin_addr.s_addr != INADDR_ANY;
+	} else {
+		lin6 = (const struct sockaddr_in6 *)&prm->local_addr;
+		rin6 = (const struct sockaddr_in6 *)&prm->remote_addr;
+		return lin6->sin6_port != 0 && rin6->sin6_port != 0 &&
+			memcmp(&lin6->sin6_addr, &tle_ipv6_any,
+			sizeof(tle_ipv6_any)) != 0 &&
+			memcmp(&rin6->sin6_addr, &tle_ipv6_any,
+			sizeof(tle_ipv6_any)) != 0;
+	}
+}
+
+/* add stream into the connected streams table, fails on duplicates. */
+static int
+stream_add_conn(struct tle_ctx *ctx, struct tle_udp_stream *s)
+{
+	int32_t rc;
+	uint32_t type;
+	struct stbl *st;
+	struct shtbl *ht;
+	struct stbl_key k;
+
+	st = CTX_UDP_STLB(ctx);
+	type = s->s.type;
+	ht = st->ht + type;
+	stbl_stream_fill_key(&k, &s->s, type);
+
+	stbl_lock(st, type);
+	if (rte_hash_lookup(ht->t, &k) >= 0)
+		rc = -EEXIST;
+	else
+		rc = rte_hash_add_key(ht->t, &k);
+	stbl_unlock(st, type);
+
+	if (rc == -EEXIST)
+		return EEXIST;
+	else if ((uint32_t)rc >= ht->nb_ent)
+		return ENOBUFS;
+
+	s->ste = ht->ent + rc;
+	s->ste->data = s;
+	rte_atomic32_inc(&CTX_UDP_STREAMS(ctx)->nb_conn);
+	return 0;
+}
+
+static void
+stream_del_conn(struct tle_ctx *ctx, struct tle_udp_stream *s)
+{
+	uint32_t type;
+	struct stbl *st;
+	struct stbl_key k;
+
+	st = CTX_UDP_STLB(ctx);
+	type = s->s.type;
+	stbl_stream_fill_key(&k, &s->s, type);
+
+	s->ste->data = NULL;
+	s->ste = NULL;
+
+	stbl_lock(st, type);
+	rte_hash_del_key(st->ht[type].t, &k);
+	stbl_unlock(st, type);
+
+	rte_atomic32_dec(&CTX_UDP_STREAMS(ctx)->nb_conn);
+}
+
+static int
+sockaddr_equal(const struct sockaddr_storage *a,
+	const struct sockaddr_storage *b, int32_t port)
+{
+	const struct sockaddr_in *a4, *b4;
+	const struct sockaddr_in6 *a6, *b6;
+
+	if (a->ss_family != b->ss_family)
+		return 0;
+
+	if (a->ss_family == AF_INET) {
+		a4 = (const struct sockaddr_in *)a;
+		b4 = (const struct sockaddr_in *)b;
+		return a4->sin_addr.s_addr == b4->sin_addr.s_addr &&
+			(port == 0 || a4->sin_port == b4->sin_port);
+	} else {
+		a6 = (const struct sockaddr_in6 *)a;
+		b6 = (const struct sockaddr_in6 *)b;
+		return memcmp(&a6->sin6_addr, &b6->sin6_addr,
+			sizeof(a6->sin6_addr)) == 0 &&
+			(port == 0 || a6->sin6_port == b6->sin6_port);
+	}
+}
+
+/*
+ * local port is already in use, check is it possible to join
+ * the port group of the stream that owns it.
+ * Should be called with grp_lock held.
+ */
+static int
+stream_join_grp(struct tle_ctx *ctx, struct tle_udp_stream *s,
+	struct udp_port_grp **pgrp)
+{
+	struct tle_stream *os;
+	struct tle_udp_stream *ls;
+	struct udp_port_grp *grp;
+
+	os = stream_find_ctx(ctx, (const struct sockaddr *)&s->prm.local_addr);
+	if (os == NULL)
+		return EEXIST;
+
+	ls = UDP_STREAM(os);
+	grp = ls->rx.grp;
+
+	/* owner is not a port group member, or addresses differ. */
+	if (grp == NULL ||
+			sockaddr_equal(&ls->prm.local_addr,
+				&s->prm.local_addr, 0) == 0 ||
+			sockaddr_equal(&ls->prm.remote_addr,
+				&s->prm.remote_addr, 1) == 0)
+		return EEXIST;
+
+	if (grp->num == RTE_DIM(grp->s))
+		return ENOSPC;
+
+	/* share L4 ports and L3 addresses with the owner. */
+	s->s.type = ls->s.type;
+	s->s.port = ls->s.port;
+	s->s.pmsk = ls->s.pmsk;
+	if (s->s.type == TLE_V4)
+		s->s.ipv4 = ls->s.ipv4;
+	else
+		s->s.ipv6 = ls->s.ipv6;
+
+	*pgrp = grp;
+	return 0;
+}
+
+static void
+stream_add_grp(struct udp_port_grp *grp, struct tle_udp_stream *s)
+{
+	s->rx.grp = grp;
+	grp->s[grp->num] = s;
+	rte_smp_wmb();
+	grp->num++;
+}
+
+/*
+ * remove stream from its port group, if stream owns the port
+ * and there are other members left, pass port ownership
+ * (and the group itself) to one of them.
+ * returns non-zero if port ownership was passed.
+ * Should be called with grp_lock held.
+ */
+static int
+stream_leave_grp(struct tle_ctx *ctx, struct tle_udp_stream *s)
+{
+	uint32_t i;
+	struct tle_udp_stream *ns;
+	struct udp_port_grp *grp, *ng;
+
+	grp = s->rx.grp;
+
+	for (i = 0; i != grp->num && grp->s[i] != s; i++)
+		;
+	if (i != grp->num) {
+		grp->s[i] = grp->s[grp->num - 1];
+		rte_smp_wmb();
+		grp->num--;
+	}
+
+	if (grp != &s->rx.grp_data || grp->num == 0)
+		return 0;
+
+	ns = grp->s[0];
+	ng = &ns->rx.grp_data;
+	*ng = *grp;
+	for (i = 0; i != ng->num; i++)
+		ng->s[i]->rx.grp = ng;
+
+	stream_move_ctx(ctx, &s->s, &ns->s);
+	return 1;
+}
+
+/* remove stream from multicast group, grp_lock has to be held. */
+static void
+mcast_del_memb(struct udp_streams *us, struct udp_mcast_grp *mg, uint32_t i)
+{
+	mcast_grp_wbegin(mg);
+	mg->s[i] = mg->s[mg->num - 1];
+	mg->num--;
+	if (mg->num == 0) {
+		mg->type = TLE_VNUM;
+		rte_atomic32_dec(&us->nb_mcast);
+	}
+	mcast_grp_wend(mg);
+}
+
+static void
+stream_leave_mcast_all(struct udp_streams *us, struct tle_udp_stream *s)
+{
+	uint32_t i, j;
+	struct udp_mcast_grp *mg;
+
+	rte_spinlock_lock(&us->grp_lock);
+	for (i = 0; i != RTE_DIM(us->mcast); i++) {
+		mg = us->mcast + i;
+		for (j = 0; j != mg->num; j++) {
+			if (mg->s[j] == s) {
+				mcast_del_memb(us, mg, j);
+				break;
+			}
+		}
+	}
+	rte_spinlock_unlock(&us->grp_lock);
+}
+
+/* check group address, returns pointer to the address itself. */
+static const void *
+mcast_grp_addr(const struct tle_udp_stream *s, const struct sockaddr *grp)
+{
+	const struct sockaddr_in *in4;
+	const struct sockaddr_in6 *in6;
+
+	if (grp == NULL || grp->sa_family != s->prm.local_addr.ss_family)
+		return NULL;
+
+	if (s->s.type == TLE_V4) {
+		in4 = (const struct sockaddr_in *)grp;
+		if (IN_MULTICAST(ntohl(in4->sin_addr.s_addr)) ||
+				in4->sin_addr.s_addr == INADDR_BROADCAST)
+			return &in4->sin_addr;
+	} else {
+		in6 = (const struct sockaddr_in6 *)grp;
+		if (IN6_IS_ADDR_MULTICAST(&in6->sin6_addr))
+			return &in6->sin6_addr;
+	}
+
+	return NULL;
+}
+
+/*
+ * only streams bound to wildcard local address and
+ * not connected could be multicast group members.
+ */
+static int
+check_mcast_stream(const struct tle_udp_stream *s)
+{
+	if (s->s.type == TLE_V4)
+		return s->ste == NULL && s->s.ipv4.mask.dst == INADDR_ANY;
+	else if (s->s.type == TLE_V6)
+		return s->ste == NULL && memcmp(&s->s.ipv6.mask.dst,
+			&tle_ipv6_any, sizeof(tle_ipv6_any)) == 0;
+	return 0;
+}
+
+int
+tle_udp_stream_join(struct tle_stream *us, const struct sockaddr *grp)
+{
+	int32_t rc;
+	uint32_t i, j, type;
+	const void *addr;
+	struct tle_udp_stream *s;
+	struct udp_streams *ust;
+	struct udp_mcast_grp *fg, *mg;
+
+	s = UDP_STREAM(us);
+	if (us == NULL || check_mcast_stream(s) == 0)
+		return -EINVAL;
+
+	addr = mcast_grp_addr(s, grp);
+	if (addr == NULL)
+		return -EINVAL;
+
+	type = s->s.type;
+	ust = CTX_UDP_STREAMS(s->s.ctx);
+
+	rc = 0;
+	mg = NULL;
+	fg = NULL;
+	rte_spinlock_lock(&ust->grp_lock);
+
+	for (i = 0; i != RTE_DIM(ust->mcast) && mg == NULL; i++) {
+		if (udp_mcast_match(ust->mcast + i, type, addr,
+				s->s.port.dst) != 0)
+			mg = ust->mcast + i;
+		else if (fg == NULL && ust->mcast[i].type == TLE_VNUM)
+			fg = ust->mcast + i;
+	}
+
+	/* new group */
+	if (mg == NULL) {
+		if (fg == NULL)
+			rc = -ENOSPC;
+		else {
+			mg = fg;
+			mcast_grp_wbegin(mg);
+			mg->num = 0;
+			mg->port = s->s.port.dst;
+			if (type == TLE_V4)
+				mg->addr.a4 = *(const uint32_t *)addr;
+			else
+				rte_memcpy(&mg->addr.a6, addr,
+					sizeof(mg->addr.a6));
+			mg->type = type;
+			mcast_grp_wend(mg);
+			rte_atomic32_inc(&ust->nb_mcast);
+		}
+	}
+
+	if (rc == 0) {
+		for (j = 0; j != mg->num && mg->s[j] != s; j++)
+			;
+		if (j != mg->num)
+			rc = -EEXIST;
+		else if (j == RTE_DIM(mg->s))
+			rc = -ENOSPC;
+		else {
+			mcast_grp_wbegin(mg);
+			mg->s[j] = s;
+			mg->num++;
+			mcast_grp_wend(mg);
+		}
+	}
+
+	rte_spinlock_unlock(&ust->grp_lock);
+	return rc;
+}
+
+int
+tle_udp_stream_leave(struct tle_stream *us, const struct sockaddr *grp)
+{
+	int32_t rc;
+	uint32_t i, j;
+	const void *addr;
+	struct tle_udp_stream *s;
+	struct udp_streams *ust;
+	struct udp_mcast_grp *mg;
+
+	s = UDP_STREAM(us);
+	if (us == NULL || check_mcast_stream(s) == 0)
+		return -EINVAL;
+
+	addr = mcast_grp_addr(s, grp);
+	if (addr == NULL)
+		return -EINVAL;
+
+	ust = CTX_UDP_STREAMS(s->s.ctx);
+
+	rc = -ENOENT;
+	rte_spinlock_lock(&ust->grp_lock);
+
+	for (i = 0; i != RTE_DIM(ust->mcast); i++) {
+		mg = ust->mcast + i;
+		if (udp_mcast_match(mg, s->s.type, addr, s->s.port.dst) == 0)
+			continue;
+		for (j = 0; j != mg->num && mg->s[j] != s; j++)
+			;
+		if (j != mg->num) {
+			mcast_del_memb(ust, mg, j);
+			rc = 0;
+		}
+		break;
+	}
+
+	rte_spinlock_unlock(&ust->grp_lock);
+	return rc;
+}
+
 static int
 check_stream_prm(const struct tle_ctx *ctx,
 	const struct tle_udp_stream_param *prm)
@@ -221,6 +619,11 @@ check_stream_prm(const struct tle_ctx *ctx,
 			ctx->prm.lookup6 == NULL))
 		return -EINVAL;
 
+	/* unknown receive options */
+	if ((prm->rx_opts & ~(TLE_UDP_RX_OPT_GRO |
+			TLE_UDP_RX_OPT_REUSEPORT)) != 0)
+		return -EINVAL;
+
 	return 0;
 }
 
@@ -229,6 +632,8 @@ tle_udp_stream_open(struct tle_ctx *ctx,
 	const struct tle_udp_stream_param *prm)
 {
 	struct tle_udp_stream *s;
+	struct udp_port_grp *grp;
+	rte_spinlock_t *lock;
 	int32_t rc;
 
 	if (ctx == NULL || prm == NULL || check_stream_prm(ctx, prm) != 0) {
@@ -251,10 +656,40 @@ tle_udp_stream_open(struct tle_ctx *ctx,
 	/* copy input parameters. */
 	s->prm = *prm;
 
-	/* setup L4 ports and L3 addresses fields. */
-	rc = stream_fill_ctx(ctx, &s->s,
-		(const struct sockaddr *)&prm->local_addr,
-		(const struct sockaddr *)&prm->remote_addr);
+	/*
+	 * setup L4 ports and L3 addresses fields,
+	 * connected streams don't occupy local port.
+	 */
+	s->ste = NULL;
+	s->rx.grp = NULL;
+	grp = NULL;
+	lock = NULL;
+
+	if (stream_is_connected(prm)) {
+		rc = stream_fill_addr(ctx, &s->s,
+			(const struct sockaddr *)&prm->local_addr,
+			(const struct sockaddr *)&prm->remote_addr);
+		if (rc == 0)
+			rc = stream_add_conn(ctx, s);
+	} else {
+		/* either create new port group or join existing one. */
+		if ((prm->rx_opts & TLE_UDP_RX_OPT_REUSEPORT) != 0) {
+			lock = &CTX_UDP_STREAMS(ctx)->grp_lock;
+			rte_spinlock_lock(lock);
+		}
+
+		rc = stream_fill_ctx(ctx, &s->s,
+			(const struct sockaddr *)&prm->local_addr,
+			(const struct sockaddr *)&prm->remote_addr);
+
+		if (lock != NULL) {
+			if (rc == 0) {
+				grp = &s->rx.grp_data;
+				grp->num = 0;
+			} else if (rc == EEXIST)
+				rc = stream_join_grp(ctx, s, &grp);
+		}
+	}
 
 	if (rc != 0) {
 		put_stream(ctx, &s->s, 1);
@@ -269,19 +704,26 @@ tle_udp_stream_open(struct tle_ctx *ctx,
 
 		/* mark stream as avaialbe for RX/TX */
 		if (s->tx.ev != NULL)
-			tle_event_raise(s->tx.ev);
+			tle_event_raise_mask(s->tx.ev, TLE_EV_OUT);
 		stream_up(s);
+
+		if (grp != NULL)
+			stream_add_grp(grp, s);
 	}
 
+	if (lock != NULL)
+		rte_spinlock_unlock(lock);
+
 	return &s->s;
 }
 
 int
 tle_udp_stream_close(struct tle_stream *us)
 {
-	int32_t rc;
+	int32_t moved, rc;
 	struct tle_ctx *ctx;
 	struct tle_udp_stream *s;
+	rte_spinlock_t *lock;
 
 	static const struct tle_stream_cb zcb;
 
@@ -291,6 +733,19 @@ tle_udp_stream_close(struct tle_stream *us)
 
 	ctx = s->s.ctx;
 
+	/* leave multicast groups, if any. */
+	if (rte_atomic32_read(&CTX_UDP_STREAMS(ctx)->nb_mcast) != 0)
+		stream_leave_mcast_all(CTX_UDP_STREAMS(ctx), s);
+
+	/* leave port group, so no new packets will be delivered to it. */
+	moved = 0;
+	lock = NULL;
+	if (s->rx.grp != NULL) {
+		lock = &CTX_UDP_STREAMS(ctx)->grp_lock;
+		rte_spinlock_lock(lock);
+		moved = stream_leave_grp(ctx, s);
+	}
+
 	/* mark stream as unavaialbe for RX/TX. */
 	stream_down(s);
 
@@ -308,7 +763,19 @@ tle_udp_stream_close(struct tle_stream *us)
 	s->tx.cb = zcb;
 
 	/* free stream's destination port */
-	rc = stream_clear_ctx(ctx, &s->s);
+	if (s->ste != NULL) {
+		stream_del_conn(ctx, s);
+		rc = 0;
+	} else if (moved == 0 && (s->rx.grp == NULL ||
+			s->rx.grp == &s->rx.grp_data))
+		rc = stream_clear_ctx(ctx, &s->s);
+	else
+		rc = 0;
+
+	if (lock != NULL) {
+		s->rx.grp = NULL;
+		rte_spinlock_unlock(lock);
+	}
 
 	/* empty stream's RX queue */
 	empty_mbuf_ring(s->rx.q);
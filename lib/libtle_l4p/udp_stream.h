@@ -16,6 +16,7 @@
 #ifndef _UDP_STREAM_H_
 #define _UDP_STREAM_H_
 
+#include <string.h>
 #include <rte_vect.h>
 #include <tle_dring.h>
 #include <tle_udp.h>
@@ -24,6 +25,7 @@
 #include "osdep.h"
 #include "ctx.h"
 #include "stream.h"
+#include "stream_table.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -38,15 +40,30 @@ union udph {
 	};
 };
 
+struct tle_udp_stream;
+
+/* streams sharing the same local port (TLE_UDP_RX_OPT_REUSEPORT). */
+struct udp_port_grp {
+	uint32_t num;
+	struct tle_udp_stream *s[TLE_UDP_REUSEPORT_MAX];
+};
+
 struct tle_udp_stream {
 
 	struct tle_stream s;
 
+	/* entry in the connected streams table, NULL if not connected. */
+	struct stbl_entry *ste;
+
 	struct {
 		struct rte_ring *q;
 		struct tle_event *ev;
 		struct tle_stream_cb cb;
 		rte_atomic32_t use;
+		/* port group stream belongs to, NULL if none. */
+		struct udp_port_grp *grp;
+		/* storage for the group, when stream owns the port. */
+		struct udp_port_grp grp_data;
 	} rx __rte_cache_aligned;
 
 	struct {
@@ -54,7 +71,8 @@ struct tle_udp_stream {
 		struct {
 			uint32_t nb_elem;  /* number of obects per drb. */
 			uint32_t nb_max;   /* number of drbs per stream. */
-			struct rte_ring *r;
+			uint32_t nb_out;   /* drbs in flight. */
+			uint32_t wait;     /* waits for drbs in ctx pool. */
 		} drb;
 		struct tle_event *ev;
 		struct tle_stream_cb cb;
@@ -63,14 +81,100 @@ struct tle_udp_stream {
 	struct tle_udp_stream_param prm;
 } __rte_cache_aligned;
 
+/* max number of multicast groups (group address, local port) per ctx. */
+#define	UDP_MCAST_GRP_NUM	0x40
+
+/*
+ * Entry can be updated (and reused for another group) by FE while BE
+ * delivers packets to its members, so BE reads it under sequence lock:
+ * *seq* is odd while the entry is being updated.
+ */
+struct udp_mcast_grp {
+	volatile uint32_t seq;
+	uint16_t type;  /* TLE_V4/TLE_V6, TLE_VNUM for unused entry */
+	uint16_t port;  /* local port, network byte order */
+	uint32_t num;   /* number of member streams */
+	union {
+		uint32_t a4;
+		rte_xmm_t a6;
+	} addr;
+	struct tle_udp_stream *s[TLE_UDP_MCAST_MAX_MEMB];
+};
+
+/*
+ * Fully specified (connected) streams are not bound to the local port,
+ * instead they are kept in the hash table keyed by 4-tuple,
+ * so many of them can share the same local port.
+ * Stream bound to that port (if any) receives the rest of the traffic.
+ */
+struct udp_streams {
+	struct stbl st;          /* connected streams table */
+	rte_atomic32_t nb_conn;  /* number of connected streams */
+	/* protects port and multicast groups membership */
+	rte_spinlock_t grp_lock;
+	rte_atomic32_t nb_mcast; /* number of joined multicast groups */
+	struct udp_mcast_grp mcast[UDP_MCAST_GRP_NUM];
+	/* streams that failed to get drbs from the ctx pool */
+	struct rte_ring *drbq;
+	struct tle_udp_stream s[];
+};
+
+#define CTX_UDP_STREAMS(ctx)	((struct udp_streams *)(ctx)->streams.buf)
+#define CTX_UDP_STLB(ctx)	(&CTX_UDP_STREAMS(ctx)->st)
+
+static inline int
+udp_mcast_match(const struct udp_mcast_grp *mg, uint32_t type,
+	const void *addr, uint16_t port)
+{
+	if (mg->type != type || mg->port != port)
+		return 0;
+	if (type == TLE_V4)
+		return mg->addr.a4 == *(const uint32_t *)addr;
+	return memcmp(&mg->addr.a6, addr, sizeof(mg->addr.a6)) == 0;
+}
+
+/* start update of multicast group entry, grp_lock has to be held. */
+static inline void
+mcast_grp_wbegin(struct udp_mcast_grp *mg)
+{
+	mg->seq++;
+	rte_smp_wmb();
+}
+
+static inline void
+mcast_grp_wend(struct udp_mcast_grp *mg)
+{
+	rte_smp_wmb();
+	mg->seq++;
+}
+
+static inline uint32_t
+mcast_grp_rbegin(const struct udp_mcast_grp *mg)
+{
+	uint32_t seq;
+
+	while (((seq = mg->seq) & 1) != 0)
+		rte_pause();
+	rte_smp_rmb();
+	return seq;
+}
+
+/* returns non-zero if entry was updated since mcast_grp_rbegin(). */
+static inline int
+mcast_grp_rretry(const struct udp_mcast_grp *mg, uint32_t seq)
+{
+	rte_smp_rmb();
+	return mg->seq != seq;
+}
+
 #define UDP_STREAM(p)	\
 ((struct tle_udp_stream *)((uintptr_t)(p) - offsetof(struct tle_udp_stream, s)))
 
 #define UDP_STREAM_TX_PENDING(s)	\
-	((s)->tx.drb.nb_max != rte_ring_count((s)->tx.drb.r))
+	(stream_drb_out(&(s)->tx.drb.nb_out) != 0)
 
 #define UDP_STREAM_TX_FINISHED(s)	\
-	((s)->tx.drb.nb_max == rte_ring_count((s)->tx.drb.r))
+	(stream_drb_out(&(s)->tx.drb.nb_out) == 0)
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,370 @@
+/*
+ * Copyright (c) 2016  Intel Corporation.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <errno.h>
+
+#include <rte_common.h>
+#include <rte_cycles.h>
+#include <rte_eal.h>
+#include <rte_malloc.h>
+#include <rte_mbuf.h>
+#include <rte_random.h>
+
+#include <cksum.h>
+
+/* max buffer size for exhaustive correctness check. */
+#define	CHECK_LEN_MAX	2048
+
+/* max buffer alignment offset to check. */
+#define	ALIGN_MAX	RTE_CACHE_LINE_SIZE
+
+/* head room, as scalar code might read up to 7 bytes before the buffer. */
+#define	BUF_HEAD	RTE_CACHE_LINE_SIZE
+
+#define	BUF_SIZE	(BUF_HEAD + ALIGN_MAX + (1 << 20))
+
+/* max number of segments in multi-segment packet tests. */
+#define	MSEG_NUM	4
+
+/* number of bytes to process by each throughput test run. */
+#define	PERF_BYTES	(UINT64_C(1) << 28)
+
+struct cksum_impl {
+	const char *name;
+	tle_raw_cksum_t fn;
+};
+
+static const struct cksum_impl cksum_impl[] = {
+	{
+		.name = "scalar",
+		.fn = tle_raw_cksum_scalar,
+	},
+#ifdef RTE_ARCH_X86
+	{
+		.name = "avx2",
+		.fn = tle_raw_cksum_avx2,
+	},
+	{
+		.name = "avx512",
+		.fn = tle_raw_cksum_avx512,
+	},
+#endif
+#ifdef RTE_ARCH_ARM64
+	{
+		.name = "neon",
+		.fn = tle_raw_cksum_neon,
+	},
+#endif
+};
+
+/*
+ * L4 offset and segment lengths for multi-segment packet tests.
+ * Each segment of odd length makes all the following ones start
+ * at odd offset within the L4 data.
+ */
+static const struct {
+	uint32_t ofs;
+	uint32_t len[MSEG_NUM];
+} mseg_test[] = {
+	{ .ofs = 0, .len = {1, 1, 1, 1}, },
+	{ .ofs = 0, .len = {3, 2, 5, 4}, },
+	{ .ofs = 1, .len = {4, 3, 1, 0}, },
+	{ .ofs = 0, .len = {7, 1000, 1, 999}, },
+	{ .ofs = 14, .len = {1461, 1, 1460, 2}, },
+	{ .ofs = 34, .len = {1501, 1499, 257, 1}, },
+	{ .ofs = 0, .len = {2, 2, 2, 2}, },
+};
+
+static const uint32_t perf_len[] = {
+	64, 256, 576, 1460, 4096, 9000, 65536,
+};
+
+static const uint32_t perf_align[] = {
+	0, 1, 2, 8, 31,
+};
+
+/* straightforward (and slow) byte-wise reference implementation. */
+static uint16_t
+ref_cksum(const uint8_t *buf, uint32_t size)
+{
+	uint32_t i;
+	uint64_t sum;
+
+	sum = 0;
+	for (i = 0; i + 1 < size; i += 2)
+		sum += buf[i] | (uint32_t)buf[i + 1] << 8;
+	if (i != size)
+		sum += buf[i];
+
+	while (sum > UINT16_MAX)
+		sum = (sum & UINT16_MAX) + (sum >> 16);
+	return sum;
+}
+
+/* 0 and 0xffff are the same value in one's complement arithmetic. */
+static int
+cksum_equal(uint16_t a, uint16_t b)
+{
+	return (a % UINT16_MAX) == (b % UINT16_MAX);
+}
+
+static void
+fill_random(uint8_t *buf, uint32_t size)
+{
+	uint32_t i;
+
+	for (i = 0; i != size; i++)
+		buf[i] = rte_rand();
+}
+
+static int
+check_one(const struct cksum_impl *im, const uint8_t *buf, uint32_t len,
+	uint32_t align)
+{
+	uint16_t x, y;
+
+	x = ref_cksum(buf + align, len);
+	y = im->fn(buf + align, len);
+	if (cksum_equal(x, y) == 0) {
+		printf("%s(%s): len=%u, align=%u, "
+			"expected: %#hx, returned: %#hx;\n",
+			__func__, im->name, len, align, x, y);
+		return -EINVAL;
+	}
+	return 0;
+}
+
+static int
+test_cksum_check(const struct cksum_impl *im, uint8_t *buf)
+{
+	int32_t rc;
+	uint32_t a, i, len;
+
+	static const uint32_t big_len[] = {
+		UINT16_MAX, UINT16_MAX + 1, 1 << 19,
+		/* enough to trigger lane accumulators flush for all SIMD. */
+		(1 << 20) - 1, 1 << 20,
+	};
+
+	printf("%s(%s) started;\n", __func__, im->name);
+
+	rc = 0;
+
+	/* random data. */
+	fill_random(buf, BUF_SIZE - BUF_HEAD);
+	for (len = 0; len <= CHECK_LEN_MAX && rc == 0; len++) {
+		for (a = 0; a != ALIGN_MAX && rc == 0; a++)
+			rc = check_one(im, buf, len, a);
+	}
+	for (i = 0; i != RTE_DIM(big_len) && rc == 0; i++) {
+		for (a = 0; a != ALIGN_MAX && rc == 0; a++)
+			rc = check_one(im, buf, big_len[i], a);
+	}
+
+	/* all ones, worst case for carries. */
+	memset(buf, UINT8_MAX, BUF_SIZE - BUF_HEAD);
+	for (i = 0; i != RTE_DIM(big_len) && rc == 0; i++) {
+		for (a = 0; a != ALIGN_MAX && rc == 0; a += 7)
+			rc = check_one(im, buf, big_len[i], a);
+	}
+
+	printf("%s(%s) finished with status: %s(%d);\n",
+		__func__, im->name, strerror(-rc), rc);
+	return rc;
+}
+
+/* build packet with given segment lengths out of the *buf* content. */
+static struct rte_mbuf *
+mseg_pkt(struct rte_mempool *mp, const uint8_t *buf, const uint32_t len[],
+	uint32_t num)
+{
+	uint32_t i, ofs;
+	struct rte_mbuf *m, *pkt;
+
+	pkt = NULL;
+	ofs = 0;
+	for (i = 0; i != num && len[i] != 0; i++) {
+		m = rte_pktmbuf_alloc(mp);
+		if (m == NULL) {
+			rte_pktmbuf_free(pkt);
+			return NULL;
+		}
+		memcpy(rte_pktmbuf_append(m, len[i]), buf + ofs, len[i]);
+		ofs += len[i];
+		if (pkt == NULL)
+			pkt = m;
+		else
+			rte_pktmbuf_chain(pkt, m);
+	}
+	return pkt;
+}
+
+/*
+ * check __udptcp_mbuf_cksum() over multi-segment packets,
+ * including segments of odd length.
+ */
+static int
+test_cksum_mseg(uint8_t *buf)
+{
+	int32_t rc;
+	uint32_t i, j, k, n, ofs;
+	uint16_t x, y;
+	struct rte_mempool *mp;
+	struct rte_mbuf *m;
+
+	printf("%s started;\n", __func__);
+
+	mp = rte_pktmbuf_pool_create("test_cksum", 2 * MSEG_NUM, 0, 0,
+		RTE_MBUF_DEFAULT_BUF_SIZE, SOCKET_ID_ANY);
+	if (mp == NULL) {
+		printf("%s: failed to create mempool;\n", __func__);
+		return -ENOMEM;
+	}
+
+	rc = 0;
+	for (i = 0; i != 2 * RTE_DIM(mseg_test) && rc == 0; i++) {
+
+		/* random data first, then all ones (worst case for carries) */
+		if (i == 0)
+			fill_random(buf, BUF_SIZE - BUF_HEAD);
+		else if (i == RTE_DIM(mseg_test))
+			memset(buf, UINT8_MAX, BUF_SIZE - BUF_HEAD);
+
+		k = i % RTE_DIM(mseg_test);
+		ofs = mseg_test[k].ofs;
+
+		m = mseg_pkt(mp, buf, mseg_test[k].len, MSEG_NUM);
+		if (m == NULL) {
+			rc = -ENOMEM;
+			break;
+		}
+
+		n = 0;
+		for (j = 0; j != MSEG_NUM; j++)
+			n += mseg_test[k].len[j];
+
+		x = ~ref_cksum(buf + ofs, n - ofs);
+		x = (x == 0) ? UINT16_MAX : x;
+		y = __udptcp_mbuf_cksum(m, ofs, 0);
+		if (x != y) {
+			printf("%s: test #%u, "
+				"expected: %#hx, returned: %#hx;\n",
+				__func__, i, x, y);
+			rc = -EINVAL;
+		}
+
+		rte_pktmbuf_free(m);
+	}
+
+	rte_mempool_free(mp);
+
+	printf("%s finished with status: %s(%d);\n",
+		__func__, strerror(-rc), rc);
+	return rc;
+}
+
+static void
+test_cksum_perf(const struct cksum_impl *im, uint8_t *buf)
+{
+	uint32_t a, i, j, n;
+	uint64_t cyc, tm, tsc_hz;
+	volatile uint16_t x;
+
+	tsc_hz = rte_get_tsc_hz();
+	fill_random(buf, BUF_SIZE - BUF_HEAD);
+
+	for (i = 0; i != RTE_DIM(perf_len); i++) {
+		for (a = 0; a != RTE_DIM(perf_align); a++) {
+
+			n = PERF_BYTES / perf_len[i];
+
+			tm = rte_rdtsc_precise();
+			for (j = 0; j != n; j++)
+				x = im->fn(buf + perf_align[a], perf_len[i]);
+			cyc = rte_rdtsc_precise() - tm;
+
+			RTE_SET_USED(x);
+			printf("%s(%s): len=%u, align=%u: "
+				"%.3Lf cycles/byte, %.3Lf GB/s;\n",
+				__func__, im->name, perf_len[i], perf_align[a],
+				(long double)cyc / ((uint64_t)n * perf_len[i]),
+				(long double)n * perf_len[i] * tsc_hz /
+				(cyc * 1e9L));
+		}
+	}
+}
+
+static int
+test_cksum(void)
+{
+	int32_t rc;
+	uint32_t i;
+	uint8_t *mem, *buf;
+
+	mem = rte_malloc(NULL, BUF_SIZE, RTE_CACHE_LINE_SIZE);
+	if (mem == NULL) {
+		printf("%s: failed to allocate %u bytes;\n",
+			__func__, BUF_SIZE);
+		return -ENOMEM;
+	}
+	memset(mem, 0, BUF_SIZE);
+	buf = mem + BUF_HEAD;
+
+	rc = 0;
+	for (i = 0; i != RTE_DIM(cksum_impl) && rc == 0; i++) {
+		if (tle_raw_cksum_supported(cksum_impl[i].fn) == 0) {
+			printf("%s: %s is not supported, skipped;\n",
+				__func__, cksum_impl[i].name);
+			continue;
+		}
+		rc = test_cksum_check(cksum_impl + i, buf);
+	}
+
+	if (rc == 0)
+		rc = test_cksum_mseg(buf);
+
+	for (i = 0; i != RTE_DIM(cksum_impl) && rc == 0; i++) {
+		if (tle_raw_cksum_supported(cksum_impl[i].fn) != 0)
+			test_cksum_perf(cksum_impl + i, buf);
+	}
+
+	rte_free(mem);
+	return rc;
+}
+
+int
+main(int argc, char *argv[])
+{
+	int32_t rc;
+
+	rc = rte_eal_init(argc, argv);
+	if (rc < 0)
+		rte_exit(EXIT_FAILURE,
+			"%s: rte_eal_init failed with error code: %d\n",
+			__func__, rc);
+
+	rc = test_cksum();
+	if (rc != 0)
+		printf("TEST FAILED\n");
+	else
+		printf("TEST OK\n");
+
+	return rc;
+}
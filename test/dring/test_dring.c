@@ -22,6 +22,7 @@
 #include <errno.h>
 
 #include <rte_common.h>
+#include <rte_atomic.h>
 #include <rte_log.h>
 #include <rte_errno.h>
 #include <rte_launch.h>
@@ -35,6 +36,7 @@
 
 #define OBJ_NUM		UINT16_MAX
 #define ITER_NUM	(4 * OBJ_NUM)
+#define PERF_OBJ_NUM	(1 << 22)	/* objects per producer */
 
 enum {
 	NONE,
@@ -50,8 +52,12 @@ struct dring_arg {
 	int32_t deq_type;
 	uint32_t enq;
 	uint32_t deq;
+	uint32_t burst;    /* perf: objects per enqueue/dequeue call */
+	uint64_t cyc;      /* perf: cycles spent */
 };
 
+static rte_atomic32_t nb_perf_prod;
+
 /*
  * free memory allocated for drbs and for the ring itself.
  */
@@ -480,6 +486,160 @@ test_dring_sp_mc(void)
 	return rc;
 }
 
+/*
+ * perf: producer enqueues PERF_OBJ_NUM objects in *burst* chunks,
+ * consumer dequeues in *burst* chunks till all producers are done.
+ */
+static int
+test_dring_perf_worker(void *arg)
+{
+	int32_t np, rc;
+	uint32_t n;
+	uint64_t tm;
+	struct dring_arg *p;
+
+	p = (struct dring_arg *)arg;
+	rc = 0;
+	n = 0;
+	tm = rte_rdtsc_precise();
+
+	if (p->enq_type != NONE) {
+		while (n != PERF_OBJ_NUM) {
+			rc = test_dring_enqueue(p->dr, p->r,
+				RTE_MIN(p->burst, PERF_OBJ_NUM - n),
+				p->enq_type);
+			if (rc < 0)
+				break;
+			n += rc;
+		}
+		p->cyc = rte_rdtsc_precise() - tm;
+		p->enq = n;
+		rte_atomic32_dec(&nb_perf_prod);
+
+	} else {
+		/*
+		 * number of active producers has to be read before dequeue,
+		 * so empty dring after that means nothing is left.
+		 */
+		do {
+			np = rte_atomic32_read(&nb_perf_prod);
+			rc = test_dring_dequeue(p->dr, p->r, p->burst,
+				p->deq_type);
+			if (rc < 0)
+				break;
+			n += rc;
+		} while (rc != 0 || np != 0);
+		p->cyc = rte_rdtsc_precise() - tm;
+		p->deq = n;
+	}
+
+	return RTE_MIN(rc, 0);
+}
+
+static int
+test_dring_perf_burst(const char *name, int32_t master_enq_type,
+	int32_t master_deq_type, int32_t slave_enq_type,
+	int32_t slave_deq_type, uint32_t burst)
+{
+	int32_t rc;
+	uint32_t lc;
+	uint64_t deq, enq, ecyc, dcyc, mcyc;
+	struct rte_ring *r;
+	struct tle_dring dr;
+	struct dring_arg arg[RTE_MAX_LCORE];
+
+	tle_dring_reset(&dr, 0);
+	r = init_drb_ring(OBJ_NUM);
+	if (r == NULL)
+		return -ENOMEM;
+
+	memset(arg, 0, sizeof(arg));
+
+	if (master_enq_type != NONE)
+		rte_atomic32_set(&nb_perf_prod, 1);
+	else
+		rte_atomic32_set(&nb_perf_prod, rte_lcore_count() - 1);
+
+	RTE_LCORE_FOREACH_WORKER(lc) {
+		arg[lc].dr = &dr;
+		arg[lc].r = r;
+		arg[lc].burst = burst;
+		arg[lc].enq_type = slave_enq_type;
+		arg[lc].deq_type = slave_deq_type;
+		rte_eal_remote_launch(test_dring_perf_worker, &arg[lc], lc);
+	}
+
+	lc = rte_lcore_id();
+	arg[lc].dr = &dr;
+	arg[lc].r = r;
+	arg[lc].burst = burst;
+	arg[lc].enq_type = master_enq_type;
+	arg[lc].deq_type = master_deq_type;
+	rc = test_dring_perf_worker(&arg[lc]);
+
+	RTE_LCORE_FOREACH_WORKER(lc)
+		rc |= rte_eal_wait_lcore(lc);
+
+	enq = 0;
+	deq = 0;
+	ecyc = 0;
+	dcyc = 0;
+	mcyc = 1;
+	RTE_LCORE_FOREACH(lc) {
+		enq += arg[lc].enq;
+		deq += arg[lc].deq;
+		if (arg[lc].enq_type != NONE)
+			ecyc += arg[lc].cyc;
+		else {
+			dcyc += arg[lc].cyc;
+			mcyc = RTE_MAX(mcyc, arg[lc].cyc);
+		}
+	}
+
+	printf("%s(%s, burst=%u): %" PRIu64 " objects enqueued, %"
+		PRIu64 " objects dequeued, "
+		"%.3Lf cycles/obj enqueue, %.3Lf cycles/obj dequeue, "
+		"%.3Lf M obj/s;\n",
+		__func__, name, burst, enq, deq,
+		(long double)ecyc / RTE_MAX(enq, UINT64_C(1)),
+		(long double)dcyc / RTE_MAX(deq, UINT64_C(1)),
+		(long double)deq * rte_get_tsc_hz() / (mcyc * 1e6L));
+
+	rc = (rc != 0) ? rc : (enq != deq);
+	if (rc != 0)
+		tle_dring_dump(stdout, 1, &dr);
+
+	fini_drb_ring(r);
+	return rc;
+}
+
+/*
+ * measure dring throughput for different MP/MC mixes and burst sizes.
+ */
+static int
+test_dring_perf(void)
+{
+	static const uint32_t burst[] = {1, 8, 32, 64, UINT8_MAX};
+
+	int32_t rc;
+	uint32_t i;
+
+	printf("%s started;\n", __func__);
+
+	rc = 0;
+	for (i = 0; i != RTE_DIM(burst) && rc == 0; i++) {
+		rc = test_dring_perf_burst("mp_sc", NONE, SINGLE, MULTI, NONE,
+			burst[i]);
+		if (rc == 0)
+			rc = test_dring_perf_burst("sp_mc", SINGLE, NONE,
+				NONE, MULTI, burst[i]);
+	}
+
+	printf("%s finished with status: %s(%d);\n",
+		__func__, strerror(-rc), rc);
+	return rc;
+}
+
 static int
 test_dring(void)
 {
@@ -501,6 +661,12 @@ test_dring(void)
 	if (rc != 0)
 		return rc;
 
+	if (rte_lcore_count() > 1) {
+		rc = test_dring_perf();
+		if (rc != 0)
+			return rc;
+	}
+
 	return 0;
 }
 
@@ -0,0 +1,241 @@
+/*
+ * Copyright (c) 2016  Intel Corporation.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <errno.h>
+
+#include <rte_common.h>
+#include <rte_atomic.h>
+#include <rte_cycles.h>
+#include <rte_eal.h>
+#include <rte_errno.h>
+#include <rte_launch.h>
+#include <rte_lcore.h>
+
+#include <tle_event.h>
+
+#define	EVENT_NUM	0x1000
+#define	ITER_NUM	(1 << 24)
+#define	GET_BURST	0x20
+#define	WAIT_TMO	1	/* ms */
+
+struct evq_arg {
+	struct tle_evq *evq;
+	struct tle_event **ev;  /* events to raise */
+	uint32_t nb_ev;
+	uint64_t nb_op;         /* number of raised/retrieved events */
+	uint64_t cyc;           /* cycles spent */
+};
+
+static rte_atomic32_t nb_prod;
+
+/*
+ * producer: raise its own events, each DOWN->UP transition is counted.
+ * As only that producer can move its events out of DOWN state,
+ * raise for the event seen in DOWN state always succeeds.
+ */
+static int
+test_evq_producer(void *arg)
+{
+	uint32_t i;
+	uint64_t n, tm;
+	struct evq_arg *p;
+	struct tle_event *ev;
+
+	p = arg;
+	n = 0;
+
+	tm = rte_rdtsc_precise();
+	for (i = 0; i != ITER_NUM; i++) {
+		ev = p->ev[i % p->nb_ev];
+		if (tle_event_state(ev) == TLE_SEV_DOWN) {
+			tle_event_raise(ev);
+			n++;
+		}
+	}
+	p->cyc = rte_rdtsc_precise() - tm;
+	p->nb_op = n;
+
+	rte_atomic32_dec(&nb_prod);
+	return 0;
+}
+
+static inline int32_t
+test_evq_get(struct tle_evq *evq, const void *evd[], uint32_t num)
+{
+	int32_t k;
+
+	if ((evq->flags & TLE_EVQ_F_WAIT) == 0)
+		return tle_evq_get(evq, evd, num);
+
+	k = tle_evq_wait(evq, evd, num, WAIT_TMO);
+	return RTE_MAX(k, 0);
+}
+
+/*
+ * consumer: retrieve events till all producers are done.
+ * For TLE_EVQ_F_WAIT queues it sleeps when there are no events.
+ */
+static void
+test_evq_consumer(struct evq_arg *p)
+{
+	int32_t k;
+	uint64_t n, tm;
+	const void *evd[GET_BURST];
+
+	n = 0;
+	tm = rte_rdtsc_precise();
+
+	while (rte_atomic32_read(&nb_prod) != 0)
+		n += test_evq_get(p->evq, evd, RTE_DIM(evd));
+
+	/* collect what is left. */
+	do {
+		k = tle_evq_get(p->evq, evd, RTE_DIM(evd));
+		n += k;
+	} while (k != 0);
+
+	p->cyc = rte_rdtsc_precise() - tm;
+	p->nb_op = n;
+}
+
+static int
+test_evq_mt(const char *name, uint32_t flags)
+{
+	int32_t rc;
+	uint32_t i, lc, nb_ev, np;
+	uint64_t cyc, n;
+	struct tle_evq *evq;
+	struct tle_evq_param prm;
+	struct tle_event *ev[EVENT_NUM];
+	struct evq_arg arg[RTE_MAX_LCORE];
+
+	memset(&prm, 0, sizeof(prm));
+	prm.socket_id = rte_socket_id();
+	prm.max_events = EVENT_NUM;
+	prm.flags = flags;
+
+	evq = tle_evq_create(&prm);
+	if (evq == NULL) {
+		printf("%s(%s): tle_evq_create failed with error code: %d\n",
+			__func__, name, rte_errno);
+		return -rte_errno;
+	}
+
+	for (i = 0; i != RTE_DIM(ev); i++) {
+		ev[i] = tle_event_alloc(evq, (void *)(uintptr_t)(i + 1));
+		tle_event_active(ev[i], TLE_SEV_DOWN);
+	}
+
+	/* each producer gets its own subset of events. */
+	np = rte_lcore_count() - 1;
+	nb_ev = RTE_DIM(ev) / np;
+	rte_atomic32_set(&nb_prod, np);
+	memset(arg, 0, sizeof(arg));
+
+	i = 0;
+	RTE_LCORE_FOREACH_WORKER(lc) {
+		arg[lc].evq = evq;
+		arg[lc].ev = ev + i * nb_ev;
+		arg[lc].nb_ev = nb_ev;
+		rte_eal_remote_launch(test_evq_producer, &arg[lc], lc);
+		i++;
+	}
+
+	lc = rte_lcore_id();
+	arg[lc].evq = evq;
+	test_evq_consumer(&arg[lc]);
+
+	rc = 0;
+	n = 0;
+	cyc = 0;
+	RTE_LCORE_FOREACH_WORKER(lc) {
+		rc |= rte_eal_wait_lcore(lc);
+		n += arg[lc].nb_op;
+		cyc += arg[lc].cyc;
+	}
+
+	lc = rte_lcore_id();
+	printf("%s(%s, producers=%u): raised=%" PRIu64 ", retrieved=%" PRIu64
+		", %.3Lf cycles/raise, %.3Lf M events/s;\n",
+		__func__, name, np, n, arg[lc].nb_op,
+		(long double)cyc / ((uint64_t)np * ITER_NUM),
+		(long double)arg[lc].nb_op * rte_get_tsc_hz() /
+		(arg[lc].cyc * 1e6L));
+
+	/* all raised events have to be retrieved exactly once. */
+	if (rc == 0 && n != arg[lc].nb_op)
+		rc = -EINVAL;
+	for (i = 0; i != RTE_DIM(ev) && rc == 0; i++) {
+		if (tle_event_state(ev[i]) != TLE_SEV_DOWN)
+			rc = -EINVAL;
+	}
+
+	for (i = 0; i != RTE_DIM(ev); i++)
+		tle_event_free(ev[i]);
+	tle_evq_destroy(evq);
+	return rc;
+}
+
+static int
+test_evq(void)
+{
+	int32_t rc;
+
+	if (rte_lcore_count() < 2) {
+		printf("%s: at least 2 lcores are required, skipped;\n",
+			__func__);
+		return 0;
+	}
+
+	printf("%s started;\n", __func__);
+
+	rc = test_evq_mt("locked", 0);
+	if (rc == 0)
+		rc = test_evq_mt("lock-free", TLE_EVQ_F_LOCKFREE);
+	if (rc == 0)
+		rc = test_evq_mt("locked-wait", TLE_EVQ_F_WAIT);
+	if (rc == 0)
+		rc = test_evq_mt("lock-free-wait",
+			TLE_EVQ_F_LOCKFREE | TLE_EVQ_F_WAIT);
+
+	printf("%s finished with status: %s(%d);\n",
+		__func__, strerror(-rc), rc);
+	return rc;
+}
+
+int
+main(int argc, char *argv[])
+{
+	int32_t rc;
+
+	rc = rte_eal_init(argc, argv);
+	if (rc < 0)
+		rte_exit(EXIT_FAILURE,
+			"%s: rte_eal_init failed with error code: %d\n",
+			__func__, rc);
+
+	rc = test_evq();
+	if (rc != 0)
+		printf("TEST FAILED\n");
+	else
+		printf("TEST OK\n");
+
+	return rc;
+}
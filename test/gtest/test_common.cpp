@@ -236,6 +236,58 @@ fill_eth_hdr_len(struct rte_mbuf *m)
 		m->packet_type = RTE_PTYPE_UNKNOWN;
 }
 
+/*
+ * splits packet *m* (L2 + IPv4 headers without options, contiguous)
+ * into contiguous IPv4 fragments carrying up to *fsz* (multiple of 8)
+ * bytes of IP payload each, *m* is freed.
+ * returns number of fragments.
+ */
+uint32_t
+gen_ipv4_frags(struct rte_mbuf *m, struct rte_mbuf *frag[], uint32_t num,
+	uint32_t fsz)
+{
+	uint32_t hl, i, len, n, ofs;
+	struct rte_mbuf *f;
+	struct rte_ipv4_hdr *ip4h;
+	uint8_t *p;
+
+	hl = m->l2_len + m->l3_len;
+	len = m->pkt_len - hl;
+
+	for (i = 0, ofs = 0; ofs != len && i != num; i++, ofs += n) {
+
+		n = RTE_MIN(fsz, len - ofs);
+		f = rte_pktmbuf_alloc(mbuf_pool);
+		if (f == NULL)
+			break;
+
+		p = (uint8_t *)rte_pktmbuf_append(f, hl + n);
+		if (p == NULL) {
+			rte_pktmbuf_free(f);
+			break;
+		}
+
+		memcpy(p, rte_pktmbuf_mtod(m, void *), hl);
+		memcpy(p + hl, rte_pktmbuf_mtod_offset(m, void *, hl + ofs), n);
+
+		ip4h = (struct rte_ipv4_hdr *)(p + m->l2_len);
+		ip4h->total_length = rte_cpu_to_be_16(m->l3_len + n);
+		ip4h->fragment_offset = rte_cpu_to_be_16(ofs / 8 |
+			((ofs + n != len) ? RTE_IPV4_HDR_MF_FLAG : 0));
+		ip4h->hdr_checksum = 0;
+		ip4h->hdr_checksum = rte_ipv4_cksum(ip4h);
+
+		f->packet_type = RTE_PTYPE_L2_ETHER | RTE_PTYPE_L3_IPV4 |
+			RTE_PTYPE_L4_FRAG;
+		f->l2_len = m->l2_len;
+		f->l3_len = m->l3_len;
+		frag[i] = f;
+	}
+
+	rte_pktmbuf_free(m);
+	return i;
+}
+
 /*
  * generic, assumes HW doesn't recognise any packet type.
  */
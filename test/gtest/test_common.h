@@ -92,6 +92,10 @@ compress_pkt_list(struct rte_mbuf *pkt[], uint32_t nb_pkt, uint32_t nb_zero);
 void
 fill_eth_hdr_len(struct rte_mbuf *m);
 
+uint32_t
+gen_ipv4_frags(struct rte_mbuf *m, struct rte_mbuf *frag[], uint32_t num,
+	uint32_t fsz);
+
 uint16_t
 typen_rx_callback(dpdk_port_t port, __rte_unused uint16_t queue,
 	struct rte_mbuf *pkt[], uint16_t nb_pkts,
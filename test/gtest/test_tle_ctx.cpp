@@ -128,3 +128,51 @@ TEST(ctx_create, ctx_create_invalidate)
 
 	tle_ctx_destroy(ctx);
 }
+
+TEST(rlim_create, rlim_create_null)
+{
+	struct tle_rlim *rl;
+
+	rl = tle_rlim_create(NULL);
+	ASSERT_EQ(rl, (struct tle_rlim *) NULL);
+	ASSERT_EQ(rte_errno, EINVAL);
+}
+
+TEST(rlim_create, rlim_create_zero_rate)
+{
+	struct tle_rlim *rl;
+	struct tle_rlim_param prm;
+
+	memset(&prm, 0, sizeof(prm));
+	prm.socket_id = SOCKET_ID_ANY;
+	prm.burst = 0x10000;
+
+	rl = tle_rlim_create(&prm);
+	ASSERT_EQ(rl, (struct tle_rlim *) NULL);
+	ASSERT_EQ(rte_errno, EINVAL);
+}
+
+TEST(rlim_create, rlim_create_update)
+{
+	int rc;
+	struct tle_rlim *rl;
+	struct tle_rlim_param prm;
+
+	memset(&prm, 0, sizeof(prm));
+	prm.socket_id = SOCKET_ID_ANY;
+	prm.rate = 1000000;
+	prm.burst = 0x10000;
+
+	rl = tle_rlim_create(&prm);
+	ASSERT_NE(rl, (void *)NULL);
+
+	prm.rate = 2000000;
+	rc = tle_rlim_update(rl, &prm);
+	ASSERT_EQ(rc, 0);
+
+	prm.burst = 0;
+	rc = tle_rlim_update(rl, &prm);
+	ASSERT_EQ(rc, -EINVAL);
+
+	tle_rlim_destroy(rl);
+}
@@ -193,3 +193,907 @@ TEST_F(test_tle_tcp_stream_ops, tcp_stream_listen_ipv6)
 	ret = tle_tcp_stream_close(stream6);
 	ASSERT_EQ(ret, 0);
 }
+
+/* --------- Tests for bulk establish call  --------- */
+
+TEST_F(test_tle_tcp_stream, tcp_stream_establish_bulk_nullctx)
+{
+	uint32_t n;
+	int32_t rc[1];
+	struct tle_stream *ts[1];
+	struct tle_tcp_conn_info ci;
+
+	memset(&ci, 0, sizeof(ci));
+	n = tle_tcp_stream_establish_bulk(nullptr, &stream_prm, &ci, ts, rc,
+		RTE_DIM(ts), 0);
+	EXPECT_EQ(n, 0U);
+	EXPECT_EQ(rte_errno, EINVAL);
+}
+
+TEST_F(test_tle_tcp_stream, tcp_stream_establish_bulk_no_dest)
+{
+	uint32_t i, n;
+	int32_t rc[2];
+	struct tle_stream *ts[2];
+	struct tle_tcp_stream_param prm[2];
+	struct tle_tcp_conn_info ci[2];
+
+	prm[0] = stream_prm;
+	prm[1] = stream_prm6;
+	memset(ci, 0, sizeof(ci));
+
+	/* dummy lookup callbacks never resolve the destination */
+	n = tle_tcp_stream_establish_bulk(ctx, prm, ci, ts, rc,
+		RTE_DIM(ts), 0);
+	EXPECT_EQ(n, 0U);
+	for (i = 0; i != RTE_DIM(ts); i++) {
+		EXPECT_EQ(ts[i], nullptr);
+		EXPECT_EQ(rc[i], -ENOENT);
+	}
+
+	/* addresses should be released, so a regular open must succeed */
+	stream = tle_tcp_stream_open(ctx,
+			(const struct tle_tcp_stream_param *)&stream_prm);
+	ASSERT_NE(stream, nullptr);
+
+	ret = tle_tcp_stream_close(stream);
+	ASSERT_EQ(ret, 0);
+}
+
+/* ------------ Data path tests over an established stream ------------ */
+
+TEST_F(test_tle_tcp_stream_io, tcp_stream_peekv_invalid)
+{
+	struct iovec iov[2];
+
+	start();
+	stream = establish(NULL, l_port);
+	ASSERT_NE(stream, nullptr);
+
+	EXPECT_EQ(tle_tcp_stream_peekv(NULL, iov, RTE_DIM(iov)), -EINVAL);
+	EXPECT_EQ(tle_tcp_stream_peekv(stream, NULL, RTE_DIM(iov)), -EINVAL);
+	EXPECT_EQ(tle_tcp_stream_peekv(stream, iov, 0), -EINVAL);
+	EXPECT_EQ(tle_tcp_stream_peekv(stream, iov, -1), -EINVAL);
+}
+
+TEST_F(test_tle_tcp_stream_io, tcp_stream_peekv_readv)
+{
+	int32_t i, n;
+	uint32_t k, seq;
+	ssize_t sz;
+	char buf[0x100];
+	struct iovec iov[4], rv;
+	static const char d1[] = "peek does ";
+	static const char d2[] = "not consume";
+
+	start();
+	stream = establish(NULL, l_port);
+	ASSERT_NE(stream, nullptr);
+
+	seq = TCP_IO_REMOTE_SEQ;
+	ASSERT_EQ(rx_pkt(l_port, seq, TCP_IO_LOCAL_SEQ, RTE_TCP_ACK_FLAG,
+		d1, sizeof(d1) - 1), 1U);
+	seq += sizeof(d1) - 1;
+	ASSERT_EQ(rx_pkt(l_port, seq, TCP_IO_LOCAL_SEQ, RTE_TCP_ACK_FLAG,
+		d2, sizeof(d2) - 1), 1U);
+
+	/* two peeks in a row see the same data */
+	for (i = 0; i != 2; i++) {
+		n = tle_tcp_stream_peekv(stream, iov, RTE_DIM(iov));
+		ASSERT_EQ(n, 2);
+		ASSERT_EQ(iov[0].iov_len, sizeof(d1) - 1);
+		ASSERT_EQ(iov[1].iov_len, sizeof(d2) - 1);
+		EXPECT_EQ(memcmp(iov[0].iov_base, d1, sizeof(d1) - 1), 0);
+		EXPECT_EQ(memcmp(iov[1].iov_base, d2, sizeof(d2) - 1), 0);
+	}
+
+	/* only as many elements as the caller provided are filled */
+	EXPECT_EQ(tle_tcp_stream_peekv(stream, iov, 1), 1);
+
+	/* readv returns exactly the bytes that were peeked */
+	rv.iov_base = buf;
+	rv.iov_len = sizeof(buf);
+	sz = tle_tcp_stream_readv(stream, &rv, 1);
+	k = sizeof(d1) + sizeof(d2) - 2;
+	ASSERT_EQ(sz, (ssize_t)k);
+	EXPECT_EQ(memcmp(buf, d1, sizeof(d1) - 1), 0);
+	EXPECT_EQ(memcmp(buf + sizeof(d1) - 1, d2, sizeof(d2) - 1), 0);
+
+	/* nothing left after the data was consumed */
+	EXPECT_EQ(tle_tcp_stream_peekv(stream, iov, RTE_DIM(iov)), 0);
+}
+
+struct tcp_io_ext_cb {
+	uint32_t nb_call;
+	void *addr;
+	void *opaque;
+};
+
+static void
+tcp_io_ext_free(void *addr, void *opaque)
+{
+	struct tcp_io_ext_cb *cb;
+
+	cb = (struct tcp_io_ext_cb *)opaque;
+	cb->nb_call++;
+	cb->addr = addr;
+	cb->opaque = opaque;
+}
+
+TEST_F(test_tle_tcp_stream_io, tcp_stream_writev_ext_invalid)
+{
+	uint8_t buf[0x10];
+	struct iovec iov;
+	struct tcp_io_ext_cb cb;
+	struct rte_mbuf_ext_shared_info shinfo;
+
+	start();
+	stream = establish(NULL, l_port);
+	ASSERT_NE(stream, nullptr);
+
+	memset(&cb, 0, sizeof(cb));
+	memset(&shinfo, 0, sizeof(shinfo));
+	shinfo.fcb_opaque = &cb;
+	iov.iov_base = buf;
+	iov.iov_len = sizeof(buf);
+
+	/* no completion callback */
+	EXPECT_EQ(tle_tcp_stream_writev_ext(stream, mbuf_pool, &iov, 1,
+		&shinfo), -1);
+	EXPECT_EQ(rte_errno, EINVAL);
+
+	shinfo.free_cb = tcp_io_ext_free;
+	EXPECT_EQ(tle_tcp_stream_writev_ext(NULL, mbuf_pool, &iov, 1,
+		&shinfo), -1);
+	EXPECT_EQ(rte_errno, EINVAL);
+	EXPECT_EQ(tle_tcp_stream_writev_ext(stream, mbuf_pool, NULL, 1,
+		&shinfo), -1);
+	EXPECT_EQ(rte_errno, EINVAL);
+	EXPECT_EQ(tle_tcp_stream_writev_ext(stream, mbuf_pool, &iov, 0,
+		&shinfo), -1);
+	EXPECT_EQ(rte_errno, EINVAL);
+	EXPECT_EQ(tle_tcp_stream_writev_ext(stream, mbuf_pool, &iov, -1,
+		&shinfo), -1);
+	EXPECT_EQ(rte_errno, EINVAL);
+	EXPECT_EQ(tle_tcp_stream_writev_ext(stream, mbuf_pool, &iov, 1,
+		NULL), -1);
+	EXPECT_EQ(rte_errno, EINVAL);
+
+	EXPECT_EQ(cb.nb_call, 0U);
+}
+
+TEST_F(test_tle_tcp_stream_io, tcp_stream_writev_ext_not_connected)
+{
+	uint8_t *buf;
+	struct iovec iov;
+	struct tcp_io_ext_cb cb;
+	struct rte_mbuf_ext_shared_info shinfo;
+
+	start();
+	stream = tle_tcp_stream_open(ctx, &stream_prm);
+	ASSERT_NE(stream, nullptr);
+
+	buf = (uint8_t *)rte_zmalloc(NULL, 0x100, 0);
+	ASSERT_NE(buf, nullptr);
+
+	memset(&cb, 0, sizeof(cb));
+	memset(&shinfo, 0, sizeof(shinfo));
+	shinfo.free_cb = tcp_io_ext_free;
+	shinfo.fcb_opaque = &cb;
+	iov.iov_base = buf;
+	iov.iov_len = 0x100;
+
+	/* failed write keeps ownership with the caller, no completion */
+	EXPECT_EQ(tle_tcp_stream_writev_ext(stream, mbuf_pool, &iov, 1,
+		&shinfo), -1);
+	EXPECT_EQ(rte_errno, ENOTCONN);
+	EXPECT_EQ(cb.nb_call, 0U);
+
+	tle_tcp_stream_close(stream);
+	rte_free(buf);
+}
+
+TEST_F(test_tle_tcp_stream_io, tcp_stream_writev_ext_completion)
+{
+	uint32_t i, k, len, n, ofs;
+	ssize_t sz;
+	uint8_t *buf, data[2 * TCP_IO_MSS];
+	struct iovec iov[3];
+	struct tcp_io_ext_cb cb;
+	struct rte_mbuf_ext_shared_info shinfo;
+	struct rte_mbuf *pkt[TCP_IO_BURST];
+
+	start();
+	stream = establish(NULL, l_port);
+	ASSERT_NE(stream, nullptr);
+
+	len = TCP_IO_MSS + 0x100;
+	buf = (uint8_t *)rte_malloc(NULL, len, 0);
+	ASSERT_NE(buf, nullptr);
+	for (i = 0; i != len; i++)
+		buf[i] = i;
+
+	memset(&cb, 0, sizeof(cb));
+	memset(&shinfo, 0, sizeof(shinfo));
+	shinfo.free_cb = tcp_io_ext_free;
+	shinfo.fcb_opaque = &cb;
+
+	/* empty leading element must not be reported as the buffer */
+	iov[0].iov_base = data;
+	iov[0].iov_len = 0;
+	iov[1].iov_base = buf;
+	iov[1].iov_len = TCP_IO_MSS;
+	iov[2].iov_base = buf + TCP_IO_MSS;
+	iov[2].iov_len = len - TCP_IO_MSS;
+
+	sz = tle_tcp_stream_writev_ext(stream, mbuf_pool, iov, RTE_DIM(iov),
+		&shinfo);
+	ASSERT_EQ(sz, (ssize_t)len);
+	EXPECT_EQ(cb.nb_call, 0U);
+
+	/* data goes out by reference, payload matches user buffer */
+	n = tx_pkts(pkt, RTE_DIM(pkt));
+	ASSERT_EQ(n, 2U);
+	ofs = 0;
+	for (i = 0; i != n; i++) {
+		EXPECT_EQ(tcp_io_seq(pkt[i]), TCP_IO_LOCAL_SEQ + ofs);
+		k = tcp_io_data(pkt[i], data, sizeof(data));
+		EXPECT_EQ(memcmp(data, buf + ofs, k), 0);
+		EXPECT_TRUE(tcp_io_cksum_valid(pkt[i]));
+		ofs += k;
+	}
+	EXPECT_EQ(ofs, len);
+
+	/* device is done with them, but the data is still unacked */
+	tcp_io_free(pkt, n);
+	EXPECT_EQ(cb.nb_call, 0U);
+
+	/* partial ACK releases the first segment only */
+	ASSERT_EQ(rx_pkt(l_port, TCP_IO_REMOTE_SEQ,
+		TCP_IO_LOCAL_SEQ + TCP_IO_MSS, RTE_TCP_ACK_FLAG, NULL, 0), 1U);
+	n = tx_pkts(pkt, RTE_DIM(pkt));
+	tcp_io_free(pkt, n);
+	EXPECT_EQ(cb.nb_call, 0U);
+
+	/* ACK for everything completes the write exactly once */
+	ASSERT_EQ(rx_pkt(l_port, TCP_IO_REMOTE_SEQ, TCP_IO_LOCAL_SEQ + len,
+		RTE_TCP_ACK_FLAG, NULL, 0), 1U);
+	n = tx_pkts(pkt, RTE_DIM(pkt));
+	tcp_io_free(pkt, n);
+	EXPECT_EQ(cb.nb_call, 1U);
+	EXPECT_EQ(cb.opaque, &cb);
+	EXPECT_TRUE(cb.addr == buf || cb.addr == buf + TCP_IO_MSS);
+
+	rte_free(buf);
+}
+
+static ssize_t
+tcp_io_write(struct tle_stream *s, const void *data, size_t len)
+{
+	struct iovec iov;
+
+	iov.iov_base = (void *)(uintptr_t)data;
+	iov.iov_len = len;
+	return tle_tcp_stream_writev(s, mbuf_pool, &iov, 1);
+}
+
+TEST_F(test_tle_tcp_stream_io, tcp_stream_nagle_hold)
+{
+	uint32_t n;
+	uint8_t data[0x100];
+	struct tle_tcp_stream_cfg cfg;
+	struct rte_mbuf *pkt[TCP_IO_BURST];
+
+	memset(data, 'n', sizeof(data));
+	memset(&cfg, 0, sizeof(cfg));
+	cfg.tx_opts = TLE_TCP_TX_OPT_NAGLE;
+
+	start();
+	stream = establish(&cfg, l_port);
+	ASSERT_NE(stream, nullptr);
+
+	/* nothing is outstanding, small segment goes out at once */
+	ASSERT_EQ(tcp_io_write(stream, data, 100), 100);
+	n = tx_pkts(pkt, RTE_DIM(pkt));
+	ASSERT_EQ(n, 1U);
+	EXPECT_EQ(tcp_io_plen(pkt[0]), 100U);
+	tcp_io_free(pkt, n);
+
+	/* next small writes are held and merged while data is unacked */
+	ASSERT_EQ(tcp_io_write(stream, data, 50), 50);
+	EXPECT_EQ(tx_pkts(pkt, RTE_DIM(pkt)), 0U);
+	ASSERT_EQ(tcp_io_write(stream, data, 30), 30);
+	EXPECT_EQ(tx_pkts(pkt, RTE_DIM(pkt)), 0U);
+
+	/* ACK releases them as one segment */
+	ASSERT_EQ(rx_pkt(l_port, TCP_IO_REMOTE_SEQ, TCP_IO_LOCAL_SEQ + 100,
+		RTE_TCP_ACK_FLAG, NULL, 0), 1U);
+	n = tx_pkts(pkt, RTE_DIM(pkt));
+	ASSERT_EQ(n, 1U);
+	EXPECT_EQ(tcp_io_seq(pkt[0]), TCP_IO_LOCAL_SEQ + 100);
+	EXPECT_EQ(tcp_io_plen(pkt[0]), 80U);
+	EXPECT_TRUE(tcp_io_cksum_valid(pkt[0]));
+	tcp_io_free(pkt, n);
+}
+
+TEST_F(test_tle_tcp_stream_io, tcp_stream_cork_hold)
+{
+	uint32_t n;
+	uint8_t data[2 * TCP_IO_MSS];
+	struct tle_tcp_stream_cfg cfg;
+	struct rte_mbuf *pkt[TCP_IO_BURST];
+
+	memset(data, 'c', sizeof(data));
+	memset(&cfg, 0, sizeof(cfg));
+	cfg.tx_opts = TLE_TCP_TX_OPT_CORK;
+
+	start();
+	stream = establish(&cfg, l_port);
+	ASSERT_NE(stream, nullptr);
+
+	/* partial segment is held even with nothing outstanding */
+	ASSERT_EQ(tcp_io_write(stream, data, 100), 100);
+	EXPECT_EQ(tx_pkts(pkt, RTE_DIM(pkt)), 0U);
+	ASSERT_EQ(tcp_io_write(stream, data, 100), 100);
+	EXPECT_EQ(tx_pkts(pkt, RTE_DIM(pkt)), 0U);
+
+	/* flush pushes it out */
+	EXPECT_EQ(tle_tcp_stream_flush(stream), 0);
+	n = tx_pkts(pkt, RTE_DIM(pkt));
+	ASSERT_EQ(n, 1U);
+	EXPECT_EQ(tcp_io_plen(pkt[0]), 200U);
+	EXPECT_TRUE(tcp_io_cksum_valid(pkt[0]));
+	tcp_io_free(pkt, n);
+
+	/* full sized segments are never held, the tail is */
+	ASSERT_EQ(tcp_io_write(stream, data, TCP_IO_MSS + 40),
+		TCP_IO_MSS + 40);
+	n = tx_pkts(pkt, RTE_DIM(pkt));
+	ASSERT_EQ(n, 1U);
+	EXPECT_EQ(tcp_io_seq(pkt[0]), TCP_IO_LOCAL_SEQ + 200);
+	EXPECT_EQ(tcp_io_plen(pkt[0]), (uint32_t)TCP_IO_MSS);
+	tcp_io_free(pkt, n);
+}
+
+TEST_F(test_tle_tcp_stream_io, tcp_stream_coalesce_send)
+{
+	uint32_t i, n;
+	uint16_t k;
+	uint8_t data[0x100];
+	struct tle_tcp_stream_cfg cfg;
+	struct rte_mbuf *m, *pkt[TCP_IO_BURST];
+
+	for (i = 0; i != sizeof(data); i++)
+		data[i] = i;
+	memset(&cfg, 0, sizeof(cfg));
+	cfg.tx_opts = TLE_TCP_TX_OPT_CORK;
+
+	start();
+	stream = establish(&cfg, l_port);
+	ASSERT_NE(stream, nullptr);
+
+	/* several small packets end up in the same segment */
+	for (i = 0; i != 4; i++) {
+		m = rte_pktmbuf_alloc(mbuf_pool);
+		ASSERT_NE(m, nullptr);
+		memcpy(rte_pktmbuf_append(m, 0x10), data + i * 0x10, 0x10);
+		k = tle_tcp_stream_send(stream, &m, 1);
+		ASSERT_EQ(k, 1);
+	}
+
+	EXPECT_EQ(tle_tcp_stream_flush(stream), 0);
+	n = tx_pkts(pkt, RTE_DIM(pkt));
+	ASSERT_EQ(n, 1U);
+	EXPECT_EQ(tcp_io_plen(pkt[0]), 0x40U);
+	EXPECT_EQ(tcp_io_data(pkt[0], data + 0x80, 0x40), 0x40U);
+	EXPECT_EQ(memcmp(data, data + 0x80, 0x40), 0);
+	EXPECT_TRUE(tcp_io_cksum_valid(pkt[0]));
+	tcp_io_free(pkt, n);
+}
+
+TEST_F(test_tle_tcp_stream_io, tcp_stream_coalesce_retransmit)
+{
+	uint32_t i, n;
+	uint8_t data[0x100], rd[0x100];
+	struct tle_tcp_stream_cfg cfg;
+	struct rte_mbuf *pkt[TCP_IO_BURST];
+
+	for (i = 0; i != sizeof(data); i++)
+		data[i] = i;
+	memset(&cfg, 0, sizeof(cfg));
+	cfg.tx_opts = TLE_TCP_TX_OPT_CORK;
+
+	start();
+	stream = establish(&cfg, l_port);
+	ASSERT_NE(stream, nullptr);
+
+	ASSERT_EQ(tcp_io_write(stream, data, 100), 100);
+	EXPECT_EQ(tle_tcp_stream_flush(stream), 0);
+	n = tx_pkts(pkt, RTE_DIM(pkt));
+	ASSERT_EQ(n, 1U);
+	tcp_io_free(pkt, n);
+
+	/* three duplicate ACKs rewind the stream to the first segment */
+	for (i = 0; i != 3; i++)
+		ASSERT_EQ(rx_pkt(l_port, TCP_IO_REMOTE_SEQ, TCP_IO_LOCAL_SEQ,
+			RTE_TCP_ACK_FLAG, NULL, 0), 1U);
+
+	/* new data must not be merged into already sent segment */
+	ASSERT_EQ(tcp_io_write(stream, data + 100, 50), 50);
+
+	n = tx_pkts(pkt, RTE_DIM(pkt));
+	ASSERT_EQ(n, 1U);
+	EXPECT_EQ(tcp_io_seq(pkt[0]), (uint32_t)TCP_IO_LOCAL_SEQ);
+	EXPECT_EQ(tcp_io_plen(pkt[0]), 100U);
+	EXPECT_EQ(tcp_io_data(pkt[0], rd, sizeof(rd)), 100U);
+	EXPECT_EQ(memcmp(rd, data, 100), 0);
+	EXPECT_TRUE(tcp_io_cksum_valid(pkt[0]));
+	tcp_io_free(pkt, n);
+
+	/* the new segment stays corked till flush */
+	EXPECT_EQ(tle_tcp_stream_flush(stream), 0);
+	n = tx_pkts(pkt, RTE_DIM(pkt));
+	ASSERT_EQ(n, 1U);
+	EXPECT_EQ(tcp_io_seq(pkt[0]), TCP_IO_LOCAL_SEQ + 100);
+	EXPECT_EQ(tcp_io_plen(pkt[0]), 50U);
+	EXPECT_EQ(tcp_io_data(pkt[0], rd, sizeof(rd)), 50U);
+	EXPECT_EQ(memcmp(rd, data + 100, 50), 0);
+	EXPECT_TRUE(tcp_io_cksum_valid(pkt[0]));
+	tcp_io_free(pkt, n);
+}
+
+/* returns window advertised by the last segment sent from *port*. */
+static int32_t
+tcp_io_last_wnd(struct rte_mbuf *pkt[], uint32_t num, uint16_t port)
+{
+	int32_t wnd;
+	uint32_t i;
+	const struct rte_tcp_hdr *th;
+
+	wnd = -1;
+	for (i = 0; i != num; i++) {
+		th = tcp_io_hdr(pkt[i]);
+		if (th->src_port == htons(port))
+			wnd = rte_be_to_cpu_16(th->rx_win);
+	}
+	return wnd;
+}
+
+TEST_F(test_tle_tcp_stream_io, tcp_stream_splice_wnd)
+{
+	int32_t full, wnd;
+	uint32_t n, seq;
+	uint16_t iport, oport;
+	uint8_t data[0x100];
+	struct tle_stream *si, *so;
+	struct rte_mbuf *pkt[TCP_IO_BURST];
+
+	memset(data, 's', sizeof(data));
+
+	/* small send buffer, so the output side limits the input one */
+	ctx_prm.max_stream_sbufs = 4;
+	start();
+
+	iport = l_port;
+	oport = l_port + 1;
+	si = establish(NULL, iport);
+	ASSERT_NE(si, nullptr);
+	so = establish(NULL, oport);
+	ASSERT_NE(so, nullptr);
+
+	seq = TCP_IO_REMOTE_SEQ;
+	ASSERT_EQ(rx_pkt(iport, seq, TCP_IO_LOCAL_SEQ, RTE_TCP_ACK_FLAG,
+		data, 100), 1U);
+	seq += 100;
+	n = tx_pkts(pkt, RTE_DIM(pkt));
+	full = tcp_io_last_wnd(pkt, n, iport);
+	tcp_io_free(pkt, n);
+	ASSERT_GT(full, 0);
+
+	/* window of the input stream now follows the output one */
+	EXPECT_EQ(tle_tcp_stream_splice(si, so), 100);
+	ASSERT_EQ(rx_pkt(iport, seq, TCP_IO_LOCAL_SEQ, RTE_TCP_ACK_FLAG,
+		data, 100), 1U);
+	seq += 100;
+	n = tx_pkts(pkt, RTE_DIM(pkt));
+	wnd = tcp_io_last_wnd(pkt, n, iport);
+	tcp_io_free(pkt, n);
+	EXPECT_GT(wnd, 0);
+	EXPECT_LT(wnd, full);
+
+	EXPECT_EQ(tle_tcp_stream_splice(si, so), 100);
+	n = tx_pkts(pkt, RTE_DIM(pkt));
+	tcp_io_free(pkt, n);
+
+	/* data is still in flight, the limit stays */
+	EXPECT_EQ(tle_tcp_stream_splice(si, so), 0);
+	ASSERT_EQ(rx_pkt(iport, seq, TCP_IO_LOCAL_SEQ, RTE_TCP_ACK_FLAG,
+		data, 100), 1U);
+	seq += 100;
+	n = tx_pkts(pkt, RTE_DIM(pkt));
+	wnd = tcp_io_last_wnd(pkt, n, iport);
+	tcp_io_free(pkt, n);
+	EXPECT_LT(wnd, full);
+	EXPECT_EQ(tle_tcp_stream_splice(si, so), 100);
+
+	/* output peer acknowledges everything */
+	n = tx_pkts(pkt, RTE_DIM(pkt));
+	tcp_io_free(pkt, n);
+	ASSERT_EQ(rx_pkt(oport, TCP_IO_REMOTE_SEQ, TCP_IO_LOCAL_SEQ + 300,
+		RTE_TCP_ACK_FLAG, NULL, 0), 1U);
+	n = tx_pkts(pkt, RTE_DIM(pkt));
+	tcp_io_free(pkt, n);
+
+	/* all spliced data is consumed, full window is advertised again */
+	EXPECT_EQ(tle_tcp_stream_splice(si, so), 0);
+	ASSERT_EQ(rx_pkt(iport, seq, TCP_IO_LOCAL_SEQ, RTE_TCP_ACK_FLAG,
+		data, 100), 1U);
+	n = tx_pkts(pkt, RTE_DIM(pkt));
+	wnd = tcp_io_last_wnd(pkt, n, iport);
+	tcp_io_free(pkt, n);
+	EXPECT_EQ(wnd, full);
+}
+
+TEST_F(test_tle_tcp_stream_io, tcp_stream_retransmit_cksum)
+{
+	uint32_t i, n;
+	uint8_t data[0x100], rd[0x100];
+	struct rte_mbuf *pkt[TCP_IO_BURST];
+
+	for (i = 0; i != sizeof(data); i++)
+		data[i] = ~i;
+
+	start();
+	stream = establish(NULL, l_port);
+	ASSERT_NE(stream, nullptr);
+
+	ASSERT_EQ(tcp_io_write(stream, data, 100), 100);
+	n = tx_pkts(pkt, RTE_DIM(pkt));
+	ASSERT_EQ(n, 1U);
+	EXPECT_EQ(rte_be_to_cpu_32(tcp_io_hdr(pkt[0])->recv_ack),
+		(uint32_t)TCP_IO_REMOTE_SEQ);
+	EXPECT_TRUE(tcp_io_cksum_valid(pkt[0]));
+	tcp_io_free(pkt, n);
+
+	/* peer sends some data, so ACK field of retransmission changes */
+	ASSERT_EQ(rx_pkt(l_port, TCP_IO_REMOTE_SEQ, TCP_IO_LOCAL_SEQ,
+		RTE_TCP_ACK_FLAG, data, 10), 1U);
+	n = tx_pkts(pkt, RTE_DIM(pkt));
+	tcp_io_free(pkt, n);
+
+	for (i = 0; i != 3; i++)
+		ASSERT_EQ(rx_pkt(l_port, TCP_IO_REMOTE_SEQ + 10,
+			TCP_IO_LOCAL_SEQ, RTE_TCP_ACK_FLAG, NULL, 0), 1U);
+
+	/* checksum of the retransmission is adjusted, not stale */
+	n = tx_pkts(pkt, RTE_DIM(pkt));
+	ASSERT_EQ(n, 1U);
+	EXPECT_EQ(tcp_io_seq(pkt[0]), (uint32_t)TCP_IO_LOCAL_SEQ);
+	EXPECT_EQ(rte_be_to_cpu_32(tcp_io_hdr(pkt[0])->recv_ack),
+		TCP_IO_REMOTE_SEQ + 10);
+	EXPECT_EQ(tcp_io_data(pkt[0], rd, sizeof(rd)), 100U);
+	EXPECT_EQ(memcmp(rd, data, 100), 0);
+	EXPECT_TRUE(tcp_io_cksum_valid(pkt[0]));
+	tcp_io_free(pkt, n);
+}
+
+/*
+ * queue 3 full segments on each of two streams (first one is queued
+ * first), run tle_tcp_process() several times and return the order
+ * in which segments leave the device: 'a' or 'b' for each of them.
+ */
+static std::string
+tcp_io_tx_order(struct tle_ctx *ctx, struct tle_dev *dev,
+	struct tle_stream *sa, struct tle_stream *sb, uint16_t pa)
+{
+	uint32_t i, n;
+	std::string order;
+	uint8_t data[3 * TCP_IO_MSS];
+	struct rte_mbuf *pkt[TCP_IO_BURST];
+
+	memset(data, 'q', sizeof(data));
+
+	if (tcp_io_write(sa, data, sizeof(data)) != (ssize_t)sizeof(data) ||
+			tcp_io_write(sb, data, sizeof(data)) !=
+			(ssize_t)sizeof(data))
+		return order;
+
+	for (i = 0; i != 4; i++)
+		tle_tcp_process(ctx, MAX_STREAMS);
+
+	n = tle_tcp_tx_bulk(dev, pkt, RTE_DIM(pkt));
+	for (i = 0; i != n; i++) {
+		if (tcp_io_plen(pkt[i]) == 0)
+			continue;
+		order += (tcp_io_hdr(pkt[i])->src_port == htons(pa)) ?
+			'a' : 'b';
+	}
+	tcp_io_free(pkt, n);
+	return order;
+}
+
+TEST_F(test_tle_tcp_stream_io, tcp_stream_tx_quantum_none)
+{
+	struct tle_stream *sa, *sb;
+
+	start();
+	sa = establish(NULL, l_port);
+	ASSERT_NE(sa, nullptr);
+	sb = establish(NULL, l_port + 1);
+	ASSERT_NE(sb, nullptr);
+
+	/* no scheduler: first stream sends all it can */
+	EXPECT_EQ(tcp_io_tx_order(ctx, dev, sa, sb, l_port), "aaabbb");
+}
+
+TEST_F(test_tle_tcp_stream_io, tcp_stream_tx_quantum_drr)
+{
+	struct tle_stream *sa, *sb;
+
+	ctx_prm.tx_quantum = TCP_IO_MSS;
+	start();
+	sa = establish(NULL, l_port);
+	ASSERT_NE(sa, nullptr);
+	sb = establish(NULL, l_port + 1);
+	ASSERT_NE(sb, nullptr);
+
+	/* one MSS per stream per round */
+	EXPECT_EQ(tcp_io_tx_order(ctx, dev, sa, sb, l_port), "ababab");
+}
+
+TEST_F(test_tle_tcp_stream_io, tcp_stream_tx_quantum_weight)
+{
+	struct tle_stream *sa, *sb;
+	struct tle_tcp_stream_cfg cfg;
+
+	ctx_prm.tx_quantum = TCP_IO_MSS;
+	start();
+	sa = establish(NULL, l_port);
+	ASSERT_NE(sa, nullptr);
+
+	memset(&cfg, 0, sizeof(cfg));
+	cfg.tx_weight = 2;
+	sb = establish(&cfg, l_port + 1);
+	ASSERT_NE(sb, nullptr);
+
+	/* second stream gets twice as much per round */
+	EXPECT_EQ(tcp_io_tx_order(ctx, dev, sa, sb, l_port), "abbaba");
+}
+
+TEST_F(test_tle_tcp_stream_io, tcp_stream_rlim_throttle)
+{
+	uint32_t n;
+	uint8_t data[4 * TCP_IO_MSS];
+	struct rte_mbuf *pkt[TCP_IO_BURST];
+	struct tle_rlim *rl;
+	struct tle_rlim_param rprm;
+	struct tle_tcp_stream_cfg cfg;
+
+	/* half of MSS per bucket, refilled in 50ms */
+	memset(&rprm, 0, sizeof(rprm));
+	rprm.socket_id = SOCKET_ID_ANY;
+	rprm.rate = 10 * TCP_IO_MSS;
+	rprm.burst = TCP_IO_MSS / 2;
+	rl = tle_rlim_create(&rprm);
+	ASSERT_NE(rl, nullptr);
+
+	start();
+	memset(&cfg, 0, sizeof(cfg));
+	cfg.tx_rlim = rl;
+	stream = establish(&cfg, l_port);
+	ASSERT_NE(stream, nullptr);
+
+	memset(data, 'r', sizeof(data));
+	ASSERT_EQ(tcp_io_write(stream, data, sizeof(data)),
+		(ssize_t)sizeof(data));
+
+	/* one full segment goes, the rest waits for the bucket refill */
+	n = tx_pkts(pkt, RTE_DIM(pkt));
+	EXPECT_EQ(n, 1U);
+	tcp_io_free(pkt, n);
+
+	n = tx_pkts(pkt, RTE_DIM(pkt));
+	EXPECT_EQ(n, 0U);
+
+	/* debt is paid, stream is unparked and sends again */
+	rte_delay_ms(200);
+	n = tx_pkts(pkt, RTE_DIM(pkt));
+	EXPECT_EQ(n, 1U);
+	EXPECT_EQ(tcp_io_seq(pkt[0]),
+		(uint32_t)(TCP_IO_LOCAL_SEQ + TCP_IO_MSS));
+	tcp_io_free(pkt, n);
+
+	/* detach rate limiter from the stream before destroying it */
+	memset(&cfg, 0, sizeof(cfg));
+	EXPECT_EQ(tle_tcp_stream_update_cfg(&stream, &cfg, 1), 1U);
+	tle_rlim_destroy(rl);
+}
+
+/* counts segments sent from *port*, with and without payload. */
+static void
+tcp_io_count(struct rte_mbuf *pkt[], uint32_t num, uint16_t port,
+	uint32_t *nb_data, uint32_t *nb_ctl)
+{
+	uint32_t i;
+
+	*nb_data = 0;
+	*nb_ctl = 0;
+	for (i = 0; i != num; i++) {
+		if (tcp_io_hdr(pkt[i])->src_port != htons(port))
+			continue;
+		if (tcp_io_plen(pkt[i]) != 0)
+			(*nb_data)++;
+		else
+			(*nb_ctl)++;
+	}
+}
+
+TEST_F(test_tle_tcp_stream_io, tcp_stream_drb_starve)
+{
+	uint32_t n, nb_ctl, nb_data;
+	uint8_t data[8 * TCP_IO_MSS];
+	struct tle_stream *sa, *sb;
+	struct rte_mbuf *pkt[TCP_IO_BURST];
+
+	/* one segment per drb, 6 drbs for data, 2 kept for control. */
+	ctx_prm.send_bulk_size = 1;
+	ctx_prm.max_drbs = 8;
+	ctx_prm.icw = 10 * TCP_IO_MSS;
+	start();
+
+	sa = establish(NULL, l_port);
+	ASSERT_NE(sa, nullptr);
+	sb = establish(NULL, l_port + 1);
+	ASSERT_NE(sb, nullptr);
+
+	memset(data, 's', sizeof(data));
+	ASSERT_EQ(tcp_io_write(sa, data, sizeof(data)),
+		(ssize_t)sizeof(data));
+	ASSERT_EQ(tcp_io_write(sb, data, TCP_IO_MSS), (ssize_t)TCP_IO_MSS);
+
+	/* first stream takes all data drbs, second one has nothing out. */
+	tle_tcp_process(ctx, MAX_STREAMS);
+
+	/* out of order data still gets an immediate ACK. */
+	ASSERT_EQ(rx_pkt(l_port + 1, TCP_IO_REMOTE_SEQ + 10, TCP_IO_LOCAL_SEQ,
+		RTE_TCP_ACK_FLAG, data, 10), 1U);
+
+	n = tle_tcp_tx_bulk(dev, pkt, RTE_DIM(pkt));
+	tcp_io_count(pkt, n, l_port, &nb_data, &nb_ctl);
+	EXPECT_EQ(nb_data, 6U);
+	tcp_io_count(pkt, n, l_port + 1, &nb_data, &nb_ctl);
+	EXPECT_EQ(nb_data, 0U);
+	EXPECT_EQ(nb_ctl, 1U);
+	tcp_io_free(pkt, n);
+
+	/* drbs are back, starved stream retries without ACK or RTO. */
+	rte_delay_ms(2);
+	n = tx_pkts(pkt, RTE_DIM(pkt));
+	tcp_io_count(pkt, n, l_port, &nb_data, &nb_ctl);
+	EXPECT_EQ(nb_data, 2U);
+	tcp_io_count(pkt, n, l_port + 1, &nb_data, &nb_ctl);
+	EXPECT_EQ(nb_data, 1U);
+	tcp_io_free(pkt, n);
+}
+
+TEST_F(test_tle_tcp_stream_io, tcp_stream_pmtu_clamp)
+{
+	uint32_t i, n, sz;
+	uint8_t data[2 * TCP_IO_MSS];
+	struct rte_mbuf *pkt[TCP_IO_BURST];
+
+	/* destination MTU is smaller than peer MSS, no PMTU probing */
+	dst_mtu = TCP_IO_MTU - 500;
+	start();
+	stream = establish(NULL, l_port);
+	ASSERT_NE(stream, nullptr);
+
+	memset(data, 'p', sizeof(data));
+	ASSERT_EQ(tcp_io_write(stream, data, sizeof(data)),
+		(ssize_t)sizeof(data));
+
+	sz = 0;
+	n = tx_pkts(pkt, RTE_DIM(pkt));
+	ASSERT_NE(n, 0U);
+	for (i = 0; i != n; i++) {
+		EXPECT_LE(tcp_io_plen(pkt[i]), TCP_IO_MSS - 500U);
+		sz += tcp_io_plen(pkt[i]);
+	}
+	EXPECT_EQ(tcp_io_plen(pkt[0]), TCP_IO_MSS - 500U);
+	EXPECT_EQ(sz, sizeof(data));
+	tcp_io_free(pkt, n);
+}
+
+TEST_F(test_tle_tcp_stream_io, tcp_stream_pmtu_probe)
+{
+	uint32_t i, n, sz;
+	uint8_t data[3 * TCP_IO_MSS];
+	struct rte_mbuf *pkt[TCP_IO_BURST];
+	struct tle_stream *s;
+
+	/* probe up to peer MSS, starting from the smaller base MSS */
+	dst_mtu = TCP_IO_MTU - 500;
+	ctx_prm.pmtu_max = 9014;
+	start();
+	stream = establish(NULL, l_port);
+	ASSERT_NE(stream, nullptr);
+
+	memset(data, 'p', sizeof(data));
+	ASSERT_EQ(tcp_io_write(stream, data, sizeof(data)),
+		(ssize_t)sizeof(data));
+
+	/* one probe clamped by peer MSS, the rest is split to base MSS */
+	n = tx_pkts(pkt, RTE_DIM(pkt));
+	ASSERT_GT(n, 1U);
+	EXPECT_EQ(tcp_io_plen(pkt[0]), (uint32_t)TCP_IO_MSS);
+	EXPECT_TRUE(tcp_io_cksum_valid(pkt[0]));
+	sz = tcp_io_plen(pkt[0]);
+	for (i = 1; i != n; i++) {
+		EXPECT_LE(tcp_io_plen(pkt[i]), TCP_IO_MSS - 500U);
+		EXPECT_EQ(tcp_io_seq(pkt[i]), TCP_IO_LOCAL_SEQ + sz);
+		EXPECT_TRUE(tcp_io_cksum_valid(pkt[i]));
+		sz += tcp_io_plen(pkt[i]);
+	}
+	EXPECT_EQ(sz, sizeof(data));
+	tcp_io_free(pkt, n);
+
+	/* probe is acknowledged, MSS is raised */
+	ASSERT_EQ(rx_pkt(l_port, TCP_IO_REMOTE_SEQ, TCP_IO_LOCAL_SEQ + sz,
+		RTE_TCP_ACK_FLAG, NULL, 0), 1U);
+	n = tx_pkts(pkt, RTE_DIM(pkt));
+	tcp_io_free(pkt, n);
+
+	ASSERT_EQ(tcp_io_write(stream, data, sizeof(data)),
+		(ssize_t)sizeof(data));
+	n = tx_pkts(pkt, RTE_DIM(pkt));
+	ASSERT_EQ(n, 3U);
+	for (i = 0; i != n; i++)
+		EXPECT_EQ(tcp_io_plen(pkt[i]), (uint32_t)TCP_IO_MSS);
+	tcp_io_free(pkt, n);
+
+	/* new stream to the same destination starts with cached PMTU */
+	s = establish(NULL, l_port + 1);
+	ASSERT_NE(s, nullptr);
+	ASSERT_EQ(tcp_io_write(s, data, TCP_IO_MSS), TCP_IO_MSS);
+	n = tx_pkts(pkt, RTE_DIM(pkt));
+	ASSERT_EQ(n, 1U);
+	EXPECT_EQ(tcp_io_plen(pkt[0]), (uint32_t)TCP_IO_MSS);
+	tcp_io_free(pkt, n);
+}
+
+TEST_F(test_tle_tcp_stream_io, tcp_stream_frag_rx)
+{
+	uint32_t i, n;
+	ssize_t sz;
+	int32_t rc[3];
+	uint8_t data[1000], buf[2 * sizeof(data)];
+	struct iovec iov;
+	struct rte_mbuf *m, *frag[4], *pkt[3], *rp[3];
+
+	for (i = 0; i != sizeof(data); i++)
+		data[i] = i;
+
+	ctx_prm.frag_tbl_size = 0x10;
+	start();
+	stream = establish(NULL, l_port);
+	ASSERT_NE(stream, nullptr);
+
+	m = gen_pkt(l_port, TCP_IO_REMOTE_SEQ, TCP_IO_LOCAL_SEQ,
+		RTE_TCP_ACK_FLAG, data, sizeof(data));
+	ASSERT_NE(m, nullptr);
+	ASSERT_EQ(gen_ipv4_frags(m, frag, RTE_DIM(frag), 400), 3U);
+
+	/* fragments arrive out of order, TCP header is in the first one */
+	pkt[0] = frag[2];
+	pkt[1] = frag[0];
+	pkt[2] = frag[1];
+	n = tle_tcp_rx_bulk(dev, pkt, rp, rc, RTE_DIM(pkt));
+	tcp_io_free(rp, RTE_DIM(pkt) - n);
+	ASSERT_EQ(n, RTE_DIM(pkt));
+
+	iov.iov_base = buf;
+	iov.iov_len = sizeof(buf);
+	sz = tle_tcp_stream_readv(stream, &iov, 1);
+	ASSERT_EQ(sz, (ssize_t)sizeof(data));
+	EXPECT_EQ(memcmp(buf, data, sizeof(data)), 0);
+}
@@ -23,7 +23,10 @@
 #include <netdb.h>
 #include <gtest/gtest.h>
 #include <gmock/gmock.h>
+#include <string>
+#include <vector>
 #include <rte_errno.h>
+#include <rte_tcp.h>
 
 #include <tle_event.h>
 #include <tle_ctx.h>
@@ -252,4 +255,313 @@ public:
 	}
 };
 
+/*
+ * Fixture for the data path tests: streams are put straight into
+ * ESTABLISHED state with tle_tcp_stream_establish(), then the test
+ * plays the role of the remote peer by feeding hand-made segments
+ * into tle_tcp_rx_bulk() and inspecting what tle_tcp_tx_bulk() returns.
+ */
+
+#define TCP_IO_LOCAL_SEQ	0x10000
+#define TCP_IO_REMOTE_SEQ	0x80000
+#define TCP_IO_MSS		1460
+/* L2 MTU that gives TCP_IO_MSS, TX segments carry timestamp option */
+#define TCP_IO_MTU		(TCP_IO_MSS + sizeof(struct rte_ether_hdr) + \
+	sizeof(struct rte_ipv4_hdr) + sizeof(struct rte_tcp_hdr) + 12)
+#define TCP_IO_WND		UINT16_MAX
+#define TCP_IO_BURST		0x40
+
+static inline struct rte_tcp_hdr *
+tcp_io_hdr(const struct rte_mbuf *m)
+{
+	return rte_pktmbuf_mtod_offset(m, struct rte_tcp_hdr *,
+		m->l2_len + m->l3_len);
+}
+
+static inline uint32_t
+tcp_io_seq(const struct rte_mbuf *m)
+{
+	return rte_be_to_cpu_32(tcp_io_hdr(m)->sent_seq);
+}
+
+static inline uint32_t
+tcp_io_plen(const struct rte_mbuf *m)
+{
+	uint32_t l4;
+
+	l4 = (tcp_io_hdr(m)->data_off >> 4) * 4;
+	return m->pkt_len - m->l2_len - m->l3_len - l4;
+}
+
+/* copies up to *len* payload bytes of the segment into *buf*. */
+static inline uint32_t
+tcp_io_data(const struct rte_mbuf *m, void *buf, uint32_t len)
+{
+	uint32_t l4, n, ofs;
+	const void *p;
+
+	l4 = (tcp_io_hdr(m)->data_off >> 4) * 4;
+	ofs = m->l2_len + m->l3_len + l4;
+	n = RTE_MIN(len, m->pkt_len - ofs);
+	p = rte_pktmbuf_read(m, ofs, n, buf);
+	if (p != buf)
+		memcpy(buf, p, n);
+	return n;
+}
+
+/* checks both IPv4 header and TCP checksums of an outgoing segment. */
+static inline int
+tcp_io_cksum_valid(const struct rte_mbuf *m)
+{
+	uint16_t cs;
+	uint32_t ofs, sum;
+	const struct rte_ipv4_hdr *ip4h;
+
+	ip4h = rte_pktmbuf_mtod_offset(m, const struct rte_ipv4_hdr *,
+		m->l2_len);
+	if (rte_raw_cksum(ip4h, m->l3_len) != 0xffff)
+		return 0;
+
+	ofs = m->l2_len + m->l3_len;
+	if (rte_raw_cksum_mbuf(m, ofs, m->pkt_len - ofs, &cs) != 0)
+		return 0;
+
+	sum = cs + rte_ipv4_phdr_cksum(ip4h, 0);
+	sum = (sum & 0xffff) + (sum >> 16);
+	sum = (sum & 0xffff) + (sum >> 16);
+	return sum == 0xffff;
+}
+
+static inline void
+tcp_io_free(struct rte_mbuf *pkt[], uint32_t num)
+{
+	uint32_t i;
+
+	for (i = 0; i != num; i++)
+		rte_pktmbuf_free(pkt[i]);
+}
+
+class test_tle_tcp_stream_io: public ::test_tle_tcp_stream {
+public:
+	static int lookup4(void *opaque, uint64_t sdata,
+		const struct in_addr *addr, struct tle_dest *res);
+
+	/* creates ctx and dev, after the test adjusted ctx_prm/dev_prm. */
+	void start(void);
+	struct tle_stream *establish(const struct tle_tcp_stream_cfg *cfg,
+		uint16_t port);
+	struct rte_mbuf *gen_pkt(uint16_t port, uint32_t seq, uint32_t ack,
+		uint8_t flags, const void *data, uint32_t len);
+	uint32_t rx_pkt(uint16_t port, uint32_t seq, uint32_t ack,
+		uint8_t flags, const void *data, uint32_t len);
+	uint32_t tx_pkts(struct rte_mbuf *pkt[], uint32_t num);
+
+protected:
+	virtual void SetUp(void)
+	{
+		ipv4_laddr = "192.0.0.1";
+		ipv4_raddr = "192.0.0.2";
+		ipv6_laddr = "2001::1000";
+		ipv6_raddr = "2001::2000";
+		l_port = 10000;
+		r_port = 10000;
+
+		memset(&ctx_prm, 0, sizeof(ctx_prm));
+		memset(&dev_prm, 0, sizeof(dev_prm));
+		memset(&stream_prm, 0, sizeof(stream_prm));
+
+		ctx_prm = ctx_prm_tmpl;
+		ctx_prm.lookup4 = lookup4;
+		ctx_prm.lookup4_data = this;
+		ctx_prm.lookup6 = dummy_lookup6;
+		dev_prm = dev_prm_tmpl;
+		setup_dev_prm(&dev_prm, ipv4_laddr, ipv6_laddr);
+		ret = setup_stream_prm(&stream_prm, ipv4_laddr, ipv4_raddr,
+			l_port, r_port);
+		ASSERT_EQ(ret, 0);
+
+		ctx = NULL;
+		dev = NULL;
+		dst_mtu = TCP_IO_MTU;
+		nb_lookup = 0;
+	}
+
+	virtual void TearDown(void)
+	{
+		uint32_t i, n;
+		struct rte_mbuf *pkt[TCP_IO_BURST];
+
+		for (i = 0; i != streams.size(); i++)
+			tle_tcp_stream_abort(streams[i]);
+		streams.clear();
+
+		if (ctx != NULL) {
+			do {
+				n = tx_pkts(pkt, RTE_DIM(pkt));
+				tcp_io_free(pkt, n);
+			} while (n != 0);
+			tle_del_dev(dev);
+			tle_ctx_destroy(ctx);
+		}
+	}
+
+	std::vector<struct tle_stream *> streams;
+	uint32_t dst_mtu;
+	uint32_t nb_lookup;
+};
+
+int
+test_tle_tcp_stream_io::lookup4(void *opaque, uint64_t sdata,
+	const struct in_addr *addr, struct tle_dest *res)
+{
+	struct rte_ether_hdr *eth;
+	struct rte_ipv4_hdr *ip4h;
+	test_tle_tcp_stream_io *t;
+
+	RTE_SET_USED(sdata);
+	RTE_SET_USED(addr);
+
+	t = (test_tle_tcp_stream_io *)opaque;
+	t->nb_lookup++;
+
+	res->dev = t->dev;
+	res->mtu = t->dst_mtu;
+	res->l2_len = sizeof(*eth);
+	res->l3_len = sizeof(*ip4h);
+	res->head_mp = mbuf_pool;
+
+	eth = (struct rte_ether_hdr *)res->hdr;
+	memset(eth, 0, sizeof(*eth));
+	eth->ether_type = rte_cpu_to_be_16(RTE_ETHER_TYPE_IPV4);
+
+	ip4h = (struct rte_ipv4_hdr *)(eth + 1);
+	memset(ip4h, 0, sizeof(*ip4h));
+	ip4h->version_ihl = 4 << 4 | sizeof(*ip4h) / RTE_IPV4_IHL_MULTIPLIER;
+	ip4h->time_to_live = 64;
+	ip4h->next_proto_id = IPPROTO_TCP;
+	return 0;
+}
+
+void
+test_tle_tcp_stream_io::start(void)
+{
+	ctx = tle_ctx_create(&ctx_prm);
+	ASSERT_NE(ctx, (void *)NULL);
+	dev = tle_add_dev(ctx, &dev_prm);
+	ASSERT_NE(dev, (void *)NULL);
+}
+
+struct tle_stream *
+test_tle_tcp_stream_io::establish(const struct tle_tcp_stream_cfg *cfg,
+	uint16_t port)
+{
+	struct tle_stream *s;
+	struct tle_tcp_stream_param prm;
+	struct tle_tcp_conn_info ci;
+
+	prm = stream_prm;
+	((struct sockaddr_in *)&prm.addr.local)->sin_port = htons(port);
+	if (cfg != NULL)
+		prm.cfg = *cfg;
+
+	memset(&ci, 0, sizeof(ci));
+	ci.seq = TCP_IO_LOCAL_SEQ;
+	ci.ack = TCP_IO_REMOTE_SEQ;
+	ci.wnd = TCP_IO_WND;
+	ci.so.mss = TCP_IO_MSS;
+
+	s = tle_tcp_stream_establish(ctx, &prm, &ci, 0);
+	if (s != NULL)
+		streams.push_back(s);
+	return s;
+}
+
+/* builds a segment the remote peer sends to the local *port*. */
+struct rte_mbuf *
+test_tle_tcp_stream_io::gen_pkt(uint16_t port, uint32_t seq, uint32_t ack,
+	uint8_t flags, const void *data, uint32_t len)
+{
+	uint32_t l2, l3, l4;
+	struct rte_mbuf *m;
+	struct rte_ether_hdr *eth;
+	struct rte_ipv4_hdr *ip4h;
+	struct rte_tcp_hdr *th;
+
+	l2 = sizeof(*eth);
+	l3 = sizeof(*ip4h);
+	l4 = sizeof(*th);
+
+	m = rte_pktmbuf_alloc(mbuf_pool);
+	if (m == NULL)
+		return NULL;
+
+	eth = (struct rte_ether_hdr *)rte_pktmbuf_append(m, l2 + l3 + l4 + len);
+	if (eth == NULL) {
+		rte_pktmbuf_free(m);
+		return NULL;
+	}
+
+	memset(eth, 0, l2);
+	eth->ether_type = rte_cpu_to_be_16(RTE_ETHER_TYPE_IPV4);
+
+	ip4h = (struct rte_ipv4_hdr *)(eth + 1);
+	memset(ip4h, 0, l3);
+	ip4h->version_ihl = 4 << 4 | l3 / RTE_IPV4_IHL_MULTIPLIER;
+	ip4h->total_length = rte_cpu_to_be_16(l3 + l4 + len);
+	ip4h->time_to_live = 64;
+	ip4h->next_proto_id = IPPROTO_TCP;
+	inet_pton(AF_INET, ipv4_raddr, &ip4h->src_addr);
+	inet_pton(AF_INET, ipv4_laddr, &ip4h->dst_addr);
+
+	th = (struct rte_tcp_hdr *)(ip4h + 1);
+	memset(th, 0, l4);
+	th->src_port = htons(r_port);
+	th->dst_port = htons(port);
+	th->sent_seq = rte_cpu_to_be_32(seq);
+	th->recv_ack = rte_cpu_to_be_32(ack);
+	th->data_off = l4 / 4 << 4;
+	th->tcp_flags = flags;
+	th->rx_win = rte_cpu_to_be_16(TCP_IO_WND);
+	if (len != 0)
+		memcpy(th + 1, data, len);
+
+	th->cksum = rte_ipv4_udptcp_cksum(ip4h, th);
+	ip4h->hdr_checksum = rte_ipv4_cksum(ip4h);
+
+	m->packet_type = RTE_PTYPE_L2_ETHER | RTE_PTYPE_L3_IPV4 |
+		RTE_PTYPE_L4_TCP;
+	m->ol_flags = RTE_MBUF_F_RX_IP_CKSUM_GOOD | RTE_MBUF_F_RX_L4_CKSUM_GOOD;
+	m->l2_len = l2;
+	m->l3_len = l3;
+	m->l4_len = l4;
+	return m;
+}
+
+/* returns number of segments accepted by the stack (0 or 1). */
+uint32_t
+test_tle_tcp_stream_io::rx_pkt(uint16_t port, uint32_t seq, uint32_t ack,
+	uint8_t flags, const void *data, uint32_t len)
+{
+	uint32_t n;
+	int32_t rc[1];
+	struct rte_mbuf *m, *rp[1];
+
+	m = gen_pkt(port, seq, ack, flags, data, len);
+	if (m == NULL)
+		return 0;
+
+	n = tle_tcp_rx_bulk(dev, &m, rp, rc, 1);
+	if (n == 0)
+		rte_pktmbuf_free(rp[0]);
+	return n;
+}
+
+/* runs the TCP state machine and collects segments it wants to send. */
+uint32_t
+test_tle_tcp_stream_io::tx_pkts(struct rte_mbuf *pkt[], uint32_t num)
+{
+	tle_tcp_process(ctx, MAX_STREAMS);
+	return tle_tcp_tx_bulk(dev, pkt, num);
+}
+
 #endif /* TEST_TLE_TCP_STREAM_H_ */
@@ -14,6 +14,8 @@
  */
 
 #include "test_tle_udp_event.h"
+#include <vector>
+#include <poll.h>
 
 TEST_F(udp_evq, udp_evq_create_null)
 {
@@ -193,3 +195,192 @@ TEST_F(udp_event, udp_event_get)
 	EXPECT_EQ(tle_evq_get(evq, evd, max_events), max_events);
 	free(evd);
 }
+
+TEST_F(udp_evq, udp_evq_create_invalid_flags)
+{
+	evq_params.flags = UINT32_MAX;
+	evq = tle_evq_create(&evq_params);
+	EXPECT_EQ(evq, (struct tle_evq *) NULL);
+	EXPECT_EQ(rte_errno, EINVAL);
+}
+
+TEST_F(udp_evq, udp_evq_lockfree_get)
+{
+	uint32_t i;
+	std::vector<int> data(max_events);
+	std::vector<const void *> evd(max_events);
+	std::vector<struct tle_event *> ev(max_events);
+
+	evq_params.flags = TLE_EVQ_F_LOCKFREE;
+	evq = tle_evq_create(&evq_params);
+	ASSERT_NE(evq, (struct tle_evq *) NULL);
+
+	for (i = 0; i != max_events; i++) {
+		ev[i] = tle_event_alloc(evq, &data[i]);
+		ASSERT_NE(ev[i], (struct tle_event *) NULL);
+		tle_event_active(ev[i], TLE_SEV_DOWN);
+		EXPECT_EQ(tle_event_state(ev[i]), TLE_SEV_DOWN);
+	}
+
+	/* raise all, but move the first one back down before get. */
+	for (i = 0; i != max_events; i++) {
+		tle_event_raise(ev[i]);
+		tle_event_raise(ev[i]);
+		EXPECT_EQ(tle_event_state(ev[i]), TLE_SEV_UP);
+	}
+	tle_event_down(ev[0]);
+	EXPECT_EQ(tle_event_state(ev[0]), TLE_SEV_DOWN);
+
+	EXPECT_EQ(tle_evq_get(evq, evd.data(), max_events), max_events - 1);
+	for (i = 1; i != max_events; i++) {
+		EXPECT_EQ(evd[i - 1], &data[i]);
+		EXPECT_EQ(tle_event_state(ev[i]), TLE_SEV_DOWN);
+	}
+	EXPECT_EQ(tle_evq_get(evq, evd.data(), max_events), 0);
+
+	/* stale ring entry must not prevent the event to be raised again. */
+	tle_event_raise(ev[0]);
+	EXPECT_EQ(tle_evq_get(evq, evd.data(), max_events), 1);
+	EXPECT_EQ(evd[0], &data[0]);
+
+	for (i = 0; i != max_events; i++)
+		tle_event_free(ev[i]);
+	EXPECT_EQ(evq->nb_free, max_events);
+	tle_evq_destroy(evq);
+}
+
+TEST_F(udp_evq, udp_evq_raise_bulk)
+{
+	uint32_t i, n;
+	struct tle_evq *lfq;
+	std::vector<int> data(max_events);
+	std::vector<const void *> evd(max_events);
+	std::vector<struct tle_event *> ev(max_events);
+
+	evq = tle_evq_create(&evq_params);
+	ASSERT_NE(evq, (struct tle_evq *) NULL);
+	evq_params.flags = TLE_EVQ_F_LOCKFREE;
+	lfq = tle_evq_create(&evq_params);
+	ASSERT_NE(lfq, (struct tle_evq *) NULL);
+
+	/* interleave events of locked and lock-free queues. */
+	for (i = 0; i != max_events; i++) {
+		ev[i] = tle_event_alloc((i & 1) ? lfq : evq, &data[i]);
+		ASSERT_NE(ev[i], (struct tle_event *) NULL);
+		tle_event_active(ev[i], TLE_SEV_DOWN);
+	}
+
+	/* event not in DOWN state has to be left intact. */
+	tle_event_idle(ev[0]);
+
+	tle_event_raise_bulk(ev.data(), max_events);
+	for (i = 0; i != max_events; i++)
+		EXPECT_EQ(tle_event_state(ev[i]),
+			(ev[i]->data == &data[0]) ? TLE_SEV_IDLE : TLE_SEV_UP);
+
+	n = tle_evq_get(evq, evd.data(), max_events);
+	EXPECT_EQ(n, (max_events - 1) / 2);
+	n = tle_evq_get(lfq, evd.data(), max_events);
+	EXPECT_EQ(n, max_events / 2);
+
+	for (i = 0; i != max_events; i++)
+		tle_event_free(ev[i]);
+	tle_evq_destroy(lfq);
+	tle_evq_destroy(evq);
+}
+
+TEST_F(udp_evq, udp_evq_wait)
+{
+	int fd;
+	int32_t rc;
+	const void *evd[1];
+	struct pollfd pfd;
+	struct tle_event *ev;
+
+	/* queue without eventfd can't be waited on. */
+	evq = tle_evq_create(&evq_params);
+	ASSERT_NE(evq, (struct tle_evq *) NULL);
+	EXPECT_EQ(tle_evq_fd(evq), -1);
+	EXPECT_EQ(tle_evq_wait(evq, evd, RTE_DIM(evd), 0), -EINVAL);
+	tle_evq_destroy(evq);
+
+	evq_params.flags = TLE_EVQ_F_WAIT;
+	evq = tle_evq_create(&evq_params);
+	ASSERT_NE(evq, (struct tle_evq *) NULL);
+	fd = tle_evq_fd(evq);
+	ASSERT_GE(fd, 0);
+
+	ev = tle_event_alloc(evq, &fd);
+	ASSERT_NE(ev, (struct tle_event *) NULL);
+	tle_event_active(ev, TLE_SEV_DOWN);
+
+	pfd.fd = fd;
+	pfd.events = POLLIN;
+
+	/* empty queue: times out, eventfd is not readable. */
+	EXPECT_EQ(tle_evq_wait(evq, evd, RTE_DIM(evd), 0), 0);
+	EXPECT_EQ(tle_evq_wait(evq, evd, RTE_DIM(evd), 1), 0);
+	EXPECT_EQ(poll(&pfd, 1, 0), 0);
+
+	/* raise makes eventfd readable, wait retrieves the event. */
+	tle_event_raise(ev);
+	EXPECT_EQ(poll(&pfd, 1, 0), 1);
+	rc = tle_evq_wait(evq, evd, RTE_DIM(evd), -1);
+	EXPECT_EQ(rc, 1);
+	EXPECT_EQ(evd[0], &fd);
+
+	/* queue is empty again, eventfd is rearmed. */
+	EXPECT_EQ(tle_evq_wait(evq, evd, RTE_DIM(evd), 0), 0);
+	EXPECT_EQ(poll(&pfd, 1, 0), 0);
+
+	tle_event_free(ev);
+	tle_evq_destroy(evq);
+}
+
+TEST_F(udp_evq, udp_evq_get_mask)
+{
+	uint32_t j;
+	int32_t n;
+	uint32_t msk[2];
+	const void *evd[2];
+	struct tle_event *ev;
+	static const uint32_t flags[] = {0, TLE_EVQ_F_LOCKFREE};
+
+	for (j = 0; j != RTE_DIM(flags); j++) {
+
+		evq_params.flags = flags[j];
+		evq = tle_evq_create(&evq_params);
+		ASSERT_NE(evq, (struct tle_evq *) NULL);
+
+		ev = tle_event_alloc(evq, &msk);
+		ASSERT_NE(ev, (struct tle_event *) NULL);
+		tle_event_active(ev, TLE_SEV_DOWN);
+
+		/* bits are accumulated while the event is UP. */
+		tle_event_raise_mask(ev, TLE_EV_IN);
+		tle_event_raise_mask(ev, TLE_EV_OUT);
+		EXPECT_EQ(tle_event_state(ev), TLE_SEV_UP);
+
+		n = tle_evq_get_mask(evq, evd, msk, RTE_DIM(evd));
+		EXPECT_EQ(n, 1);
+		EXPECT_EQ(evd[0], &msk);
+		EXPECT_EQ(msk[0], (uint32_t)(TLE_EV_IN | TLE_EV_OUT));
+		EXPECT_EQ(tle_event_state(ev), TLE_SEV_DOWN);
+
+		/* raise without readiness bits is not reported. */
+		tle_event_raise(ev);
+		EXPECT_EQ(tle_evq_get_mask(evq, evd, msk, RTE_DIM(evd)), 0);
+		EXPECT_EQ(tle_event_state(ev), TLE_SEV_DOWN);
+
+		/* plain get still works, mask is preserved till get_mask. */
+		tle_event_raise_mask(ev, TLE_EV_HUP);
+		EXPECT_EQ(tle_evq_get(evq, evd, RTE_DIM(evd)), 1);
+		tle_event_raise_mask(ev, TLE_EV_ERR);
+		n = tle_evq_get_mask(evq, evd, msk, RTE_DIM(evd));
+		EXPECT_EQ(n, 1);
+		EXPECT_EQ(msk[0], (uint32_t)(TLE_EV_HUP | TLE_EV_ERR));
+
+		tle_event_free(ev);
+		tle_evq_destroy(evq);
+	}
+}
@@ -0,0 +1,724 @@
+/*
+ * Copyright (c) 2016  Intel Corporation.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "test_tle_udp_io.h"
+
+TEST_F(test_tle_udp_io, udp_stream_gso)
+{
+	uint32_t i, n, ofs;
+	uint8_t data[1200], rd[sizeof(data)];
+	struct rte_mbuf *m, *pkt[UDP_IO_BURST];
+	struct tle_stream *s;
+	struct tle_udp_stream_param prm;
+	struct sockaddr_storage da;
+
+	for (i = 0; i != sizeof(data); i++)
+		data[i] = i;
+
+	start();
+	udp_io_addr(&da, raddr, r_port);
+
+	/* without GSO, datagram that fits into MTU is sent as it is */
+	fill_prm(&prm, l_port, NULL, 0);
+	s = open(&prm);
+	ASSERT_NE(s, nullptr);
+
+	m = gen_data(data, sizeof(data));
+	ASSERT_NE(m, nullptr);
+	ASSERT_EQ(tle_udp_stream_send(s, &m, 1,
+		(const struct sockaddr *)&da), 1U);
+
+	n = tx_pkts(pkt, RTE_DIM(pkt));
+	ASSERT_EQ(n, 1U);
+	EXPECT_EQ(udp_io_plen(pkt[0]), sizeof(data));
+	udp_io_free(pkt, n);
+
+	/* with GSO, the same packet is split into gso_size datagrams */
+	fill_prm(&prm, l_port + 1, NULL, 0);
+	prm.gso_size = 500;
+	s = open(&prm);
+	ASSERT_NE(s, nullptr);
+
+	m = gen_data(data, sizeof(data));
+	ASSERT_NE(m, nullptr);
+	ASSERT_EQ(tle_udp_stream_send(s, &m, 1,
+		(const struct sockaddr *)&da), 1U);
+
+	n = tx_pkts(pkt, RTE_DIM(pkt));
+	ASSERT_EQ(n, 3U);
+	for (i = 0, ofs = 0; i != n; i++) {
+		EXPECT_EQ(udp_io_plen(pkt[i]),
+			RTE_MIN((uint32_t)sizeof(data) - ofs, 500U));
+		EXPECT_EQ((uint32_t)rte_be_to_cpu_16(
+			udp_io_hdr(pkt[i])->dgram_len),
+			udp_io_plen(pkt[i]) + sizeof(struct rte_udp_hdr));
+		EXPECT_EQ(udp_io_hdr(pkt[i])->src_port, htons(l_port + 1));
+		EXPECT_EQ(udp_io_hdr(pkt[i])->dst_port, htons(r_port));
+		EXPECT_EQ(udp_io_ip4(pkt[i])->fragment_offset, 0);
+		EXPECT_TRUE(udp_io_cksum_valid(pkt[i]));
+		ofs += udp_io_data(pkt[i], rd + ofs, sizeof(rd) - ofs);
+	}
+	EXPECT_EQ(ofs, sizeof(data));
+	EXPECT_EQ(memcmp(rd, data, sizeof(data)), 0);
+	udp_io_free(pkt, n);
+}
+
+TEST_F(test_tle_udp_io, udp_stream_gro)
+{
+	uint32_t i, n;
+	uint8_t data[1700], rd[sizeof(data)];
+	struct rte_mbuf *pkt[UDP_IO_BURST];
+	struct tle_stream *sg, *sp;
+	struct tle_udp_stream_param prm;
+
+	static const uint32_t len[] = {500, 500, 500, 200};
+
+	for (i = 0; i != sizeof(data); i++)
+		data[i] = i * 3;
+
+	start();
+
+	fill_prm(&prm, l_port, NULL, 0);
+	prm.rx_opts = TLE_UDP_RX_OPT_GRO;
+	sg = open(&prm);
+	ASSERT_NE(sg, nullptr);
+
+	fill_prm(&prm, l_port + 1, NULL, 0);
+	sp = open(&prm);
+	ASSERT_NE(sp, nullptr);
+
+	/* same flow to both streams, only GRO one merges datagrams */
+	for (i = 0, n = 0; i != RTE_DIM(len); n += len[i], i++) {
+		pkt[i] = gen_pkt(raddr, r_port, l_port, data + n, len[i]);
+		ASSERT_NE(pkt[i], nullptr);
+		pkt[i + RTE_DIM(len)] = gen_pkt(raddr, r_port, l_port + 1,
+			data + n, len[i]);
+		ASSERT_NE(pkt[i + RTE_DIM(len)], nullptr);
+	}
+	ASSERT_EQ(rx_pkts(pkt, 2 * RTE_DIM(len)), 2 * RTE_DIM(len));
+
+	n = tle_udp_stream_recv(sg, pkt, RTE_DIM(pkt));
+	ASSERT_EQ(n, 1U);
+	EXPECT_EQ(pkt[0]->nb_segs, RTE_DIM(len));
+	EXPECT_EQ((uint32_t)pkt[0]->tso_segsz, len[0]);
+	ASSERT_EQ(pkt[0]->pkt_len, sizeof(data));
+	EXPECT_EQ(memcmp(rte_pktmbuf_read(pkt[0], 0, sizeof(rd), rd), data,
+		sizeof(data)), 0);
+	udp_io_free(pkt, n);
+
+	n = tle_udp_stream_recv(sp, pkt, RTE_DIM(pkt));
+	ASSERT_EQ(n, RTE_DIM(len));
+	for (i = 0; i != n; i++) {
+		EXPECT_EQ(pkt[i]->nb_segs, 1);
+		EXPECT_EQ(pkt[i]->pkt_len, len[i]);
+	}
+	udp_io_free(pkt, n);
+}
+
+TEST_F(test_tle_udp_io, udp_stream_gro_flows)
+{
+	uint32_t n;
+	uint8_t data[500];
+	struct rte_mbuf *pkt[UDP_IO_BURST];
+	struct tle_stream *s;
+	struct tle_udp_stream_param prm;
+
+	memset(data, 'g', sizeof(data));
+	start();
+
+	fill_prm(&prm, l_port, NULL, 0);
+	prm.rx_opts = TLE_UDP_RX_OPT_GRO;
+	s = open(&prm);
+	ASSERT_NE(s, nullptr);
+
+	/*
+	 * datagram of another flow, or bigger datagram
+	 * terminate the sequence.
+	 */
+	pkt[0] = gen_pkt(raddr, r_port, l_port, data, 400);
+	pkt[1] = gen_pkt(raddr, r_port, l_port, data, 400);
+	pkt[2] = gen_pkt(raddr, r_port + 1, l_port, data, 400);
+	pkt[3] = gen_pkt(raddr, r_port, l_port, data, 400);
+	pkt[4] = gen_pkt(raddr, r_port, l_port, data, 500);
+	for (n = 0; n != 5; n++)
+		ASSERT_NE(pkt[n], nullptr);
+	ASSERT_EQ(rx_pkts(pkt, 5), 5U);
+
+	n = tle_udp_stream_recv(s, pkt, RTE_DIM(pkt));
+	ASSERT_EQ(n, 4U);
+	EXPECT_EQ(pkt[0]->nb_segs, 2);
+	EXPECT_EQ((uint32_t)pkt[0]->tso_segsz, 400U);
+	EXPECT_EQ(pkt[0]->pkt_len, 800U);
+	EXPECT_EQ((uint32_t)pkt[1]->tso_segsz, 0U);
+	EXPECT_EQ((uint32_t)pkt[2]->tso_segsz, 0U);
+	EXPECT_EQ((uint32_t)pkt[3]->tso_segsz, 0U);
+	EXPECT_EQ(pkt[3]->pkt_len, sizeof(data));
+	udp_io_free(pkt, n);
+}
+
+TEST_F(test_tle_udp_io, udp_stream_dst_cache)
+{
+	uint32_t n;
+	uint8_t data[0x10];
+	struct rte_mbuf *pkt[UDP_IO_BURST];
+	struct tle_stream *s;
+	struct tle_udp_stream_param prm;
+
+	memset(data, 'd', sizeof(data));
+	ctx_prm.dst_cache_size = 0x40;
+	start();
+
+	fill_prm(&prm, l_port, NULL, 0);
+	s = open(&prm);
+	ASSERT_NE(s, nullptr);
+
+	/* miss: route lookup is invoked */
+	ASSERT_EQ(send(s, raddr, r_port, data, sizeof(data)), 1U);
+	EXPECT_EQ(nb_lookup, 1U);
+
+	/* hit: cached destination is used, for any remote port */
+	ASSERT_EQ(send(s, raddr, r_port, data, sizeof(data)), 1U);
+	ASSERT_EQ(send(s, raddr, r_port + 1, data, sizeof(data)), 1U);
+	EXPECT_EQ(nb_lookup, 1U);
+
+	/* another remote address */
+	ASSERT_EQ(send(s, "192.0.0.3", r_port, data, sizeof(data)), 1U);
+	EXPECT_EQ(nb_lookup, 2U);
+
+	/* all cached entries become stale */
+	tle_ctx_invalidate(ctx);
+	ASSERT_EQ(send(s, raddr, r_port, data, sizeof(data)), 1U);
+	ASSERT_EQ(send(s, "192.0.0.3", r_port, data, sizeof(data)), 1U);
+	EXPECT_EQ(nb_lookup, 4U);
+	ASSERT_EQ(send(s, raddr, r_port, data, sizeof(data)), 1U);
+	EXPECT_EQ(nb_lookup, 4U);
+
+	/* cached destination is as good as the looked up one */
+	n = tx_pkts(pkt, RTE_DIM(pkt));
+	ASSERT_EQ(n, 7U);
+	EXPECT_EQ(udp_io_ip4(pkt[0])->dst_addr, udp_io_ip4(pkt[1])->dst_addr);
+	EXPECT_EQ(udp_io_ip4(pkt[0])->src_addr, udp_io_ip4(pkt[1])->src_addr);
+	EXPECT_NE(udp_io_ip4(pkt[0])->dst_addr, udp_io_ip4(pkt[3])->dst_addr);
+	EXPECT_TRUE(udp_io_cksum_valid(pkt[1]));
+	udp_io_free(pkt, n);
+}
+
+TEST_F(test_tle_udp_io, udp_stream_send_multi)
+{
+	uint32_t i, n;
+	uint8_t data[0x10];
+	struct rte_mbuf *m[6], *pkt[UDP_IO_BURST];
+	struct tle_stream *s;
+	struct tle_udp_stream_param prm;
+	struct sockaddr_storage da[3];
+	const struct sockaddr *pda[RTE_DIM(m)];
+
+	static const uint8_t dst[RTE_DIM(m)] = {0, 1, 0, 2, 1, 0};
+	static const char * const addr[RTE_DIM(da)] = {
+		"192.0.0.2", "192.0.0.3", "192.0.0.4",
+	};
+
+	memset(data, 'm', sizeof(data));
+	start();
+
+	fill_prm(&prm, l_port, NULL, 0);
+	s = open(&prm);
+	ASSERT_NE(s, nullptr);
+
+	for (i = 0; i != RTE_DIM(da); i++)
+		udp_io_addr(da + i, addr[i], r_port + i);
+
+	for (i = 0; i != RTE_DIM(m); i++) {
+		data[0] = i;
+		m[i] = gen_data(data, sizeof(data));
+		ASSERT_NE(m[i], nullptr);
+		pda[i] = (const struct sockaddr *)(da + dst[i]);
+	}
+
+	/* one route lookup per unique destination, order is preserved */
+	EXPECT_EQ(tle_udp_stream_send_multi(s, m, RTE_DIM(m), pda),
+		RTE_DIM(m));
+	EXPECT_EQ(nb_lookup, RTE_DIM(da));
+
+	n = tx_pkts(pkt, RTE_DIM(pkt));
+	ASSERT_EQ(n, RTE_DIM(m));
+	for (i = 0; i != n; i++) {
+		EXPECT_EQ(udp_io_ip4(pkt[i])->dst_addr,
+			inet_addr(addr[dst[i]]));
+		EXPECT_EQ(udp_io_hdr(pkt[i])->dst_port,
+			htons(r_port + dst[i]));
+		EXPECT_EQ(udp_io_hdr(pkt[i])->src_port, htons(l_port));
+		EXPECT_EQ(rte_pktmbuf_mtod_offset(pkt[i], uint8_t *,
+			pkt[i]->pkt_len - sizeof(data))[0], i);
+		EXPECT_TRUE(udp_io_cksum_valid(pkt[i]));
+	}
+	udp_io_free(pkt, n);
+}
+
+TEST_F(test_tle_udp_io, udp_stream_send_multi_partial)
+{
+	uint32_t i, n;
+	uint8_t data[0x10];
+	struct rte_mbuf *m[4], *pkt[UDP_IO_BURST];
+	struct tle_stream *s;
+	struct tle_udp_stream_param prm;
+	struct sockaddr_storage da[2];
+	struct sockaddr_in6 d6;
+	const struct sockaddr *pda[RTE_DIM(m)];
+
+	memset(data, 'p', sizeof(data));
+	start();
+
+	fill_prm(&prm, l_port, NULL, 0);
+	s = open(&prm);
+	ASSERT_NE(s, nullptr);
+
+	udp_io_addr(da + 0, raddr, r_port);
+	udp_io_addr(da + 1, "192.0.0.3", r_port);
+	memset(&d6, 0, sizeof(d6));
+	d6.sin6_family = AF_INET6;
+
+	for (i = 0; i != RTE_DIM(m); i++) {
+		m[i] = gen_data(data, sizeof(data));
+		ASSERT_NE(m[i], nullptr);
+		pda[i] = (const struct sockaddr *)da;
+	}
+
+	/* invalid address: packets before it are sent */
+	pda[2] = (const struct sockaddr *)&d6;
+	rte_errno = 0;
+	EXPECT_EQ(tle_udp_stream_send_multi(s, m, RTE_DIM(m), pda), 2U);
+	EXPECT_EQ(rte_errno, EINVAL);
+	n = tx_pkts(pkt, RTE_DIM(pkt));
+	EXPECT_EQ(n, 2U);
+	udp_io_free(pkt, n);
+
+	/* second packet goes to unreachable destination */
+	unreach = inet_addr("192.0.0.3");
+	pda[1] = (const struct sockaddr *)(da + 1);
+	rte_errno = 0;
+	EXPECT_EQ(tle_udp_stream_send_multi(s, m + 2, 2, pda), 1U);
+	EXPECT_EQ(rte_errno, ENOENT);
+	n = tx_pkts(pkt, RTE_DIM(pkt));
+	EXPECT_EQ(n, 1U);
+	udp_io_free(pkt, n);
+
+	/* nothing can be sent, packets stay with the caller */
+	rte_errno = 0;
+	EXPECT_EQ(tle_udp_stream_send_multi(s, m + 3, 1, pda + 1), 0U);
+	EXPECT_EQ(rte_errno, ENOENT);
+	EXPECT_EQ(tx_pkts(pkt, RTE_DIM(pkt)), 0U);
+	rte_pktmbuf_free(m[3]);
+}
+
+/* returns tags (first payload byte) of all datagrams received by stream */
+static std::string
+udp_io_recv_tags(struct tle_stream *s)
+{
+	uint32_t i, n;
+	std::string tags;
+	struct rte_mbuf *pkt[UDP_IO_BURST];
+
+	n = tle_udp_stream_recv(s, pkt, RTE_DIM(pkt));
+	for (i = 0; i != n; i++)
+		tags += rte_pktmbuf_mtod(pkt[i], char *)[0];
+	udp_io_free(pkt, n);
+	return tags;
+}
+
+TEST_F(test_tle_udp_io, udp_stream_conn_demux)
+{
+	uint32_t i;
+	struct rte_mbuf *pkt[6];
+	struct tle_stream *sc1, *sc2, *sw;
+	struct tle_udp_stream_param prm;
+
+	start();
+
+	fill_prm(&prm, l_port, NULL, 0);
+	sw = open(&prm);
+	ASSERT_NE(sw, nullptr);
+
+	/* connected streams share the same local port */
+	fill_prm(&prm, l_port, raddr, r_port);
+	sc1 = open(&prm);
+	ASSERT_NE(sc1, nullptr);
+	fill_prm(&prm, l_port, raddr, r_port + 1);
+	sc2 = open(&prm);
+	ASSERT_NE(sc2, nullptr);
+
+	pkt[0] = gen_pkt(raddr, r_port, l_port, "a", 1);
+	pkt[1] = gen_pkt(raddr, r_port + 1, l_port, "b", 1);
+	pkt[2] = gen_pkt(raddr, r_port + 2, l_port, "c", 1);
+	pkt[3] = gen_pkt("192.0.0.3", r_port, l_port, "d", 1);
+	pkt[4] = gen_pkt(raddr, r_port, l_port, "e", 1);
+	pkt[5] = gen_pkt(raddr, r_port + 1, l_port, "f", 1);
+	for (i = 0; i != RTE_DIM(pkt); i++)
+		ASSERT_NE(pkt[i], nullptr);
+
+	ASSERT_EQ(rx_pkts(pkt, RTE_DIM(pkt)), RTE_DIM(pkt));
+	EXPECT_EQ(udp_io_recv_tags(sc1), "ae");
+	EXPECT_EQ(udp_io_recv_tags(sc2), "bf");
+	EXPECT_EQ(udp_io_recv_tags(sw), "cd");
+
+	/* once connected stream is closed, its flow goes to the port owner */
+	ASSERT_EQ(tle_udp_stream_close(sc1), 0);
+	streams.erase(std::find(streams.begin(), streams.end(), sc1));
+
+	pkt[0] = gen_pkt(raddr, r_port, l_port, "g", 1);
+	pkt[1] = gen_pkt(raddr, r_port + 1, l_port, "h", 1);
+	for (i = 0; i != 2; i++)
+		ASSERT_NE(pkt[i], nullptr);
+
+	ASSERT_EQ(rx_pkts(pkt, 2), 2U);
+	EXPECT_EQ(udp_io_recv_tags(sc2), "h");
+	EXPECT_EQ(udp_io_recv_tags(sw), "g");
+}
+
+TEST_F(test_tle_udp_io, udp_stream_mcast_rx)
+{
+	uint32_t i;
+	int32_t rc;
+	struct rte_mbuf *pkt[2];
+	struct tle_stream *s1, *s2;
+	struct tle_udp_stream_param prm;
+	struct sockaddr_storage grp;
+	const char *gaddr = "224.0.0.10";
+
+	/* stream RX queue holds up to 3 datagrams. */
+	ctx_prm.max_stream_rbufs = 4;
+	start();
+
+	fill_prm(&prm, l_port, NULL, 0);
+	prm.rx_opts = TLE_UDP_RX_OPT_REUSEPORT;
+	s1 = open(&prm);
+	ASSERT_NE(s1, nullptr);
+	s2 = open(&prm);
+	ASSERT_NE(s2, nullptr);
+
+	udp_io_addr(&grp, gaddr, 0);
+	rc = tle_udp_stream_join(s1, (const struct sockaddr *)&grp);
+	ASSERT_EQ(rc, 0);
+	rc = tle_udp_stream_join(s2, (const struct sockaddr *)&grp);
+	ASSERT_EQ(rc, 0);
+
+	/* each member gets its own copy of the datagram. */
+	pkt[0] = gen_pkt(raddr, r_port, l_port, "a", 1, gaddr);
+	pkt[1] = gen_pkt(raddr, r_port, l_port, "b", 1, gaddr);
+	for (i = 0; i != RTE_DIM(pkt); i++)
+		ASSERT_NE(pkt[i], nullptr);
+	ASSERT_EQ(rx_pkts(pkt, 2), 2U);
+	EXPECT_EQ(udp_io_recv_tags(s1), "ab");
+
+	/* datagram accepted by at least one member is not rejected. */
+	pkt[0] = gen_pkt(raddr, r_port, l_port, "c", 1, gaddr);
+	pkt[1] = gen_pkt(raddr, r_port, l_port, "d", 1, gaddr);
+	for (i = 0; i != RTE_DIM(pkt); i++)
+		ASSERT_NE(pkt[i], nullptr);
+	ASSERT_EQ(rx_pkts(pkt, 2), 2U);
+
+	/* datagram nobody has room for is rejected. */
+	pkt[0] = gen_pkt(raddr, r_port, l_port, "e", 1, gaddr);
+	pkt[1] = gen_pkt(raddr, r_port, l_port, "f", 1, gaddr);
+	for (i = 0; i != RTE_DIM(pkt); i++)
+		ASSERT_NE(pkt[i], nullptr);
+	ASSERT_EQ(rx_pkts(pkt, 2), 1U);
+	ASSERT_EQ(rx_rc.size(), 1U);
+	EXPECT_EQ(rx_rc[0], ENOBUFS);
+
+	EXPECT_EQ(udp_io_recv_tags(s1), "cde");
+	EXPECT_EQ(udp_io_recv_tags(s2), "abc");
+
+	/* stream that left the group doesn't get its datagrams any more. */
+	rc = tle_udp_stream_leave(s1, (const struct sockaddr *)&grp);
+	ASSERT_EQ(rc, 0);
+
+	pkt[0] = gen_pkt(raddr, r_port, l_port, "g", 1, gaddr);
+	ASSERT_NE(pkt[0], nullptr);
+	ASSERT_EQ(rx_pkts(pkt, 1), 1U);
+	EXPECT_EQ(udp_io_recv_tags(s1), "");
+	EXPECT_EQ(udp_io_recv_tags(s2), "g");
+}
+
+/* number of flows (remote ports) sent to the reuseport group. */
+#define	UDP_IO_FLOWS	8
+
+/*
+ * checks that both datagrams of each flow (tagged by the flow)
+ * were delivered to one and the same member of the group.
+ */
+static void
+udp_io_check_flows(const std::string tags[], uint32_t num)
+{
+	uint32_t f, i, k, n;
+
+	for (f = 0; f != UDP_IO_FLOWS; f++) {
+		k = 0;
+		for (i = 0; i != num; i++) {
+			n = std::count(tags[i].begin(), tags[i].end(), 'a' + f);
+			EXPECT_TRUE(n == 0 || n == 2) << "flow " << f;
+			k += (n != 0);
+		}
+		EXPECT_EQ(k, 1U) << "flow " << f;
+	}
+}
+
+TEST_F(test_tle_udp_io, udp_stream_reuseport_spread)
+{
+	char tag;
+	uint32_t f, i;
+	std::string tags[3];
+	struct rte_mbuf *pkt[2 * UDP_IO_FLOWS];
+	struct tle_stream *s[RTE_DIM(tags)];
+	struct tle_udp_stream_param prm;
+
+	start();
+
+	fill_prm(&prm, l_port, NULL, 0);
+	prm.rx_opts = TLE_UDP_RX_OPT_REUSEPORT;
+	for (i = 0; i != RTE_DIM(s); i++) {
+		s[i] = open(&prm);
+		ASSERT_NE(s[i], nullptr);
+	}
+
+	/* two datagrams per flow, flows are interleaved. */
+	for (i = 0; i != RTE_DIM(pkt); i++) {
+		f = i % UDP_IO_FLOWS;
+		tag = 'a' + f;
+		pkt[i] = gen_pkt(raddr, r_port + f, l_port, &tag, 1);
+		ASSERT_NE(pkt[i], nullptr);
+	}
+	ASSERT_EQ(rx_pkts(pkt, RTE_DIM(pkt)), RTE_DIM(pkt));
+
+	/* flows are spread over all members, each flow sticks to one. */
+	for (i = 0; i != RTE_DIM(s); i++) {
+		tags[i] = udp_io_recv_tags(s[i]);
+		EXPECT_NE(tags[i], "") << "member " << i;
+	}
+	udp_io_check_flows(tags, RTE_DIM(tags));
+
+	/* group survives its owner, port moves to the other member. */
+	ASSERT_EQ(tle_udp_stream_close(s[0]), 0);
+	streams.erase(std::find(streams.begin(), streams.end(), s[0]));
+
+	for (i = 0; i != RTE_DIM(pkt); i++) {
+		f = i % UDP_IO_FLOWS;
+		tag = 'a' + f;
+		pkt[i] = gen_pkt(raddr, r_port + f, l_port, &tag, 1);
+		ASSERT_NE(pkt[i], nullptr);
+	}
+	ASSERT_EQ(rx_pkts(pkt, RTE_DIM(pkt)), RTE_DIM(pkt));
+
+	for (i = 1; i != RTE_DIM(s); i++) {
+		tags[i - 1] = udp_io_recv_tags(s[i]);
+		EXPECT_NE(tags[i - 1], "") << "member " << i;
+	}
+	udp_io_check_flows(tags, RTE_DIM(tags) - 1);
+}
+
+TEST_F(test_tle_udp_io, udp_stream_frag_rx)
+{
+	uint32_t i, n;
+	uint8_t data[1000], rd[sizeof(data)];
+	struct rte_mbuf *frag[4], *pkt[UDP_IO_BURST];
+	struct rte_ipv4_hdr *ip4h;
+	struct tle_stream *s;
+	struct tle_udp_stream_param prm;
+
+	for (i = 0; i != sizeof(data); i++)
+		data[i] = i;
+
+	ctx_prm.frag_tbl_size = 0x10;
+	start();
+
+	fill_prm(&prm, l_port, NULL, 0);
+	s = open(&prm);
+	ASSERT_NE(s, nullptr);
+
+	pkt[0] = gen_pkt(raddr, r_port, l_port, data, sizeof(data));
+	ASSERT_NE(pkt[0], nullptr);
+	ASSERT_EQ(gen_ipv4_frags(pkt[0], frag, RTE_DIM(frag), 400), 3U);
+
+	/* fragments arrive out of order and in different bursts. */
+	pkt[0] = frag[2];
+	pkt[1] = gen_pkt(raddr, r_port, l_port, "x", 1);
+	pkt[2] = frag[0];
+	ASSERT_NE(pkt[1], nullptr);
+	ASSERT_EQ(rx_pkts(pkt, 3), 3U);
+	EXPECT_EQ(udp_io_recv_tags(s), "x");
+
+	ASSERT_EQ(rx_pkts(frag + 1, 1), 1U);
+
+	n = tle_udp_stream_recv(s, pkt, RTE_DIM(pkt));
+	ASSERT_EQ(n, 1U);
+	ASSERT_EQ(pkt[0]->pkt_len, sizeof(data));
+	EXPECT_EQ(memcmp(rte_pktmbuf_read(pkt[0], 0, sizeof(rd), rd), data,
+		sizeof(data)), 0);
+	udp_io_free(pkt, n);
+
+	/* fragment of another protocol is rejected. */
+	pkt[0] = gen_pkt(raddr, r_port, l_port, data, sizeof(data));
+	ASSERT_NE(pkt[0], nullptr);
+	ASSERT_EQ(gen_ipv4_frags(pkt[0], frag, RTE_DIM(frag), 400), 3U);
+	for (i = 0; i != 3; i++) {
+		ip4h = rte_pktmbuf_mtod_offset(frag[i], struct rte_ipv4_hdr *,
+			frag[i]->l2_len);
+		ip4h->next_proto_id = IPPROTO_TCP;
+		ip4h->hdr_checksum = 0;
+		ip4h->hdr_checksum = rte_ipv4_cksum(ip4h);
+	}
+	ASSERT_EQ(rx_pkts(frag, 3), 0U);
+	ASSERT_EQ(rx_rc.size(), 3U);
+	for (i = 0; i != 3; i++)
+		EXPECT_EQ(rx_rc[i], EINVAL);
+	EXPECT_EQ(udp_io_recv_tags(s), "");
+}
+
+static void
+udp_io_count_cb(void *data, struct tle_stream *s)
+{
+	RTE_SET_USED(s);
+	(*(uint32_t *)data)++;
+}
+
+TEST_F(test_tle_udp_io, udp_stream_cb_defer)
+{
+	uint32_t nb_cb;
+	struct rte_mbuf *pkt[1];
+	struct tle_stream *s, *ns;
+	struct tle_udp_stream_param prm;
+
+	ctx_prm.flags |= TLE_CTX_FLAG_CB_DEFER;
+	start();
+
+	/* nothing was deferred yet. */
+	EXPECT_EQ(tle_ctx_cb_dispatch(ctx, UINT32_MAX), 0U);
+	EXPECT_EQ(tle_ctx_cb_dispatch(NULL, UINT32_MAX), 0U);
+
+	nb_cb = 0;
+	fill_prm(&prm, l_port, NULL, 0);
+	prm.recv_cb.func = udp_io_count_cb;
+	prm.recv_cb.data = &nb_cb;
+	s = open(&prm);
+	ASSERT_NE(s, nullptr);
+
+	/* callback is not invoked from within tle_udp_rx_bulk(). */
+	pkt[0] = gen_pkt(raddr, r_port, l_port, "a", 1);
+	ASSERT_NE(pkt[0], nullptr);
+	ASSERT_EQ(rx_pkts(pkt, 1), 1U);
+	EXPECT_EQ(nb_cb, 0U);
+
+	EXPECT_EQ(tle_ctx_cb_dispatch(ctx, UINT32_MAX), 1U);
+	EXPECT_EQ(nb_cb, 1U);
+	EXPECT_EQ(tle_ctx_cb_dispatch(ctx, UINT32_MAX), 0U);
+	EXPECT_EQ(udp_io_recv_tags(s), "a");
+
+	/* callback deferred for the closed stream is not invoked. */
+	pkt[0] = gen_pkt(raddr, r_port, l_port, "b", 1);
+	ASSERT_NE(pkt[0], nullptr);
+	ASSERT_EQ(rx_pkts(pkt, 1), 1U);
+
+	ASSERT_EQ(tle_udp_stream_close(s), 0);
+	streams.erase(std::find(streams.begin(), streams.end(), s));
+
+	/* even if the same stream object was reopened meanwhile. */
+	ns = open(&prm);
+	ASSERT_EQ(ns, s);
+
+	EXPECT_EQ(tle_ctx_cb_dispatch(ctx, UINT32_MAX), 1U);
+	EXPECT_EQ(nb_cb, 1U);
+
+	/* new stream gets its own callbacks. */
+	pkt[0] = gen_pkt(raddr, r_port, l_port, "c", 1);
+	ASSERT_NE(pkt[0], nullptr);
+	ASSERT_EQ(rx_pkts(pkt, 1), 1U);
+	EXPECT_EQ(tle_ctx_cb_dispatch(ctx, UINT32_MAX), 1U);
+	EXPECT_EQ(nb_cb, 2U);
+	EXPECT_EQ(udp_io_recv_tags(ns), "c");
+
+	/* close/reopen churn doesn't pile up entries in the queue. */
+	for (uint32_t i = 0; i != 4 * UDP_IO_MAX_STREAMS; i++) {
+		pkt[0] = gen_pkt(raddr, r_port, l_port, "d", 1);
+		ASSERT_NE(pkt[0], nullptr);
+		ASSERT_EQ(rx_pkts(pkt, 1), 1U);
+
+		ASSERT_EQ(tle_udp_stream_close(ns), 0);
+		streams.erase(std::find(streams.begin(), streams.end(), ns));
+		ns = open(&prm);
+		ASSERT_EQ(ns, s);
+	}
+
+	EXPECT_EQ(tle_ctx_cb_dispatch(ctx, UINT32_MAX), 1U);
+	EXPECT_EQ(nb_cb, 2U);
+
+	/* reopened stream is notified through the entry still queued. */
+	pkt[0] = gen_pkt(raddr, r_port, l_port, "e", 1);
+	ASSERT_NE(pkt[0], nullptr);
+	ASSERT_EQ(rx_pkts(pkt, 1), 1U);
+
+	ASSERT_EQ(tle_udp_stream_close(ns), 0);
+	streams.erase(std::find(streams.begin(), streams.end(), ns));
+	ns = open(&prm);
+	ASSERT_EQ(ns, s);
+
+	pkt[0] = gen_pkt(raddr, r_port, l_port, "f", 1);
+	ASSERT_NE(pkt[0], nullptr);
+	ASSERT_EQ(rx_pkts(pkt, 1), 1U);
+
+	EXPECT_EQ(tle_ctx_cb_dispatch(ctx, UINT32_MAX), 1U);
+	EXPECT_EQ(nb_cb, 3U);
+	EXPECT_EQ(udp_io_recv_tags(ns), "f");
+}
+
+TEST_F(test_tle_udp_io, udp_stream_drb_pool)
+{
+	uint32_t nb_cb;
+	struct rte_mbuf *pkt[UDP_IO_BURST];
+	struct tle_stream *s1, *s2;
+	struct tle_udp_stream_param prm;
+
+	/* one datagram per drb, two drbs for the whole ctx. */
+	ctx_prm.send_bulk_size = 1;
+	ctx_prm.max_drbs = 2;
+	start();
+
+	fill_prm(&prm, l_port, NULL, 0);
+	s1 = open(&prm);
+	ASSERT_NE(s1, nullptr);
+
+	nb_cb = 0;
+	fill_prm(&prm, l_port + 1, NULL, 0);
+	prm.send_cb.func = udp_io_count_cb;
+	prm.send_cb.data = &nb_cb;
+	s2 = open(&prm);
+	ASSERT_NE(s2, nullptr);
+
+	/* s1 takes all drbs, so sending blocks for both streams. */
+	EXPECT_EQ(send(s1, raddr, r_port, "a", 1), 1U);
+	EXPECT_EQ(send(s1, raddr, r_port, "b", 1), 1U);
+	EXPECT_EQ(send(s1, raddr, r_port, "c", 1), 0U);
+	EXPECT_EQ(send(s2, raddr, r_port, "d", 1), 0U);
+	EXPECT_EQ(nb_cb, 0U);
+
+	/* drb of s1 is back in the pool, s2 is notified and resumes. */
+	ASSERT_EQ(tx_pkts(pkt, 1), 1U);
+	udp_io_free(pkt, 1);
+	EXPECT_EQ(nb_cb, 1U);
+	EXPECT_EQ(send(s2, raddr, r_port, "d", 1), 1U);
+
+	ASSERT_EQ(tx_pkts(pkt, RTE_DIM(pkt)), 2U);
+	udp_io_free(pkt, 2);
+	EXPECT_EQ(send(s1, raddr, r_port, "c", 1), 1U);
+}
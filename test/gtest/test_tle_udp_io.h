@@ -0,0 +1,407 @@
+/*
+ * Copyright (c) 2016  Intel Corporation.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TEST_TLE_UDP_IO_H_
+#define TEST_TLE_UDP_IO_H_
+
+#include <arpa/inet.h>
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <rte_errno.h>
+#include <rte_udp.h>
+
+#include <tle_ctx.h>
+#include <tle_udp.h>
+
+#include "test_common.h"
+
+/*
+ * Fixture for the UDP data path tests: the test plays the role of
+ * remote peers by feeding hand-made datagrams into tle_udp_rx_bulk()
+ * and inspecting what tle_udp_tx_bulk() returns.
+ */
+
+#define UDP_IO_MAX_STREAMS	0x10
+#define UDP_IO_RBUFS		0x100
+#define UDP_IO_SBUFS		0x100
+#define UDP_IO_BURST		0x40
+#define UDP_IO_MTU		(RTE_ETHER_MTU + sizeof(struct rte_ether_hdr))
+
+static const struct tle_ctx_param udp_io_ctx_prm_tmpl = {
+	.socket_id = SOCKET_ID_ANY,
+	.proto = TLE_PROTO_UDP,
+	.max_streams = UDP_IO_MAX_STREAMS,
+	.free_streams = {
+		.min = 0,
+		.max = 0,
+	},
+	.max_stream_rbufs = UDP_IO_RBUFS,
+	.max_stream_sbufs = UDP_IO_SBUFS,
+};
+
+static inline struct rte_udp_hdr *
+udp_io_hdr(const struct rte_mbuf *m)
+{
+	return rte_pktmbuf_mtod_offset(m, struct rte_udp_hdr *,
+		m->l2_len + m->l3_len);
+}
+
+static inline struct rte_ipv4_hdr *
+udp_io_ip4(const struct rte_mbuf *m)
+{
+	return rte_pktmbuf_mtod_offset(m, struct rte_ipv4_hdr *, m->l2_len);
+}
+
+/* payload length of the outgoing datagram. */
+static inline uint32_t
+udp_io_plen(const struct rte_mbuf *m)
+{
+	return m->pkt_len - m->l2_len - m->l3_len - sizeof(struct rte_udp_hdr);
+}
+
+/* copies up to *len* payload bytes of the datagram into *buf*. */
+static inline uint32_t
+udp_io_data(const struct rte_mbuf *m, void *buf, uint32_t len)
+{
+	uint32_t n, ofs;
+	const void *p;
+
+	ofs = m->l2_len + m->l3_len + sizeof(struct rte_udp_hdr);
+	n = RTE_MIN(len, m->pkt_len - ofs);
+	p = rte_pktmbuf_read(m, ofs, n, buf);
+	if (p != buf)
+		memcpy(buf, p, n);
+	return n;
+}
+
+/* checks both IPv4 header and UDP checksums of an outgoing datagram. */
+static inline int
+udp_io_cksum_valid(const struct rte_mbuf *m)
+{
+	uint16_t cs;
+	uint32_t ofs, sum;
+	const struct rte_ipv4_hdr *ip4h;
+
+	ip4h = udp_io_ip4(m);
+	if (rte_raw_cksum(ip4h, m->l3_len) != 0xffff)
+		return 0;
+
+	ofs = m->l2_len + m->l3_len;
+	if (rte_raw_cksum_mbuf(m, ofs, m->pkt_len - ofs, &cs) != 0)
+		return 0;
+
+	sum = cs + rte_ipv4_phdr_cksum(ip4h, 0);
+	sum = (sum & 0xffff) + (sum >> 16);
+	sum = (sum & 0xffff) + (sum >> 16);
+	return sum == 0xffff;
+}
+
+static inline void
+udp_io_free(struct rte_mbuf *pkt[], uint32_t num)
+{
+	uint32_t i;
+
+	for (i = 0; i != num; i++)
+		rte_pktmbuf_free(pkt[i]);
+}
+
+/* fills IPv4 socket address, NULL *addr* means INADDR_ANY. */
+static inline void
+udp_io_addr(struct sockaddr_storage *ss, const char *addr, uint16_t port)
+{
+	struct sockaddr_in *in4;
+
+	in4 = (struct sockaddr_in *)ss;
+	memset(in4, 0, sizeof(*in4));
+	in4->sin_family = AF_INET;
+	in4->sin_port = htons(port);
+	if (addr != NULL)
+		inet_pton(AF_INET, addr, &in4->sin_addr);
+}
+
+class test_tle_udp_io: public ::testing::Test {
+public:
+	static int lookup4(void *opaque, uint64_t sdata,
+		const struct in_addr *addr, struct tle_dest *res);
+
+	/* creates ctx and dev, after the test adjusted ctx_prm/dev_prm. */
+	void start(void);
+	void fill_prm(struct tle_udp_stream_param *prm, uint16_t lport,
+		const char *ra, uint16_t rport);
+	struct tle_stream *open(const struct tle_udp_stream_param *prm);
+	struct rte_mbuf *gen_data(const void *data, uint32_t len);
+	uint32_t send(struct tle_stream *s, const char *ra, uint16_t rport,
+		const void *data, uint32_t len);
+	struct rte_mbuf *gen_pkt(const char *ra, uint16_t rport,
+		uint16_t lport, const void *data, uint32_t len,
+		const char *la = NULL);
+	uint32_t rx_pkts(struct rte_mbuf *pkt[], uint32_t num);
+	uint32_t tx_pkts(struct rte_mbuf *pkt[], uint32_t num);
+
+protected:
+	virtual void SetUp(void)
+	{
+		laddr = "192.0.0.1";
+		raddr = "192.0.0.2";
+		l_port = 10000;
+		r_port = 20000;
+
+		ctx_prm = udp_io_ctx_prm_tmpl;
+		ctx_prm.lookup4 = lookup4;
+		ctx_prm.lookup4_data = this;
+		ctx_prm.lookup6 = dummy_lookup6;
+
+		memset(&dev_prm, 0, sizeof(dev_prm));
+		inet_pton(AF_INET, laddr, &dev_prm.local_addr4);
+
+		ctx = NULL;
+		dev = NULL;
+		dst_mtu = UDP_IO_MTU;
+		nb_lookup = 0;
+		unreach = INADDR_NONE;
+	}
+
+	virtual void TearDown(void)
+	{
+		uint32_t i, n;
+		struct rte_mbuf *pkt[UDP_IO_BURST];
+
+		for (i = 0; i != streams.size(); i++)
+			tle_udp_stream_close(streams[i]);
+		streams.clear();
+
+		if (ctx != NULL) {
+			do {
+				n = tx_pkts(pkt, RTE_DIM(pkt));
+				udp_io_free(pkt, n);
+			} while (n != 0);
+			tle_del_dev(dev);
+			tle_ctx_destroy(ctx);
+		}
+	}
+
+	struct tle_ctx *ctx;
+	struct tle_dev *dev;
+	struct tle_ctx_param ctx_prm;
+	struct tle_dev_param dev_prm;
+	std::vector<struct tle_stream *> streams;
+	std::vector<int32_t> rx_rc;
+
+	const char *laddr;
+	const char *raddr;
+	uint16_t l_port;
+	uint16_t r_port;
+	uint32_t dst_mtu;
+	uint32_t nb_lookup;
+	in_addr_t unreach;  /* lookup4 fails for that address */
+};
+
+int
+test_tle_udp_io::lookup4(void *opaque, uint64_t sdata,
+	const struct in_addr *addr, struct tle_dest *res)
+{
+	struct rte_ether_hdr *eth;
+	struct rte_ipv4_hdr *ip4h;
+	test_tle_udp_io *t;
+
+	RTE_SET_USED(sdata);
+
+	t = (test_tle_udp_io *)opaque;
+	t->nb_lookup++;
+
+	if (addr->s_addr == t->unreach)
+		return -ENOENT;
+
+	res->dev = t->dev;
+	res->mtu = t->dst_mtu;
+	res->l2_len = sizeof(*eth);
+	res->l3_len = sizeof(*ip4h);
+	res->head_mp = mbuf_pool;
+
+	eth = (struct rte_ether_hdr *)res->hdr;
+	memset(eth, 0, sizeof(*eth));
+	eth->ether_type = rte_cpu_to_be_16(RTE_ETHER_TYPE_IPV4);
+
+	ip4h = (struct rte_ipv4_hdr *)(eth + 1);
+	memset(ip4h, 0, sizeof(*ip4h));
+	ip4h->version_ihl = 4 << 4 | sizeof(*ip4h) / RTE_IPV4_IHL_MULTIPLIER;
+	ip4h->time_to_live = 64;
+	ip4h->next_proto_id = IPPROTO_UDP;
+	return 0;
+}
+
+void
+test_tle_udp_io::start(void)
+{
+	ctx = tle_ctx_create(&ctx_prm);
+	ASSERT_NE(ctx, (void *)NULL);
+	dev = tle_add_dev(ctx, &dev_prm);
+	ASSERT_NE(dev, (void *)NULL);
+}
+
+/*
+ * stream bound to *lport*, NULL *ra* means any remote address,
+ * otherwise stream is connected to *ra*:*rport*.
+ */
+void
+test_tle_udp_io::fill_prm(struct tle_udp_stream_param *prm, uint16_t lport,
+	const char *ra, uint16_t rport)
+{
+	memset(prm, 0, sizeof(*prm));
+	udp_io_addr(&prm->local_addr, (ra != NULL) ? laddr : NULL, lport);
+	udp_io_addr(&prm->remote_addr, ra, rport);
+}
+
+struct tle_stream *
+test_tle_udp_io::open(const struct tle_udp_stream_param *prm)
+{
+	struct tle_stream *s;
+
+	s = tle_udp_stream_open(ctx, prm);
+	if (s != NULL)
+		streams.push_back(s);
+	return s;
+}
+
+/* builds a packet to pass to tle_udp_stream_send(). */
+struct rte_mbuf *
+test_tle_udp_io::gen_data(const void *data, uint32_t len)
+{
+	struct rte_mbuf *m;
+	void *p;
+
+	m = rte_pktmbuf_alloc(mbuf_pool);
+	if (m == NULL)
+		return NULL;
+
+	p = rte_pktmbuf_append(m, len);
+	if (p == NULL) {
+		rte_pktmbuf_free(m);
+		return NULL;
+	}
+
+	memcpy(p, data, len);
+	return m;
+}
+
+/* sends one datagram to *ra*:*rport*, returns number of queued ones. */
+uint32_t
+test_tle_udp_io::send(struct tle_stream *s, const char *ra, uint16_t rport,
+	const void *data, uint32_t len)
+{
+	uint32_t n;
+	struct rte_mbuf *m;
+	struct sockaddr_storage da;
+
+	m = gen_data(data, len);
+	if (m == NULL)
+		return 0;
+
+	udp_io_addr(&da, ra, rport);
+	n = tle_udp_stream_send(s, &m, 1, (const struct sockaddr *)&da);
+	if (n == 0)
+		rte_pktmbuf_free(m);
+	return n;
+}
+
+/*
+ * builds a datagram the remote peer *ra* sends to the local *lport*,
+ * destination address is *la* or local address of the device if NULL.
+ */
+struct rte_mbuf *
+test_tle_udp_io::gen_pkt(const char *ra, uint16_t rport, uint16_t lport,
+	const void *data, uint32_t len, const char *la)
+{
+	uint32_t l2, l3, l4;
+	struct rte_mbuf *m;
+	struct rte_ether_hdr *eth;
+	struct rte_ipv4_hdr *ip4h;
+	struct rte_udp_hdr *uh;
+
+	l2 = sizeof(*eth);
+	l3 = sizeof(*ip4h);
+	l4 = sizeof(*uh);
+
+	m = rte_pktmbuf_alloc(mbuf_pool);
+	if (m == NULL)
+		return NULL;
+
+	eth = (struct rte_ether_hdr *)rte_pktmbuf_append(m, l2 + l3 + l4 + len);
+	if (eth == NULL) {
+		rte_pktmbuf_free(m);
+		return NULL;
+	}
+
+	memset(eth, 0, l2);
+	eth->ether_type = rte_cpu_to_be_16(RTE_ETHER_TYPE_IPV4);
+
+	ip4h = (struct rte_ipv4_hdr *)(eth + 1);
+	memset(ip4h, 0, l3);
+	ip4h->version_ihl = 4 << 4 | l3 / RTE_IPV4_IHL_MULTIPLIER;
+	ip4h->total_length = rte_cpu_to_be_16(l3 + l4 + len);
+	ip4h->time_to_live = 64;
+	ip4h->next_proto_id = IPPROTO_UDP;
+	inet_pton(AF_INET, ra, &ip4h->src_addr);
+	inet_pton(AF_INET, (la != NULL) ? la : laddr, &ip4h->dst_addr);
+
+	uh = (struct rte_udp_hdr *)(ip4h + 1);
+	uh->src_port = htons(rport);
+	uh->dst_port = htons(lport);
+	uh->dgram_len = rte_cpu_to_be_16(l4 + len);
+	uh->dgram_cksum = 0;
+	if (len != 0)
+		memcpy(uh + 1, data, len);
+
+	uh->dgram_cksum = rte_ipv4_udptcp_cksum(ip4h, uh);
+	ip4h->hdr_checksum = rte_ipv4_cksum(ip4h);
+
+	m->packet_type = RTE_PTYPE_L2_ETHER | RTE_PTYPE_L3_IPV4 |
+		RTE_PTYPE_L4_UDP;
+	m->l2_len = l2;
+	m->l3_len = l3;
+	m->l4_len = l4;
+	return m;
+}
+
+/*
+ * passes packets to tle_udp_rx_bulk(), rejected ones are freed,
+ * their error codes are stored in *rx_rc*.
+ * returns number of packets accepted by the stack.
+ */
+uint32_t
+test_tle_udp_io::rx_pkts(struct rte_mbuf *pkt[], uint32_t num)
+{
+	uint32_t k, n;
+	int32_t rc[num];
+	struct rte_mbuf *rp[num];
+
+	n = tle_udp_rx_bulk(dev, pkt, rp, rc, num);
+
+	rx_rc.clear();
+	for (k = 0; k != num - n; k++)
+		rx_rc.push_back(rc[k]);
+	udp_io_free(rp, num - n);
+	return n;
+}
+
+uint32_t
+test_tle_udp_io::tx_pkts(struct rte_mbuf *pkt[], uint32_t num)
+{
+	return tle_udp_tx_bulk(dev, pkt, num);
+}
+
+#endif /* TEST_TLE_UDP_IO_H_ */
@@ -75,6 +75,144 @@ TEST_F(test_tle_udp_stream, stream_test_open_duplicate)
 	EXPECT_EQ(rte_errno, EEXIST);
 }
 
+TEST_F(test_tle_udp_stream, stream_test_open_connected_same_port)
+{
+	stream = tle_udp_stream_open(ctx,
+			(const struct tle_udp_stream_param *)&stream_prm);
+	EXPECT_NE(stream, nullptr);
+	streams.push_back(stream);
+
+	/* same local port, different remote port */
+	ip4_addr = (struct sockaddr_in *) &stream_prm.remote_addr;
+	ip4_addr->sin_port = htons(port + 1);
+	stream = tle_udp_stream_open(ctx,
+			(const struct tle_udp_stream_param *)&stream_prm);
+	EXPECT_NE(stream, nullptr);
+	streams.push_back(stream);
+}
+
+TEST_F(test_tle_udp_stream, stream_test_open_connected_and_bound)
+{
+	stream = tle_udp_stream_open(ctx,
+			(const struct tle_udp_stream_param *)&stream_prm);
+	EXPECT_NE(stream, nullptr);
+	streams.push_back(stream);
+
+	/* stream bound to the same local port, any remote */
+	ip4_addr = (struct sockaddr_in *) &stream_prm.remote_addr;
+	ip4_addr->sin_port = 0;
+	ip4_addr->sin_addr.s_addr = INADDR_ANY;
+	stream = tle_udp_stream_open(ctx,
+			(const struct tle_udp_stream_param *)&stream_prm);
+	EXPECT_NE(stream, nullptr);
+	streams.push_back(stream);
+
+	stream = tle_udp_stream_open(ctx,
+			(const struct tle_udp_stream_param *)&stream_prm);
+	EXPECT_EQ(stream, nullptr);
+	EXPECT_EQ(rte_errno, EEXIST);
+}
+
+TEST_F(test_tle_udp_stream, stream_test_open_reuseport)
+{
+	struct tle_stream *ls;
+
+	/* port groups are for streams not connected to remote peer */
+	ip4_addr = (struct sockaddr_in *) &stream_prm.remote_addr;
+	ip4_addr->sin_port = 0;
+	ip4_addr->sin_addr.s_addr = INADDR_ANY;
+	stream_prm.rx_opts = TLE_UDP_RX_OPT_REUSEPORT;
+
+	ls = tle_udp_stream_open(ctx,
+			(const struct tle_udp_stream_param *)&stream_prm);
+	EXPECT_NE(ls, nullptr);
+
+	stream = tle_udp_stream_open(ctx,
+			(const struct tle_udp_stream_param *)&stream_prm);
+	EXPECT_NE(stream, nullptr);
+	streams.push_back(stream);
+
+	/* close port owner, remaining member should keep the port */
+	ret = tle_udp_stream_close(ls);
+	EXPECT_EQ(ret, 0);
+
+	stream = tle_udp_stream_open(ctx,
+			(const struct tle_udp_stream_param *)&stream_prm);
+	EXPECT_NE(stream, nullptr);
+	streams.push_back(stream);
+
+	/* stream without the option can't share the port */
+	stream_prm.rx_opts = 0;
+	stream = tle_udp_stream_open(ctx,
+			(const struct tle_udp_stream_param *)&stream_prm);
+	EXPECT_EQ(stream, nullptr);
+	EXPECT_EQ(rte_errno, EEXIST);
+}
+
+TEST_F(test_tle_udp_stream, stream_test_mcast_join_leave)
+{
+	struct sockaddr_in grp;
+
+	memset(&grp, 0, sizeof(grp));
+	grp.sin_family = AF_INET;
+	inet_pton(AF_INET, "239.1.1.1", &grp.sin_addr);
+
+	/* connected stream can't join */
+	stream = tle_udp_stream_open(ctx,
+			(const struct tle_udp_stream_param *)&stream_prm);
+	EXPECT_NE(stream, nullptr);
+	ret = tle_udp_stream_join(stream, (const struct sockaddr *)&grp);
+	EXPECT_EQ(ret, -EINVAL);
+	ret = tle_udp_stream_close(stream);
+	EXPECT_EQ(ret, 0);
+
+	/* membership is for streams with wildcard addresses */
+	ip4_addr = (struct sockaddr_in *) &stream_prm.local_addr;
+	ip4_addr->sin_addr.s_addr = INADDR_ANY;
+	ip4_addr = (struct sockaddr_in *) &stream_prm.remote_addr;
+	ip4_addr->sin_port = 0;
+	ip4_addr->sin_addr.s_addr = INADDR_ANY;
+
+	stream = tle_udp_stream_open(ctx,
+			(const struct tle_udp_stream_param *)&stream_prm);
+	EXPECT_NE(stream, nullptr);
+	streams.push_back(stream);
+
+	ret = tle_udp_stream_join(stream, (const struct sockaddr *)&grp);
+	EXPECT_EQ(ret, 0);
+	ret = tle_udp_stream_join(stream, (const struct sockaddr *)&grp);
+	EXPECT_EQ(ret, -EEXIST);
+
+	/* unicast address is not a group */
+	inet_pton(AF_INET, "10.0.0.1", &grp.sin_addr);
+	ret = tle_udp_stream_join(stream, (const struct sockaddr *)&grp);
+	EXPECT_EQ(ret, -EINVAL);
+
+	inet_pton(AF_INET, "239.1.1.1", &grp.sin_addr);
+	ret = tle_udp_stream_leave(stream, (const struct sockaddr *)&grp);
+	EXPECT_EQ(ret, 0);
+	ret = tle_udp_stream_leave(stream, (const struct sockaddr *)&grp);
+	EXPECT_EQ(ret, -ENOENT);
+}
+
+TEST_F(test_tle_udp_stream, stream_test_open_gro)
+{
+	stream_prm.rx_opts = TLE_UDP_RX_OPT_GRO;
+	stream = tle_udp_stream_open(ctx,
+			(const struct tle_udp_stream_param *)&stream_prm);
+	EXPECT_NE(stream, nullptr);
+	streams.push_back(stream);
+}
+
+TEST_F(test_tle_udp_stream, stream_test_open_invalid_rx_opts)
+{
+	stream_prm.rx_opts = UINT32_MAX;
+	stream = tle_udp_stream_open(ctx,
+			(const struct tle_udp_stream_param *)&stream_prm);
+	EXPECT_EQ(stream, nullptr);
+	EXPECT_EQ(rte_errno, EINVAL);
+}
+
 TEST_F(test_tle_udp_stream, stream_test_close)
 {
 	stream = tle_udp_stream_open(ctx,
@@ -118,6 +256,21 @@ TEST_F(test_tle_udp_stream, stream_get_param)
 	EXPECT_EQ(ret, 0);
 }
 
+TEST_F(test_tle_udp_stream, stream_get_param_gso)
+{
+	struct tle_udp_stream_param prm;
+
+	stream_prm.gso_size = 1200;
+	stream = tle_udp_stream_open(ctx,
+			(const struct tle_udp_stream_param *)&stream_prm);
+	EXPECT_NE(stream, nullptr);
+	streams.push_back(stream);
+
+	ret = tle_udp_stream_get_param(stream, &prm);
+	EXPECT_EQ(ret, 0);
+	EXPECT_EQ(prm.gso_size, 1200);
+}
+
 TEST_F(test_tle_udp_stream, stream_get_param_streamnull)
 {
 	struct tle_udp_stream_param prm;